@@ -38,7 +38,7 @@ if not exist "%OUTPUT_DIR%" (
 )
 
 REM =====================================================================
-REM Find and list all .vert and .frag shader files
+REM Find and list all .vert, .frag and .comp shader files
 REM =====================================================================
 echo.
 echo Searching for shader files in "%SHADER_DIR%"...
@@ -60,6 +60,13 @@ for %%f in ("%SHADER_DIR%\*.frag") do (
     )
 )
 
+REM Collect all .comp files
+for %%f in ("%SHADER_DIR%\*.comp") do (
+    if exist "%%f" (
+        set "shaderList=!shaderList! "%%f""
+    )
+)
+
 REM Check if any shaders found
 if "!shaderList!"=="" (
     echo No shader files found in "%SHADER_DIR%".
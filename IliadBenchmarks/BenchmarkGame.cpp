@@ -0,0 +1,83 @@
+﻿#include "BenchmarkGame.h"
+#include "BenchmarkScene.h"
+
+#include <algorithm>
+#include <utility>
+
+BenchmarkGame::BenchmarkGame(std::string name, uint32_t objectCount, uint32_t seed, const CameraPath& cameraPath, uint32_t warmupFrames, bool pipelined)
+	: m_Name(std::move(name))
+	, m_ObjectCount(objectCount)
+	, m_Seed(seed)
+	, m_CameraPath(cameraPath)
+	, m_WarmupFrames(warmupFrames)
+	, m_Pipelined(pipelined)
+{
+}
+
+void BenchmarkGame::OnGamePreparing()
+{
+	// The sample project setup without dynamic resolution, a changing render extent would make runs incomparable
+	SetRenderPath(ili::RenderPath::Forward);
+	SetDepthPrePassEnabled(true);
+	SetOcclusionCullingEnabled(true);
+	SetPipelinedRenderingEnabled(m_Pipelined);
+}
+
+void BenchmarkGame::InitializeGame()
+{
+	m_pCurrentScene = m_SceneManager.CreateScene<BenchmarkScene>("Benchmark", m_ObjectCount, m_Seed);
+	m_DeviceName = m_Device->Properties.deviceName;
+}
+
+void BenchmarkGame::OnUpdate(ili::GameObject* viewerObject, float deltaTime)
+{
+	m_CameraPath.Apply(m_PathTime, *viewerObject);
+	m_PathTime += deltaTime;
+}
+
+void BenchmarkGame::OnFrameSubmitted()
+{
+	const auto now = std::chrono::steady_clock::now();
+	const float cpuFrameTime = std::chrono::duration<float, std::chrono::milliseconds::period>(now - m_LastSubmitTime).count();
+	m_LastSubmitTime = now;
+
+	// The first frame has no previous submission to measure against, so it is always part of the warmup
+	if (m_SubmittedFrames++ < std::max(m_WarmupFrames, 1u)) return;
+
+	m_CpuFrameTimes.push_back(cpuFrameTime);
+	m_RecordTimes.push_back(GetCommandRecordTime());
+	if (const float gpuFrameTime = GetGpuFrameTime(); gpuFrameTime > 0.f) m_GpuFrameTimes.push_back(gpuFrameTime);
+
+	m_TotalRenderStats += GetRenderStats();
+
+	uint64_t deviceLocalMemory{};
+	uint64_t hostMemory{};
+	for (const ili::MemoryHeapUsage& heap : m_Device->GetMemoryHeapUsage())
+	{
+		(heap.isDeviceLocal ? deviceLocalMemory : hostMemory) += heap.allocatedBytes;
+	}
+	m_PeakDeviceLocalMemory = std::max(m_PeakDeviceLocalMemory, deviceLocalMemory);
+	m_PeakHostMemory = std::max(m_PeakHostMemory, hostMemory);
+}
+
+BenchmarkResult BenchmarkGame::GetResult() const
+{
+	BenchmarkResult result{};
+	result.name = m_Name;
+	result.objectCount = m_ObjectCount;
+	result.frameCount = static_cast<uint32_t>(m_CpuFrameTimes.size());
+	result.cpuFrameTime = MetricSummary::FromSamples(m_CpuFrameTimes);
+	result.recordTime = MetricSummary::FromSamples(m_RecordTimes);
+	result.gpuFrameTime = MetricSummary::FromSamples(m_GpuFrameTimes);
+
+	const float frameCount = static_cast<float>(std::max(result.frameCount, 1u));
+	result.drawCalls = static_cast<float>(m_TotalRenderStats.drawCalls) / frameCount;
+	result.pipelineBinds = static_cast<float>(m_TotalRenderStats.pipelineBinds) / frameCount;
+	result.descriptorSetBinds = static_cast<float>(m_TotalRenderStats.descriptorSetBinds) / frameCount;
+	result.meshBinds = static_cast<float>(m_TotalRenderStats.meshBinds) / frameCount;
+	result.triangleCount = static_cast<float>(m_TotalRenderStats.triangleCount) / frameCount;
+
+	result.deviceLocalMemory = m_PeakDeviceLocalMemory;
+	result.hostMemory = m_PeakHostMemory;
+	return result;
+}
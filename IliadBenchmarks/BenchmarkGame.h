@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Core/IliadGame.h"
+
+#include "BenchmarkReport.h"
+#include "CameraPath.h"
+
+// Renders one benchmark scene along the camera path and collects the per-frame measurements of the run
+class BenchmarkGame final : public ili::IliadGame
+{
+public:
+	BenchmarkGame(std::string name, uint32_t objectCount, uint32_t seed, const CameraPath& cameraPath, uint32_t warmupFrames, bool pipelined);
+	virtual ~BenchmarkGame() override = default;
+
+	BenchmarkGame(const BenchmarkGame& other) = delete;
+	BenchmarkGame(BenchmarkGame&& other) noexcept = delete;
+	BenchmarkGame& operator=(const BenchmarkGame& other) = delete;
+	BenchmarkGame& operator=(BenchmarkGame&& other) noexcept = delete;
+
+	// Summary of the frames after the warmup, valid once Run returned
+	BenchmarkResult GetResult() const;
+	const std::string& GetDeviceName() const { return m_DeviceName; }
+
+protected:
+	virtual void OnGamePreparing() override;
+	virtual void InitializeGame() override;
+	virtual void OnUpdate(ili::GameObject* viewerObject, float deltaTime) override;
+	virtual void OnFrameSubmitted() override;
+
+private:
+	std::string m_Name;
+	uint32_t m_ObjectCount;
+	uint32_t m_Seed;
+	const CameraPath& m_CameraPath;
+	// Skipped frames, pipelines and the occlusion history need a few frames to settle
+	uint32_t m_WarmupFrames;
+	bool m_Pipelined;
+
+	float m_PathTime{};
+	uint32_t m_SubmittedFrames{};
+	std::chrono::steady_clock::time_point m_LastSubmitTime{};
+
+	std::vector<float> m_CpuFrameTimes{};
+	std::vector<float> m_RecordTimes{};
+	std::vector<float> m_GpuFrameTimes{};
+	ili::RenderStats m_TotalRenderStats{};
+	uint64_t m_PeakDeviceLocalMemory{};
+	uint64_t m_PeakHostMemory{};
+	std::string m_DeviceName{};
+};
@@ -0,0 +1,292 @@
+﻿#include "BenchmarkReport.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "Core/Utils.h"
+
+namespace
+{
+	void WriteSummary(std::ostream& stream, const char* name, const MetricSummary& summary)
+	{
+		stream << "      \"" << name << "\": { \"mean\": " << summary.mean << ", \"min\": " << summary.min
+			<< ", \"p50\": " << summary.p50 << ", \"p90\": " << summary.p90 << ", \"p99\": " << summary.p99
+			<< ", \"max\": " << summary.max << " },\n";
+	}
+
+	// Just enough JSON to read back the reports this file writes, no escapes beyond \" and \\ and no unicode
+	struct JsonValue
+	{
+		double number{};
+		std::string text{};
+		std::vector<JsonValue> array{};
+		// Members of an object, values[i] belongs to keys[i]
+		std::vector<std::string> keys{};
+		std::vector<JsonValue> values{};
+
+		// Missing members read as zero or empty
+		const JsonValue& operator[](const std::string& key) const
+		{
+			static const JsonValue empty{};
+			const auto it = std::ranges::find(keys, key);
+			return it != keys.end() ? values[static_cast<size_t>(it - keys.begin())] : empty;
+		}
+	};
+
+	class JsonParser final
+	{
+	public:
+		explicit JsonParser(std::string text) : m_Text(std::move(text)) {}
+
+		JsonValue Parse()
+		{
+			JsonValue value = ParseValue();
+			SkipWhitespace();
+			if (m_Position != m_Text.size()) Fail("trailing characters");
+			return value;
+		}
+
+	private:
+		JsonValue ParseValue()
+		{
+			SkipWhitespace();
+			if (m_Position >= m_Text.size()) Fail("unexpected end");
+
+			JsonValue value{};
+			const char character = m_Text[m_Position];
+			if (character == '{')
+			{
+				++m_Position;
+				SkipWhitespace();
+				if (Consume('}')) return value;
+				do
+				{
+					SkipWhitespace();
+					const std::string key = ParseString();
+					SkipWhitespace();
+					if (!Consume(':')) Fail("expected ':'");
+					value.keys.push_back(key);
+					value.values.push_back(ParseValue());
+					SkipWhitespace();
+				} while (Consume(','));
+				if (!Consume('}')) Fail("expected '}'");
+			}
+			else if (character == '[')
+			{
+				++m_Position;
+				SkipWhitespace();
+				if (Consume(']')) return value;
+				do
+				{
+					value.array.push_back(ParseValue());
+					SkipWhitespace();
+				} while (Consume(','));
+				if (!Consume(']')) Fail("expected ']'");
+			}
+			else if (character == '"')
+			{
+				value.text = ParseString();
+			}
+			else
+			{
+				const size_t start = m_Position;
+				while (m_Position < m_Text.size() && (std::isalnum(static_cast<unsigned char>(m_Text[m_Position])) ||
+					m_Text[m_Position] == '-' || m_Text[m_Position] == '+' || m_Text[m_Position] == '.'))
+				{
+					++m_Position;
+				}
+				const std::string token = m_Text.substr(start, m_Position - start);
+				if (token.empty()) Fail("unexpected character");
+				// true, false and null are never written, anything else has to be a number
+				std::istringstream stream{ token };
+				if (!(stream >> value.number)) Fail("invalid number " + token);
+			}
+			return value;
+		}
+
+		std::string ParseString()
+		{
+			if (!Consume('"')) Fail("expected '\"'");
+			std::string text{};
+			while (m_Position < m_Text.size() && m_Text[m_Position] != '"')
+			{
+				if (m_Text[m_Position] == '\\') ++m_Position;
+				if (m_Position < m_Text.size()) text += m_Text[m_Position++];
+			}
+			if (!Consume('"')) Fail("unterminated string");
+			return text;
+		}
+
+		void SkipWhitespace()
+		{
+			while (m_Position < m_Text.size() && std::isspace(static_cast<unsigned char>(m_Text[m_Position]))) ++m_Position;
+		}
+
+		bool Consume(char character)
+		{
+			if (m_Position >= m_Text.size() || m_Text[m_Position] != character) return false;
+			++m_Position;
+			return true;
+		}
+
+		[[noreturn]] void Fail(const std::string& reason) const
+		{
+			throw std::runtime_error("Failed to parse benchmark report at offset " + std::to_string(m_Position) + ": " + reason);
+		}
+
+		std::string m_Text;
+		size_t m_Position{};
+	};
+
+	MetricSummary ReadSummary(const JsonValue& value)
+	{
+		MetricSummary summary{};
+		summary.mean = static_cast<float>(value["mean"].number);
+		summary.min = static_cast<float>(value["min"].number);
+		summary.p50 = static_cast<float>(value["p50"].number);
+		summary.p90 = static_cast<float>(value["p90"].number);
+		summary.p99 = static_cast<float>(value["p99"].number);
+		summary.max = static_cast<float>(value["max"].number);
+		return summary;
+	}
+}
+
+MetricSummary MetricSummary::FromSamples(std::vector<float> samples)
+{
+	MetricSummary summary{};
+	if (samples.empty()) return summary;
+
+	std::ranges::sort(samples);
+
+	const auto percentile = [&samples](float fraction)
+	{
+		const size_t rank = static_cast<size_t>(std::ceil(fraction * static_cast<float>(samples.size())));
+		return samples[std::clamp(rank, size_t{ 1 }, samples.size()) - 1];
+	};
+
+	summary.mean = std::accumulate(samples.begin(), samples.end(), 0.f) / static_cast<float>(samples.size());
+	summary.min = samples.front();
+	summary.p50 = percentile(.5f);
+	summary.p90 = percentile(.9f);
+	summary.p99 = percentile(.99f);
+	summary.max = samples.back();
+	return summary;
+}
+
+void BenchmarkReport::WriteJson(const std::string& filePath) const
+{
+	std::ofstream file(filePath);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Failed to open file: " + filePath);
+	}
+
+	file << "{\n  \"device\": \"" << ili::Utils::EscapeJson(deviceName) << "\",\n"
+		<< "  \"width\": " << width << ",\n  \"height\": " << height << ",\n"
+		<< "  \"pipelined\": " << (pipelined ? 1 : 0) << ",\n  \"unit\": \"ms\",\n  \"scenes\": [\n";
+
+	for (size_t i{}; i < results.size(); ++i)
+	{
+		const BenchmarkResult& result = results[i];
+		file << "    {\n      \"name\": \"" << ili::Utils::EscapeJson(result.name) << "\",\n"
+			<< "      \"objects\": " << result.objectCount << ",\n"
+			<< "      \"frames\": " << result.frameCount << ",\n";
+		WriteSummary(file, "cpuFrameTime", result.cpuFrameTime);
+		WriteSummary(file, "recordTime", result.recordTime);
+		WriteSummary(file, "gpuFrameTime", result.gpuFrameTime);
+		file << "      \"drawCalls\": " << result.drawCalls << ",\n"
+			<< "      \"pipelineBinds\": " << result.pipelineBinds << ",\n"
+			<< "      \"descriptorSetBinds\": " << result.descriptorSetBinds << ",\n"
+			<< "      \"meshBinds\": " << result.meshBinds << ",\n"
+			<< "      \"triangles\": " << result.triangleCount << ",\n"
+			<< "      \"deviceLocalMemory\": " << result.deviceLocalMemory << ",\n"
+			<< "      \"hostMemory\": " << result.hostMemory << "\n"
+			<< "    }" << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	file << "  ]\n}\n";
+}
+
+BenchmarkReport BenchmarkReport::ReadJson(const std::string& filePath)
+{
+	std::ifstream file(filePath);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Failed to open file: " + filePath);
+	}
+
+	std::stringstream contents{};
+	contents << file.rdbuf();
+	const JsonValue root = JsonParser{ contents.str() }.Parse();
+
+	BenchmarkReport report{};
+	report.deviceName = root["device"].text;
+	report.width = static_cast<uint32_t>(root["width"].number);
+	report.height = static_cast<uint32_t>(root["height"].number);
+	report.pipelined = root["pipelined"].number != 0.;
+
+	for (const JsonValue& scene : root["scenes"].array)
+	{
+		BenchmarkResult result{};
+		result.name = scene["name"].text;
+		result.objectCount = static_cast<uint32_t>(scene["objects"].number);
+		result.frameCount = static_cast<uint32_t>(scene["frames"].number);
+		result.cpuFrameTime = ReadSummary(scene["cpuFrameTime"]);
+		result.recordTime = ReadSummary(scene["recordTime"]);
+		result.gpuFrameTime = ReadSummary(scene["gpuFrameTime"]);
+		result.drawCalls = static_cast<float>(scene["drawCalls"].number);
+		result.pipelineBinds = static_cast<float>(scene["pipelineBinds"].number);
+		result.descriptorSetBinds = static_cast<float>(scene["descriptorSetBinds"].number);
+		result.meshBinds = static_cast<float>(scene["meshBinds"].number);
+		result.triangleCount = static_cast<float>(scene["triangles"].number);
+		result.deviceLocalMemory = static_cast<uint64_t>(scene["deviceLocalMemory"].number);
+		result.hostMemory = static_cast<uint64_t>(scene["hostMemory"].number);
+		report.results.push_back(std::move(result));
+	}
+
+	return report;
+}
+
+std::vector<BenchmarkRegression> BenchmarkReport::CompareToBaseline(const BenchmarkReport& baseline, float threshold) const
+{
+	if (baseline.width != width || baseline.height != height)
+	{
+		throw std::runtime_error("Failed to compare to the baseline, it was recorded at " + std::to_string(baseline.width) + "x"
+			+ std::to_string(baseline.height) + " instead of " + std::to_string(width) + "x" + std::to_string(height));
+	}
+
+	std::vector<BenchmarkRegression> regressions{};
+
+	for (const BenchmarkResult& current : results)
+	{
+		const auto it = std::ranges::find(baseline.results, current.name, &BenchmarkResult::name);
+		if (it == baseline.results.end()) continue;
+		const BenchmarkResult& previous = *it;
+
+		const auto check = [&](const char* metric, double baselineValue, double currentValue)
+		{
+			if (currentValue > baselineValue * (1.0 + threshold)) regressions.push_back({ current.name, metric, baselineValue, currentValue });
+		};
+
+		check("cpuFrameTime.p50", previous.cpuFrameTime.p50, current.cpuFrameTime.p50);
+		check("cpuFrameTime.p99", previous.cpuFrameTime.p99, current.cpuFrameTime.p99);
+		check("recordTime.p50", previous.recordTime.p50, current.recordTime.p50);
+		if (previous.gpuFrameTime.p50 > 0.f && current.gpuFrameTime.p50 > 0.f)
+		{
+			check("gpuFrameTime.p50", previous.gpuFrameTime.p50, current.gpuFrameTime.p50);
+			check("gpuFrameTime.p99", previous.gpuFrameTime.p99, current.gpuFrameTime.p99);
+		}
+		check("drawCalls", previous.drawCalls, current.drawCalls);
+		check("stateChanges", previous.pipelineBinds + previous.descriptorSetBinds + previous.meshBinds,
+			current.pipelineBinds + current.descriptorSetBinds + current.meshBinds);
+		check("deviceLocalMemory", static_cast<double>(previous.deviceLocalMemory), static_cast<double>(current.deviceLocalMemory));
+		check("hostMemory", static_cast<double>(previous.hostMemory), static_cast<double>(current.hostMemory));
+	}
+
+	return regressions;
+}
@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Distribution of a per-frame measurement in milliseconds
+struct MetricSummary final
+{
+	float mean{};
+	float min{};
+	float p50{};
+	float p90{};
+	float p99{};
+	float max{};
+
+	// Nearest-rank percentiles, all zero for an empty sample set
+	static MetricSummary FromSamples(std::vector<float> samples);
+};
+
+struct BenchmarkResult final
+{
+	std::string name{};
+	uint32_t objectCount{};
+	uint32_t frameCount{};
+
+	MetricSummary cpuFrameTime{};
+	// From the start of the command buffer to its submission, see IliadGame::GetCommandRecordTime
+	MetricSummary recordTime{};
+	// Empty when the device has no timestamp support
+	MetricSummary gpuFrameTime{};
+
+	// Per frame averages of the mesh render systems
+	float drawCalls{};
+	float pipelineBinds{};
+	float descriptorSetBinds{};
+	float meshBinds{};
+	float triangleCount{};
+
+	// Highest allocated bytes seen during the run, split by heap type
+	uint64_t deviceLocalMemory{};
+	uint64_t hostMemory{};
+};
+
+// A metric of a scene that got worse than the baseline by more than the allowed threshold
+struct BenchmarkRegression final
+{
+	std::string scene{};
+	std::string metric{};
+	double baseline{};
+	double current{};
+};
+
+class BenchmarkReport final
+{
+public:
+	BenchmarkReport() = default;
+	~BenchmarkReport() = default;
+
+	BenchmarkReport(const BenchmarkReport& other) = default;
+	BenchmarkReport(BenchmarkReport&& other) noexcept = default;
+	BenchmarkReport& operator=(const BenchmarkReport& other) = default;
+	BenchmarkReport& operator=(BenchmarkReport&& other) noexcept = default;
+
+	// Throws when the file cannot be written
+	void WriteJson(const std::string& filePath) const;
+	// Reads a report written by WriteJson, throws when the file cannot be read or parsed
+	static BenchmarkReport ReadJson(const std::string& filePath);
+
+	/**
+	 * Compares every scene that is in both reports. A metric regresses when it grows by more than the
+	 * threshold, 0.1 allows 10%. GPU times are skipped when either report has none.
+	 * Throws when the baseline was rendered at another resolution, none of its times are comparable then
+	 */
+	std::vector<BenchmarkRegression> CompareToBaseline(const BenchmarkReport& baseline, float threshold) const;
+
+	std::string deviceName{};
+	uint32_t width{};
+	uint32_t height{};
+	// Recorded on the render thread while the next frame was simulated, see IliadGame::SetPipelinedRenderingEnabled
+	bool pipelined{};
+	std::vector<BenchmarkResult> results{};
+};
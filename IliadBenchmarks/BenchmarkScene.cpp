@@ -0,0 +1,86 @@
+﻿#include "BenchmarkScene.h"
+
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "Core/ContentLoader.h"
+#include "Core/PointLight.h"
+#include "Graphics/Material.h"
+#include "SceneGraph/ModelComponent.h"
+#include "SceneGraph/TransformComponent.h"
+
+BenchmarkScene::BenchmarkScene(uint32_t objectCount, uint32_t seed) :
+	m_ObjectCount(objectCount),
+	m_Random(seed)
+{
+}
+
+void BenchmarkScene::Initialize()
+{
+	const ili::ContentLoader& contentLoader = ili::ContentLoader::GetInstance();
+
+	// Parsed side by side on the job system
+	const std::vector<std::shared_ptr<ili::Model>> models = contentLoader.LoadModelsFromFiles(
+	{
+		"Assets/Models/sphere.obj",
+		"Assets/Models/colored_cube.obj",
+		"Assets/Models/flat_vase.obj"
+	});
+
+	const std::array<std::shared_ptr<ili::Texture>, 4> albedoMaps
+	{
+		contentLoader.LoadTextureFromFile("Assets/Textures/wood.png"),
+		contentLoader.LoadTextureFromFile("Assets/Textures/bg3_albedo.png"),
+		contentLoader.LoadTextureFromFile("Assets/Textures/viking_room.png"),
+		contentLoader.LoadTextureFromFile("Assets/Textures/cat.jpg")
+	};
+	const std::shared_ptr<ili::Texture> normalMap = contentLoader.LoadTextureFromFile("Assets/Textures/bg3_normal.png");
+
+	// A handful of materials, as in a real scene many objects share one
+	std::vector<std::shared_ptr<ili::Material>> materials{};
+	for (size_t i{}; i < albedoMaps.size() * 2; ++i)
+	{
+		auto material = std::make_shared<ili::Material>();
+		material->SetAlbedo(albedoMaps[i % albedoMaps.size()]);
+		if (i % 2 == 1) material->SetNormal(normalMap);
+		material->SetMetallic(static_cast<float>(i % 3) * .5f);
+		material->SetRoughness(.2f + .1f * static_cast<float>(i));
+		materials.push_back(std::move(material));
+	}
+
+	const float spacing = 2.f * HALF_EXTENT / std::cbrt(static_cast<float>(m_ObjectCount));
+	const float baseScale = .35f * spacing;
+
+	for (uint32_t i{}; i < m_ObjectCount; ++i)
+	{
+		const uint32_t modelIndex = m_Random() % models.size();
+		// One in four objects has no material and goes through the vertex color render system
+		const bool isTextured = m_Random() % 4 != 0;
+		const uint32_t materialIndex = m_Random() % materials.size();
+
+		auto pGameObject = CreateGameObject<ili::GameObject>();
+		auto pModelComponent = pGameObject->AddComponent<ili::ModelComponent>(models[modelIndex]);
+		if (isTextured) pModelComponent->SetMaterial(materials[materialIndex]);
+
+		ili::TransformComponent* pTransform = pGameObject->GetTransform();
+		pTransform->SetPosition({ NextFloat(-HALF_EXTENT, HALF_EXTENT), NextFloat(-HALF_EXTENT, HALF_EXTENT), NextFloat(-HALF_EXTENT, HALF_EXTENT) });
+		pTransform->SetRotationDegrees({ NextFloat(0.f, 360.f), NextFloat(0.f, 360.f), 0.f });
+		const float scale = baseScale * NextFloat(.5f, 1.f);
+		pTransform->SetScale({ scale, scale, scale });
+	}
+
+	for (uint32_t i{}; i < POINT_LIGHT_COUNT; ++i)
+	{
+		const glm::vec3 color{ NextFloat(.2f, 1.f), NextFloat(.2f, 1.f), NextFloat(.2f, 1.f) };
+		auto pLight = CreatePointLight(2.f, .05f, color);
+		pLight->GetTransform()->SetPosition({ NextFloat(-HALF_EXTENT, HALF_EXTENT), NextFloat(-HALF_EXTENT, HALF_EXTENT), NextFloat(-HALF_EXTENT, HALF_EXTENT) });
+	}
+}
+
+float BenchmarkScene::NextFloat(float min, float max)
+{
+	const float unit = static_cast<float>(m_Random() >> 8) / static_cast<float>(1u << 24);
+	return min + (max - min) * unit;
+}
@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <random>
+
+#include "SceneGraph/Scene.h"
+
+/**
+ * Procedurally generated scene of the benchmark suite. Objects are scattered through a cube with a fixed seed,
+ * so a given object count always produces the same scene. Their size shrinks with the density so every scale
+ * covers the screen about the same way, and only the object count changes between the scales
+ */
+class BenchmarkScene final : public ili::Scene
+{
+public:
+	// Half the side of the cube the objects are placed in, the camera far plane is at 10 units
+	static constexpr float HALF_EXTENT = 4.f;
+	static constexpr uint32_t POINT_LIGHT_COUNT = 32;
+
+	BenchmarkScene(uint32_t objectCount, uint32_t seed);
+	virtual ~BenchmarkScene() override = default;
+
+	BenchmarkScene(const BenchmarkScene& other) = delete;
+	BenchmarkScene(BenchmarkScene&& other) noexcept = delete;
+	BenchmarkScene& operator=(const BenchmarkScene& other) = delete;
+	BenchmarkScene& operator=(BenchmarkScene&& other) noexcept = delete;
+
+	virtual void Initialize() override;
+
+protected:
+	virtual void Update(float /*deltaTime*/) override {}
+
+private:
+	// std distributions differ between standard libraries, the raw engine output does not
+	float NextFloat(float min, float max);
+
+	uint32_t m_ObjectCount{};
+	std::mt19937 m_Random;
+};
@@ -0,0 +1,156 @@
+﻿#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "BenchmarkGame.h"
+#include "BenchmarkReport.h"
+#include "BenchmarkScene.h"
+#include "CameraPath.h"
+
+namespace
+{
+	struct SceneScale
+	{
+		const char* name;
+		uint32_t objectCount;
+	};
+
+	constexpr SceneScale SCENE_SCALES[]{ { "1k", 1'000 }, { "10k", 10'000 }, { "100k", 100'000 } };
+	// Every scale places its objects with the same seed, changing it invalidates all existing baselines
+	constexpr uint32_t SCENE_SEED = 1234;
+
+	struct BenchmarkOptions
+	{
+		uint32_t frameCount{ 300 };
+		uint32_t warmupFrames{ 30 };
+		uint32_t width{ 1600 };
+		uint32_t height{ 900 };
+		// Comma separated scale names, all scales when empty
+		std::string scenes{};
+		std::string cameraPathFile{};
+		std::string outputFile{ "benchmark_results.json" };
+		std::string baselineFile{};
+		float threshold{ .1f };
+		bool pipelined{ false };
+	};
+
+	// [--frames N] [--warmup N] [--width N] [--height N] [--scenes 1k,10k,100k] [--camera-path FILE]
+	// [--output FILE] [--baseline FILE] [--threshold FRACTION] [--pipelined]
+	BenchmarkOptions ParseOptions(int argc, char* argv[])
+	{
+		BenchmarkOptions options{};
+		for (int i{ 1 }; i < argc; ++i)
+		{
+			const std::string_view argument{ argv[i] };
+			const bool hasValue = i + 1 < argc;
+
+			if (argument == "--frames" && hasValue) options.frameCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			else if (argument == "--warmup" && hasValue) options.warmupFrames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			else if (argument == "--width" && hasValue) options.width = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			else if (argument == "--height" && hasValue) options.height = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			else if (argument == "--scenes" && hasValue) options.scenes = argv[++i];
+			else if (argument == "--camera-path" && hasValue) options.cameraPathFile = argv[++i];
+			else if (argument == "--output" && hasValue) options.outputFile = argv[++i];
+			else if (argument == "--baseline" && hasValue) options.baselineFile = argv[++i];
+			else if (argument == "--threshold" && hasValue) options.threshold = std::strtof(argv[++i], nullptr);
+			else if (argument == "--pipelined") options.pipelined = true;
+			else std::cerr << "Ignoring unknown argument " << argument << std::endl;
+		}
+		return options;
+	}
+
+	bool IsSceneSelected(const BenchmarkOptions& options, std::string_view name)
+	{
+		if (options.scenes.empty()) return true;
+
+		std::string_view remaining{ options.scenes };
+		while (!remaining.empty())
+		{
+			const size_t separator = remaining.find(',');
+			if (remaining.substr(0, separator) == name) return true;
+			if (separator == std::string_view::npos) break;
+			remaining.remove_prefix(separator + 1);
+		}
+		return false;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		const BenchmarkOptions options = ParseOptions(argc, argv);
+		const CameraPath cameraPath = options.cameraPathFile.empty()
+			? CameraPath::CreateOrbit(BenchmarkScene::HALF_EXTENT)
+			: CameraPath::LoadFromFile(options.cameraPathFile);
+
+		ili::HeadlessSettings headlessSettings{};
+		headlessSettings.enabled = true;
+		headlessSettings.width = options.width;
+		headlessSettings.height = options.height;
+		headlessSettings.frameCount = options.warmupFrames + options.frameCount;
+
+		BenchmarkReport report{};
+		report.width = options.width;
+		report.height = options.height;
+		report.pipelined = options.pipelined;
+
+		// One game per scale, so no scene inherits the resources or pipeline caches of the previous one
+		for (const SceneScale& scale : SCENE_SCALES)
+		{
+			if (!IsSceneSelected(options, scale.name)) continue;
+
+			std::cout << "Running the " << scale.name << " scene..." << std::endl;
+			const auto pGame = std::make_unique<BenchmarkGame>(scale.name, scale.objectCount, SCENE_SEED, cameraPath, options.warmupFrames, options.pipelined);
+			pGame->SetHeadlessSettings(headlessSettings);
+			pGame->Run();
+
+			const BenchmarkResult result = pGame->GetResult();
+			std::cout << "  cpu p50 " << result.cpuFrameTime.p50 << " ms, p99 " << result.cpuFrameTime.p99
+				<< " ms, gpu p50 " << result.gpuFrameTime.p50 << " ms, " << result.drawCalls << " draws" << std::endl;
+
+			report.deviceName = pGame->GetDeviceName();
+			report.results.push_back(result);
+		}
+
+		if (report.results.empty())
+		{
+			std::cerr << "No scene matches --scenes " << options.scenes << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		report.WriteJson(options.outputFile);
+		std::cout << "Results written to " << options.outputFile << std::endl;
+
+		if (options.baselineFile.empty()) return EXIT_SUCCESS;
+
+		const BenchmarkReport baseline = BenchmarkReport::ReadJson(options.baselineFile);
+		if (baseline.deviceName != report.deviceName)
+		{
+			std::cerr << "Warning: the baseline was recorded on " << baseline.deviceName << ", not on " << report.deviceName << std::endl;
+		}
+		if (baseline.pipelined != report.pipelined)
+		{
+			std::cerr << "Warning: the baseline was recorded " << (baseline.pipelined ? "with" : "without") << " --pipelined" << std::endl;
+		}
+
+		const std::vector<BenchmarkRegression> regressions = report.CompareToBaseline(baseline, options.threshold);
+		for (const BenchmarkRegression& regression : regressions)
+		{
+			std::cerr << "Regression in " << regression.scene << ": " << regression.metric << " went from "
+				<< regression.baseline << " to " << regression.current << std::endl;
+		}
+		if (regressions.empty()) std::cout << "No regressions against " << options.baselineFile << std::endl;
+
+		return regressions.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << exception.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+}
@@ -0,0 +1,109 @@
+﻿#include "CameraPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "SceneGraph/GameObject.h"
+#include "SceneGraph/TransformComponent.h"
+
+CameraPath CameraPath::CreateOrbit(float sceneHalfExtent)
+{
+	static constexpr int KEYFRAME_COUNT = 16;
+	static constexpr float SECONDS_PER_KEYFRAME = 1.f;
+
+	CameraPath path{};
+	for (int i{}; i <= KEYFRAME_COUNT; ++i)
+	{
+		// Alternates between flying around the scene and cutting through it
+		const float angle = glm::two_pi<float>() * static_cast<float>(i) / static_cast<float>(KEYFRAME_COUNT);
+		const float radius = sceneHalfExtent * (i % 2 == 0 ? 1.6f : .4f);
+		const float height = sceneHalfExtent * .5f * std::sin(angle * 2.f);
+
+		Keyframe keyframe{};
+		keyframe.time = static_cast<float>(i) * SECONDS_PER_KEYFRAME;
+		keyframe.position = { radius * std::cos(angle), height, radius * std::sin(angle) };
+		keyframe.target = { -.5f * keyframe.position.x, 0.f, -.5f * keyframe.position.z };
+		path.m_Keyframes.push_back(keyframe);
+	}
+	return path;
+}
+
+CameraPath CameraPath::LoadFromFile(const std::string& filePath)
+{
+	std::ifstream file{ filePath };
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Failed to open camera path " + filePath);
+	}
+
+	CameraPath path{};
+	std::string line{};
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#') continue;
+
+		std::istringstream stream{ line };
+		Keyframe keyframe{};
+		if (!(stream >> keyframe.time
+			>> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+			>> keyframe.target.x >> keyframe.target.y >> keyframe.target.z))
+		{
+			throw std::runtime_error("Failed to parse camera path keyframe: " + line);
+		}
+		path.m_Keyframes.push_back(keyframe);
+	}
+
+	if (path.m_Keyframes.size() < 2)
+	{
+		throw std::runtime_error("Failed to load camera path " + filePath + ", it needs at least two keyframes");
+	}
+
+	std::ranges::sort(path.m_Keyframes, {}, &Keyframe::time);
+
+	// Shifted so the path starts at zero and loops over its own duration
+	const float startTime = path.m_Keyframes.front().time;
+	for (Keyframe& keyframe : path.m_Keyframes) keyframe.time -= startTime;
+
+	return path;
+}
+
+void CameraPath::Apply(float time, ili::GameObject& viewerObject) const
+{
+	if (m_Keyframes.empty()) return;
+
+	glm::vec3 position = m_Keyframes.front().position;
+	glm::vec3 target = m_Keyframes.front().target;
+
+	const float duration = GetDuration();
+	if (duration > 0.f)
+	{
+		const float loopTime = std::fmod(time, duration);
+		const auto next = std::ranges::upper_bound(m_Keyframes, loopTime, {}, &Keyframe::time);
+		const auto previous = next - 1;
+		if (next != m_Keyframes.end())
+		{
+			const float t = (loopTime - previous->time) / std::max(next->time - previous->time, 1e-6f);
+			position = glm::mix(previous->position, next->position, t);
+			target = glm::mix(previous->target, next->target, t);
+		}
+		else
+		{
+			position = previous->position;
+			target = previous->target;
+		}
+	}
+
+	// Inverse of the forward vector the camera builds from its yaw and pitch in Camera::SetViewYXZ
+	const glm::vec3 direction = glm::normalize(target - position);
+	const float pitch = std::asin(std::clamp(-direction.y, -1.f, 1.f));
+	const float yaw = std::atan2(direction.x, direction.z);
+
+	viewerObject.GetTransform()->SetPosition(position);
+	viewerObject.GetTransform()->SetRotationRadians({ pitch, yaw, 0.f });
+}
@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+namespace ili
+{
+	class GameObject;
+}
+
+/**
+ * Camera flight through the benchmark scenes, the camera looks at a target point that moves along with it.
+ * Keyframes are interpolated linearly and the path loops, so any frame count covers the same motion.
+ * A path file has one keyframe per line: time px py pz tx ty tz, lines starting with # are ignored
+ */
+class CameraPath final
+{
+public:
+	struct Keyframe
+	{
+		float time{};
+		glm::vec3 position{};
+		glm::vec3 target{};
+	};
+
+	CameraPath() = default;
+	~CameraPath() = default;
+
+	CameraPath(const CameraPath& other) = default;
+	CameraPath(CameraPath&& other) noexcept = default;
+	CameraPath& operator=(const CameraPath& other) = default;
+	CameraPath& operator=(CameraPath&& other) noexcept = default;
+
+	// Orbits a scene of the given half extent while sweeping through it, so near and far objects both get drawn
+	static CameraPath CreateOrbit(float sceneHalfExtent);
+	// Throws when the file cannot be read or holds fewer than two keyframes
+	static CameraPath LoadFromFile(const std::string& filePath);
+
+	// Places the viewer on the path, time in seconds
+	void Apply(float time, ili::GameObject& viewerObject) const;
+
+	float GetDuration() const { return m_Keyframes.empty() ? 0.f : m_Keyframes.back().time; }
+	const std::vector<Keyframe>& GetKeyframes() const { return m_Keyframes; }
+
+private:
+	// Sorted by time, the first one at time zero
+	std::vector<Keyframe> m_Keyframes{};
+};
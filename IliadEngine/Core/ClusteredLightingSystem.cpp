@@ -0,0 +1,126 @@
+﻿#include "ClusteredLightingSystem.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include "PointLight.h"
+#include "SceneGraph/TransformComponent.h"
+
+namespace ili
+{
+	namespace
+	{
+		// Lighting below this value is cut off, it decides how far a light reaches. Mirrored in the shaders' falloff
+		constexpr float LIGHT_CUTOFF = 0.01f;
+
+		// Mirrors local_size_x in cluster_lights.comp
+		constexpr uint32_t CLUSTER_WORKGROUP_SIZE = 128;
+	}
+
+	ClusteredLightingSystem::ClusteredLightingSystem(Device& device, PipelineRegistry& pipelineRegistry, VkDescriptorSetLayout globalSetLayout) :
+		m_Device(device),
+		m_PipelineRegistry(pipelineRegistry)
+	{
+		CreateBuffers();
+		CreatePipeline(globalSetLayout);
+	}
+
+	float ClusteredLightingSystem::GetLightRange(float intensity, float radius)
+	{
+		// Intensity / distance^2 == cutoff
+		return std::max(radius, std::sqrt(std::max(intensity, 0.f) / LIGHT_CUTOFF));
+	}
+
+	void ClusteredLightingSystem::CreateBuffers()
+	{
+		for (int i{}; i < SwapChain::MAX_FRAMES_IN_FLIGHT; ++i)
+		{
+			m_LightBuffers.emplace_back(CreateLightBuffer(INITIAL_POINT_LIGHT_CAPACITY));
+
+			// Only ever touched by the GPU
+			m_ClusterLightCountBuffers.emplace_back(std::make_unique<Buffer>(m_Device, sizeof(uint32_t), CLUSTER_COUNT,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+			m_ClusterLightIndexBuffers.emplace_back(std::make_unique<Buffer>(m_Device, sizeof(uint32_t), CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+		}
+
+		m_LightData.reserve(INITIAL_POINT_LIGHT_CAPACITY);
+	}
+
+	std::unique_ptr<Buffer> ClusteredLightingSystem::CreateLightBuffer(uint32_t capacity) const
+	{
+		// Rewritten by the CPU every frame
+		auto pBuffer = std::make_unique<Buffer>(m_Device, sizeof(PointLight), capacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		pBuffer->Map();
+		return pBuffer;
+	}
+
+	void ClusteredLightingSystem::CreatePipeline(VkDescriptorSetLayout globalSetLayout)
+	{
+		m_PipelineLayout = m_PipelineRegistry.GetPipelineLayout({ globalSetLayout }, {});
+		m_pClusterPipeline = m_PipelineRegistry.GetComputePipeline("Assets/CompiledShaders/cluster_lights.comp.spv", m_PipelineLayout);
+	}
+
+	bool ClusteredLightingSystem::Update(const FrameInfo& frameInfo, GlobalUbo& ubo, const std::vector<PointLightInstance>& pointLights, VkExtent2D renderExtent)
+	{
+		m_LightData.clear();
+		for (const PointLightInstance& pointLight : pointLights)
+		{
+			PointLight& light = m_LightData.emplace_back();
+			light.position = glm::vec4(pointLight.position, GetLightRange(pointLight.intensity, pointLight.radius));
+			light.color = glm::vec4(pointLight.color, pointLight.intensity);
+		}
+
+		// The fence of this frame slot has been waited on, nothing reads its old buffer anymore
+		std::unique_ptr<Buffer>& pLightBuffer = m_LightBuffers[frameInfo.frameIndex];
+		const bool isGrown = m_LightData.size() > pLightBuffer->GetInstanceCount();
+		if (isGrown) pLightBuffer = CreateLightBuffer(std::bit_ceil(static_cast<uint32_t>(m_LightData.size())));
+
+		if (!m_LightData.empty())
+		{
+			const VkDeviceSize dataSize = m_LightData.size() * sizeof(PointLight);
+			pLightBuffer->WriteToBuffer(m_LightData.data(), dataSize);
+			pLightBuffer->Flush();
+		}
+
+		ubo.pointLightCount = static_cast<int>(m_LightData.size());
+
+		// Slices are spaced exponentially: slice = log(z) * scale + bias
+		const float nearPlane = frameInfo.camera.GetNearPlane();
+		const float farPlane = frameInfo.camera.GetFarPlane();
+		const float logDepthRange = std::log(farPlane / nearPlane);
+		const float sliceScale = static_cast<float>(CLUSTER_COUNT_Z) / logDepthRange;
+		const float sliceBias = -static_cast<float>(CLUSTER_COUNT_Z) * std::log(nearPlane) / logDepthRange;
+
+		ubo.clusterDepthParams = glm::vec4(nearPlane, farPlane, sliceScale, sliceBias);
+		ubo.screenSize = glm::vec4(static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height), 0.f, 0.f);
+		return isGrown;
+	}
+
+	void ClusteredLightingSystem::AssignLightsToClusters(const FrameInfo& frameInfo)
+	{
+		m_pClusterPipeline->Bind(frameInfo.commandBuffer);
+
+		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1,
+			&frameInfo.globalDescriptorSet, 0, nullptr);
+
+		// One invocation per cluster
+		const uint32_t groupCount = (CLUSTER_COUNT + CLUSTER_WORKGROUP_SIZE - 1) / CLUSTER_WORKGROUP_SIZE;
+		vkCmdDispatch(frameInfo.commandBuffer, groupCount, 1, 1);
+
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(frameInfo.commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0,
+			1, &barrier,
+			0, nullptr,
+			0, nullptr);
+	}
+}
@@ -0,0 +1,79 @@
+﻿#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Graphics/Buffer.h"
+#include "Graphics/ComputePipeline.h"
+#include "Graphics/Device.h"
+#include "Graphics/PipelineRegistry.h"
+#include "Graphics/SwapChain.h"
+#include "Structs/FrameInfo.h"
+
+namespace ili
+{
+	struct PointLightInstance;
+
+	/**
+	 * Clustered forward lighting.
+	 * Point lights are uploaded into a storage buffer every frame, then a compute pass splits the view frustum
+	 * into CLUSTER_COUNT_X * CLUSTER_COUNT_Y screen tiles and CLUSTER_COUNT_Z exponential depth slices and writes,
+	 * for every cluster, the indices of the lights whose sphere of influence touches it.
+	 * The mesh fragment shaders then only loop over the lights of the cluster they fall in.
+	 *
+	 * All buffers live in the global descriptor set:
+	 * binding 1: lights, binding 2: light count per cluster, binding 3: light indices (MAX_LIGHTS_PER_CLUSTER per cluster)
+	 * The constants below are mirrored in Shaders/common.glsl.
+	 */
+	class ClusteredLightingSystem
+	{
+	public:
+		static constexpr uint32_t CLUSTER_COUNT_X = 16;
+		static constexpr uint32_t CLUSTER_COUNT_Y = 9;
+		static constexpr uint32_t CLUSTER_COUNT_Z = 24;
+		static constexpr uint32_t CLUSTER_COUNT = CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z;
+		static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+
+		ClusteredLightingSystem(Device& device, PipelineRegistry& pipelineRegistry, VkDescriptorSetLayout globalSetLayout);
+		~ClusteredLightingSystem() = default;
+
+		ClusteredLightingSystem(const ClusteredLightingSystem&) = delete;
+		ClusteredLightingSystem& operator=(const ClusteredLightingSystem&) = delete;
+		ClusteredLightingSystem(ClusteredLightingSystem&&) = delete;
+		ClusteredLightingSystem& operator=(ClusteredLightingSystem&&) = delete;
+
+		// Writes the lights into this frame's light buffer and the cluster parameters into the ubo.
+		// Returns true when the light buffer had to grow, the frame's global descriptor set then needs the new GetLightBufferInfo
+		bool Update(const FrameInfo& frameInfo, GlobalUbo& ubo, const std::vector<PointLightInstance>& pointLights, VkExtent2D renderExtent);
+
+		// Records the light assignment compute pass, must be called outside of a render pass.
+		// Ends with a barrier that makes the cluster lists visible to fragment shaders
+		void AssignLightsToClusters(const FrameInfo& frameInfo);
+
+		VkDescriptorBufferInfo GetLightBufferInfo(int frameIndex) const { return m_LightBuffers[frameIndex]->DescriptorInfo(); }
+		VkDescriptorBufferInfo GetClusterLightCountBufferInfo(int frameIndex) const { return m_ClusterLightCountBuffers[frameIndex]->DescriptorInfo(); }
+		VkDescriptorBufferInfo GetClusterLightIndexBufferInfo(int frameIndex) const { return m_ClusterLightIndexBuffers[frameIndex]->DescriptorInfo(); }
+
+		// Distance at which a light of the given intensity falls below the lighting cutoff, never smaller than its radius
+		static float GetLightRange(float intensity, float radius);
+
+	private:
+		void CreateBuffers();
+		std::unique_ptr<Buffer> CreateLightBuffer(uint32_t capacity) const;
+		void CreatePipeline(VkDescriptorSetLayout globalSetLayout);
+
+		Device& m_Device;
+		PipelineRegistry& m_PipelineRegistry;
+
+		// Owned by the pipeline registry
+		ComputePipeline* m_pClusterPipeline{};
+		VkPipelineLayout m_PipelineLayout{};
+
+		// One of each per frame in flight, the compute pass of the next frame may run while this one is still shading
+		std::vector<std::unique_ptr<Buffer>> m_LightBuffers{};
+		std::vector<std::unique_ptr<Buffer>> m_ClusterLightCountBuffers{};
+		std::vector<std::unique_ptr<Buffer>> m_ClusterLightIndexBuffers{};
+
+		std::vector<PointLight> m_LightData{};
+	};
+}
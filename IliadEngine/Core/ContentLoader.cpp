@@ -1,5 +1,6 @@
 ﻿#include "ContentLoader.h"
 #include "../Core/Utils.h"
+#include "JobSystem.h"
 #include <stdexcept>
 
 #define GLM_ENABLE_EXPERIMENTAL
@@ -101,21 +102,59 @@ namespace ili
         }
     }
 
-    std::shared_ptr<ili::Model> ContentLoader::LoadModelFromFile(const std::string& filepath) const
+    std::shared_ptr<ili::Model> ContentLoader::LoadModelFromFile(const std::string& filepath, bool buildMeshBvh) const
     {
         assert(m_pDevice != nullptr && "Device is not initialized");
 
         Builder builder{};
         builder.LoadModel(filepath);
 
-        return std::make_shared<ili::Model>(*m_pDevice, builder.vertices, builder.indices);
+        return Track(m_LoadedModels, std::make_shared<ili::Model>(*m_pDevice, builder.vertices, builder.indices, buildMeshBvh));
+    }
+
+    std::vector<std::shared_ptr<ili::Model>> ContentLoader::LoadModelsFromFiles(const std::vector<std::string>& filepaths, bool buildMeshBvh) const
+    {
+        assert(m_pDevice != nullptr && "Device is not initialized");
+
+        std::vector<Builder> builders(filepaths.size());
+        JobSystem::GetInstance().ParallelFor(static_cast<uint32_t>(filepaths.size()), 1, [&builders, &filepaths](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                builders[i].LoadModel(filepaths[i]);
+            }
+        });
+
+        std::vector<std::shared_ptr<ili::Model>> models{};
+        models.reserve(builders.size());
+        for (const Builder& builder : builders)
+        {
+            models.push_back(Track(m_LoadedModels, std::make_shared<ili::Model>(*m_pDevice, builder.vertices, builder.indices, buildMeshBvh)));
+        }
+        return models;
+    }
+
+    std::shared_ptr<OccluderMesh> ContentLoader::LoadOccluderFromFile(const std::string& filepath) const
+    {
+        Builder builder{};
+        builder.LoadModel(filepath);
+
+        auto pOccluder = std::make_shared<OccluderMesh>();
+        pOccluder->positions.reserve(builder.vertices.size());
+        for (const auto& vertex : builder.vertices)
+        {
+            pOccluder->positions.push_back(vertex.position);
+        }
+        pOccluder->indices = std::move(builder.indices);
+
+        return Track(m_LoadedOccluders, std::move(pOccluder));
     }
 
     std::shared_ptr<Texture> ContentLoader::LoadTextureFromFile(const std::string& filepath) const
     {
 		assert(m_pDevice != nullptr && "Device is not initialized");
 
-		return std::make_shared<Texture>(*m_pDevice, filepath);
+		return Track(m_LoadedTextures, std::make_shared<Texture>(*m_pDevice, filepath));
     }
 
     std::shared_ptr<Texture> ContentLoader::CreateTextureFromColor(const glm::vec4& color)
@@ -148,6 +187,23 @@ namespace ili
         // Upload data to the texture
         texture->UploadData(data, dataSize);
 
-        return texture;
+        return Track(m_LoadedTextures, std::shared_ptr<Texture>(std::move(texture)));
+    }
+
+    ContentStats ContentLoader::GetContentStats() const
+    {
+        const std::lock_guard lock{ m_TrackingMutex };
+
+        const auto countAlive = [](auto& resources)
+        {
+            std::erase_if(resources, [](const auto& pResource) { return pResource.expired(); });
+            return static_cast<uint32_t>(resources.size());
+        };
+
+        ContentStats stats{};
+        stats.modelCount = countAlive(m_LoadedModels);
+        stats.textureCount = countAlive(m_LoadedTextures);
+        stats.occluderCount = countAlive(m_LoadedOccluders);
+        return stats;
     }
 }
\ No newline at end of file
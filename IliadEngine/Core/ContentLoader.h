@@ -4,12 +4,22 @@
 #include "Graphics/Model.h"
 #include "Graphics/Device.h"
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "Graphics/Texture.h"
+#include "Core/SoftwareOcclusionCuller.h"
 
 namespace ili
 {
+    // Resources loaded through the ContentLoader that are still referenced somewhere
+    struct ContentStats
+    {
+        uint32_t modelCount{};
+        uint32_t textureCount{};
+        uint32_t occluderCount{};
+    };
 
     class ContentLoader final : public Singleton<ContentLoader>
     {
@@ -25,22 +35,45 @@ namespace ili
             m_pDevice = device;
         }
 
-        std::shared_ptr<Model> LoadModelFromFile(const std::string& filepath) const;
+        // buildMeshBvh keeps the triangles on the CPU for ray queries, see Model
+        std::shared_ptr<Model> LoadModelFromFile(const std::string& filepath, bool buildMeshBvh = false) const;
+        // The files are parsed in parallel on the JobSystem, the models are uploaded on the calling thread. Same order as the paths
+        std::vector<std::shared_ptr<Model>> LoadModelsFromFiles(const std::vector<std::string>& filepaths, bool buildMeshBvh = false) const;
+        // CPU only, does not need the device
+        std::shared_ptr<OccluderMesh> LoadOccluderFromFile(const std::string& filepath) const;
         std::shared_ptr<Texture> LoadTextureFromFile(const std::string& filepath) const;
         std::shared_ptr<Texture> CreateTextureFromColor(const glm::vec4& color);
-    private:
-        friend class Singleton<ContentLoader>;
-        ContentLoader() = default;
 
-        ili::Device* m_pDevice = nullptr;
-        std::shared_ptr<Texture> LoadTextureFromData(VkExtent3D extent, VkFormat format, const void* data, VkDeviceSize dataSize) const;
+        ContentStats GetContentStats() const;
 
+        // OBJ file parsed into an indexed mesh with duplicate vertices merged, CPU only
         struct Builder
         {
             std::vector<ili::Model::Vertex> vertices{};
             std::vector<uint32_t> indices{};
 
+            // Throws when the file cannot be parsed
             void LoadModel(const std::string& filepath);
         };
+    private:
+        friend class Singleton<ContentLoader>;
+        ContentLoader() = default;
+
+        template <typename T>
+        std::shared_ptr<T> Track(std::vector<std::weak_ptr<T>>& resources, std::shared_ptr<T> pResource) const
+        {
+            const std::lock_guard lock{ m_TrackingMutex };
+            resources.push_back(pResource);
+            return pResource;
+        }
+
+        // Only weak references, the loader never keeps anything alive
+        mutable std::mutex m_TrackingMutex{};
+        mutable std::vector<std::weak_ptr<Model>> m_LoadedModels{};
+        mutable std::vector<std::weak_ptr<Texture>> m_LoadedTextures{};
+        mutable std::vector<std::weak_ptr<OccluderMesh>> m_LoadedOccluders{};
+
+        ili::Device* m_pDevice = nullptr;
+        std::shared_ptr<Texture> LoadTextureFromData(VkExtent3D extent, VkFormat format, const void* data, VkDeviceSize dataSize) const;
     };
 }
@@ -0,0 +1,137 @@
+﻿#include "CpuProfiler.h"
+
+#ifdef ILIAD_ENABLE_CPU_PROFILER
+
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+#include "Utils.h"
+
+namespace ili
+{
+	void CpuProfiler::RecordScope(const char* name, int64_t start, int64_t end)
+	{
+		Record(GetThreadBuffer(), { name, start, end - start, m_FrameIndex.load(std::memory_order_relaxed) });
+	}
+
+	void CpuProfiler::MarkFrame()
+	{
+		const uint64_t frame = m_FrameIndex.fetch_add(1, std::memory_order_relaxed) + 1;
+		Record(GetThreadBuffer(), { "Frame", GetTime(), -1, frame });
+	}
+
+	void CpuProfiler::SetThreadName(const std::string& name)
+	{
+		ThreadBuffer& buffer = GetThreadBuffer();
+
+		const std::lock_guard lock{ m_BuffersMutex };
+		buffer.name = name;
+	}
+
+	void CpuProfiler::WriteChromeTrace(const std::string& filePath) const
+	{
+		std::ofstream file(filePath);
+		if (!file.is_open())
+		{
+			throw std::runtime_error("Failed to open file: " + filePath);
+		}
+
+		// The format wants microseconds, the fraction keeps the nanoseconds
+		file << std::fixed << std::setprecision(3);
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+		const std::lock_guard lock{ m_BuffersMutex };
+
+		bool isFirst{ true };
+		const auto separate = [&file, &isFirst]()
+		{
+			if (!isFirst) file << ",\n";
+			isFirst = false;
+		};
+
+		for (const auto& pBuffer : m_ThreadBuffers)
+		{
+			if (!pBuffer->name.empty())
+			{
+				separate();
+				file << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << pBuffer->threadId
+					<< R"(,"args":{"name":")" << Utils::EscapeJson(pBuffer->name) << "\"}}";
+			}
+
+			const uint64_t count = pBuffer->writeCount.load(std::memory_order_acquire);
+			const uint64_t first = count > EVENTS_PER_THREAD ? count - EVENTS_PER_THREAD : 0;
+
+			for (uint64_t i = first; i < count; ++i)
+			{
+				CpuProfileEvent event{};
+				if (!ReadEvent(pBuffer->events[i % EVENTS_PER_THREAD], i, event)) continue;
+
+				separate();
+				if (event.duration < 0)
+				{
+					file << R"({"name":")" << Utils::EscapeJson(event.name) << R"(","ph":"i","s":"g","pid":1,"tid":)" << pBuffer->threadId
+						<< ",\"ts\":" << static_cast<double>(event.start) / 1000.0
+						<< R"(,"args":{"frame":)" << event.frame << "}}";
+				}
+				else
+				{
+					file << R"({"name":")" << Utils::EscapeJson(event.name) << R"(","ph":"X","pid":1,"tid":)" << pBuffer->threadId
+						<< ",\"ts\":" << static_cast<double>(event.start) / 1000.0
+						<< ",\"dur\":" << static_cast<double>(event.duration) / 1000.0
+						<< R"(,"args":{"frame":)" << event.frame << "}}";
+				}
+			}
+		}
+
+		file << "\n]}\n";
+	}
+
+	CpuProfiler::ThreadBuffer& CpuProfiler::GetThreadBuffer()
+	{
+		thread_local ThreadBuffer* pThreadBuffer{};
+		if (pThreadBuffer) return *pThreadBuffer;
+
+		const std::lock_guard lock{ m_BuffersMutex };
+		auto pBuffer = std::make_unique<ThreadBuffer>();
+		pBuffer->threadId = static_cast<uint32_t>(m_ThreadBuffers.size());
+		pThreadBuffer = pBuffer.get();
+		m_ThreadBuffers.push_back(std::move(pBuffer));
+
+		return *pThreadBuffer;
+	}
+
+	void CpuProfiler::Record(ThreadBuffer& buffer, const CpuProfileEvent& event)
+	{
+		const uint64_t count = buffer.writeCount.load(std::memory_order_relaxed);
+		EventSlot& slot = buffer.events[count % EVENTS_PER_THREAD];
+
+		// The fence keeps the new fields from becoming visible before the odd sequence
+		slot.sequence.store(2 * count + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.name.store(event.name, std::memory_order_relaxed);
+		slot.start.store(event.start, std::memory_order_relaxed);
+		slot.duration.store(event.duration, std::memory_order_relaxed);
+		slot.frame.store(event.frame, std::memory_order_relaxed);
+		slot.sequence.store(2 * count + 2, std::memory_order_release);
+
+		buffer.writeCount.store(count + 1, std::memory_order_release);
+	}
+
+	bool CpuProfiler::ReadEvent(const EventSlot& slot, uint64_t eventIndex, CpuProfileEvent& event)
+	{
+		const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+		if (sequence != 2 * eventIndex + 2) return false;
+
+		event.name = slot.name.load(std::memory_order_relaxed);
+		event.start = slot.start.load(std::memory_order_relaxed);
+		event.duration = slot.duration.load(std::memory_order_relaxed);
+		event.frame = slot.frame.load(std::memory_order_relaxed);
+
+		// A writer that started meanwhile has changed the sequence by the time the fields were read
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return slot.sequence.load(std::memory_order_relaxed) == sequence;
+	}
+}
+
+#endif
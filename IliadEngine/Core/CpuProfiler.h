@@ -0,0 +1,144 @@
+﻿#pragma once
+
+// Release builds leave the profiler out completely unless ILIAD_ENABLE_CPU_PROFILER is defined,
+// e.g. through the ILIAD_CPU_PROFILER CMake option
+#if !defined(ILIAD_ENABLE_CPU_PROFILER) && !defined(NDEBUG)
+#define ILIAD_ENABLE_CPU_PROFILER
+#endif
+
+#ifdef ILIAD_ENABLE_CPU_PROFILER
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Singleton.h"
+
+namespace ili
+{
+	struct CpuProfileEvent
+	{
+		// Must outlive the profiler, string literals and __func__ do
+		const char* name{};
+		// Nanoseconds since the profiler was created
+		int64_t start{};
+		// Negative for frame markers
+		int64_t duration{};
+		uint64_t frame{};
+	};
+
+	/**
+	 * Records timed scopes and frame markers of every thread and writes them as a Chrome trace
+	 * (chrome://tracing, Perfetto). Each thread owns a ring buffer that only it writes to, so recording takes no lock,
+	 * the mutex is only taken when a thread records for the first time and while writing the trace.
+	 * Use the ILIAD_PROFILE_* macros instead of the class, they disappear when the profiler is compiled out.
+	 */
+	class CpuProfiler final : public Singleton<CpuProfiler>
+	{
+	public:
+		// Per thread, older events are overwritten once a thread has recorded more
+		static constexpr uint32_t EVENTS_PER_THREAD = 1 << 16;
+
+		CpuProfiler(const CpuProfiler& other) = delete;
+		CpuProfiler(CpuProfiler&& other) noexcept = delete;
+		CpuProfiler& operator=(const CpuProfiler& other) = delete;
+		CpuProfiler& operator=(CpuProfiler&& other) noexcept = delete;
+		virtual ~CpuProfiler() override = default;
+
+		int64_t GetTime() const
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_Epoch).count();
+		}
+
+		void RecordScope(const char* name, int64_t start, int64_t end);
+		// Marks the start of a new frame on the calling thread
+		void MarkFrame();
+		// Shown instead of the thread id in the trace viewer
+		void SetThreadName(const std::string& name);
+
+		/**
+		 * Writes the recorded events in the Chrome trace_event JSON format.
+		 * Threads may keep recording meanwhile, events they overwrite while the file is written are left out
+		 */
+		void WriteChromeTrace(const std::string& filePath) const;
+
+	private:
+		friend class Singleton<CpuProfiler>;
+		CpuProfiler() = default;
+
+		// A CpuProfileEvent behind a sequence lock, the writer of the trace copies it while its thread may overwrite it
+		struct EventSlot
+		{
+			// 2 * (n + 1) once event n is written, odd while it is being written
+			std::atomic<uint64_t> sequence{};
+			std::atomic<const char*> name{};
+			std::atomic<int64_t> start{};
+			std::atomic<int64_t> duration{};
+			std::atomic<uint64_t> frame{};
+		};
+
+		struct ThreadBuffer
+		{
+			std::array<EventSlot, EVENTS_PER_THREAD> events{};
+			// Only ever incremented by the owning thread
+			std::atomic<uint64_t> writeCount{};
+			uint32_t threadId{};
+			std::string name{};
+		};
+
+		ThreadBuffer& GetThreadBuffer();
+		static void Record(ThreadBuffer& buffer, const CpuProfileEvent& event);
+		// False when the slot no longer holds event eventIndex, or it was overwritten while it was copied
+		static bool ReadEvent(const EventSlot& slot, uint64_t eventIndex, CpuProfileEvent& event);
+
+		std::chrono::steady_clock::time_point m_Epoch{ std::chrono::steady_clock::now() };
+		std::atomic<uint64_t> m_FrameIndex{};
+
+		// Buffers stay alive after their thread exits so its events still end up in the trace
+		mutable std::mutex m_BuffersMutex{};
+		std::vector<std::unique_ptr<ThreadBuffer>> m_ThreadBuffers{};
+	};
+
+	class CpuProfileScope final
+	{
+	public:
+		explicit CpuProfileScope(const char* name) : m_Name{ name }, m_Start{ CpuProfiler::GetInstance().GetTime() } {}
+		~CpuProfileScope()
+		{
+			CpuProfiler& profiler = CpuProfiler::GetInstance();
+			profiler.RecordScope(m_Name, m_Start, profiler.GetTime());
+		}
+
+		CpuProfileScope(const CpuProfileScope&) = delete;
+		CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+		CpuProfileScope(CpuProfileScope&&) = delete;
+		CpuProfileScope& operator=(CpuProfileScope&&) = delete;
+
+	private:
+		const char* m_Name;
+		int64_t m_Start;
+	};
+}
+
+#define ILIAD_PROFILE_CONCAT_INNER(a, b) a##b
+#define ILIAD_PROFILE_CONCAT(a, b) ILIAD_PROFILE_CONCAT_INNER(a, b)
+
+// Times the rest of the enclosing block
+#define ILIAD_PROFILE_SCOPE(name) const ::ili::CpuProfileScope ILIAD_PROFILE_CONCAT(cpuProfileScope, __LINE__){ name }
+#define ILIAD_PROFILE_FUNCTION() ILIAD_PROFILE_SCOPE(__func__)
+#define ILIAD_PROFILE_FRAME() ::ili::CpuProfiler::GetInstance().MarkFrame()
+#define ILIAD_PROFILE_THREAD(name) ::ili::CpuProfiler::GetInstance().SetThreadName(name)
+
+#else
+
+#define ILIAD_PROFILE_SCOPE(name) ((void)0)
+#define ILIAD_PROFILE_FUNCTION() ((void)0)
+#define ILIAD_PROFILE_FRAME() ((void)0)
+#define ILIAD_PROFILE_THREAD(name) ((void)0)
+
+#endif
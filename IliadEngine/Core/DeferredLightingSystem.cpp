@@ -0,0 +1,96 @@
+﻿#include "DeferredLightingSystem.h"
+
+#include <array>
+#include <cassert>
+
+#include "Structs/FrameInfo.h"
+
+namespace ili
+{
+	namespace
+	{
+		constexpr uint32_t LIGHT_VOLUME_VERTEX_COUNT = 36;
+	}
+
+	DeferredLightingSystem::DeferredLightingSystem(Device& device, PipelineRegistry& pipelineRegistry, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) :
+		m_Device(device),
+		m_PipelineRegistry(pipelineRegistry)
+	{
+		CreatePipelineLayout(globalSetLayout);
+		CreatePipelines(renderPass);
+	}
+
+	void DeferredLightingSystem::CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout)
+	{
+		m_pGBufferSetLayout = &m_PipelineRegistry.GetDescriptorSetLayout(DescriptorSetLayout::Builder(m_Device)
+			.AddBinding(0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT) // Albedo
+			.AddBinding(1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT) // Normal
+			.AddBinding(2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT) // Metallic, roughness, AO
+			.AddBinding(3, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)); // Depth
+
+		const std::vector<VkDescriptorSetLayout> descriptorSetLayouts = { globalSetLayout, m_pGBufferSetLayout->GetDescriptorSetLayout() };
+
+		m_PipelineLayout = m_PipelineRegistry.GetPipelineLayout(descriptorSetLayouts, {});
+	}
+
+	void DeferredLightingSystem::CreatePipelines(VkRenderPass renderPass)
+	{
+		assert(m_PipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+		PipelineConfigInfo pipelineConfig{};
+		Pipeline::GetDefaultPipelineConfigInfo(pipelineConfig);
+		pipelineConfig.vertexAttributeDescriptions.clear();
+		pipelineConfig.vertexBindingDescriptions.clear();
+
+		// Every light adds onto the swap chain image
+		pipelineConfig.colorBlendAttachment.blendEnable = VK_TRUE;
+		pipelineConfig.colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		pipelineConfig.colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		pipelineConfig.colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+		pipelineConfig.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		pipelineConfig.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		pipelineConfig.colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+		// Depth is bound read-only in the lighting subpass
+		pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+		pipelineConfig.renderPass = renderPass;
+		pipelineConfig.subpass = GBuffer::LIGHTING_SUBPASS;
+		pipelineConfig.pipelineLayout = m_PipelineLayout;
+
+		pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+		m_pAmbientPipeline = m_PipelineRegistry.GetPipeline("Assets/CompiledShaders/deferred_ambient.vert.spv", "Assets/CompiledShaders/deferred_ambient.frag.spv", pipelineConfig);
+
+		// Only the back faces are drawn, a fragment passes when the scene surface is in front of the far side of the volume
+		pipelineConfig.depthStencilInfo.depthTestEnable = VK_TRUE;
+		pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;
+		pipelineConfig.rasterizationInfo.cullMode = VK_CULL_MODE_FRONT_BIT;
+		pipelineConfig.rasterizationInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+		m_pLightVolumePipeline = m_PipelineRegistry.GetPipeline("Assets/CompiledShaders/deferred_light.vert.spv", "Assets/CompiledShaders/deferred_light.frag.spv", pipelineConfig);
+	}
+
+	void DeferredLightingSystem::Render(const FrameInfo& frameInfo, const GBuffer& gBuffer, uint32_t imageIndex, int lightCount)
+	{
+		auto inputAttachmentInfos = gBuffer.GetInputAttachmentInfos(imageIndex);
+
+		VkDescriptorSet gBufferDescriptorSet;
+		DescriptorWriter(*m_pGBufferSetLayout, frameInfo.frameDescriptorPool)
+			.WriteImage(0, &inputAttachmentInfos[0])
+			.WriteImage(1, &inputAttachmentInfos[1])
+			.WriteImage(2, &inputAttachmentInfos[2])
+			.WriteImage(3, &inputAttachmentInfos[3])
+			.Build(gBufferDescriptorSet);
+
+		const std::array<VkDescriptorSet, 2> descriptorSets = { frameInfo.globalDescriptorSet, gBufferDescriptorSet };
+		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0,
+			static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
+
+		m_pAmbientPipeline->Bind(frameInfo.commandBuffer);
+		vkCmdDraw(frameInfo.commandBuffer, 3, 1, 0, 0);
+
+		if (lightCount <= 0) return;
+
+		m_pLightVolumePipeline->Bind(frameInfo.commandBuffer);
+		vkCmdDraw(frameInfo.commandBuffer, LIGHT_VOLUME_VERTEX_COUNT, static_cast<uint32_t>(lightCount), 0, 0);
+	}
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+
+#include "Graphics/Descriptors.h"
+#include "Graphics/Device.h"
+#include "Graphics/GBuffer.h"
+#include "Graphics/Pipeline.h"
+#include "Graphics/PipelineRegistry.h"
+
+namespace ili
+{
+	struct FrameInfo;
+
+	/**
+	 * Lighting subpass of the deferred path.
+	 * A fullscreen triangle adds the ambient term, then every point light is drawn as one instance of a cube that
+	 * bounds its range, so a light only shades the pixels it can reach. The cube's back faces are depth tested with
+	 * GREATER_OR_EQUAL, which skips pixels whose surface lies behind the light volume and keeps working with the
+	 * camera inside it. A light whose cube reaches past the far plane would lose those back faces to clipping, it is
+	 * drawn as a full-screen triangle on the far plane instead. Lights are read from the light buffer filled by the
+	 * ClusteredLightingSystem.
+	 */
+	class DeferredLightingSystem
+	{
+	public:
+		DeferredLightingSystem(Device& device, PipelineRegistry& pipelineRegistry, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+		~DeferredLightingSystem() = default;
+
+		DeferredLightingSystem(const DeferredLightingSystem&) = delete;
+		DeferredLightingSystem& operator=(const DeferredLightingSystem&) = delete;
+		DeferredLightingSystem(DeferredLightingSystem&&) = delete;
+		DeferredLightingSystem& operator=(DeferredLightingSystem&&) = delete;
+
+		// Must be recorded in the lighting subpass, imageIndex selects the G-buffer of the current swap chain image
+		void Render(const FrameInfo& frameInfo, const GBuffer& gBuffer, uint32_t imageIndex, int lightCount);
+
+	private:
+		void CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout);
+		void CreatePipelines(VkRenderPass renderPass);
+
+		Device& m_Device;
+		PipelineRegistry& m_PipelineRegistry;
+
+		// All owned by the pipeline registry
+		Pipeline* m_pAmbientPipeline{};
+		Pipeline* m_pLightVolumePipeline{};
+		VkPipelineLayout m_PipelineLayout{};
+		DescriptorSetLayout* m_pGBufferSetLayout{};
+	};
+}
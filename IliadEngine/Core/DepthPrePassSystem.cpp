@@ -0,0 +1,115 @@
+﻿#include "DepthPrePassSystem.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "OcclusionCullingSystem.h"
+#include "SoftwareOcclusionCuller.h"
+#include "SceneGraph/ModelComponent.h"
+#include "SceneGraph/TransformComponent.h"
+#include "Structs/FrameInfo.h"
+
+namespace ili
+{
+	// Same layout as the mesh render systems so the pipeline registry hands out a single shared pipeline layout.
+	// The normal matrix is not read by the depth shader
+	struct DepthPrePassPushConstantData
+	{
+		glm::mat4 modelMatrix{ 1.f };
+		glm::mat4 normalMatrix{ 1.f };
+	};
+
+	DepthPrePassSystem::DepthPrePassSystem(Device& device, PipelineRegistry& pipelineRegistry, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) :
+		m_Device(device),
+		m_PipelineRegistry(pipelineRegistry)
+	{
+		CreatePipelineLayout(globalSetLayout);
+		CreatePipeline(renderPass);
+	}
+
+	void DepthPrePassSystem::CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout)
+	{
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(DepthPrePassPushConstantData);
+
+		const std::vector<VkDescriptorSetLayout> descriptorSetLayouts = { globalSetLayout };
+
+		m_PipelineLayout = m_PipelineRegistry.GetPipelineLayout(descriptorSetLayouts, { pushConstantRange });
+	}
+
+	void DepthPrePassSystem::CreatePipeline(VkRenderPass renderPass)
+	{
+		PipelineConfigInfo pipelineConfig{};
+
+		Pipeline::GetDefaultPipelineConfigInfo(pipelineConfig);
+
+		// Only the position attribute is fetched, the stride stays the one of the full vertex
+		pipelineConfig.vertexAttributeDescriptions.resize(1);
+
+		// No fragment shader, so nothing may be written to the color attachment
+		pipelineConfig.colorBlendAttachment.colorWriteMask = 0;
+
+		pipelineConfig.renderPass = renderPass;
+		pipelineConfig.pipelineLayout = m_PipelineLayout;
+		m_pPipeline = m_PipelineRegistry.GetPipeline("Assets/CompiledShaders/depth_prepass.vert.spv", "", pipelineConfig);
+	}
+
+	void DepthPrePassSystem::RenderGameObjects(const FrameInfo& frameInfo, const ModelList& models)
+	{
+		m_RenderQueue.Clear();
+
+		const glm::mat4& view = frameInfo.camera.GetView();
+
+		for (const ModelInstance& instance : models)
+		{
+			if (!instance.pModel) continue;
+
+			// Materials do not matter for depth, so draws only group by mesh and go front-to-back within it
+			Model* pModel = instance.pModel.get();
+			if (frameInfo.pSoftwareOcclusion &&
+				!frameInfo.pSoftwareOcclusion->IsVisible(pModel->GetBoundingSphere().GetTransformed(instance.modelMatrix), m_Stats)) continue;
+
+			const float viewDepth = (view * instance.modelMatrix[3]).z;
+
+			m_RenderQueue.Add({ RenderQueue::MakeOpaqueKey(m_pPipeline->GetId(), 0, pModel->GetId(), viewDepth), &instance, m_pPipeline, pModel, nullptr });
+		}
+
+		if (m_RenderQueue.GetSize() == 0) return;
+
+		m_RenderQueue.Sort();
+
+		m_pPipeline->Bind(frameInfo.commandBuffer);
+		++m_Stats.pipelineBinds;
+
+		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1,
+			&frameInfo.globalDescriptorSet, 0, nullptr);
+		++m_Stats.descriptorSetBinds;
+
+		const Model* pBoundModel{};
+		for (const auto& packet : m_RenderQueue.GetPackets())
+		{
+			DepthPrePassPushConstantData pushData{};
+			pushData.modelMatrix = packet.pInstance->modelMatrix;
+
+			vkCmdPushConstants(frameInfo.commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(DepthPrePassPushConstantData), &pushData);
+
+			if (packet.pModel != pBoundModel)
+			{
+				packet.pModel->Bind(frameInfo.commandBuffer);
+				pBoundModel = packet.pModel;
+				++m_Stats.meshBinds;
+			}
+
+			if (frameInfo.pOcclusionCulling)
+				frameInfo.pOcclusionCulling->Draw(frameInfo, *packet.pInstance);
+			else
+				packet.pModel->Draw(frameInfo.commandBuffer);
+			++m_Stats.drawCalls;
+			++m_Stats.instanceCount;
+			m_Stats.triangleCount += packet.pModel->GetTriangleCount();
+		}
+	}
+}
@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include "Graphics/Pipeline.h"
+#include "Graphics/PipelineRegistry.h"
+#include "Graphics/RenderQueue.h"
+#include "Graphics/Device.h"
+#include "SceneGraph/GameObject.h"
+#include "SceneGraph/ModelComponent.h"
+#include "Structs/RenderStats.h"
+
+namespace ili
+{
+	struct FrameInfo;
+
+	// Lays down the depth of every opaque mesh with a position-only pipeline, so the shading passes after it
+	// can test with EQUAL and only run their fragment shaders once per pixel
+	class DepthPrePassSystem
+	{
+	public:
+		DepthPrePassSystem(Device& device, PipelineRegistry& pipelineRegistry, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+		~DepthPrePassSystem() = default;
+
+		DepthPrePassSystem(const DepthPrePassSystem&) = delete;
+		DepthPrePassSystem& operator=(const DepthPrePassSystem&) = delete;
+		DepthPrePassSystem(DepthPrePassSystem&&) = delete;
+		DepthPrePassSystem& operator=(DepthPrePassSystem&&) = delete;
+
+		void RenderGameObjects(const FrameInfo& frameInfo, const ModelList& models);
+
+		void ResetStats() { m_Stats = {}; }
+		const RenderStats& GetStats() const { return m_Stats; }
+	private:
+		void CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout);
+		void CreatePipeline(VkRenderPass renderPass);
+
+		Device& m_Device;
+		PipelineRegistry& m_PipelineRegistry;
+
+		// Both are owned by the pipeline registry
+		Pipeline* m_pPipeline{};
+		VkPipelineLayout m_PipelineLayout{};
+
+		RenderQueue m_RenderQueue{};
+		RenderStats m_Stats{};
+	};
+}
@@ -0,0 +1,53 @@
+﻿#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace ili
+{
+	namespace
+	{
+		// Weight of a new sample in the moving average
+		constexpr float SMOOTHING = .1f;
+		// The scale only grows again once the frame comfortably fits the budget
+		constexpr float GROW_THRESHOLD = .85f;
+		// Aim slightly below the budget so that a single slow frame does not trigger a drop right away
+		constexpr float TARGET_MARGIN = .9f;
+	}
+
+	void DynamicResolutionController::SetSettings(const DynamicResolutionSettings& settings)
+	{
+		assert(settings.minScale > 0.f && settings.minScale <= settings.maxScale && "Invalid dynamic resolution bounds");
+		assert(settings.targetFrameTime > 0.f && "The target frame time has to be positive");
+
+		m_Settings = settings;
+		m_Scale = std::clamp(m_Scale, m_Settings.minScale, m_Settings.maxScale);
+	}
+
+	float DynamicResolutionController::Update(float gpuFrameTime)
+	{
+		if (gpuFrameTime <= 0.f) return m_Scale;
+
+		m_SmoothedFrameTime = m_SmoothedFrameTime == 0.f ? gpuFrameTime : std::lerp(m_SmoothedFrameTime, gpuFrameTime, SMOOTHING);
+
+		if (++m_FramesSinceChange < SETTLE_FRAMES) return m_Scale;
+
+		const float target = m_Settings.targetFrameTime;
+		const bool isOverBudget = m_SmoothedFrameTime > target;
+		const bool hasHeadroom = m_SmoothedFrameTime < target * GROW_THRESHOLD;
+		if (!isOverBudget && !hasHeadroom) return m_Scale;
+
+		const float desiredScale = m_Scale * std::sqrt(target * TARGET_MARGIN / m_SmoothedFrameTime);
+		// Rounded down onto the step grid, the epsilon keeps exact steps from falling one step short
+		const float newScale = std::clamp(std::floor(desiredScale / SCALE_STEP + 1e-3f) * SCALE_STEP, m_Settings.minScale, m_Settings.maxScale);
+
+		if (std::abs(newScale - m_Scale) < SCALE_STEP * .5f) return m_Scale;
+
+		m_Scale = newScale;
+		m_FramesSinceChange = 0;
+		// Times measured at the old scale say nothing about the new one
+		m_SmoothedFrameTime = 0.f;
+		return m_Scale;
+	}
+}
@@ -0,0 +1,52 @@
+﻿#pragma once
+
+namespace ili
+{
+	struct DynamicResolutionSettings
+	{
+		bool enabled{ false };
+		// GPU time one frame may take, in milliseconds
+		float targetFrameTime{ 1000.f / 60.f };
+		// Bounds of the scale applied to both sides of the render extent
+		float minScale{ .5f };
+		float maxScale{ 1.f };
+	};
+
+	/**
+	 * Picks the render scale from measured GPU frame times.
+	 * Shading cost grows with the pixel count, so the scale moves with the square root of the budget ratio.
+	 * The scale only changes in fixed steps, and only after the smoothed time has left a band around the target
+	 * for a few frames, so the resolution does not oscillate from frame to frame.
+	 */
+	class DynamicResolutionController final
+	{
+	public:
+		static constexpr float SCALE_STEP = .05f;
+		// Frames to wait after a change, the frames in flight still report times measured at the old scale
+		static constexpr int SETTLE_FRAMES = 10;
+
+		DynamicResolutionController() = default;
+		~DynamicResolutionController() = default;
+
+		DynamicResolutionController(const DynamicResolutionController&) = delete;
+		DynamicResolutionController& operator=(const DynamicResolutionController&) = delete;
+		DynamicResolutionController(DynamicResolutionController&&) = delete;
+		DynamicResolutionController& operator=(DynamicResolutionController&&) = delete;
+
+		// Keeps the current scale if it is still within the new bounds
+		void SetSettings(const DynamicResolutionSettings& settings);
+		const DynamicResolutionSettings& GetSettings() const { return m_Settings; }
+
+		// Feeds the GPU time of a finished frame in milliseconds, returns the scale for the next frame
+		float Update(float gpuFrameTime);
+
+		float GetScale() const { return m_Scale; }
+		float GetSmoothedFrameTime() const { return m_SmoothedFrameTime; }
+
+	private:
+		DynamicResolutionSettings m_Settings{};
+		float m_Scale{ 1.f };
+		float m_SmoothedFrameTime{};
+		int m_FramesSinceChange{};
+	};
+}
@@ -0,0 +1,160 @@
+﻿#include "GBufferRenderSystem.h"
+
+#include <array>
+#include <cassert>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "Graphics/GBuffer.h"
+#include "SoftwareOcclusionCuller.h"
+#include "SceneGraph/ModelComponent.h"
+#include "SceneGraph/TransformComponent.h"
+#include "Structs/FrameInfo.h"
+
+namespace ili
+{
+	struct GBufferPushConstantData
+	{
+		glm::mat4 modelMatrix{ 1.f };
+		glm::mat4 normalMatrix{ 1.f };
+	};
+
+	GBufferRenderSystem::GBufferRenderSystem(Device& device, PipelineRegistry& pipelineRegistry, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) :
+		m_Device(device),
+		m_PipelineRegistry(pipelineRegistry)
+	{
+		CreatePipelineLayout(globalSetLayout);
+		CreatePipelines(renderPass);
+	}
+
+	void GBufferRenderSystem::CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout)
+	{
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(GBufferPushConstantData);
+
+		m_pMaterialSetLayout = &m_PipelineRegistry.GetDescriptorSetLayout(DescriptorSetLayout::Builder(m_Device)
+			.AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // Albedo Map
+			.AddBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // Normal Map
+			.AddBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // Metallic Map
+			.AddBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // Roughness Map
+			.AddBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)); // AO Map
+
+		// The vertex color pipeline never binds set 1, sharing the layout keeps set 0 bound across both pipelines
+		const std::vector<VkDescriptorSetLayout> descriptorSetLayouts = { globalSetLayout, m_pMaterialSetLayout->GetDescriptorSetLayout() };
+
+		m_PipelineLayout = m_PipelineRegistry.GetPipelineLayout(descriptorSetLayouts, { pushConstantRange });
+	}
+
+	void GBufferRenderSystem::CreatePipelines(VkRenderPass renderPass)
+	{
+		assert(m_PipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+		PipelineConfigInfo pipelineConfig{};
+		Pipeline::GetDefaultPipelineConfigInfo(pipelineConfig);
+
+		// One blend state per G-buffer target, none of them blend
+		std::array<VkPipelineColorBlendAttachmentState, GBuffer::GEOMETRY_COLOR_ATTACHMENT_COUNT> blendAttachments{};
+		blendAttachments.fill(pipelineConfig.colorBlendAttachment);
+		pipelineConfig.colorBlendInfo.attachmentCount = static_cast<uint32_t>(blendAttachments.size());
+		pipelineConfig.colorBlendInfo.pAttachments = blendAttachments.data();
+
+		pipelineConfig.renderPass = renderPass;
+		pipelineConfig.subpass = GBuffer::GEOMETRY_SUBPASS;
+		pipelineConfig.pipelineLayout = m_PipelineLayout;
+
+		m_pMaterialPipeline = m_PipelineRegistry.GetPipeline("Assets/CompiledShaders/gbuffer.vert.spv", "Assets/CompiledShaders/gbuffer.frag.spv", pipelineConfig);
+		m_pVertexColorPipeline = m_PipelineRegistry.GetPipeline("Assets/CompiledShaders/gbuffer.vert.spv", "Assets/CompiledShaders/gbuffer_color.frag.spv", pipelineConfig);
+	}
+
+	void GBufferRenderSystem::RenderGameObjects(const FrameInfo& frameInfo, const ModelList& models)
+	{
+		m_RenderQueue.Clear();
+
+		const glm::mat4& view = frameInfo.camera.GetView();
+
+		for (const ModelInstance& instance : models)
+		{
+			if (!instance.pModel) continue;
+
+			Model* pModel = instance.pModel.get();
+			if (frameInfo.pSoftwareOcclusion &&
+				!frameInfo.pSoftwareOcclusion->IsVisible(pModel->GetBoundingSphere().GetTransformed(instance.modelMatrix), m_Stats)) continue;
+
+			const MaterialTextures* pMaterial = instance.pMaterial.get();
+			Pipeline* pPipeline = pMaterial ? m_pMaterialPipeline : m_pVertexColorPipeline;
+			const float viewDepth = (view * instance.modelMatrix[3]).z;
+
+			m_RenderQueue.Add({
+				RenderQueue::MakeOpaqueKey(pPipeline->GetId(), pMaterial ? pMaterial->materialId : 0, pModel->GetId(), viewDepth),
+				&instance, pPipeline, pModel, pMaterial });
+		}
+
+		if (m_RenderQueue.GetSize() == 0) return;
+
+		m_RenderQueue.Sort();
+
+		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1,
+			&frameInfo.globalDescriptorSet, 0, nullptr);
+		++m_Stats.descriptorSetBinds;
+
+		const Pipeline* pBoundPipeline{};
+		const MaterialTextures* pBoundMaterial{};
+		const Model* pBoundModel{};
+		for (const auto& packet : m_RenderQueue.GetPackets())
+		{
+			if (packet.pPipeline != pBoundPipeline)
+			{
+				packet.pPipeline->Bind(frameInfo.commandBuffer);
+				pBoundPipeline = packet.pPipeline;
+				++m_Stats.pipelineBinds;
+			}
+
+			// Draws are grouped by material, so one descriptor set is written per material instead of per object
+			if (packet.pMaterial && packet.pMaterial != pBoundMaterial)
+			{
+				VkDescriptorImageInfo albedoImageInfo = packet.pMaterial->albedoMap->GetImageInfo();
+				VkDescriptorImageInfo normalImageInfo = packet.pMaterial->normalMap->GetImageInfo();
+				VkDescriptorImageInfo metallicImageInfo = packet.pMaterial->metallicMap->GetImageInfo();
+				VkDescriptorImageInfo roughnessImageInfo = packet.pMaterial->roughnessMap->GetImageInfo();
+				VkDescriptorImageInfo aoImageInfo = packet.pMaterial->aoMap->GetImageInfo();
+
+				VkDescriptorSet materialDescriptorSet;
+				DescriptorWriter(*m_pMaterialSetLayout, frameInfo.frameDescriptorPool)
+					.WriteImage(0, &albedoImageInfo)
+					.WriteImage(1, &normalImageInfo)
+					.WriteImage(2, &metallicImageInfo)
+					.WriteImage(3, &roughnessImageInfo)
+					.WriteImage(4, &aoImageInfo)
+					.Build(materialDescriptorSet);
+
+				vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 1, 1,
+					&materialDescriptorSet, 0, nullptr);
+
+				pBoundMaterial = packet.pMaterial;
+				++m_Stats.descriptorSetBinds;
+			}
+
+			GBufferPushConstantData pushData{};
+			pushData.modelMatrix = packet.pInstance->modelMatrix;
+			pushData.normalMatrix = packet.pInstance->normalMatrix;
+
+			vkCmdPushConstants(frameInfo.commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(GBufferPushConstantData), &pushData);
+
+			if (packet.pModel != pBoundModel)
+			{
+				packet.pModel->Bind(frameInfo.commandBuffer);
+				pBoundModel = packet.pModel;
+				++m_Stats.meshBinds;
+			}
+
+			packet.pModel->Draw(frameInfo.commandBuffer);
+			++m_Stats.drawCalls;
+			++m_Stats.instanceCount;
+			m_Stats.triangleCount += packet.pModel->GetTriangleCount();
+		}
+	}
+}
@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Graphics/Descriptors.h"
+#include "Graphics/Device.h"
+#include "Graphics/Pipeline.h"
+#include "Graphics/PipelineRegistry.h"
+#include "Graphics/RenderQueue.h"
+#include "SceneGraph/GameObject.h"
+#include "SceneGraph/ModelComponent.h"
+#include "Structs/RenderStats.h"
+
+namespace ili
+{
+	struct FrameInfo;
+
+	/**
+	 * Geometry subpass of the deferred path.
+	 * Writes albedo, normal and metallic/roughness/AO of every model into the G-buffer, no lighting is done here.
+	 * Objects with a material sample its maps, objects without one use their vertex color.
+	 */
+	class GBufferRenderSystem
+	{
+	public:
+		GBufferRenderSystem(Device& device, PipelineRegistry& pipelineRegistry, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+		~GBufferRenderSystem() = default;
+
+		GBufferRenderSystem(const GBufferRenderSystem&) = delete;
+		GBufferRenderSystem& operator=(const GBufferRenderSystem&) = delete;
+		GBufferRenderSystem(GBufferRenderSystem&&) = delete;
+		GBufferRenderSystem& operator=(GBufferRenderSystem&&) = delete;
+
+		void RenderGameObjects(const FrameInfo& frameInfo, const ModelList& models);
+
+		void ResetStats() { m_Stats = {}; }
+		const RenderStats& GetStats() const { return m_Stats; }
+	private:
+		void CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout);
+		void CreatePipelines(VkRenderPass renderPass);
+
+		Device& m_Device;
+		PipelineRegistry& m_PipelineRegistry;
+
+		// All owned by the pipeline registry
+		Pipeline* m_pMaterialPipeline{};
+		Pipeline* m_pVertexColorPipeline{};
+		VkPipelineLayout m_PipelineLayout{};
+		DescriptorSetLayout* m_pMaterialSetLayout{};
+
+		RenderQueue m_RenderQueue{};
+		RenderStats m_Stats{};
+	};
+}
@@ -1,5 +1,8 @@
 ﻿#include <chrono>
+#include <cstdio>
+#include <filesystem>
 #include <iostream>
+#include <utility>
 #include <vulkan/vulkan.h>
 #include <GLFW/glfw3.h>
 
@@ -16,7 +19,11 @@
 #include "SceneGraph/SceneManager.h"
 
 #include "IliadGame.h"
+#include "CpuProfiler.h"
+#include "ContentLoader.h"
+#include "JobSystem.h"
 
+#include "SceneGraph/OccluderComponent.h"
 #include "SceneGraph/TransformComponent.h"
 
 namespace ili
@@ -28,7 +35,9 @@ namespace ili
 		OnGamePreparing();
 
 		// INITIALIZE
-		InitializeWindow();
+		// Before anything that loads, the calling thread becomes the main thread of the job system
+		JobSystem::GetInstance().Initialize();
+		if (!IsHeadless()) InitializeWindow();
 		InitializeVulkan();
 
 		ContentLoader::GetInstance().Initialize(m_Device.get());
@@ -46,23 +55,354 @@ namespace ili
 		// Initialize current time
 		m_CurrentTime = std::chrono::high_resolution_clock::now();
 
+		ILIAD_PROFILE_THREAD("Main thread");
+		if (IsHeadless())
+		{
+			RunHeadless(viewerObject);
+			WaitForRenderFrame();
+			vkDeviceWaitIdle(m_Device->GetDevice());
+			JobSystem::GetInstance().Shutdown();
+			return;
+		}
+
 		while (!m_Window->ShouldClose())
 		{
-			glfwPollEvents();
+			ILIAD_PROFILE_FRAME();
+			{
+				ILIAD_PROFILE_SCOPE("Poll events");
+				glfwPollEvents();
+			}
 
 			GameLoop(viewerObject, m_CameraController);
 		}
 
+		WaitForRenderFrame();
 		vkDeviceWaitIdle(m_Device->GetDevice());
+		JobSystem::GetInstance().Shutdown();
+	}
+
+	void IliadGame::RunHeadless(GameObject* viewerObject)
+	{
+		const bool isCapturing = !m_HeadlessSettings.captureDirectory.empty();
+		if (isCapturing) std::filesystem::create_directories(m_HeadlessSettings.captureDirectory);
+
+		for (uint32_t frame{}; frame < m_HeadlessSettings.frameCount; ++frame)
+		{
+			ILIAD_PROFILE_FRAME();
+			GameLoop(viewerObject, m_CameraController);
+
+			const bool isLastFrame = frame + 1 == m_HeadlessSettings.frameCount;
+			const uint32_t interval = m_HeadlessSettings.captureInterval;
+			if (!isCapturing || !(isLastFrame || (interval > 0 && frame % interval == 0))) continue;
+
+			// The capture is of this frame, which may still be recorded
+			WaitForRenderFrame();
+
+			char fileName[32]{};
+			std::snprintf(fileName, sizeof(fileName), "frame_%05u.png", frame);
+			const std::filesystem::path filePath = std::filesystem::path{ m_HeadlessSettings.captureDirectory } / fileName;
+			if (!m_Renderer->SaveFrame(filePath.string()))
+			{
+				std::cerr << "Failed to write frame capture " << filePath.string() << std::endl;
+			}
+		}
 	}
 
 	void IliadGame::GameLoop(GameObject* viewerObject, KeyboardMovementController& cameraController)
 	{
-		// Calculate deltaTime
+		ILIAD_PROFILE_FUNCTION();
+
+		// Calculate deltaTime, fixed when headless so that every run simulates the same frames
 		const auto newTime = std::chrono::high_resolution_clock::now();
-		const auto frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - m_CurrentTime).count();
+		const float frameTime = IsHeadless() ? m_HeadlessSettings.frameTime : std::chrono::duration<float, std::chrono::seconds::period>(newTime - m_CurrentTime).count();
 		m_CurrentTime = newTime;
 
+		// Work that other threads handed to the main thread, like GLFW calls
+		JobSystem::GetInstance().ExecuteMainThreadJobs();
+
+		// There is no input without a window, the viewer stays where the game placed it
+		if (m_Window) HandleWindowInput(viewerObject, cameraController, frameTime);
+		OnUpdate(viewerObject, frameTime);
+
+		PerformanceHud* pHud = GetActivePerformanceHud();
+
+		m_Camera.SetViewYXZ(viewerObject->GetTransform()->GetPosition(), viewerObject->GetTransform()->GetRotationRadians());
+		//m_Camera.SetViewYXZ(viewerObject->GetTransform()->GetPosition(), {glm::radians<float>(-35), 0.f, 0.f});
+
+		// Update camera projection, the swap chain may be recreated while a frame is recorded
+		if (m_RenderCounter.IsDone()) m_AspectRatio = m_Renderer->GetAspectRatio();
+		m_Camera.SetPerspectiveProjection(glm::radians(60.f), m_AspectRatio, 0.1f, 10.f);
+
+		{
+			ILIAD_PROFILE_SCOPE("SceneManager::Update");
+			HudCpuScope hudScope{ pHud, "Scene update" };
+			m_SceneManager.Update(frameTime);
+		}
+		{
+			ILIAD_PROFILE_SCOPE("Scene::UpdateTransforms");
+			HudCpuScope hudScope{ pHud, "Transform propagation" };
+			m_pCurrentScene->UpdateTransforms();
+		}
+
+		// The render thread may still read the other snapshot
+		const uint32_t snapshotIndex = m_RenderSnapshotIndex;
+		m_RenderSnapshotIndex = (m_RenderSnapshotIndex + 1) % RENDER_SNAPSHOT_COUNT;
+		RenderSnapshot& snapshot = m_RenderSnapshots[snapshotIndex];
+		snapshot.frameTime = frameTime;
+		snapshot.pHud = pHud;
+		BuildRenderSnapshot(snapshot, m_SoftwareOcclusionCullers[snapshotIndex]);
+
+		// Frames are recorded one after the other, this bounds the game to one frame ahead of the render thread
+		WaitForRenderFrame();
+
+		// Nothing reads the scene while no frame is recorded, the snapshots keep what they draw alive
+		m_pCurrentScene->DestroyRemovedGameObjects();
+		if (pHud) BuildPerformanceHud(snapshot);
+
+		if (!m_PipelinedRenderingEnabled)
+		{
+			RenderFrame(snapshot);
+			WaitForRenderFrame();
+			return;
+		}
+
+		// Kept until the next WaitForRenderFrame, a job must not throw
+		JobSystem::GetInstance().Run([this, &snapshot]()
+		{
+			try
+			{
+				RenderFrame(snapshot);
+			}
+			catch (...)
+			{
+				m_pRenderException = std::current_exception();
+			}
+		}, &m_RenderCounter);
+	}
+
+	void IliadGame::BuildRenderSnapshot(RenderSnapshot& snapshot, SoftwareOcclusionCuller& softwareOcclusionCuller)
+	{
+		ILIAD_PROFILE_FUNCTION();
+
+		snapshot.camera = m_Camera;
+		snapshot.depthPrePass = m_DepthPrePassEnabled;
+		snapshot.occlusionCulling = m_OcclusionCullingEnabled;
+		snapshot.gpuProfiling = m_GpuProfilingEnabled || snapshot.pHud != nullptr;
+		{
+			ILIAD_PROFILE_SCOPE("Frustum culling");
+			HudCpuScope hudScope{ snapshot.pHud, "Frustum culling" };
+			GatherVisibleObjects(snapshot);
+		}
+
+		snapshot.pSoftwareOcclusion = nullptr;
+		if (m_SoftwareOcclusionCullingEnabled)
+		{
+			ILIAD_PROFILE_SCOPE("Software occlusion culling");
+			HudCpuScope hudScope{ snapshot.pHud, "Software occlusion" };
+			softwareOcclusionCuller.BeginFrame(m_Camera.GetProjection() * m_Camera.GetView());
+			for (const auto [pTransform, pOccluder] : m_pCurrentScene->View<TransformComponent, OccluderComponent>())
+			{
+				if (!pOccluder->GetMesh()) continue;
+
+				softwareOcclusionCuller.RasterizeOccluder(*pOccluder->GetMesh(), pTransform->GetMatrix());
+			}
+			snapshot.pSoftwareOcclusion = &softwareOcclusionCuller;
+		}
+
+		m_RecomputedTransformCount = TransformComponent::ConsumeRecomputeCount();
+	}
+
+	void IliadGame::WaitForRenderFrame()
+	{
+		{
+			ILIAD_PROFILE_SCOPE("Wait for render thread");
+			JobSystem::GetInstance().Wait(m_RenderCounter);
+		}
+
+		if (m_pRenderException) std::rethrow_exception(std::exchange(m_pRenderException, nullptr));
+
+		if (m_IsDynamicResolutionPending) ApplyDynamicResolutionSettings();
+
+		m_FrameStats = m_RecordingFrameStats;
+
+		if (!m_IsFrameSubmitted) return;
+		m_IsFrameSubmitted = false;
+		OnFrameSubmitted();
+	}
+
+	void IliadGame::RenderFrame(const RenderSnapshot& snapshot)
+	{
+		ILIAD_PROFILE_FUNCTION();
+
+		PerformanceHud* pHud = snapshot.pHud;
+
+		// Begin rendering
+		VkCommandBuffer commandBuffer{};
+		{
+			HudCpuScope hudScope{ pHud, "Acquire image" };
+			commandBuffer = m_Renderer->BeginFrame();
+		}
+
+		if (!commandBuffer) return;
+
+		const auto recordStartTime = std::chrono::high_resolution_clock::now();
+		const int frameIndex = m_Renderer->GetFrameIndex();
+		m_FramePools[frameIndex]->ResetPool();
+		const bool isDeferred = m_RenderPath == RenderPath::Deferred;
+		const bool isCulling = snapshot.occlusionCulling && !isDeferred;
+		FrameInfo frameInfo{ frameIndex, snapshot.frameTime, commandBuffer, snapshot.camera, m_GlobalDescriptorSets[frameIndex], *m_FramePools[frameIndex], snapshot.depthPrePass && !isDeferred };
+		if (isCulling) frameInfo.pOcclusionCulling = &m_OcclusionCullingSystem.value();
+		frameInfo.pSoftwareOcclusion = snapshot.pSoftwareOcclusion;
+		// Reset once per frame, the occlusion culled path records the meshes in two phases that add up
+		if (m_DepthPrePassSystem) m_DepthPrePassSystem->ResetStats();
+		if (m_TextureRenderSystem) m_TextureRenderSystem->ResetStats();
+		if (m_RenderSystem) m_RenderSystem->ResetStats();
+		if (m_GBufferRenderSystem) m_GBufferRenderSystem->ResetStats();
+		if (m_GpuProfiler && snapshot.gpuProfiling)
+		{
+			m_GpuProfiler->BeginFrame(commandBuffer, frameIndex);
+			frameInfo.pGpuProfiler = m_GpuProfiler.get();
+		}
+
+		// The fence of this frame slot has been waited on, so the queries recorded in it last time are done.
+		// The second query only holds results when the frame was split by the occlusion culling
+		const uint32_t firstQuery = static_cast<uint32_t>(frameIndex) * OVERDRAW_QUERIES_PER_FRAME;
+		std::vector<uint64_t> statistics{};
+		if (m_OverdrawQueryPool && m_OverdrawQueryPool->GetResults(firstQuery, statistics))
+		{
+			uint64_t& shadedFragmentCount = m_RecordingFrameStats.shadedFragmentCount;
+			shadedFragmentCount = statistics[0];
+			if (m_OverdrawQueryPool->GetResults(firstQuery + 1, statistics)) shadedFragmentCount += statistics[0];
+
+			const VkExtent2D extent = m_Renderer->GetRenderExtent();
+			m_RecordingFrameStats.overdrawFactor = static_cast<float>(shadedFragmentCount) / static_cast<float>(extent.width * extent.height);
+		}
+
+		GlobalUbo globalUbo{};
+		globalUbo.projectionMatrix = snapshot.camera.GetProjection();
+		globalUbo.viewMatrix = snapshot.camera.GetView();
+		globalUbo.inverseViewMatrix = snapshot.camera.GetInverseView();
+		{
+			ILIAD_PROFILE_SCOPE("Light updates");
+			HudCpuScope hudScope{ pHud, "Light updates" };
+			if (m_ClusteredLightingSystem.value().Update(frameInfo, globalUbo, snapshot.pointLights, m_Renderer->GetRenderExtent()))
+			{
+				auto lightBufferInfo = m_ClusteredLightingSystem->GetLightBufferInfo(frameIndex);
+				DescriptorWriter(*m_GlobalSetLayout, *m_GlobalDescriptorPool)
+					.WriteBuffer(1, &lightBufferInfo)
+					.Overwrite(m_GlobalDescriptorSets[frameIndex]);
+			}
+			m_PointLightSystem.value().Update(frameInfo, snapshot.pointLights);
+		}
+
+		{
+			ILIAD_PROFILE_SCOPE("UBO write");
+			HudCpuScope hudScope{ pHud, "UBO write" };
+			m_UboBuffers[frameIndex]->WriteToBuffer(&globalUbo);
+			m_UboBuffers[frameIndex]->Flush();
+		}
+
+		if (m_OverdrawQueryPool)
+		{
+			m_OverdrawQueryPool->Reset(commandBuffer, firstQuery);
+			m_OverdrawQueryPool->Reset(commandBuffer, firstQuery + 1);
+		}
+
+		if (isDeferred)
+		{
+			ILIAD_PROFILE_SCOPE("Record deferred frame");
+			HudCpuScope hudScope{ pHud, "Record commands" };
+
+			// The light volumes read the light buffer directly, the cluster lists are not needed
+			m_Renderer->BeginDeferredRenderPass(commandBuffer);
+			GpuProfileScope deferredPassScope{ frameInfo.pGpuProfiler, commandBuffer, "Deferred pass" };
+
+			if (m_OverdrawQueryPool) m_OverdrawQueryPool->Begin(commandBuffer, firstQuery);
+			{
+				GpuProfileScope scope{ frameInfo.pGpuProfiler, commandBuffer, "GBufferRenderSystem" };
+				m_GBufferRenderSystem.value().RenderGameObjects(frameInfo, snapshot.models);
+			}
+			if (m_OverdrawQueryPool) m_OverdrawQueryPool->End(commandBuffer, firstQuery);
+
+			m_Renderer->NextDeferredSubpass(commandBuffer);
+			{
+				GpuProfileScope scope{ frameInfo.pGpuProfiler, commandBuffer, "DeferredLightingSystem" };
+				m_DeferredLightingSystem.value().Render(frameInfo, m_Renderer->GetGBuffer(), m_Renderer->GetCurrentImageIndex(), globalUbo.pointLightCount);
+			}
+			{
+				GpuProfileScope scope{ frameInfo.pGpuProfiler, commandBuffer, "PointLightSystem" };
+				m_PointLightSystem.value().Render(frameInfo);
+			}
+			m_Renderer->EndDeferredRenderPass(commandBuffer);
+		}
+		else
+		{
+			ILIAD_PROFILE_SCOPE("Record forward frame");
+			HudCpuScope hudScope{ pHud, "Record commands" };
+
+			{
+				GpuProfileScope scope{ frameInfo.pGpuProfiler, commandBuffer, "Light clustering" };
+				m_ClusteredLightingSystem.value().AssignLightsToClusters(frameInfo);
+			}
+
+			if (isCulling)
+			{
+				// Everything that was visible against last frame's depth
+				GpuProfileScope scope{ frameInfo.pGpuProfiler, commandBuffer, "Occlusion culling" };
+				m_OcclusionCullingSystem.value().Update(frameInfo, snapshot.models, m_Renderer->GetRenderExtent(), m_Renderer->GetSwapChainExtent());
+				m_OcclusionCullingSystem.value().Cull(frameInfo);
+			}
+
+			// Both halves of a pass split by the occlusion culling are added up under one name
+			m_Renderer->BeginSwapChainRenderPass(commandBuffer);
+			uint32_t forwardPassScope = frameInfo.pGpuProfiler ? frameInfo.pGpuProfiler->BeginScope(commandBuffer, "Forward pass") : GpuProfiler::INVALID_SCOPE;
+			RenderMeshes(frameInfo, snapshot, firstQuery);
+
+			if (isCulling)
+			{
+				// Rebuild the pyramid from the depth drawn so far and draw what it reveals
+				if (frameInfo.pGpuProfiler) frameInfo.pGpuProfiler->EndScope(commandBuffer, forwardPassScope);
+				m_Renderer->EndSwapChainRenderPass(commandBuffer);
+				{
+					GpuProfileScope scope{ frameInfo.pGpuProfiler, commandBuffer, "Depth pyramid" };
+					m_OcclusionCullingSystem.value().BuildDepthPyramid(frameInfo, m_Renderer->GetCurrentDepthImage(),
+						m_Renderer->GetCurrentDepthImageView(), m_Renderer->GetDepthFormat());
+				}
+
+				frameInfo.cullPhase = 1;
+				{
+					GpuProfileScope scope{ frameInfo.pGpuProfiler, commandBuffer, "Occlusion culling" };
+					m_OcclusionCullingSystem.value().Cull(frameInfo);
+				}
+
+				m_Renderer->ResumeSwapChainRenderPass(commandBuffer);
+				if (frameInfo.pGpuProfiler) forwardPassScope = frameInfo.pGpuProfiler->BeginScope(commandBuffer, "Forward pass");
+				RenderMeshes(frameInfo, snapshot, firstQuery + 1);
+			}
+
+			{
+				GpuProfileScope scope{ frameInfo.pGpuProfiler, commandBuffer, "PointLightSystem" };
+				m_PointLightSystem.value().Render(frameInfo);
+			}
+			if (frameInfo.pGpuProfiler) frameInfo.pGpuProfiler->EndScope(commandBuffer, forwardPassScope);
+			m_Renderer->EndSwapChainRenderPass(commandBuffer);
+		}
+
+		m_RecordingFrameStats.descriptorSetCount = m_FramePools[frameIndex]->GetAllocatedSetCount();
+		if (pHud) RenderPerformanceHud(frameInfo, *pHud);
+
+		m_RecordingFrameStats.commandRecordTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - recordStartTime).count();
+		CollectFrameStats(frameInfo, snapshot);
+
+		{
+			HudCpuScope hudScope{ pHud, "Submit and present" };
+			m_Renderer->EndFrame();
+		}
+		m_IsFrameSubmitted = true;
+	}
+
+	void IliadGame::HandleWindowInput(GameObject* viewerObject, KeyboardMovementController& cameraController, float frameTime)
+	{
 		//Handle escaping the window
 		const int escapeState = glfwGetKey(m_Window->GetWindow(), GLFW_KEY_ESCAPE);
 		if (escapeState == GLFW_PRESS && !m_EscapePressedLastFrame)
@@ -93,40 +433,142 @@ namespace ili
 		// Update the last frame's Escape key state
 		m_EscapePressedLastFrame = (escapeState == GLFW_PRESS);
 
+		// Write the CPU trace of the frames recorded so far
+		const int traceKeyState = glfwGetKey(m_Window->GetWindow(), GLFW_KEY_F12);
+		if (traceKeyState == GLFW_PRESS && !m_TraceKeyPressedLastFrame && WriteCpuTrace(CPU_TRACE_FILE_PATH))
+		{
+			std::cout << "CPU trace written to " << CPU_TRACE_FILE_PATH << std::endl;
+		}
+		m_TraceKeyPressedLastFrame = (traceKeyState == GLFW_PRESS);
+
+		const int hudKeyState = glfwGetKey(m_Window->GetWindow(), GLFW_KEY_F1);
+		if (hudKeyState == GLFW_PRESS && !m_HudKeyPressedLastFrame) m_PerformanceHudVisible = !m_PerformanceHudVisible;
+		m_HudKeyPressedLastFrame = (hudKeyState == GLFW_PRESS);
+
 		// Handle input and update GameObject
-		cameraController.MoveInPlaneXZ(m_Window->GetWindow(), frameTime, *viewerObject);
-		m_Camera.SetViewYXZ(viewerObject->GetTransform()->GetPosition(), viewerObject->GetTransform()->GetRotationRadians());
-		//m_Camera.SetViewYXZ(viewerObject->GetTransform()->GetPosition(), {glm::radians<float>(-35), 0.f, 0.f});
+		{
+			ILIAD_PROFILE_SCOPE("Camera input");
+			HudCpuScope hudScope{ GetActivePerformanceHud(), "Camera input" };
+			cameraController.MoveInPlaneXZ(m_Window->GetWindow(), frameTime, *viewerObject);
+		}
+	}
 
-		// Update camera projection
-		const float aspectRatio = m_Renderer->GetAspectRatio();
-		m_Camera.SetPerspectiveProjection(glm::radians(60.f), aspectRatio, 0.1f, 10.f);
+	void IliadGame::BuildPerformanceHud(const RenderSnapshot& snapshot)
+	{
+		// Counters of the systems are those of the previous frame, it is the last one they recorded
+		PerformanceHudStats stats{};
+		stats.cpuFrameTime = snapshot.frameTime * 1000.f;
+		stats.gpuFrameTime = m_Renderer->GetGpuFrameTime();
+		stats.resolutionScale = m_Renderer->GetResolutionScale();
+		stats.renderStats = m_FrameStats.renderStats;
+		stats.recomputedTransformCount = m_RecomputedTransformCount;
+		stats.pointLightInstanceCount = m_FrameStats.pointLightInstanceCount;
+		stats.descriptorSetCount = m_FrameStats.descriptorSetCount;
+		if (m_GpuProfiler) stats.gpuScopes = m_GpuProfiler->GetScopeStats();
+		stats.memoryHeaps = m_Device->GetMemoryHeapUsage();
+		stats.content = ContentLoader::GetInstance().GetContentStats();
+		stats.pipelineCount = m_PipelineRegistry->GetPipelineCount() + m_PipelineRegistry->GetComputePipelineCount();
+		// Point lights are game objects as well, but counted on their own
+		stats.gameObjectCount = m_pCurrentScene->GetGameObjects().size() - m_pCurrentScene->GetPointLights().size();
+		stats.pointLightCount = m_pCurrentScene->GetPointLights().size();
+		stats.visibleModelCount = snapshot.models.size();
+		stats.visiblePointLightCount = snapshot.pointLights.size();
+		stats.sceneAllocator = m_pCurrentScene->GetAllocatorStats();
+
+		m_PerformanceHud->Build(stats);
+	}
 
-		// Begin rendering
-		if (const auto commandBuffer = m_Renderer->BeginFrame())
+	void IliadGame::RenderPerformanceHud(const FrameInfo& frameInfo, PerformanceHud& hud)
+	{
+		m_Renderer->BeginOverlayRenderPass(frameInfo.commandBuffer);
 		{
-			const int frameIndex = m_Renderer->GetFrameIndex();
-			m_FramePools[frameIndex]->ResetPool();
-			const FrameInfo frameInfo{ frameIndex, frameTime, commandBuffer, m_Camera, m_GlobalDescriptorSets[frameIndex], *m_FramePools[frameIndex] };
+			GpuProfileScope scope{ frameInfo.pGpuProfiler, frameInfo.commandBuffer, "Performance HUD" };
+			hud.Render(frameInfo.commandBuffer);
+		}
+		m_Renderer->EndOverlayRenderPass(frameInfo.commandBuffer);
+	}
 
-			GlobalUbo globalUbo{};
-			globalUbo.projectionMatrix = m_Camera.GetProjection();
-			globalUbo.viewMatrix = m_Camera.GetView();
-			globalUbo.inverseViewMatrix = m_Camera.GetInverseView();
-			m_SceneManager.Update(frameTime);
-			m_PointLightSystem.value().Update(frameInfo, globalUbo, m_pCurrentScene->GetPointLights());
-			m_UboBuffers[frameIndex]->WriteToBuffer(&globalUbo);
-			m_UboBuffers[frameIndex]->Flush();
+	void IliadGame::GatherVisibleObjects(RenderSnapshot& snapshot)
+	{
+		snapshot.models.clear();
+		snapshot.pointLights.clear();
+		m_VisibleLights.clear();
 
-			m_Renderer->BeginSwapChainRenderPass(commandBuffer);
-			m_TextureRenderSystem.value().RenderGameObjects(frameInfo, m_pCurrentScene->GetGameObjects());
-			m_RenderSystem.value().RenderGameObjects(frameInfo, m_pCurrentScene->GetGameObjects());
-			m_PointLightSystem.value().Render(frameInfo, m_pCurrentScene->GetPointLights());
-			m_Renderer->EndSwapChainRenderPass(commandBuffer);
-			m_Renderer->EndFrame();
+		if (m_FrustumCullingEnabled)
+		{
+			const Frustum frustum = m_Camera.GetFrustum();
+			m_pCurrentScene->QueryModels(frustum, snapshot.models);
+			m_pCurrentScene->QueryPointLights(frustum, m_VisibleLights);
+		}
+		else
+		{
+			for (const auto [pTransform, pModelComponent] : m_pCurrentScene->View<TransformComponent, ModelComponent>())
+			{
+				snapshot.models.push_back(pModelComponent->GetInstance());
+			}
+			m_VisibleLights = m_pCurrentScene->GetPointLights();
+		}
+
+		snapshot.pointLights.reserve(m_VisibleLights.size());
+		for (const PointLightGameObject* pLight : m_VisibleLights)
+		{
+			snapshot.pointLights.push_back(pLight->GetInstance());
 		}
 	}
 
+	void IliadGame::RenderMeshes(const FrameInfo& frameInfo, const RenderSnapshot& snapshot, uint32_t overdrawQuery)
+	{
+		PerformanceHud* pHud = snapshot.pHud;
+
+		if (frameInfo.depthPrePass)
+		{
+			GpuProfileScope scope{ frameInfo.pGpuProfiler, frameInfo.commandBuffer, "DepthPrePassSystem" };
+			HudCpuScope hudScope{ pHud, "DepthPrePassSystem" };
+			m_DepthPrePassSystem.value().RenderGameObjects(frameInfo, snapshot.models);
+		}
+
+		if (m_OverdrawQueryPool) m_OverdrawQueryPool->Begin(frameInfo.commandBuffer, overdrawQuery);
+		{
+			GpuProfileScope scope{ frameInfo.pGpuProfiler, frameInfo.commandBuffer, "TextureRenderSystem" };
+			HudCpuScope hudScope{ pHud, "TextureRenderSystem" };
+			m_TextureRenderSystem.value().RenderGameObjects(frameInfo, snapshot.models);
+		}
+		{
+			GpuProfileScope scope{ frameInfo.pGpuProfiler, frameInfo.commandBuffer, "RenderSystem" };
+			HudCpuScope hudScope{ pHud, "RenderSystem" };
+			m_RenderSystem.value().RenderGameObjects(frameInfo, snapshot.models);
+		}
+		if (m_OverdrawQueryPool) m_OverdrawQueryPool->End(frameInfo.commandBuffer, overdrawQuery);
+	}
+
+	bool IliadGame::WriteCpuTrace(const std::string& filePath) const
+	{
+#ifdef ILIAD_ENABLE_CPU_PROFILER
+		CpuProfiler::GetInstance().WriteChromeTrace(filePath);
+		return true;
+#else
+		(void)filePath;
+		return false;
+#endif
+	}
+
+	void IliadGame::CollectFrameStats(const FrameInfo& frameInfo, const RenderSnapshot& snapshot)
+	{
+		RenderFrameStats& stats = m_RecordingFrameStats;
+
+		stats.renderStats = {};
+		if (m_DepthPrePassSystem && frameInfo.depthPrePass) stats.renderStats += m_DepthPrePassSystem->GetStats();
+		if (m_TextureRenderSystem) stats.renderStats += m_TextureRenderSystem->GetStats();
+		if (m_RenderSystem) stats.renderStats += m_RenderSystem->GetStats();
+		if (m_GBufferRenderSystem) stats.renderStats += m_GBufferRenderSystem->GetStats();
+
+		if (m_OcclusionCullingSystem) stats.occlusionCulling = m_OcclusionCullingSystem->GetStats();
+
+		// Every test of this frame was made against the culler of its snapshot, the per-system counts are in renderStats
+		stats.softwareOcclusion = snapshot.pSoftwareOcclusion ? snapshot.pSoftwareOcclusion->GetStats() : SoftwareOcclusionStats{};
+		stats.pointLightInstanceCount = m_PointLightSystem->GetVisibleLightCount();
+	}
+
 	void IliadGame::InitializeWindow()
 	{
 		static constexpr int WIDTH = 1600;
@@ -143,14 +585,30 @@ namespace ili
 		glfwSetCursorPos(m_Window->GetWindow(), windowWidth / 2.0, windowHeight / 2.0);
 	}
 
+	void IliadGame::ApplyDynamicResolutionSettings()
+	{
+		if (!m_Renderer) return;
+
+		// The renderer reads them while it records
+		m_IsDynamicResolutionPending = !m_RenderCounter.IsDone();
+		if (!m_IsDynamicResolutionPending) m_Renderer->SetDynamicResolutionSettings(m_DynamicResolutionSettings);
+	}
+
 	void IliadGame::InitializeVulkan()
 	{
 		m_Device = std::make_unique<Device>(m_Window.get());
-		m_Renderer = std::make_unique<Renderer>(m_Window.get(), *m_Device);
+		if (IsHeadless()) m_Renderer = std::make_unique<Renderer>(VkExtent2D{ m_HeadlessSettings.width, m_HeadlessSettings.height }, *m_Device, m_RenderPath);
+		else m_Renderer = std::make_unique<Renderer>(m_Window.get(), *m_Device, m_RenderPath);
+		ApplyDynamicResolutionSettings();
+		if (GpuProfiler::IsSupported(*m_Device)) m_GpuProfiler = std::make_unique<GpuProfiler>(*m_Device);
+		// The HUD draws through GLFW, so there is none without a window
+		if (m_Window) m_PerformanceHud = std::make_unique<PerformanceHud>(*m_Window, *m_Device, m_Renderer->GetOverlayRenderPass(), m_Renderer->GetSwapChainImageCount());
+		m_PipelineRegistry = std::make_unique<PipelineRegistry>(*m_Device);
 
 		m_GlobalDescriptorPool = DescriptorPool::Builder(*m_Device)
 			.setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
 			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 * SwapChain::MAX_FRAMES_IN_FLIGHT)
 			.build();
 
 		m_FramePools.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
@@ -158,6 +616,9 @@ namespace ili
 			.setMaxSets(1000)
 			.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000)
 			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 4)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 32)
 			.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
 
 		for (int i{}; i < m_FramePools.size(); ++i)
@@ -171,23 +632,57 @@ namespace ili
 			m_UboBuffers[i]->Map();
 		}
 
-		const auto globalSetLayout = DescriptorSetLayout::Builder(*m_Device)
-			.AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
+		// Kept alive for the lifetime of the game, the pipeline registry keys its layouts on this handle
+		m_GlobalSetLayout = DescriptorSetLayout::Builder(*m_Device)
+			.AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT)
+			.AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT) // Point lights
+			.AddBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT) // Light count per cluster
+			.AddBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT) // Light indices per cluster
 			.Build();
 
+		// Owns the light and cluster buffers referenced by the global descriptor sets
+		m_ClusteredLightingSystem.emplace(*m_Device, *m_PipelineRegistry, m_GlobalSetLayout->GetDescriptorSetLayout());
+
 		for (int i{}; i < m_GlobalDescriptorSets.size(); ++i)
 		{
 			auto bufferInfo = m_UboBuffers[i]->DescriptorInfo();
-			DescriptorWriter(*globalSetLayout, *m_GlobalDescriptorPool)
+			auto lightBufferInfo = m_ClusteredLightingSystem->GetLightBufferInfo(i);
+			auto clusterLightCountInfo = m_ClusteredLightingSystem->GetClusterLightCountBufferInfo(i);
+			auto clusterLightIndexInfo = m_ClusteredLightingSystem->GetClusterLightIndexBufferInfo(i);
+			DescriptorWriter(*m_GlobalSetLayout, *m_GlobalDescriptorPool)
 				.WriteBuffer(0, &bufferInfo)
+				.WriteBuffer(1, &lightBufferInfo)
+				.WriteBuffer(2, &clusterLightCountInfo)
+				.WriteBuffer(3, &clusterLightIndexInfo)
 				.Build(m_GlobalDescriptorSets[i]);
 		}
 
-		m_RenderSystem.emplace(*m_Device, m_Renderer->GetSwapChainRenderPass(), globalSetLayout->GetDescriptorSetLayout());
+		if (m_RenderPath == RenderPath::Deferred)
+		{
+			m_GBufferRenderSystem.emplace(*m_Device, *m_PipelineRegistry, m_Renderer->GetDeferredRenderPass(), m_GlobalSetLayout->GetDescriptorSetLayout());
+
+			m_DeferredLightingSystem.emplace(*m_Device, *m_PipelineRegistry, m_Renderer->GetDeferredRenderPass(), m_GlobalSetLayout->GetDescriptorSetLayout());
+
+			m_PointLightSystem.emplace(*m_Device, *m_PipelineRegistry, m_Renderer->GetDeferredRenderPass(), m_GlobalSetLayout->GetDescriptorSetLayout(), GBuffer::LIGHTING_SUBPASS);
+		}
+		else
+		{
+			m_RenderSystem.emplace(*m_Device, *m_PipelineRegistry, m_Renderer->GetSwapChainRenderPass(), m_GlobalSetLayout->GetDescriptorSetLayout());
+
+			m_PointLightSystem.emplace(*m_Device, *m_PipelineRegistry, m_Renderer->GetSwapChainRenderPass(), m_GlobalSetLayout->GetDescriptorSetLayout());
+
+			m_TextureRenderSystem.emplace(*m_Device, *m_PipelineRegistry, m_Renderer->GetSwapChainRenderPass(), m_GlobalSetLayout->GetDescriptorSetLayout());
+
+			m_DepthPrePassSystem.emplace(*m_Device, *m_PipelineRegistry, m_Renderer->GetSwapChainRenderPass(), m_GlobalSetLayout->GetDescriptorSetLayout());
 
-		m_PointLightSystem.emplace(*m_Device, m_Renderer->GetSwapChainRenderPass(), globalSetLayout->GetDescriptorSetLayout());
+			m_OcclusionCullingSystem.emplace(*m_Device, *m_PipelineRegistry);
+		}
 
-		m_TextureRenderSystem.emplace(*m_Device, m_Renderer->GetSwapChainRenderPass(), globalSetLayout->GetDescriptorSetLayout());
+		if (m_Device->EnabledFeatures.pipelineStatisticsQuery)
+		{
+			m_OverdrawQueryPool = std::make_unique<PipelineStatisticsQueryPool>(*m_Device,
+				VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT, SwapChain::MAX_FRAMES_IN_FLIGHT * OVERDRAW_QUERIES_PER_FRAME);
+		}
 	}
 
 }
@@ -7,16 +7,62 @@
 #include "Core/Renderer.h"
 
 #include "Graphics/Descriptors.h"
+#include "Graphics/PipelineRegistry.h"
 #include "Core/RenderSystem.h"
 #include "Core/PointLightSystem.h"
+#include "Core/DepthPrePassSystem.h"
+#include "Core/ClusteredLightingSystem.h"
+#include "Core/GBufferRenderSystem.h"
+#include "Core/DeferredLightingSystem.h"
+#include "Core/OcclusionCullingSystem.h"
+#include "Core/SoftwareOcclusionCuller.h"
+#include "Graphics/PipelineStatisticsQueryPool.h"
+#include "Graphics/GpuProfiler.h"
+#include "Core/PerformanceHud.h"
+#include "Core/RenderSnapshot.h"
+#include "Core/JobSystem.h"
 
+#include <array>
 #include <chrono>
+#include <exception>
 
 #include "ContentLoader.h"
 #include "Graphics/TextureRenderSystem.h"
 
 namespace ili
 {
+	// Runs the game without a window, for benchmarks and regression tests on build machines.
+	// Any Vulkan driver works, including a software one such as lavapipe (select it with VK_DRIVER_FILES)
+	struct HeadlessSettings
+	{
+		bool enabled{ false };
+		// Size of the offscreen images that stand in for the swap chain
+		uint32_t width{ 1600 };
+		uint32_t height{ 900 };
+		// Run returns after this many frames
+		uint32_t frameCount{ 300 };
+		// Simulation step of every frame in seconds, fixed so that every run renders the same images
+		float frameTime{ 1.f / 60.f };
+		// Frames are written into this directory as PNG files, nothing is written while it is empty
+		std::string captureDirectory{};
+		// Also captures every n-th frame, the last frame is always captured. Zero captures only the last frame
+		uint32_t captureInterval{ 0 };
+	};
+
+	// Measured while a frame is recorded. The render thread fills them in and WaitForRenderFrame hands them to the getters
+	struct RenderFrameStats final
+	{
+		uint64_t shadedFragmentCount{};
+		float overdrawFactor{};
+		float commandRecordTime{};
+		uint32_t descriptorSetCount{};
+		uint32_t pointLightInstanceCount{};
+		// Summed over the render systems, with the software occlusion tests each of them made this frame
+		RenderStats renderStats{};
+		OcclusionCullingStats occlusionCulling{};
+		// Copied from the culler of the frame's snapshot once the frame is recorded
+		SoftwareOcclusionStats softwareOcclusion{};
+	};
 
 	class IliadGame
 	{
@@ -30,20 +76,153 @@ namespace ili
 
 		void Run();
 
+		// Has to be set before Run, the game then never opens a window
+		void SetHeadlessSettings(const HeadlessSettings& settings)
+		{
+			assert(!m_Renderer && "Headless mode has to be chosen before Vulkan is initialized");
+			assert((!settings.enabled || (settings.width > 0 && settings.height > 0)) && "Headless images cannot be empty");
+			m_HeadlessSettings = settings;
+		}
+		const HeadlessSettings& GetHeadlessSettings() const { return m_HeadlessSettings; }
+		bool IsHeadless() const { return m_HeadlessSettings.enabled; }
+
+		// Fragment shader invocations of the shading passes (mesh systems), measured a few frames ago.
+		// Only available when the device supports pipeline statistics queries
+		uint64_t GetShadedFragmentCount() const { return m_FrameStats.shadedFragmentCount; }
+		// Shaded fragments per screen pixel, 1.0 means no overdraw at all
+		float GetOverdrawFactor() const { return m_FrameStats.overdrawFactor; }
+
+		// Draws and state changes recorded by the mesh render systems in the last frame
+		const RenderStats& GetRenderStats() const { return m_FrameStats.renderStats; }
+
+		// Writes the CPU profiler events as a Chrome trace (F12 in game), false when the profiler is compiled out
+		bool WriteCpuTrace(const std::string& filePath) const;
+
+		// Frustum culled, occluded and disoccluded objects, measured a few frames ago
+		const OcclusionCullingStats& GetOcclusionCullingStats() const { return m_FrameStats.occlusionCulling; }
+		// Occluder triangles and culled objects of the software occlusion culling in the last frame
+		const SoftwareOcclusionStats& GetSoftwareOcclusionStats() const { return m_FrameStats.softwareOcclusion; }
+
+		// CPU milliseconds from the start of the command buffer to its submission in the last frame,
+		// covering the recording of every pass but not the scene update
+		float GetCommandRecordTime() const { return m_FrameStats.commandRecordTime; }
+
+		// Transforms that rebuilt their cached matrices in the last frame, the others did not move
+		uint32_t GetRecomputedTransformCount() const { return m_RecomputedTransformCount; }
+
+		// Scale applied to both sides of the render extent, 1.0 while dynamic resolution is off
+		float GetResolutionScale() const { return m_Renderer ? m_Renderer->GetResolutionScale() : 1.f; }
+		// GPU milliseconds of a frame a few frames ago, zero when the device has no timestamp support
+		float GetGpuFrameTime() const { return m_Renderer ? m_Renderer->GetGpuFrameTime() : 0.f; }
+
+		// GPU time per render system and pass, null when the device has no timestamp support.
+		// Only records while GPU profiling is enabled
+		const GpuProfiler* GetGpuProfiler() const { return m_GpuProfiler.get(); }
+
 	protected:
 		// Called before all the initializations, in case it is ever needed
 		virtual void OnGamePreparing() = 0;
 		virtual void InitializeGame() = 0;
+		// Called every frame before the camera follows the viewer, e.g. to move the viewer along a path
+		virtual void OnUpdate(GameObject* /*viewerObject*/, float /*deltaTime*/) {}
+		// Called on the main thread after the command buffer of a frame was submitted, no frame is being recorded meanwhile
+		virtual void OnFrameSubmitted() {}
 		void GameLoop(GameObject* viewerObject, KeyboardMovementController& cameraController);
+		void HandleWindowInput(GameObject* viewerObject, KeyboardMovementController& cameraController, float frameTime);
+		// Renders the fixed number of frames and writes the requested captures
+		void RunHeadless(GameObject* viewerObject);
 
 		// Initialization methods
 		void InitializeWindow();
 		void InitializeVulkan();
 
+		// Null while the HUD is hidden, so the timing scopes cost nothing
+		PerformanceHud* GetActivePerformanceHud() const { return m_PerformanceHudVisible ? m_PerformanceHud.get() : nullptr; }
+		// Main thread, while no frame is being recorded
+		void BuildPerformanceHud(const RenderSnapshot& snapshot);
+		void RenderPerformanceHud(const FrameInfo& frameInfo, PerformanceHud& hud);
+
+		// Hands the settings to the renderer once it exists, InitializeVulkan applies whatever was set before.
+		// While a frame is being recorded they are held back until WaitForRenderFrame
+		void ApplyDynamicResolutionSettings();
+
+		// Copies the camera and what it sees out of the scene
+		void BuildRenderSnapshot(RenderSnapshot& snapshot, SoftwareOcclusionCuller& softwareOcclusionCuller);
+		// Fills the model and light lists of the snapshot
+		void GatherVisibleObjects(RenderSnapshot& snapshot);
+
+		// Records and submits a frame, on the render thread when pipelined rendering is enabled
+		void RenderFrame(const RenderSnapshot& snapshot);
+		// Returns once the frame started last is submitted, then publishes its stats and reports it to the game
+		void WaitForRenderFrame();
+		// Render thread, reads the counters of the systems that recorded the frame
+		void CollectFrameStats(const FrameInfo& frameInfo, const RenderSnapshot& snapshot);
+
+		// Depth pre-pass and mesh systems of the forward path, the overdraw query wraps the shading passes
+		void RenderMeshes(const FrameInfo& frameInfo, const RenderSnapshot& snapshot, uint32_t overdrawQuery);
+
+		// Enables the depth-only pass that runs before the mesh systems, can be toggled at any time.
+		// Forward path only, the G-buffer pass already shades nothing
+		void SetDepthPrePassEnabled(bool enabled) { m_DepthPrePassEnabled = enabled; }
+		bool IsDepthPrePassEnabled() const { return m_DepthPrePassEnabled; }
+
+		// Enables the hierarchical-Z occlusion culling of the mesh systems, can be toggled at any time.
+		// Forward path only, splitting the deferred render pass would push the G-buffer out of tile memory
+		void SetOcclusionCullingEnabled(bool enabled) { m_OcclusionCullingEnabled = enabled; }
+		bool IsOcclusionCullingEnabled() const { return m_OcclusionCullingEnabled; }
+
+		// Enables the CPU occlusion culling against game objects with an OccluderComponent, can be toggled at any time.
+		// Works on both render paths and needs no GPU support, the occluders should be few and low polygon
+		void SetSoftwareOcclusionCullingEnabled(bool enabled) { m_SoftwareOcclusionCullingEnabled = enabled; }
+		bool IsSoftwareOcclusionCullingEnabled() const { return m_SoftwareOcclusionCullingEnabled; }
+
+		// Hands the render and light systems only what the camera's frustum touches, found through the scene's
+		// spatial indices. Enabled by default, can be toggled at any time
+		void SetFrustumCullingEnabled(bool enabled) { m_FrustumCullingEnabled = enabled; }
+		bool IsFrustumCullingEnabled() const { return m_FrustumCullingEnabled; }
+
+		// Records and submits frame N on a job while the game loop simulates frame N + 1, can be toggled at any time.
+		// What is drawn then lags the simulation by one frame, the game never runs further ahead than that
+		void SetPipelinedRenderingEnabled(bool enabled) { m_PipelinedRenderingEnabled = enabled; }
+		bool IsPipelinedRenderingEnabled() const { return m_PipelinedRenderingEnabled; }
+
+		// Brackets every render system and pass with timestamp queries, can be toggled at any time
+		void SetGpuProfilingEnabled(bool enabled) { m_GpuProfilingEnabled = enabled; }
+		bool IsGpuProfilingEnabled() const { return m_GpuProfilingEnabled; }
+
+		// Shows the performance overlay (F1 in game), can be toggled at any time.
+		// While visible, GPU profiling is active as well
+		void SetPerformanceHudVisible(bool visible) { m_PerformanceHudVisible = visible; }
+		bool IsPerformanceHudVisible() const { return m_PerformanceHudVisible; }
+
+		// Renders at a resolution that follows the GPU frame time and upscales it to the window, can be toggled at any time.
+		// Forward path only, the swap chain images have to support being blitted into
+		void SetDynamicResolutionEnabled(bool enabled) { m_DynamicResolutionSettings.enabled = enabled; ApplyDynamicResolutionSettings(); }
+		bool IsDynamicResolutionEnabled() const { return m_DynamicResolutionSettings.enabled; }
+		// GPU time in milliseconds the resolution is scaled to fit in
+		void SetTargetFrameTime(float milliseconds) { m_DynamicResolutionSettings.targetFrameTime = milliseconds; ApplyDynamicResolutionSettings(); }
+		float GetTargetFrameTime() const { return m_DynamicResolutionSettings.targetFrameTime; }
+		void SetResolutionScaleBounds(float minScale, float maxScale)
+		{
+			assert(minScale > 0.f && minScale <= maxScale && maxScale <= 1.f && "The resolution scale bounds must satisfy 0 < min <= max <= 1");
+			m_DynamicResolutionSettings.minScale = minScale;
+			m_DynamicResolutionSettings.maxScale = maxScale;
+			ApplyDynamicResolutionSettings();
+		}
+
+		// Picks forward or deferred shading, has to be called from OnGamePreparing
+		void SetRenderPath(RenderPath renderPath)
+		{
+			assert(!m_Renderer && "The render path has to be chosen before Vulkan is initialized");
+			m_RenderPath = renderPath;
+		}
+		RenderPath GetRenderPath() const { return m_RenderPath; }
+
 		// Member variables
 		std::unique_ptr<Window> m_Window{};
 		std::unique_ptr<Device> m_Device{};
 		std::unique_ptr<Renderer> m_Renderer{};
+		std::unique_ptr<PipelineRegistry> m_PipelineRegistry{};
 
 		// Camera setup
 		Camera m_Camera{};
@@ -53,6 +232,7 @@ namespace ili
 
 		// Vulkan resources
 		std::unique_ptr<DescriptorPool> m_GlobalDescriptorPool{};
+		std::unique_ptr<DescriptorSetLayout> m_GlobalSetLayout{};
 		std::vector<std::unique_ptr<ili::Buffer>> m_UboBuffers{ ili::SwapChain::MAX_FRAMES_IN_FLIGHT };
 		std::vector<VkDescriptorSet> m_GlobalDescriptorSets{ ili::SwapChain::MAX_FRAMES_IN_FLIGHT };
 		std::vector<std::unique_ptr<DescriptorPool>> m_FramePools;
@@ -61,6 +241,58 @@ namespace ili
 		std::optional<RenderSystem> m_RenderSystem{};
 		std::optional<PointLightSystem> m_PointLightSystem{};
 		std::optional<TextureRenderSystem> m_TextureRenderSystem{};
+		std::optional<DepthPrePassSystem> m_DepthPrePassSystem{};
+		std::optional<ClusteredLightingSystem> m_ClusteredLightingSystem{};
+		std::optional<GBufferRenderSystem> m_GBufferRenderSystem{};
+		std::optional<DeferredLightingSystem> m_DeferredLightingSystem{};
+		std::optional<OcclusionCullingSystem> m_OcclusionCullingSystem{};
+		RenderPath m_RenderPath{ RenderPath::Forward };
+		HeadlessSettings m_HeadlessSettings{};
+
+		// Overdraw measurement, one query per culling phase per frame in flight
+		static constexpr uint32_t OVERDRAW_QUERIES_PER_FRAME = 2;
+		std::unique_ptr<PipelineStatisticsQueryPool> m_OverdrawQueryPool{};
+		bool m_DepthPrePassEnabled{ false };
+		bool m_OcclusionCullingEnabled{ false };
+
+		// Scratch of GatherVisibleObjects, the snapshot keeps copies of the lights
+		std::vector<PointLightGameObject*> m_VisibleLights{};
+		bool m_FrustumCullingEnabled{ true };
+
+		// The game fills one snapshot while the render thread reads another, so it is at most one frame ahead.
+		// A snapshot is refilled MAX_FRAMES_IN_FLIGHT + 2 frames after it was filled. By then the frame recorded before the
+		// current one has waited on the fence of the snapshot's frame, so the GPU is done with the meshes and textures it held.
+		// A frame that fails to acquire an image recreates the swap chain, which waits for the device to idle
+		static constexpr uint32_t RENDER_SNAPSHOT_COUNT = SwapChain::MAX_FRAMES_IN_FLIGHT + 2;
+		std::array<RenderSnapshot, RENDER_SNAPSHOT_COUNT> m_RenderSnapshots{};
+		// The occluders are rasterized with the snapshot, so each snapshot gets its own depth buffer
+		std::array<SoftwareOcclusionCuller, RENDER_SNAPSHOT_COUNT> m_SoftwareOcclusionCullers{};
+		uint32_t m_RenderSnapshotIndex{};
+		bool m_SoftwareOcclusionCullingEnabled{ false };
+
+		JobCounter m_RenderCounter{};
+		// Thrown while recording on the render thread, rethrown by WaitForRenderFrame
+		std::exception_ptr m_pRenderException{};
+		bool m_PipelinedRenderingEnabled{ false };
+		// Set by the render thread, reported through OnFrameSubmitted once it is waited for
+		bool m_IsFrameSubmitted{ false };
+		// Written by the render thread only, copied to m_FrameStats once the frame is waited for
+		RenderFrameStats m_RecordingFrameStats{};
+		RenderFrameStats m_FrameStats{};
+		// Read from the swap chain only while no frame is recorded, the render thread may recreate it
+		float m_AspectRatio{ 1.f };
+		// Changed while a frame was recorded, applied once it is done
+		bool m_IsDynamicResolutionPending{ false };
+
+		DynamicResolutionSettings m_DynamicResolutionSettings{};
+
+		std::unique_ptr<GpuProfiler> m_GpuProfiler{};
+		bool m_GpuProfilingEnabled{ false };
+
+		std::unique_ptr<PerformanceHud> m_PerformanceHud{};
+		bool m_PerformanceHudVisible{ false };
+
+		uint32_t m_RecomputedTransformCount{};
 
 	protected:
 		// Scene management
@@ -72,6 +304,10 @@ namespace ili
 
 		bool m_IsCursorLocked = true;
 		bool m_EscapePressedLastFrame = false;
+
+		static constexpr const char* CPU_TRACE_FILE_PATH = "cpu_trace.json";
+		bool m_TraceKeyPressedLastFrame = false;
+		bool m_HudKeyPressedLastFrame = false;
 	};
 
 }
@@ -0,0 +1,229 @@
+﻿#include "JobSystem.h"
+
+#include <string>
+
+#include "CpuProfiler.h"
+
+namespace ili
+{
+	namespace
+	{
+		// Index of the queue the calling thread owns, workers set it when they start
+		thread_local uint32_t t_QueueIndex{};
+	}
+
+	JobSystem::JobSystem()
+		: m_MainThreadId(std::this_thread::get_id())
+	{
+		m_pQueues.emplace_back(std::make_unique<JobQueue>());
+	}
+
+	JobSystem::~JobSystem()
+	{
+		Shutdown();
+	}
+
+	uint32_t JobSystem::GetDefaultWorkerCount()
+	{
+		// Zero when the core count is unknown
+		const uint32_t coreCount = std::thread::hardware_concurrency();
+		return coreCount > 1 ? coreCount - 1 : 0;
+	}
+
+	void JobSystem::Initialize(uint32_t workerCount)
+	{
+		Shutdown();
+
+		m_MainThreadId = std::this_thread::get_id();
+		t_QueueIndex = 0;
+		m_IsStopping = false;
+
+		m_pQueues.resize(workerCount + 1);
+		for (std::unique_ptr<JobQueue>& pQueue : m_pQueues)
+		{
+			if (!pQueue) pQueue = std::make_unique<JobQueue>();
+		}
+
+		m_Workers.reserve(workerCount);
+		for (uint32_t queueIndex = 1; queueIndex <= workerCount; ++queueIndex)
+		{
+			m_Workers.emplace_back([this, queueIndex]() { WorkerLoop(queueIndex); });
+		}
+	}
+
+	void JobSystem::Shutdown()
+	{
+		{
+			const std::lock_guard lock{ m_SleepMutex };
+			m_IsStopping = true;
+		}
+		m_WakeCondition.notify_all();
+
+		// The workers only leave once the queues are empty, jobs that queue more jobs after that are run here
+		m_Workers.clear();
+		while (TryRunJob() || TryRunMainThreadJob()) {}
+
+		m_pQueues.resize(1);
+	}
+
+	void JobSystem::Run(Job job, JobCounter* pCounter)
+	{
+		if (pCounter) pCounter->m_Count.fetch_add(1, std::memory_order_relaxed);
+
+		// Counted before it is pushed, so a thread that takes it right away never sees the count drop below zero
+		m_QueuedCount.fetch_add(1);
+
+		JobQueue& queue = *m_pQueues[t_QueueIndex < m_pQueues.size() ? t_QueueIndex : 0];
+		{
+			const std::lock_guard lock{ queue.mutex };
+			queue.jobs.push_back({ std::move(job), pCounter });
+		}
+
+		// A worker that is about to sleep counts itself as sleeping before it checks for jobs, so one of the two sees the other
+		if (m_SleepingCount.load() > 0)
+		{
+			{ const std::lock_guard lock{ m_SleepMutex }; }
+			m_WakeCondition.notify_one();
+		}
+		// Every worker is busy, a waiting thread can take the job
+		else if (m_WaitingCount.load() > 0)
+		{
+			{ const std::lock_guard lock{ m_SleepMutex }; }
+			m_WaitCondition.notify_one();
+		}
+	}
+
+	void JobSystem::Wait(const JobCounter& counter)
+	{
+		const bool isMainThread = IsMainThread();
+		while (!counter.IsDone())
+		{
+			if (isMainThread && TryRunMainThreadJob()) continue;
+			if (TryRunJob()) continue;
+
+			// The last jobs of the counter are running on other threads. Counted before the checks like the sleeping workers
+			std::unique_lock lock{ m_SleepMutex };
+			m_WaitingCount.fetch_add(1);
+			m_WaitCondition.wait(lock, [this, &counter, isMainThread]()
+			{
+				return counter.m_Count.load() == 0 || m_QueuedCount.load() > 0 || (isMainThread && m_MainThreadJobCount.load() > 0);
+			});
+			m_WaitingCount.fetch_sub(1);
+		}
+	}
+
+	void JobSystem::RunOnMainThread(Job job, JobCounter* pCounter)
+	{
+		if (IsMainThread())
+		{
+			job();
+			return;
+		}
+
+		if (pCounter) pCounter->m_Count.fetch_add(1, std::memory_order_relaxed);
+
+		// Counted before it is pushed like the other jobs
+		m_MainThreadJobCount.fetch_add(1);
+		{
+			const std::lock_guard lock{ m_MainThreadMutex };
+			m_MainThreadJobs.push_back({ std::move(job), pCounter });
+		}
+
+		// The main thread may be sleeping in Wait
+		NotifyWaitingThreads();
+	}
+
+	void JobSystem::ExecuteMainThreadJobs()
+	{
+		assert(IsMainThread() && "Main thread jobs can only run on the main thread");
+
+		while (TryRunMainThreadJob()) {}
+	}
+
+	void JobSystem::WorkerLoop(uint32_t queueIndex)
+	{
+		t_QueueIndex = queueIndex;
+		ILIAD_PROFILE_THREAD("Job worker " + std::to_string(queueIndex));
+
+		while (true)
+		{
+			if (TryRunJob()) continue;
+			if (m_IsStopping) return;
+
+			std::unique_lock lock{ m_SleepMutex };
+			m_SleepingCount.fetch_add(1);
+			m_WakeCondition.wait(lock, [this]() { return m_QueuedCount.load() > 0 || m_IsStopping; });
+			m_SleepingCount.fetch_sub(1);
+		}
+	}
+
+	bool JobSystem::TryRunJob()
+	{
+		if (m_QueuedCount.load(std::memory_order_relaxed) == 0) return false;
+
+		const uint32_t queueCount = static_cast<uint32_t>(m_pQueues.size());
+		const uint32_t ownIndex = t_QueueIndex < queueCount ? t_QueueIndex : 0;
+
+		QueuedJob queuedJob{};
+		bool isFound{};
+		for (uint32_t offset{}; offset < queueCount && !isFound; ++offset)
+		{
+			JobQueue& queue = *m_pQueues[(ownIndex + offset) % queueCount];
+			const std::lock_guard lock{ queue.mutex };
+			if (queue.jobs.empty()) continue;
+
+			// The own queue from the back, the others from the front
+			if (offset == 0)
+			{
+				queuedJob = std::move(queue.jobs.back());
+				queue.jobs.pop_back();
+			}
+			else
+			{
+				queuedJob = std::move(queue.jobs.front());
+				queue.jobs.pop_front();
+			}
+			isFound = true;
+		}
+		if (!isFound) return false;
+
+		m_QueuedCount.fetch_sub(1, std::memory_order_relaxed);
+		Execute(queuedJob);
+		return true;
+	}
+
+	bool JobSystem::TryRunMainThreadJob()
+	{
+		QueuedJob queuedJob{};
+		{
+			const std::lock_guard lock{ m_MainThreadMutex };
+			if (m_MainThreadJobs.empty()) return false;
+
+			queuedJob = std::move(m_MainThreadJobs.front());
+			m_MainThreadJobs.pop_front();
+		}
+		m_MainThreadJobCount.fetch_sub(1);
+
+		Execute(queuedJob);
+		return true;
+	}
+
+	void JobSystem::Execute(QueuedJob& queuedJob)
+	{
+		queuedJob.job();
+		if (!queuedJob.pCounter) return;
+
+		// Sequentially consistent like the count of waiting threads, so a thread about to sleep on this counter is woken.
+		// It also releases everything the job wrote to the waiting thread
+		if (queuedJob.pCounter->m_Count.fetch_sub(1) == 1) NotifyWaitingThreads();
+	}
+
+	void JobSystem::NotifyWaitingThreads()
+	{
+		if (m_WaitingCount.load() == 0) return;
+
+		{ const std::lock_guard lock{ m_SleepMutex }; }
+		// They may wait for different counters
+		m_WaitCondition.notify_all();
+	}
+}
@@ -0,0 +1,178 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Singleton.h"
+
+namespace ili
+{
+	// Must not throw, an exception leaving a job on a worker terminates the program
+	using Job = std::function<void()>;
+
+	// Counts the unfinished jobs that were started with it, JobSystem::Wait returns once it is back at zero
+	class JobCounter final
+	{
+	public:
+		JobCounter() = default;
+		~JobCounter() = default;
+
+		JobCounter(const JobCounter& other) = delete;
+		JobCounter(JobCounter&& other) noexcept = delete;
+		JobCounter& operator=(const JobCounter& other) = delete;
+		JobCounter& operator=(JobCounter&& other) noexcept = delete;
+
+		bool IsDone() const { return m_Count.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<uint32_t> m_Count{};
+	};
+
+	/**
+	 * Runs jobs on a fixed set of worker threads and on every thread that waits for them.
+	 * Each thread owns a deque, it pushes and pops its own jobs at the back so freshly split work stays in its cache,
+	 * idle threads steal from the front of the others where the oldest and usually largest jobs are.
+	 * A waiting thread runs jobs until its counter is done, so jobs can start and wait for jobs themselves.
+	 * Once there is nothing left to take it sleeps until the counter is done or new work is queued.
+	 * Work that has to happen on the main thread, like GLFW calls, goes through RunOnMainThread.
+	 * Before Initialize, or with zero workers, every job runs on the thread that waits for it
+	 */
+	class JobSystem final : public Singleton<JobSystem>
+	{
+	public:
+		JobSystem(const JobSystem& other) = delete;
+		JobSystem(JobSystem&& other) noexcept = delete;
+		JobSystem& operator=(const JobSystem& other) = delete;
+		JobSystem& operator=(JobSystem&& other) noexcept = delete;
+		virtual ~JobSystem() override;
+
+		// One worker per core besides the calling thread
+		static uint32_t GetDefaultWorkerCount();
+
+		// Replaces the workers, the calling thread becomes the main thread. No other thread may use the job system meanwhile
+		void Initialize(uint32_t workerCount = GetDefaultWorkerCount());
+		// Runs every queued job to completion and joins the workers
+		void Shutdown();
+
+		// The counter may be null when nobody waits for the job
+		void Run(Job job, JobCounter* pCounter);
+		// Runs queued jobs until the counter is done, on the main thread the main thread jobs as well
+		void Wait(const JobCounter& counter);
+
+		/**
+		 * Calls function(begin, end) for chunks of up to grainSize of [0, count) on every thread and returns once all are done.
+		 * A few jobs take chunks until none are left, so uneven chunks balance out without a job per chunk.
+		 * The first exception thrown by function is rethrown here after the other chunks finished
+		 */
+		template <typename Function>
+		void ParallelFor(uint32_t count, uint32_t grainSize, const Function& function);
+
+		// Runs the job right away on the main thread, from other threads it is queued until ExecuteMainThreadJobs or a Wait on the main thread
+		void RunOnMainThread(Job job, JobCounter* pCounter);
+		// Called by the game loop once a frame
+		void ExecuteMainThreadJobs();
+		bool IsMainThread() const { return std::this_thread::get_id() == m_MainThreadId; }
+
+		// The workers and the main thread
+		uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_pQueues.size()); }
+
+	private:
+		friend class Singleton<JobSystem>;
+		JobSystem();
+
+		struct QueuedJob
+		{
+			Job job{};
+			JobCounter* pCounter{};
+		};
+
+		// Apart on their own cache lines, the owner and thieves lock them often
+		struct alignas(64) JobQueue
+		{
+			std::mutex mutex{};
+			std::deque<QueuedJob> jobs{};
+		};
+
+		void WorkerLoop(uint32_t queueIndex);
+		// Pops a job from the queue of the calling thread or steals one, false when all queues are empty
+		bool TryRunJob();
+		bool TryRunMainThreadJob();
+		void Execute(QueuedJob& queuedJob);
+		// Wakes the threads sleeping in Wait, when there are any
+		void NotifyWaitingThreads();
+
+		// Index zero belongs to the main thread and to every thread that is not a worker
+		std::vector<std::unique_ptr<JobQueue>> m_pQueues{};
+		std::vector<std::jthread> m_Workers{};
+		// Jobs in the queues that no thread took yet
+		std::atomic<uint32_t> m_QueuedCount{};
+
+		std::mutex m_SleepMutex{};
+		std::condition_variable m_WakeCondition{};
+		std::atomic<uint32_t> m_SleepingCount{};
+		std::atomic<bool> m_IsStopping{};
+		// Threads sleeping in Wait, apart from the workers so finished jobs do not wake idle workers
+		std::condition_variable m_WaitCondition{};
+		std::atomic<uint32_t> m_WaitingCount{};
+
+		std::mutex m_MainThreadMutex{};
+		std::deque<QueuedJob> m_MainThreadJobs{};
+		// Lets the sleeping main thread check for its jobs without taking their mutex
+		std::atomic<uint32_t> m_MainThreadJobCount{};
+		std::thread::id m_MainThreadId{};
+	};
+
+	template <typename Function>
+	void JobSystem::ParallelFor(uint32_t count, uint32_t grainSize, const Function& function)
+	{
+		assert(grainSize > 0 && "Grain size must be at least one");
+
+		const uint32_t chunkCount = (count + grainSize - 1) / grainSize;
+		const uint32_t jobCount = std::min(chunkCount, GetThreadCount());
+		if (jobCount <= 1)
+		{
+			if (count > 0) function(0u, count);
+			return;
+		}
+
+		std::atomic<uint32_t> nextChunk{};
+		std::exception_ptr pException{};
+		std::mutex exceptionMutex{};
+		const auto work = [&]()
+		{
+			for (uint32_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++)
+			{
+				const uint32_t begin = chunk * grainSize;
+				try
+				{
+					function(begin, std::min(begin + grainSize, count));
+				}
+				catch (...)
+				{
+					const std::lock_guard lock{ exceptionMutex };
+					if (!pException) pException = std::current_exception();
+				}
+			}
+		};
+
+		// The jobs only hold a reference, work outlives them as Wait returns after the last one
+		JobCounter counter{};
+		for (uint32_t i = 1; i < jobCount; ++i) Run(std::cref(work), &counter);
+		work();
+		Wait(counter);
+
+		if (pException) std::rethrow_exception(pException);
+	}
+}
@@ -0,0 +1,482 @@
+﻿#include "OcclusionCullingSystem.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include "Graphics/SwapChain.h"
+#include "SceneGraph/ModelComponent.h"
+#include "SceneGraph/TransformComponent.h"
+#include "Structs/FrameInfo.h"
+
+namespace ili
+{
+	namespace
+	{
+		// Mirror local_size in hzb_cull.comp and hzb_build.comp
+		constexpr uint32_t CULL_WORKGROUP_SIZE = 64;
+		constexpr uint32_t BUILD_WORKGROUP_SIZE = 8;
+
+		// Mirrors CullUniforms in hzb_cull.comp
+		struct CullUniforms
+		{
+			glm::mat4 viewProjection{ 1.f };
+			glm::mat4 pyramidViewProjection{ 1.f };
+			// One per culling phase
+			glm::vec4 pyramidSize[2]{};
+			uint32_t objectCount{};
+			uint32_t pyramidValid{};
+		};
+
+		struct CullPushConstants
+		{
+			uint32_t phase{};
+		};
+
+		struct BuildPushConstants
+		{
+			glm::ivec2 sourceSize{};
+			glm::ivec2 destinationSize{};
+		};
+
+		uint32_t GetMipCount(VkExtent2D extent)
+		{
+			return static_cast<uint32_t>(std::bit_width(std::max(extent.width, extent.height)));
+		}
+
+		// Size of the part of the pyramid a render extent fills, and the levels built for it
+		glm::vec4 GetPyramidSize(VkExtent2D renderExtent)
+		{
+			return { static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height), static_cast<float>(GetMipCount(renderExtent)), 0.f };
+		}
+
+		// Room for every object to have the larger of the two kinds of draw commands
+		constexpr uint32_t MAX_DRAW_COMMAND_WORDS = OcclusionCullingSystem::MAX_CULLED_OBJECTS * (sizeof(VkDrawIndexedIndirectCommand) / sizeof(uint32_t));
+
+		// Hidden until a culling phase decides otherwise, returns the first word of the command
+		template <typename DrawCommand>
+		uint32_t AppendDrawCommand(std::vector<uint32_t>& words, DrawCommand drawCommand)
+		{
+			drawCommand.instanceCount = 0;
+
+			const size_t offset = words.size();
+			words.resize(offset + sizeof(DrawCommand) / sizeof(uint32_t));
+			std::memcpy(words.data() + offset, &drawCommand, sizeof(DrawCommand));
+			return static_cast<uint32_t>(offset);
+		}
+
+		VkImageAspectFlags GetDepthAspectMask(VkFormat depthFormat)
+		{
+			const bool hasStencil = depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT;
+			return VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencil ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+		}
+	}
+
+	OcclusionCullingSystem::OcclusionCullingSystem(Device& device, PipelineRegistry& pipelineRegistry) :
+		m_Device(device),
+		m_PipelineRegistry(pipelineRegistry)
+	{
+		CreateBuffers();
+		CreatePipelines();
+
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		// Never filter, an interpolated depth is not conservative
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.minLod = 0.f;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+		if (vkCreateSampler(m_Device.GetDevice(), &samplerInfo, nullptr, &m_Sampler) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create depth pyramid sampler");
+		}
+	}
+
+	OcclusionCullingSystem::~OcclusionCullingSystem()
+	{
+		DestroyDepthPyramid();
+		vkDestroySampler(m_Device.GetDevice(), m_Sampler, nullptr);
+	}
+
+	void OcclusionCullingSystem::CreateBuffers()
+	{
+		for (int i{}; i < SwapChain::MAX_FRAMES_IN_FLIGHT; ++i)
+		{
+			m_BoundsBuffers.emplace_back(std::make_unique<Buffer>(m_Device, sizeof(glm::vec4), MAX_CULLED_OBJECTS,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT));
+			m_BoundsBuffers.back()->Map();
+
+			m_DrawCommandOffsetBuffers.emplace_back(std::make_unique<Buffer>(m_Device, sizeof(uint32_t), MAX_CULLED_OBJECTS,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT));
+			m_DrawCommandOffsetBuffers.back()->Map();
+
+			for (auto& drawCommandBuffers : m_DrawCommandBuffers)
+			{
+				drawCommandBuffers.emplace_back(std::make_unique<Buffer>(m_Device, sizeof(uint32_t), MAX_DRAW_COMMAND_WORDS,
+					VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT));
+				drawCommandBuffers.back()->Map();
+			}
+
+			// Read back by the CPU
+			m_StatsBuffers.emplace_back(std::make_unique<Buffer>(m_Device, sizeof(OcclusionCullingStats), 1,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT));
+			m_StatsBuffers.back()->Map();
+
+			m_UniformBuffers.emplace_back(std::make_unique<Buffer>(m_Device, sizeof(CullUniforms), 1,
+				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, m_Device.Properties.limits.minUniformBufferOffsetAlignment));
+			m_UniformBuffers.back()->Map();
+		}
+
+		m_HasStats.resize(SwapChain::MAX_FRAMES_IN_FLIGHT, false);
+		m_Bounds.reserve(MAX_CULLED_OBJECTS);
+		m_DrawCommandWords.reserve(MAX_DRAW_COMMAND_WORDS);
+		m_DrawCommandOffsets.reserve(MAX_CULLED_OBJECTS);
+	}
+
+	void OcclusionCullingSystem::CreatePipelines()
+	{
+		m_pCullSetLayout = &m_PipelineRegistry.GetDescriptorSetLayout(DescriptorSetLayout::Builder(m_Device)
+			.AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Object bounds
+			.AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // First phase draw commands
+			.AddBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Second phase draw commands
+			.AddBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Depth pyramid
+			.AddBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Statistics
+			.AddBinding(5, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Matrices and counts
+			.AddBinding(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)); // Draw command offsets
+
+		m_pBuildSetLayout = &m_PipelineRegistry.GetDescriptorSetLayout(DescriptorSetLayout::Builder(m_Device)
+			.AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Source level
+			.AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)); // Destination level
+
+		const VkPushConstantRange cullPushConstantRange{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants) };
+		m_CullPipelineLayout = m_PipelineRegistry.GetPipelineLayout({ m_pCullSetLayout->GetDescriptorSetLayout() }, { cullPushConstantRange });
+		m_pCullPipeline = m_PipelineRegistry.GetComputePipeline("Assets/CompiledShaders/hzb_cull.comp.spv", m_CullPipelineLayout);
+
+		const VkPushConstantRange buildPushConstantRange{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BuildPushConstants) };
+		m_BuildPipelineLayout = m_PipelineRegistry.GetPipelineLayout({ m_pBuildSetLayout->GetDescriptorSetLayout() }, { buildPushConstantRange });
+		m_pBuildPipeline = m_PipelineRegistry.GetComputePipeline("Assets/CompiledShaders/hzb_build.comp.spv", m_BuildPipelineLayout);
+	}
+
+	void OcclusionCullingSystem::CreateDepthPyramid(VkExtent2D extent)
+	{
+		m_PyramidExtent = extent;
+		m_PyramidMipCount = GetMipCount(extent);
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = extent.width;
+		imageInfo.extent.height = extent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = m_PyramidMipCount;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = VK_FORMAT_R32_SFLOAT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		m_Device.CreateImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_PyramidImage, m_PyramidMemory);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = m_PyramidImage;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = VK_FORMAT_R32_SFLOAT;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = m_PyramidMipCount;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(m_Device.GetDevice(), &viewInfo, nullptr, &m_PyramidView) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create depth pyramid image view");
+		}
+
+		// One view per level, each level is written as a storage image and then read as the source of the next
+		m_PyramidMipViews.resize(m_PyramidMipCount);
+		for (uint32_t mip{}; mip < m_PyramidMipCount; ++mip)
+		{
+			viewInfo.subresourceRange.baseMipLevel = mip;
+			viewInfo.subresourceRange.levelCount = 1;
+
+			if (vkCreateImageView(m_Device.GetDevice(), &viewInfo, nullptr, &m_PyramidMipViews[mip]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create depth pyramid mip view");
+			}
+		}
+
+		m_IsPyramidInitialized = false;
+		m_IsPyramidValid = false;
+	}
+
+	void OcclusionCullingSystem::DestroyDepthPyramid()
+	{
+		for (const auto mipView : m_PyramidMipViews)
+		{
+			vkDestroyImageView(m_Device.GetDevice(), mipView, nullptr);
+		}
+		m_PyramidMipViews.clear();
+
+		vkDestroyImageView(m_Device.GetDevice(), m_PyramidView, nullptr);
+		vkDestroyImage(m_Device.GetDevice(), m_PyramidImage, nullptr);
+		m_Device.FreeMemory(m_PyramidMemory);
+		m_PyramidView = VK_NULL_HANDLE;
+		m_PyramidImage = VK_NULL_HANDLE;
+		m_PyramidMemory = VK_NULL_HANDLE;
+	}
+
+	void OcclusionCullingSystem::InitializeDepthPyramid(VkCommandBuffer commandBuffer)
+	{
+		if (m_IsPyramidInitialized) return;
+
+		// Every level is kept in the general layout, it is both written as a storage image and sampled
+		VkImageMemoryBarrier pyramidBarrier{};
+		pyramidBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		pyramidBarrier.srcAccessMask = 0;
+		pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		pyramidBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		pyramidBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		pyramidBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		pyramidBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		pyramidBarrier.image = m_PyramidImage;
+		pyramidBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_PyramidMipCount, 0, 1 };
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &pyramidBarrier);
+		m_IsPyramidInitialized = true;
+	}
+
+	void OcclusionCullingSystem::Update(const FrameInfo& frameInfo, const ModelList& models, VkExtent2D renderExtent, VkExtent2D swapChainExtent)
+	{
+		const int frameIndex = frameInfo.frameIndex;
+
+		// The fence of this frame slot has been waited on, so its counters are final
+		auto* pStats = static_cast<OcclusionCullingStats*>(m_StatsBuffers[frameIndex]->GetMappedMemory());
+		if (m_HasStats[frameIndex])
+		{
+			m_StatsBuffers[frameIndex]->Invalidate();
+			m_Stats = *pStats;
+		}
+		*pStats = {};
+
+		// Dynamic resolution only changes the render extent, which fits in a pyramid of the swap chain's size
+		if (swapChainExtent.width != m_PyramidExtent.width || swapChainExtent.height != m_PyramidExtent.height)
+		{
+			// The other frame in flight may still be sampling the old pyramid
+			m_Device.WaitIdle();
+			DestroyDepthPyramid();
+			CreateDepthPyramid(swapChainExtent);
+		}
+		assert(renderExtent.width <= m_PyramidExtent.width && renderExtent.height <= m_PyramidExtent.height && "The render extent cannot exceed the swap chain");
+		m_RenderExtent = renderExtent;
+
+		m_Bounds.clear();
+		m_DrawCommandWords.clear();
+		m_DrawCommandOffsets.clear();
+		m_DrawSlots.clear();
+		for (const ModelInstance& instance : models)
+		{
+			if (m_Bounds.size() == MAX_CULLED_OBJECTS) break;
+
+			if (!instance.pModel) continue;
+
+			const Model& model = *instance.pModel;
+			const Sphere worldSphere = model.GetBoundingSphere().GetTransformed(instance.modelMatrix);
+
+			// Model::DrawIndirect reads a VkDrawIndirectCommand for models without an index buffer
+			const uint32_t drawCommandOffset = model.HasIndexBuffer() ?
+				AppendDrawCommand(m_DrawCommandWords, model.GetIndexedIndirectCommand()) :
+				AppendDrawCommand(m_DrawCommandWords, model.GetIndirectCommand());
+
+			m_DrawSlots.emplace(&instance, drawCommandOffset);
+			m_Bounds.emplace_back(worldSphere.center, worldSphere.radius);
+			m_DrawCommandOffsets.push_back(drawCommandOffset);
+		}
+
+		m_Stats.objectCount = static_cast<uint32_t>(m_Bounds.size());
+
+		if (!m_Bounds.empty())
+		{
+			m_BoundsBuffers[frameIndex]->WriteToBuffer(m_Bounds.data(), m_Bounds.size() * sizeof(glm::vec4));
+			m_BoundsBuffers[frameIndex]->Flush();
+			m_DrawCommandOffsetBuffers[frameIndex]->WriteToBuffer(m_DrawCommandOffsets.data(), m_DrawCommandOffsets.size() * sizeof(uint32_t));
+			m_DrawCommandOffsetBuffers[frameIndex]->Flush();
+
+			for (auto& drawCommandBuffers : m_DrawCommandBuffers)
+			{
+				drawCommandBuffers[frameIndex]->WriteToBuffer(m_DrawCommandWords.data(), m_DrawCommandWords.size() * sizeof(uint32_t));
+				drawCommandBuffers[frameIndex]->Flush();
+			}
+		}
+
+		CullUniforms uniforms{};
+		uniforms.viewProjection = frameInfo.camera.GetProjection() * frameInfo.camera.GetView();
+		uniforms.pyramidViewProjection = m_PyramidViewProjection;
+		// The first phase reads the pyramid of the previous frame, which may have had another render extent
+		uniforms.pyramidSize[0] = GetPyramidSize(m_PyramidRenderExtent);
+		uniforms.pyramidSize[1] = GetPyramidSize(renderExtent);
+		uniforms.objectCount = static_cast<uint32_t>(m_Bounds.size());
+		uniforms.pyramidValid = m_IsPyramidValid ? 1 : 0;
+		m_UniformBuffers[frameIndex]->WriteToBuffer(&uniforms);
+		m_UniformBuffers[frameIndex]->Flush();
+		m_StatsBuffers[frameIndex]->Flush();
+
+		m_CullDescriptorSet = VK_NULL_HANDLE;
+	}
+
+	void OcclusionCullingSystem::Cull(const FrameInfo& frameInfo)
+	{
+		if (m_Bounds.empty()) return;
+
+		const int frameIndex = frameInfo.frameIndex;
+
+		// Shared by both phases of the frame
+		if (m_CullDescriptorSet == VK_NULL_HANDLE)
+		{
+			auto boundsInfo = m_BoundsBuffers[frameIndex]->DescriptorInfo();
+			auto firstPhaseInfo = m_DrawCommandBuffers[0][frameIndex]->DescriptorInfo();
+			auto secondPhaseInfo = m_DrawCommandBuffers[1][frameIndex]->DescriptorInfo();
+			VkDescriptorImageInfo pyramidInfo{ m_Sampler, m_PyramidView, VK_IMAGE_LAYOUT_GENERAL };
+			auto statsInfo = m_StatsBuffers[frameIndex]->DescriptorInfo();
+			auto uniformInfo = m_UniformBuffers[frameIndex]->DescriptorInfo();
+			auto drawCommandOffsetInfo = m_DrawCommandOffsetBuffers[frameIndex]->DescriptorInfo();
+
+			DescriptorWriter(*m_pCullSetLayout, frameInfo.frameDescriptorPool)
+				.WriteBuffer(0, &boundsInfo)
+				.WriteBuffer(1, &firstPhaseInfo)
+				.WriteBuffer(2, &secondPhaseInfo)
+				.WriteImage(3, &pyramidInfo)
+				.WriteBuffer(4, &statsInfo)
+				.WriteBuffer(5, &uniformInfo)
+				.WriteBuffer(6, &drawCommandOffsetInfo)
+				.Build(m_CullDescriptorSet);
+
+			m_HasStats[frameIndex] = true;
+		}
+
+		InitializeDepthPyramid(frameInfo.commandBuffer);
+
+		m_pCullPipeline->Bind(frameInfo.commandBuffer);
+		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipelineLayout, 0, 1,
+			&m_CullDescriptorSet, 0, nullptr);
+
+		const CullPushConstants push{ frameInfo.cullPhase };
+		vkCmdPushConstants(frameInfo.commandBuffer, m_CullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &push);
+
+		const uint32_t groupCount = (static_cast<uint32_t>(m_Bounds.size()) + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE;
+		vkCmdDispatch(frameInfo.commandBuffer, groupCount, 1, 1);
+
+		// The instance counts are consumed by the indirect draws, and by the second phase
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(frameInfo.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	void OcclusionCullingSystem::BuildDepthPyramid(const FrameInfo& frameInfo, VkImage depthImage, VkImageView depthImageView, VkFormat depthFormat)
+	{
+		const VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+		InitializeDepthPyramid(commandBuffer);
+
+		VkImageMemoryBarrier depthBarrier{};
+		depthBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		depthBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		depthBarrier.image = depthImage;
+		depthBarrier.subresourceRange = { GetDepthAspectMask(depthFormat), 0, 1, 0, 1 };
+
+		// The compute stage is in the source scope so the first phase is done reading the old pyramid
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &depthBarrier);
+
+		m_pBuildPipeline->Bind(commandBuffer);
+
+		// Only the top left corner covered by the render extent is written, on as many levels as it needs
+		VkExtent2D sourceExtent = m_RenderExtent;
+		const uint32_t mipCount = GetMipCount(m_RenderExtent);
+		for (uint32_t mip{}; mip < mipCount; ++mip)
+		{
+			const VkExtent2D destinationExtent{ std::max(m_RenderExtent.width >> mip, 1u), std::max(m_RenderExtent.height >> mip, 1u) };
+
+			VkDescriptorImageInfo sourceInfo = mip == 0
+				? VkDescriptorImageInfo{ m_Sampler, depthImageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL }
+				: VkDescriptorImageInfo{ m_Sampler, m_PyramidMipViews[mip - 1], VK_IMAGE_LAYOUT_GENERAL };
+			VkDescriptorImageInfo destinationInfo{ VK_NULL_HANDLE, m_PyramidMipViews[mip], VK_IMAGE_LAYOUT_GENERAL };
+
+			VkDescriptorSet descriptorSet;
+			DescriptorWriter(*m_pBuildSetLayout, frameInfo.frameDescriptorPool)
+				.WriteImage(0, &sourceInfo)
+				.WriteImage(1, &destinationInfo)
+				.Build(descriptorSet);
+
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_BuildPipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+			const BuildPushConstants push{
+				{ static_cast<int>(sourceExtent.width), static_cast<int>(sourceExtent.height) },
+				{ static_cast<int>(destinationExtent.width), static_cast<int>(destinationExtent.height) } };
+			vkCmdPushConstants(commandBuffer, m_BuildPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BuildPushConstants), &push);
+
+			vkCmdDispatch(commandBuffer,
+				(destinationExtent.width + BUILD_WORKGROUP_SIZE - 1) / BUILD_WORKGROUP_SIZE,
+				(destinationExtent.height + BUILD_WORKGROUP_SIZE - 1) / BUILD_WORKGROUP_SIZE, 1);
+
+			// The level just written is the source of the next one, and of the culling afterwards
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+				1, &barrier, 0, nullptr, 0, nullptr);
+
+			sourceExtent = destinationExtent;
+		}
+
+		depthBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &depthBarrier);
+
+		m_PyramidViewProjection = frameInfo.camera.GetProjection() * frameInfo.camera.GetView();
+		m_PyramidRenderExtent = m_RenderExtent;
+		m_IsPyramidValid = true;
+	}
+
+	void OcclusionCullingSystem::Draw(const FrameInfo& frameInfo, const ModelInstance& instance) const
+	{
+		const Model& model = *instance.pModel;
+		const auto it = m_DrawSlots.find(&instance);
+
+		// Over the object limit, always drawn in the first phase
+		if (it == m_DrawSlots.end())
+		{
+			if (frameInfo.cullPhase == 0) model.Draw(frameInfo.commandBuffer);
+			return;
+		}
+
+		const VkBuffer drawCommandBuffer = m_DrawCommandBuffers[frameInfo.cullPhase][frameInfo.frameIndex]->GetBuffer();
+		model.DrawIndirect(frameInfo.commandBuffer, drawCommandBuffer, it->second * sizeof(uint32_t));
+	}
+}
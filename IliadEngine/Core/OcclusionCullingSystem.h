@@ -0,0 +1,128 @@
+﻿#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Graphics/Buffer.h"
+#include "Graphics/ComputePipeline.h"
+#include "Graphics/Descriptors.h"
+#include "Graphics/Device.h"
+#include "Graphics/Model.h"
+#include "Graphics/PipelineRegistry.h"
+#include "SceneGraph/GameObject.h"
+#include "SceneGraph/ModelComponent.h"
+
+namespace ili
+{
+	struct FrameInfo;
+
+	// Mirrors the CullStats buffer in hzb_cull.comp
+	struct OcclusionCullingStats
+	{
+		uint32_t frustumCulledCount{};
+		// In the frustum but hidden in both phases
+		uint32_t occludedCount{};
+		// Hidden in the previous frame's depth but visible in this frame's, drawn by the second phase
+		uint32_t disoccludedCount{};
+		uint32_t objectCount{};
+	};
+
+	/**
+	 * Two-phase hierarchical-Z occlusion culling for the forward path.
+	 * Every model gets an indirect draw command whose instance count is decided on the GPU:
+	 * - Phase 0 tests all objects against the frustum and the depth pyramid of the previous frame, the survivors are
+	 *   drawn in the first part of the frame.
+	 * - The depth pyramid is then rebuilt from that depth and the rejected objects are tested again. Whatever turns out
+	 *   to be visible is drawn in the second part, so culling against stale depth can never leave holes.
+	 * The mesh systems draw through Draw whenever FrameInfo::pOcclusionCulling is set.
+	 */
+	class OcclusionCullingSystem
+	{
+	public:
+		// Objects beyond this are drawn without culling
+		static constexpr uint32_t MAX_CULLED_OBJECTS = 8192;
+
+		OcclusionCullingSystem(Device& device, PipelineRegistry& pipelineRegistry);
+		~OcclusionCullingSystem();
+
+		OcclusionCullingSystem(const OcclusionCullingSystem&) = delete;
+		OcclusionCullingSystem& operator=(const OcclusionCullingSystem&) = delete;
+		OcclusionCullingSystem(OcclusionCullingSystem&&) = delete;
+		OcclusionCullingSystem& operator=(OcclusionCullingSystem&&) = delete;
+
+		// Collects the models of the scene, uploads their bounds and draw commands and reads back
+		// the statistics this frame slot produced last time. The depth pyramid is sized for the swap chain and only
+		// reallocated when that changes, a lower render extent fills part of it
+		void Update(const FrameInfo& frameInfo, const ModelList& models, VkExtent2D renderExtent, VkExtent2D swapChainExtent);
+
+		// Records the culling pass for frameInfo.cullPhase, must be called outside of a render pass
+		void Cull(const FrameInfo& frameInfo);
+
+		// Rebuilds the depth pyramid from the depth attachment, must be called outside of a render pass.
+		// The depth image is expected in, and returned to, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+		void BuildDepthPyramid(const FrameInfo& frameInfo, VkImage depthImage, VkImageView depthImageView, VkFormat depthFormat);
+
+		// Records the draw of an instance of the list given to Update for frameInfo.cullPhase, its model has to be bound already
+		void Draw(const FrameInfo& frameInfo, const ModelInstance& instance) const;
+
+		// Measured a few frames ago, like the overdraw statistics
+		const OcclusionCullingStats& GetStats() const { return m_Stats; }
+
+	private:
+		static constexpr uint32_t PHASE_COUNT = 2;
+
+		void CreateBuffers();
+		void CreatePipelines();
+		void CreateDepthPyramid(VkExtent2D extent);
+		void DestroyDepthPyramid();
+		// Moves a freshly created pyramid out of the undefined layout
+		void InitializeDepthPyramid(VkCommandBuffer commandBuffer);
+
+		Device& m_Device;
+		PipelineRegistry& m_PipelineRegistry;
+
+		// Owned by the pipeline registry
+		ComputePipeline* m_pCullPipeline{};
+		ComputePipeline* m_pBuildPipeline{};
+		VkPipelineLayout m_CullPipelineLayout{};
+		VkPipelineLayout m_BuildPipelineLayout{};
+		DescriptorSetLayout* m_pCullSetLayout{};
+		DescriptorSetLayout* m_pBuildSetLayout{};
+		VkDescriptorSet m_CullDescriptorSet{};
+
+		// One of each per frame in flight, written by the CPU every frame
+		std::vector<std::unique_ptr<Buffer>> m_BoundsBuffers{};
+		std::vector<std::unique_ptr<Buffer>> m_DrawCommandOffsetBuffers{};
+		std::vector<std::unique_ptr<Buffer>> m_DrawCommandBuffers[PHASE_COUNT]{};
+		std::vector<std::unique_ptr<Buffer>> m_StatsBuffers{};
+		std::vector<std::unique_ptr<Buffer>> m_UniformBuffers{};
+		std::vector<bool> m_HasStats{};
+
+		std::vector<glm::vec4> m_Bounds{};
+		// Indexed and non-indexed draw commands packed one after the other, so every model gets the command its draw call reads
+		std::vector<uint32_t> m_DrawCommandWords{};
+		// Per object, the first word of its draw command
+		std::vector<uint32_t> m_DrawCommandOffsets{};
+		// Keyed by the instances in the list given to Update, which lives until the frame is recorded. Holds the first word of the draw command
+		std::unordered_map<const ModelInstance*, uint32_t> m_DrawSlots{};
+
+		// Depth pyramid, every mip level keeps the farthest depth of the level below
+		VkImage m_PyramidImage{};
+		VkDeviceMemory m_PyramidMemory{};
+		VkImageView m_PyramidView{};
+		std::vector<VkImageView> m_PyramidMipViews{};
+		VkSampler m_Sampler{};
+		// Allocated size of level 0
+		VkExtent2D m_PyramidExtent{};
+		uint32_t m_PyramidMipCount{};
+		// Render extent of the frame being recorded, and the one the current pyramid was built from
+		VkExtent2D m_RenderExtent{};
+		VkExtent2D m_PyramidRenderExtent{};
+		bool m_IsPyramidInitialized{ false };
+		bool m_IsPyramidValid{ false };
+		glm::mat4 m_PyramidViewProjection{ 1.f };
+
+		OcclusionCullingStats m_Stats{};
+	};
+}
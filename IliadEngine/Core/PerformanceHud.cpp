@@ -0,0 +1,229 @@
+﻿#include "PerformanceHud.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+#include "imgui.h"
+#include "imgui_impl_glfw.h"
+#include "imgui_impl_vulkan.h"
+
+namespace ili
+{
+	namespace
+	{
+		void CheckImGuiVulkanResult(VkResult result)
+		{
+			if (result < 0) throw std::runtime_error("ImGui Vulkan backend call failed");
+		}
+
+		float ToMebibytes(VkDeviceSize bytes)
+		{
+			return static_cast<float>(static_cast<double>(bytes) / (1024.0 * 1024.0));
+		}
+	}
+
+	PerformanceHud::PerformanceHud(Window& window, Device& device, VkRenderPass overlayRenderPass, uint32_t imageCount)
+	{
+		// The font atlas is the only texture ImGui binds
+		m_pDescriptorPool = DescriptorPool::Builder(device)
+			.setMaxSets(1)
+			.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1)
+			.build();
+
+		IMGUI_CHECKVERSION();
+		ImGui::CreateContext();
+		ImGui::StyleColorsDark();
+		// Positions are not worth a file next to the executable
+		ImGui::GetIO().IniFilename = nullptr;
+
+		if (!ImGui_ImplGlfw_InitForVulkan(window.GetWindow(), true))
+		{
+			throw std::runtime_error("Failed to initialize the ImGui GLFW backend");
+		}
+
+		ImGui_ImplVulkan_InitInfo initInfo{};
+		initInfo.Instance = device.GetInstance();
+		initInfo.PhysicalDevice = device.GetPhysicalDevice();
+		initInfo.Device = device.GetDevice();
+		initInfo.QueueFamily = device.FindPhysicalQueueFamilies().GraphicsFamily;
+		initInfo.Queue = device.GetGraphicsQueue();
+		initInfo.DescriptorPool = m_pDescriptorPool->GetDescriptorPool();
+		initInfo.RenderPass = overlayRenderPass;
+		initInfo.MinImageCount = std::max(imageCount, 2u);
+		initInfo.ImageCount = std::max(imageCount, 2u);
+		initInfo.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+		initInfo.CheckVkResultFn = CheckImGuiVulkanResult;
+
+		if (!ImGui_ImplVulkan_Init(&initInfo))
+		{
+			throw std::runtime_error("Failed to initialize the ImGui Vulkan backend");
+		}
+	}
+
+	PerformanceHud::~PerformanceHud()
+	{
+		ImGui_ImplVulkan_Shutdown();
+		ImGui_ImplGlfw_Shutdown();
+		ImGui::DestroyContext();
+	}
+
+	void PerformanceHud::AddCpuTiming(const char* name, float milliseconds)
+	{
+		const std::lock_guard lock{ m_CpuTimingMutex };
+		const auto it = std::find_if(m_CpuTimings.begin(), m_CpuTimings.end(), [name](const CpuTiming& timing) { return timing.name == name; });
+		if (it == m_CpuTimings.end())
+		{
+			m_CpuTimings.push_back({ name, milliseconds, milliseconds });
+			return;
+		}
+
+		it->lastTime = milliseconds;
+		it->averageTime += (milliseconds - it->averageTime) * .05f;
+	}
+
+	void PerformanceHud::Build(const PerformanceHudStats& stats)
+	{
+		ImGui_ImplVulkan_NewFrame();
+		ImGui_ImplGlfw_NewFrame();
+		ImGui::NewFrame();
+
+		ImGui::SetNextWindowPos({ 10.f, 10.f }, ImGuiCond_FirstUseEver);
+		ImGui::SetNextWindowSize({ 380.f, 0.f }, ImGuiCond_FirstUseEver);
+		if (ImGui::Begin("Performance"))
+		{
+			DrawFrameGraphs(stats);
+			DrawTimings(stats);
+			DrawRenderStats(stats);
+			DrawMemory(stats);
+		}
+		ImGui::End();
+
+		ImGui::Render();
+	}
+
+	void PerformanceHud::Render(VkCommandBuffer commandBuffer)
+	{
+		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+	}
+
+	void PerformanceHud::DrawFrameGraphs(const PerformanceHudStats& stats)
+	{
+		m_CpuFrameTimes[m_HistoryOffset] = stats.cpuFrameTime;
+		m_GpuFrameTimes[m_HistoryOffset] = stats.gpuFrameTime;
+		m_HistoryOffset = (m_HistoryOffset + 1) % HISTORY_SIZE;
+
+		// Shared scale so both graphs can be compared at a glance
+		const float maxTime = std::max(*std::max_element(m_CpuFrameTimes.begin(), m_CpuFrameTimes.end()),
+			*std::max_element(m_GpuFrameTimes.begin(), m_GpuFrameTimes.end()));
+		const float graphScale = std::max(maxTime * 1.1f, 1.f);
+
+		char overlay[64];
+		snprintf(overlay, sizeof(overlay), "CPU %.2f ms (%.0f fps)", stats.cpuFrameTime, stats.cpuFrameTime > 0.f ? 1000.f / stats.cpuFrameTime : 0.f);
+		ImGui::PlotLines("##CpuFrameTimes", m_CpuFrameTimes.data(), HISTORY_SIZE, static_cast<int>(m_HistoryOffset), overlay, 0.f, graphScale, { -1.f, 60.f });
+
+		snprintf(overlay, sizeof(overlay), "GPU %.2f ms", stats.gpuFrameTime);
+		ImGui::PlotLines("##GpuFrameTimes", m_GpuFrameTimes.data(), HISTORY_SIZE, static_cast<int>(m_HistoryOffset), overlay, 0.f, graphScale, { -1.f, 60.f });
+
+		if (stats.resolutionScale < 1.f) ImGui::Text("Resolution scale: %.0f%%", stats.resolutionScale * 100.f);
+	}
+
+	void PerformanceHud::DrawTimings(const PerformanceHudStats& stats) const
+	{
+		if (ImGui::CollapsingHeader("CPU timings", ImGuiTreeNodeFlags_DefaultOpen) &&
+			ImGui::BeginTable("CpuTimings", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+		{
+			ImGui::TableSetupColumn("Stage");
+			ImGui::TableSetupColumn("Last (ms)");
+			ImGui::TableSetupColumn("Avg (ms)");
+			ImGui::TableHeadersRow();
+
+			const std::lock_guard lock{ m_CpuTimingMutex };
+			for (const auto& timing : m_CpuTimings)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::TextUnformatted(timing.name);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", timing.lastTime);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", timing.averageTime);
+			}
+			ImGui::EndTable();
+		}
+
+		if (!ImGui::CollapsingHeader("GPU timings", ImGuiTreeNodeFlags_DefaultOpen)) return;
+
+		if (stats.gpuScopes.empty())
+		{
+			ImGui::TextDisabled("No timestamp support");
+			return;
+		}
+
+		if (ImGui::BeginTable("GpuTimings", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+		{
+			ImGui::TableSetupColumn("Scope");
+			ImGui::TableSetupColumn("Avg (ms)");
+			ImGui::TableSetupColumn("Min");
+			ImGui::TableSetupColumn("Max");
+			ImGui::TableHeadersRow();
+
+			for (const auto& scope : stats.gpuScopes)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::TextUnformatted(scope.name.c_str());
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", scope.averageTime);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", scope.minTime);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", scope.maxTime);
+			}
+			ImGui::EndTable();
+		}
+	}
+
+	void PerformanceHud::DrawRenderStats(const PerformanceHudStats& stats)
+	{
+		if (!ImGui::CollapsingHeader("Rendering", ImGuiTreeNodeFlags_DefaultOpen)) return;
+
+		const RenderStats& renderStats = stats.renderStats;
+		ImGui::Text("Draw calls: %u", renderStats.drawCalls);
+		ImGui::Text("Instances: %u (+%u light billboards)", renderStats.instanceCount, stats.pointLightInstanceCount);
+		ImGui::Text("Triangles: %llu", static_cast<unsigned long long>(renderStats.triangleCount));
+		ImGui::Text("State changes: %u (pipelines %u, descriptor sets %u, meshes %u)", renderStats.GetStateChanges(),
+			renderStats.pipelineBinds, renderStats.descriptorSetBinds, renderStats.meshBinds);
+		ImGui::Text("Descriptor sets allocated: %u", stats.descriptorSetCount);
+		ImGui::Text("Transforms recomputed: %u", stats.recomputedTransformCount);
+	}
+
+	void PerformanceHud::DrawMemory(const PerformanceHudStats& stats)
+	{
+		if (ImGui::CollapsingHeader("GPU memory"))
+		{
+			for (size_t i{}; i < stats.memoryHeaps.size(); ++i)
+			{
+				const MemoryHeapUsage& heap = stats.memoryHeaps[i];
+				const float allocated = ToMebibytes(heap.allocatedBytes);
+				const float size = ToMebibytes(heap.heapSize);
+
+				char label[96];
+				snprintf(label, sizeof(label), "%.1f / %.0f MiB, %u allocations", allocated, size, heap.allocationCount);
+				ImGui::Text("Heap %zu%s", i, heap.isDeviceLocal ? " (device local)" : "");
+				ImGui::ProgressBar(size > 0.f ? allocated / size : 0.f, { -1.f, 0.f }, label);
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Resources"))
+		{
+			ImGui::Text("Models: %u", stats.content.modelCount);
+			ImGui::Text("Textures: %u", stats.content.textureCount);
+			ImGui::Text("Occluders: %u", stats.content.occluderCount);
+			ImGui::Text("Pipelines: %zu", stats.pipelineCount);
+			ImGui::Text("Game objects: %zu", stats.gameObjectCount);
+			ImGui::Text("Point lights: %zu", stats.pointLightCount);
+			ImGui::Text("Visible: %zu models, %zu point lights", stats.visibleModelCount, stats.visiblePointLightCount);
+
+			const SceneAllocatorStats& allocator = stats.sceneAllocator;
+			ImGui::Text("Scene pools: %u, %u chunks", allocator.poolCount, allocator.chunkCount);
+			ImGui::Text("Pooled objects: %u, %llu allocations", allocator.liveObjectCount, static_cast<unsigned long long>(allocator.allocationCount));
+			ImGui::Text("Pool memory: %.1f / %.1f KiB, %.0f%% free", static_cast<float>(allocator.usedBytes) / 1024.f,
+				static_cast<float>(allocator.reservedBytes) / 1024.f, allocator.GetFragmentation() * 100.f);
+		}
+	}
+}
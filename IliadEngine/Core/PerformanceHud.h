@@ -0,0 +1,120 @@
+﻿#pragma once
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ContentLoader.h"
+#include "Window.h"
+#include "Graphics/Descriptors.h"
+#include "Graphics/Device.h"
+#include "Graphics/GpuProfiler.h"
+#include "SceneGraph/SceneAllocator.h"
+#include "Structs/RenderStats.h"
+
+namespace ili
+{
+	// Everything the HUD shows besides its own CPU timings, gathered by the game only while the HUD is visible
+	struct PerformanceHudStats
+	{
+		// Milliseconds
+		float cpuFrameTime{};
+		float gpuFrameTime{};
+		float resolutionScale{ 1.f };
+
+		RenderStats renderStats{};
+		// Of the previous frame, the count is only complete once a frame was submitted
+		uint32_t recomputedTransformCount{};
+		uint32_t pointLightInstanceCount{};
+		uint32_t descriptorSetCount{};
+
+		std::vector<GpuScopeStats> gpuScopes{};
+		std::vector<MemoryHeapUsage> memoryHeaps{};
+
+		ContentStats content{};
+		size_t pipelineCount{};
+		size_t gameObjectCount{};
+		size_t pointLightCount{};
+		// Left after frustum culling
+		size_t visibleModelCount{};
+		size_t visiblePointLightCount{};
+		SceneAllocatorStats sceneAllocator{};
+	};
+
+	/**
+	 * ImGui overlay with frame time graphs, CPU and GPU timings, draw counts, memory and resource counts.
+	 * Owns the ImGui context and its Vulkan backend. Nothing is built or recorded unless Build and Render are called,
+	 * so a hidden HUD costs nothing but the memory of the ImGui context.
+	 * Build talks to GLFW and has to run on the main thread, Render only records and may run on the thread that records the frame.
+	 */
+	class PerformanceHud final
+	{
+	public:
+		static constexpr uint32_t HISTORY_SIZE = 240;
+
+		PerformanceHud(Window& window, Device& device, VkRenderPass overlayRenderPass, uint32_t imageCount);
+		~PerformanceHud();
+
+		PerformanceHud(const PerformanceHud&) = delete;
+		PerformanceHud& operator=(const PerformanceHud&) = delete;
+		PerformanceHud(PerformanceHud&&) = delete;
+		PerformanceHud& operator=(PerformanceHud&&) = delete;
+
+		// Name must outlive the HUD, string literals do. Safe to call from any thread
+		void AddCpuTiming(const char* name, float milliseconds);
+
+		// Builds the window on the main thread, the draws stay valid until the next Build
+		void Build(const PerformanceHudStats& stats);
+		// Records the draws of the last Build, must be called inside the overlay render pass
+		void Render(VkCommandBuffer commandBuffer);
+
+	private:
+		struct CpuTiming
+		{
+			const char* name{};
+			float lastTime{};
+			float averageTime{};
+		};
+
+		void DrawFrameGraphs(const PerformanceHudStats& stats);
+		void DrawTimings(const PerformanceHudStats& stats) const;
+		static void DrawRenderStats(const PerformanceHudStats& stats);
+		static void DrawMemory(const PerformanceHudStats& stats);
+
+		std::unique_ptr<DescriptorPool> m_pDescriptorPool{};
+
+		// Few stages, a linear search beats hashing. The game and the render thread both add to it
+		std::vector<CpuTiming> m_CpuTimings{};
+		mutable std::mutex m_CpuTimingMutex{};
+
+		std::array<float, HISTORY_SIZE> m_CpuFrameTimes{};
+		std::array<float, HISTORY_SIZE> m_GpuFrameTimes{};
+		uint32_t m_HistoryOffset{};
+	};
+
+	// Times the rest of the enclosing block for the HUD, does nothing without a HUD
+	class HudCpuScope final
+	{
+	public:
+		HudCpuScope(PerformanceHud* pHud, const char* name) : m_pHud{ pHud }, m_Name{ name }
+		{
+			if (m_pHud) m_Start = std::chrono::steady_clock::now();
+		}
+		~HudCpuScope()
+		{
+			if (m_pHud) m_pHud->AddCpuTiming(m_Name, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_Start).count());
+		}
+
+		HudCpuScope(const HudCpuScope&) = delete;
+		HudCpuScope& operator=(const HudCpuScope&) = delete;
+		HudCpuScope(HudCpuScope&&) = delete;
+		HudCpuScope& operator=(HudCpuScope&&) = delete;
+
+	private:
+		PerformanceHud* m_pHud;
+		const char* m_Name;
+		std::chrono::steady_clock::time_point m_Start{};
+	};
+}
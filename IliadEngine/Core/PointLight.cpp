@@ -1,8 +1,14 @@
 ﻿#include "PointLight.h"
+#include "ClusteredLightingSystem.h"
 
 ili::PointLightGameObject::PointLightGameObject(unsigned id, float intensity, float radius, glm::vec3 color): 
 	GameObject(id),
 	m_Intensity(intensity), 
 	m_Radius(radius), 
 	m_Color(color)
-{}
\ No newline at end of file
+{}
+
+std::optional<ili::Sphere> ili::PointLightGameObject::GetWorldBounds()
+{
+	return Sphere{ GetTransform()->GetWorldPosition(), ClusteredLightingSystem::GetLightRange(m_Intensity, m_Radius) };
+}
\ No newline at end of file
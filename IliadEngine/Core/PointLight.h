@@ -3,6 +3,14 @@
 
 namespace ili
 {
+	// A point light as the light systems see it, copied so a frame can be recorded from it while the scene changes
+	struct PointLightInstance final
+	{
+		glm::vec3 position{};
+		float intensity{};
+		glm::vec3 color{};
+		float radius{};
+	};
 
 	class PointLightGameObject final : public GameObject
 	{
@@ -15,19 +23,28 @@ namespace ili
 		PointLightGameObject& operator=(const PointLightGameObject&) = delete;
 		PointLightGameObject& operator=(PointLightGameObject&&) = delete;
 
-		void SetIntensity(float intensity) { m_Intensity = intensity; }
+		void SetIntensity(float intensity) { m_Intensity = intensity; GetTransform()->MarkBoundsDirty(); }
 		float GetIntensity() const { return m_Intensity; }
 
-		void SetRadius(float radius) { m_Radius = radius; }
+		void SetRadius(float radius) { m_Radius = radius; GetTransform()->MarkBoundsDirty(); }
 		float GetRadius() const { return m_Radius; }
 
 		void SetColor(const glm::vec3& color) { m_Color = color; }
 		glm::vec3 GetColor() const { return m_Color; }
 
+		PointLightInstance GetInstance() const { return { GetTransform()->GetWorldPosition(), m_Intensity, m_Color, m_Radius }; }
+
+		// Everything the light reaches, see ClusteredLightingSystem::GetLightRange
+		virtual std::optional<Sphere> GetWorldBounds() override;
+
 	private:
+		friend class Scene;
+
 		float m_Intensity{};
 		float m_Radius{};
 		glm::vec3 m_Color{};
+		// Position in the scene's point lights, so a destroyed light is swapped out in constant time
+		uint32_t m_LightIndex{};
 
 	};
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 ﻿#include "PointLightSystem.h"
 
 #include <array>
+#include <bit>
+#include <cstddef>
 #include <stdexcept>
 
 #define GLM_FORCE_RADIANS
@@ -12,102 +14,105 @@
 
 #include "../SceneGraph/GameObject.h"
 #include "../SceneGraph/Camera.h"
+#include "../Graphics/SwapChain.h"
 #include "SceneGraph/TransformComponent.h"
 #include "Structs/FrameInfo.h"
 
 namespace ili
 {
-	struct PointLightPushConstants
+	PointLightSystem::PointLightSystem(Device& device, PipelineRegistry& pipelineRegistry, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, uint32_t subpass) :
+		m_Device(device),
+		m_PipelineRegistry(pipelineRegistry)
 	{
-		glm::vec4 position{};
-		glm::vec4 color{};
-		float radius{};
-	};
-
+		CreateInstanceBuffers();
+		CreatePipelineLayout(globalSetLayout);
+		CreatePipeline(renderPass, subpass);
+	}
 
-	PointLightSystem::PointLightSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : m_Device(device)
+	void PointLightSystem::CreateInstanceBuffers()
 	{
-		CreatePipelineLayout(globalSetLayout);
-		CreatePipeline(renderPass);
+		for (int i{}; i < SwapChain::MAX_FRAMES_IN_FLIGHT; ++i)
+		{
+			m_InstanceBuffers.emplace_back(CreateInstanceBuffer(INITIAL_POINT_LIGHT_CAPACITY));
+		}
+
+		m_InstanceData.reserve(INITIAL_POINT_LIGHT_CAPACITY);
 	}
 
-	PointLightSystem::~PointLightSystem()
+	std::unique_ptr<Buffer> PointLightSystem::CreateInstanceBuffer(uint32_t capacity) const
 	{
-		vkDestroyPipelineLayout(m_Device.GetDevice(), m_PipelineLayout, nullptr);
+		auto pBuffer = std::make_unique<Buffer>(m_Device, sizeof(LightInstance), capacity,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		pBuffer->Map();
+		return pBuffer;
 	}
 
 	void PointLightSystem::CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout)
 	{
-		VkPushConstantRange pushConstantRange{};
-		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-		pushConstantRange.offset = 0;
-		pushConstantRange.size = sizeof(PointLightPushConstants);
-
 		const std::vector<VkDescriptorSetLayout> descriptorSetLayouts = { globalSetLayout };
 
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-		pipelineLayoutInfo.pushConstantRangeCount = 1;
-		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-		if (vkCreatePipelineLayout(m_Device.GetDevice(), &pipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed to create pipeline layout");
-		}
+		m_PipelineLayout = m_PipelineRegistry.GetPipelineLayout(descriptorSetLayouts, {});
 	}
 
-	void PointLightSystem::CreatePipeline(VkRenderPass renderPass)
+	void PointLightSystem::CreatePipeline(VkRenderPass renderPass, uint32_t subpass)
 	{
 		PipelineConfigInfo pipelineConfig{};
 
 		Pipeline::GetDefaultPipelineConfigInfo(pipelineConfig);
-		pipelineConfig.vertexAttributeDescriptions.clear();
-		pipelineConfig.vertexBindingDescriptions.clear();
+		// The billboard corners come from gl_VertexIndex, the only vertex input is the per-light instance data
+		pipelineConfig.vertexBindingDescriptions = { { 0, sizeof(LightInstance), VK_VERTEX_INPUT_RATE_INSTANCE } };
+		pipelineConfig.vertexAttributeDescriptions = {
+			{ 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(LightInstance, position) },
+			{ 1, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(LightInstance, color) }
+		};
 
 		pipelineConfig.renderPass = renderPass;
+		pipelineConfig.subpass = subpass;
 		pipelineConfig.pipelineLayout = m_PipelineLayout;
-		m_Pipeline = std::make_unique<Pipeline>(m_Device, "Assets/CompiledShaders/pointLight.vert.spv", "Assets/CompiledShaders/pointLight.frag.spv", pipelineConfig);
+		if (subpass != 0) pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+		m_pPipeline = m_PipelineRegistry.GetPipeline("Assets/CompiledShaders/pointLight.vert.spv", "Assets/CompiledShaders/pointLight.frag.spv", pipelineConfig);
 	}
 
-	void PointLightSystem::Update(const FrameInfo& frameInfo, GlobalUbo& ubo, std::vector<std::unique_ptr<PointLightGameObject>>& pointLights)
+	void PointLightSystem::Update(const FrameInfo& frameInfo, const std::vector<PointLightInstance>& pointLights)
 	{
-		int lightIndex{};
-		for (auto& pointLight : pointLights)
+		const Frustum frustum = frameInfo.camera.GetFrustum();
+
+		m_InstanceData.clear();
+		for (const PointLightInstance& pointLight : pointLights)
 		{
-			ubo.pointLights[lightIndex].position = glm::vec4(pointLight->GetTransform()->GetPosition(), 1.f);
-			ubo.pointLights[lightIndex].color = glm::vec4(pointLight->GetColor(), pointLight->GetIntensity());
+			if (!frustum.Intersects({ pointLight.position, pointLight.radius })) continue;
 
-			lightIndex++;
+			m_InstanceData.push_back({
+				glm::vec4(pointLight.position, pointLight.radius),
+				glm::vec4(pointLight.color, pointLight.intensity) });
 		}
 
-		ubo.pointLightCount = lightIndex;
+		m_VisibleLightCount = static_cast<uint32_t>(m_InstanceData.size());
+		if (m_VisibleLightCount == 0) return;
+
+		// The fence of this frame slot has been waited on, nothing reads its old buffer anymore
+		std::unique_ptr<Buffer>& pInstanceBuffer = m_InstanceBuffers[frameInfo.frameIndex];
+		if (m_VisibleLightCount > pInstanceBuffer->GetInstanceCount()) pInstanceBuffer = CreateInstanceBuffer(std::bit_ceil(m_VisibleLightCount));
+
+		const VkDeviceSize dataSize = m_InstanceData.size() * sizeof(LightInstance);
+		pInstanceBuffer->WriteToBuffer(m_InstanceData.data(), dataSize);
+		pInstanceBuffer->Flush();
 	}
 
-	void PointLightSystem::Render(const FrameInfo& frameInfo, std::vector<std::unique_ptr<PointLightGameObject>>& pointLights)
+	void PointLightSystem::Render(const FrameInfo& frameInfo)
 	{
-		m_Pipeline->Bind(frameInfo.commandBuffer);
+		if (m_VisibleLightCount == 0) return;
+
+		m_pPipeline->Bind(frameInfo.commandBuffer);
 
 		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1,
 			&frameInfo.globalDescriptorSet, 0, nullptr);
 
-		for (auto& pointLight : pointLights)
-		{
-			PointLightPushConstants pushConstants{};
-			pushConstants.position = glm::vec4(pointLight->GetTransform()->GetPosition(), 1.f);
-			pushConstants.color = glm::vec4(pointLight->GetColor(), pointLight->GetIntensity());
-			pushConstants.radius = pointLight->GetRadius();
-
-			vkCmdPushConstants(frameInfo.commandBuffer, 
-				m_PipelineLayout, 
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 
-				0, 
-				sizeof(PointLightPushConstants), 
-				&pushConstants);
-
-			vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
-		}
+		const VkBuffer instanceBuffer = m_InstanceBuffers[frameInfo.frameIndex]->GetBuffer();
+		constexpr VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(frameInfo.commandBuffer, 0, 1, &instanceBuffer, &offset);
+
+		vkCmdDraw(frameInfo.commandBuffer, 6, m_VisibleLightCount, 0, 0);
 	}
 
 }
\ No newline at end of file
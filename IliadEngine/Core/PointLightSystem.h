@@ -1,36 +1,64 @@
 ﻿#pragma once
 
+#include <memory>
+#include <vector>
+
+#include "../Graphics/Buffer.h"
 #include "../Graphics/Pipeline.h"
+#include "../Graphics/PipelineRegistry.h"
 #include "../Graphics/Device.h"
 #include "SceneGraph/Camera.h"
 #include "SceneGraph/GameObject.h"
 
 namespace ili
 {
-	class PointLightGameObject;
-	struct GlobalUbo;
+	struct PointLightInstance;
 	struct FrameInfo;
 
+	/**
+	 * Draws the point light billboards.
+	 * Update culls the lights against the view frustum and writes the visible ones into this frame's instance buffer,
+	 * Render then draws all of them with a single instanced draw.
+	 */
 	class PointLightSystem
 	{
 	public:
-		PointLightSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
-		~PointLightSystem();
+		// A subpass other than 0 is the deferred lighting subpass, where the depth buffer is read-only
+		PointLightSystem(Device& device, PipelineRegistry& pipelineRegistry, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, uint32_t subpass = 0);
+		~PointLightSystem() = default;
 
 		PointLightSystem(const PointLightSystem&) = delete;
 		PointLightSystem& operator=(const PointLightSystem&) = delete;
 		PointLightSystem(PointLightSystem&&) = delete;
 		PointLightSystem& operator=(PointLightSystem&&) = delete;
 
-		void Update(const FrameInfo& frameInfo, GlobalUbo& ubo, std::vector<std::unique_ptr<PointLightGameObject>>& pointLights);
-		void Render(const FrameInfo& frameInfo, std::vector<std::unique_ptr<PointLightGameObject>>& pointLights);
+		void Update(const FrameInfo& frameInfo, const std::vector<PointLightInstance>& pointLights);
+		void Render(const FrameInfo& frameInfo);
+
+		// Lights that survived frustum culling in the last Update
+		uint32_t GetVisibleLightCount() const { return m_VisibleLightCount; }
 	private:
+		struct LightInstance
+		{
+			glm::vec4 position{}; //The w component is the billboard radius
+			glm::vec4 color{}; //Alpha channel is intensity
+		};
+
+		void CreateInstanceBuffers();
+		std::unique_ptr<Buffer> CreateInstanceBuffer(uint32_t capacity) const;
 		void CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout);
-		void CreatePipeline(VkRenderPass renderPass);
+		void CreatePipeline(VkRenderPass renderPass, uint32_t subpass);
 
 		Device& m_Device;
+		PipelineRegistry& m_PipelineRegistry;
 
-		std::unique_ptr<Pipeline> m_Pipeline{};
+		// Both are owned by the pipeline registry
+		Pipeline* m_pPipeline{};
 		VkPipelineLayout m_PipelineLayout{};
+
+		// One per frame in flight, rewritten by the CPU every frame
+		std::vector<std::unique_ptr<Buffer>> m_InstanceBuffers{};
+		std::vector<LightInstance> m_InstanceData{};
+		uint32_t m_VisibleLightCount{};
 	};
 }
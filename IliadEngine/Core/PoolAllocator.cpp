@@ -0,0 +1,65 @@
+﻿#include "PoolAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace ili
+{
+	PoolAllocator::PoolAllocator(size_t blockSize, size_t blockAlignment)
+		: m_BlockAlignment(std::max(blockAlignment, alignof(FreeBlock)))
+	{
+		// Every block has to hold a free list link and keep the blocks after it aligned
+		blockSize = std::max(blockSize, sizeof(FreeBlock));
+		m_Stats.blockSize = (blockSize + m_BlockAlignment - 1) / m_BlockAlignment * m_BlockAlignment;
+	}
+
+	PoolAllocator::~PoolAllocator()
+	{
+		assert(m_Stats.liveBlockCount == 0 && "Every object has to be destroyed before its pool");
+		for (void* pChunk : m_pChunks)
+		{
+			::operator delete(pChunk, std::align_val_t{ m_BlockAlignment });
+		}
+	}
+
+	void* PoolAllocator::Allocate()
+	{
+		if (!m_pFreeList) AllocateChunk();
+
+		FreeBlock* pBlock = m_pFreeList;
+		m_pFreeList = pBlock->pNext;
+
+		++m_Stats.allocationCount;
+		++m_Stats.liveBlockCount;
+		return pBlock;
+	}
+
+	void PoolAllocator::Deallocate(void* pBlock)
+	{
+		assert(m_Stats.liveBlockCount > 0 && "More blocks freed than allocated");
+
+		FreeBlock* pFreeBlock = static_cast<FreeBlock*>(pBlock);
+		pFreeBlock->pNext = m_pFreeList;
+		m_pFreeList = pFreeBlock;
+		--m_Stats.liveBlockCount;
+	}
+
+	void PoolAllocator::AllocateChunk()
+	{
+		const uint32_t blockCount = m_pChunks.empty() ? FIRST_CHUNK_BLOCK_COUNT : std::min(m_Stats.capacityBlockCount, MAX_BLOCKS_PER_CHUNK);
+
+		std::byte* pChunk = static_cast<std::byte*>(::operator new(blockCount * m_Stats.blockSize, std::align_val_t{ m_BlockAlignment }));
+		m_pChunks.push_back(pChunk);
+
+		// Linked back to front, so the blocks are handed out in address order
+		for (uint32_t i = blockCount; i-- > 0;)
+		{
+			FreeBlock* pBlock = reinterpret_cast<FreeBlock*>(pChunk + i * m_Stats.blockSize);
+			pBlock->pNext = m_pFreeList;
+			m_pFreeList = pBlock;
+		}
+
+		++m_Stats.chunkCount;
+		m_Stats.capacityBlockCount += blockCount;
+	}
+}
@@ -0,0 +1,93 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace ili
+{
+	struct PoolStats
+	{
+		// Calls to Allocate since the pool was created, each one would have been a separate heap allocation
+		uint64_t allocationCount{};
+		// Heap allocations the pool made itself, one per chunk
+		uint32_t chunkCount{};
+		uint32_t liveBlockCount{};
+		uint32_t capacityBlockCount{};
+		size_t blockSize{};
+
+		size_t GetReservedBytes() const { return static_cast<size_t>(capacityBlockCount) * blockSize; }
+		size_t GetUsedBytes() const { return static_cast<size_t>(liveBlockCount) * blockSize; }
+		// Share of the reserved blocks that are free, holes left by freed objects and the unused end of the last chunk
+		float GetFragmentation() const { return capacityBlockCount > 0 ? 1.f - static_cast<float>(liveBlockCount) / static_cast<float>(capacityBlockCount) : 0.f; }
+	};
+
+	/**
+	 * Fixed size blocks carved out of large chunks, freed blocks go on an intrusive free list and are handed out
+	 * first. Chunks double in size up to MAX_BLOCKS_PER_CHUNK and are only returned when the pool is destroyed,
+	 * all at once. Not thread safe
+	 */
+	class PoolAllocator final
+	{
+	public:
+		PoolAllocator(size_t blockSize, size_t blockAlignment);
+		~PoolAllocator();
+
+		PoolAllocator(const PoolAllocator& other) = delete;
+		PoolAllocator(PoolAllocator&& other) noexcept = delete;
+		PoolAllocator& operator=(const PoolAllocator& other) = delete;
+		PoolAllocator& operator=(PoolAllocator&& other) noexcept = delete;
+
+		void* Allocate();
+		// The block has to come from this pool
+		void Deallocate(void* pBlock);
+
+		const PoolStats& GetStats() const { return m_Stats; }
+
+	private:
+		static constexpr uint32_t FIRST_CHUNK_BLOCK_COUNT = 16;
+		static constexpr uint32_t MAX_BLOCKS_PER_CHUNK = 1'024;
+
+		struct FreeBlock
+		{
+			FreeBlock* pNext;
+		};
+
+		void AllocateChunk();
+
+		size_t m_BlockAlignment;
+		std::vector<void*> m_pChunks{};
+		FreeBlock* m_pFreeList{};
+		PoolStats m_Stats{};
+	};
+
+	// Destroys an object that was constructed in a pool and gives its block back, objects without a pool are deleted
+	struct PoolDeleter
+	{
+		PoolAllocator* pPool{};
+
+		template <typename T>
+		void operator()(T* pObject) const
+		{
+			if (!pPool)
+			{
+				delete pObject;
+				return;
+			}
+
+			// The block starts at the most derived object, the pointer may be to one of its bases
+			void* pBlock{};
+			if constexpr (std::is_polymorphic_v<T>) pBlock = dynamic_cast<void*>(pObject);
+			else pBlock = pObject;
+
+			pObject->~T();
+			pPool->Deallocate(pBlock);
+		}
+	};
+
+	template <typename T>
+	using PoolPtr = std::unique_ptr<T, PoolDeleter>;
+}
@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "PointLight.h"
+#include "SceneGraph/Camera.h"
+#include "SceneGraph/ModelComponent.h"
+
+namespace ili
+{
+	class PerformanceHud;
+	class SoftwareOcclusionCuller;
+
+	/**
+	 * Everything a frame is recorded from, copied out of the scene by the game thread once the simulation of the frame is done.
+	 * The render thread only reads it, so the game thread can change the scene meanwhile. The models hold on to their
+	 * meshes and materials, objects destroyed after the copy stay drawable until the snapshot is refilled.
+	 * IliadGame only refills a snapshot once the fence of the frame recorded from it has signalled, so the GPU never
+	 * reads a buffer or texture that was released with it.
+	 */
+	struct RenderSnapshot final
+	{
+		Camera camera{};
+		float frameTime{};
+
+		// Left after frustum culling
+		ModelList models{};
+		std::vector<PointLightInstance> pointLights{};
+
+		// Owned by the game, one per snapshot. Null while software occlusion culling is off
+		const SoftwareOcclusionCuller* pSoftwareOcclusion{};
+
+		bool depthPrePass{};
+		bool occlusionCulling{};
+		bool gpuProfiling{};
+		// Built before the frame is recorded, null while the HUD is hidden
+		PerformanceHud* pHud{};
+	};
+}
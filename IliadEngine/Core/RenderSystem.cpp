@@ -10,6 +10,8 @@
 
 #include "../SceneGraph/GameObject.h"
 #include "../SceneGraph/Camera.h"
+#include "Core/OcclusionCullingSystem.h"
+#include "Core/SoftwareOcclusionCuller.h"
 #include "SceneGraph/ModelComponent.h"
 #include "SceneGraph/TransformComponent.h"
 #include "Structs/FrameInfo.h"
@@ -22,17 +24,14 @@ namespace ili
 		glm::mat4 normalMatrix{ 1.f }; //Identity matrix
 	};
 
-	RenderSystem::RenderSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : m_Device(device)
+	RenderSystem::RenderSystem(Device& device, PipelineRegistry& pipelineRegistry, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) :
+		m_Device(device),
+		m_PipelineRegistry(pipelineRegistry)
 	{
 		CreatePipelineLayout(globalSetLayout);
 		CreatePipeline(renderPass);
 	}
 
-	RenderSystem::~RenderSystem()
-	{
-		vkDestroyPipelineLayout(m_Device.GetDevice(), m_PipelineLayout, nullptr);
-	}
-
 	void RenderSystem::CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout)
 	{
 		VkPushConstantRange pushConstantRange{};
@@ -42,17 +41,7 @@ namespace ili
 
 		const std::vector<VkDescriptorSetLayout> descriptorSetLayouts = { globalSetLayout };
 
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-		pipelineLayoutInfo.pushConstantRangeCount = 1;
-		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-		if (vkCreatePipelineLayout(m_Device.GetDevice(), &pipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed to create pipeline layout");
-		}
+		m_PipelineLayout = m_PipelineRegistry.GetPipelineLayout(descriptorSetLayouts, { pushConstantRange });
 	}
 
 	void RenderSystem::CreatePipeline(VkRenderPass renderPass)
@@ -63,34 +52,75 @@ namespace ili
 
 		pipelineConfig.renderPass = renderPass;
 		pipelineConfig.pipelineLayout = m_PipelineLayout;
-		m_Pipeline = std::make_unique<Pipeline>(m_Device, "Assets/CompiledShaders/shader.vert.spv", "Assets/CompiledShaders/shader.frag.spv", pipelineConfig);
+		m_pPipeline = m_PipelineRegistry.GetPipeline("Assets/CompiledShaders/shader.vert.spv", "Assets/CompiledShaders/shader.frag.spv", pipelineConfig);
+
+		// Variant used after the depth pre-pass, only the visible surface gets shaded
+		pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+		pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+		m_pDepthEqualPipeline = m_PipelineRegistry.GetPipeline("Assets/CompiledShaders/shader.vert.spv", "Assets/CompiledShaders/shader.frag.spv", pipelineConfig);
 	}
 
-	void RenderSystem::RenderGameObjects(const FrameInfo& frameInfo, const std::vector<std::unique_ptr<GameObject>>& gameObjects)
+	void RenderSystem::RenderGameObjects(const FrameInfo& frameInfo, const ModelList& models)
 	{
-		m_Pipeline->Bind(frameInfo.commandBuffer);
+		m_RenderQueue.Clear();
 
-		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, 
-			&frameInfo.globalDescriptorSet, 0, nullptr);
+		Pipeline* pPipeline = frameInfo.depthPrePass ? m_pDepthEqualPipeline : m_pPipeline;
+		const glm::mat4& view = frameInfo.camera.GetView();
 
-		for (auto& gameObject : gameObjects)
+		for (const ModelInstance& instance : models)
 		{
-			const auto modelComponent = gameObject->GetComponent<ModelComponent>();
+			// With the pre-pass the EQUAL test would let this and the TextureRenderSystem both shade objects with a material
+			if (!instance.pModel || (frameInfo.depthPrePass && instance.pMaterial)) continue;
 
-			if (!modelComponent) continue;
+			Model* pModel = instance.pModel.get();
+			if (frameInfo.pSoftwareOcclusion &&
+				!frameInfo.pSoftwareOcclusion->IsVisible(pModel->GetBoundingSphere().GetTransformed(instance.modelMatrix), m_Stats)) continue;
 
-//			if (!modelComponent->GetModel() || modelComponent->GetDiffuseMap()) continue;
+			const float viewDepth = (view * instance.modelMatrix[3]).z;
+
+			m_RenderQueue.Add({ RenderQueue::MakeOpaqueKey(pPipeline->GetId(), 0, pModel->GetId(), viewDepth), &instance, pPipeline, pModel, nullptr });
+		}
+
+		if (m_RenderQueue.GetSize() == 0) return;
+
+		m_RenderQueue.Sort();
+
+		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, 
+			&frameInfo.globalDescriptorSet, 0, nullptr);
+		++m_Stats.descriptorSetBinds;
+
+		const Pipeline* pBoundPipeline{};
+		const Model* pBoundModel{};
+		for (const auto& packet : m_RenderQueue.GetPackets())
+		{
+			if (packet.pPipeline != pBoundPipeline)
+			{
+				packet.pPipeline->Bind(frameInfo.commandBuffer);
+				pBoundPipeline = packet.pPipeline;
+				++m_Stats.pipelineBinds;
+			}
 
 			SimplePushConstantData pushData{};
 
-			pushData.modelMatrix = gameObject->GetTransform()->GetMatrix();
-			pushData.normalMatrix = gameObject->GetTransform()->GetNormalMatrix();
+			pushData.modelMatrix = packet.pInstance->modelMatrix;
+			pushData.normalMatrix = packet.pInstance->normalMatrix;
 
 			vkCmdPushConstants(frameInfo.commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &pushData);
 
-
-			modelComponent->GetModel()->Bind(frameInfo.commandBuffer);
-			modelComponent->GetModel()->Draw(frameInfo.commandBuffer);
+			if (packet.pModel != pBoundModel)
+			{
+				packet.pModel->Bind(frameInfo.commandBuffer);
+				pBoundModel = packet.pModel;
+				++m_Stats.meshBinds;
+			}
+
+			if (frameInfo.pOcclusionCulling)
+				frameInfo.pOcclusionCulling->Draw(frameInfo, *packet.pInstance);
+			else
+				packet.pModel->Draw(frameInfo.commandBuffer);
+			++m_Stats.drawCalls;
+			++m_Stats.instanceCount;
+			m_Stats.triangleCount += packet.pModel->GetTriangleCount();
 		}
 	}
 }
\ No newline at end of file
@@ -1,9 +1,13 @@
 ﻿#pragma once
 
 #include "Graphics/Pipeline.h"
+#include "Graphics/PipelineRegistry.h"
+#include "Graphics/RenderQueue.h"
 #include "Graphics/Device.h"
 #include "SceneGraph/Camera.h"
 #include "SceneGraph/GameObject.h"
+#include "SceneGraph/ModelComponent.h"
+#include "Structs/RenderStats.h"
 
 namespace ili
 {
@@ -12,22 +16,31 @@ namespace ili
 	class RenderSystem
 	{
 	public:
-		RenderSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
-		~RenderSystem();
+		RenderSystem(Device& device, PipelineRegistry& pipelineRegistry, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+		~RenderSystem() = default;
 
 		RenderSystem(const RenderSystem&) = delete;
 		RenderSystem& operator=(const RenderSystem&) = delete;
 		RenderSystem(RenderSystem&&) = delete;
 		RenderSystem& operator=(RenderSystem&&) = delete;
 
-		void RenderGameObjects(const FrameInfo& frameInfo, const std::vector<std::unique_ptr<GameObject>>& gameObjects);
+		void RenderGameObjects(const FrameInfo& frameInfo, const ModelList& models);
+
+		void ResetStats() { m_Stats = {}; }
+		const RenderStats& GetStats() const { return m_Stats; }
 	private:
 		void CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout);
 		void CreatePipeline(VkRenderPass renderPass);
 
 		Device& m_Device;
+		PipelineRegistry& m_PipelineRegistry;
 
-		std::unique_ptr<Pipeline> m_Pipeline{};
+		// Both are owned by the pipeline registry
+		Pipeline* m_pPipeline{};
+		Pipeline* m_pDepthEqualPipeline{};
 		VkPipelineLayout m_PipelineLayout{};
+
+		RenderQueue m_RenderQueue{};
+		RenderStats m_Stats{};
 	};
 }
\ No newline at end of file
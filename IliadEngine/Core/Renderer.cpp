@@ -1,16 +1,41 @@
 ﻿#include "Renderer.h"
 
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <stdexcept>
 
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include "CpuProfiler.h"
+#include "JobSystem.h"
 #include "../SceneGraph/GameObject.h"
 
 namespace ili
 {
-	Renderer::Renderer(Window* window, Device& device) : m_Window(window), m_Device(device)
+	Renderer::Renderer(Window* window, Device& device, RenderPath renderPath) : m_Window(window), m_Device(device), m_RenderPath(renderPath)
+	{
+		Initialize();
+	}
+
+	Renderer::Renderer(VkExtent2D extent, Device& device, RenderPath renderPath) : m_Window(nullptr), m_HeadlessExtent(extent), m_Device(device), m_RenderPath(renderPath)
+	{
+		assert(m_Device.IsHeadless() && "A headless renderer needs a device without a surface");
+		Initialize();
+	}
+
+	void Renderer::Initialize()
 	{
 		RecreateSwapChain();
 		CreateCommandBuffers();
+
+		if (TimestampQueryPool::IsSupported(m_Device))
+		{
+			m_pTimestampQueryPool = std::make_unique<TimestampQueryPool>(m_Device, 2 * SwapChain::MAX_FRAMES_IN_FLIGHT);
+		}
+
+		m_RenderExtent = m_pSwapChain->GetSwapChainExtent();
 	}
 
 	Renderer::~Renderer()
@@ -21,6 +46,7 @@ namespace ili
 	VkCommandBuffer Renderer::BeginFrame()
 	{
 		assert(!m_FrameStarted && "Cannot call BeginFrame while frame is in progress");
+		ILIAD_PROFILE_SCOPE("Renderer::BeginFrame");
 
 		const auto result = m_pSwapChain->AcquireNextImage(&m_CurrentImageIndex);
 
@@ -48,14 +74,43 @@ namespace ili
 			throw std::runtime_error("Failed to begin recording command buffer");
 		}
 
+		m_UseRenderTarget = m_DynamicResolution.GetSettings().enabled && m_pRenderTarget;
+		m_HasBlittedRenderTarget = false;
+
+		if (m_pTimestampQueryPool)
+		{
+			// The fence waited on while acquiring the image guarantees that the last frame in this slot finished
+			const uint32_t firstQuery = static_cast<uint32_t>(m_CurrentFrameIndex) * 2;
+
+			std::vector<uint64_t> timestamps{};
+			if (m_pTimestampQueryPool->GetResults(firstQuery, 2, timestamps) && timestamps[1] >= timestamps[0])
+			{
+				m_GpuFrameTime = static_cast<float>(static_cast<double>(timestamps[1] - timestamps[0]) * m_pTimestampQueryPool->GetPeriod() / 1'000'000.0);
+				if (m_UseRenderTarget) m_DynamicResolution.Update(m_GpuFrameTime);
+			}
+
+			m_pTimestampQueryPool->Reset(commandBuffer, firstQuery, 2);
+			m_pTimestampQueryPool->WriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, firstQuery);
+		}
+
+		UpdateRenderExtent();
+
 		return commandBuffer;
 	}
 
 	void Renderer::EndFrame()
 	{
 		assert(m_FrameStarted && "Cannot call EndFrame while frame is not in progress");
+		ILIAD_PROFILE_SCOPE("Renderer::EndFrame");
 		const auto commandBuffer = GetCurrentCommandBuffer();
 
+		if (m_UseRenderTarget && !m_HasBlittedRenderTarget) BlitRenderTarget(commandBuffer);
+
+		if (m_pTimestampQueryPool)
+		{
+			m_pTimestampQueryPool->WriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, static_cast<uint32_t>(m_CurrentFrameIndex) * 2 + 1);
+		}
+
 		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
 		{
 			throw std::runtime_error("Failed to record command buffer");
@@ -63,9 +118,10 @@ namespace ili
 
 		const auto result = m_pSwapChain->SubmitCommandBuffers(&commandBuffer, &m_CurrentImageIndex);
 
-		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_Window->WasWindowResized())
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || (m_Window && m_Window->WasWindowResized()))
 		{
-			m_Window->ResetWindowResizedFlag();
+			// Headless swap chains are recreated at the fixed extent
+			if (m_Window) m_Window->ResetWindowResizedFlag();
 			RecreateSwapChain();
 		}
 
@@ -83,45 +139,211 @@ namespace ili
 		assert(m_FrameStarted && "Cannot begin render pass when frame is not in progress");
 		assert(commandBuffer == GetCurrentCommandBuffer() && "You can only begin the render pass on a command buffer from the same frame");
 
+		std::array<VkClearValue, 2> clearValues{};
+		clearValues[0].color = { 0.013f, 0.012f, 0.015f, 1.0f };
+		clearValues[1].depthStencil = { 1.0f, 0 };
+
+		if (m_UseRenderTarget)
+		{
+			BeginRenderPass(commandBuffer, m_pRenderTarget->GetRenderPass(), m_pRenderTarget->GetFrameBuffer(m_CurrentImageIndex),
+				static_cast<uint32_t>(clearValues.size()), clearValues.data());
+			return;
+		}
+
+		BeginRenderPass(commandBuffer, m_pSwapChain->GetRenderPass(), m_pSwapChain->GetFrameBuffer(m_CurrentImageIndex),
+			static_cast<uint32_t>(clearValues.size()), clearValues.data());
+	}
+
+	void Renderer::ResumeSwapChainRenderPass(VkCommandBuffer commandBuffer)
+	{
+		assert(m_FrameStarted && "Cannot begin render pass when frame is not in progress");
+		assert(commandBuffer == GetCurrentCommandBuffer() && "You can only begin the render pass on a command buffer from the same frame");
+
+		// Both attachments are loaded, the clear values are ignored
+		if (m_UseRenderTarget)
+		{
+			BeginRenderPass(commandBuffer, m_pRenderTarget->GetResumeRenderPass(), m_pRenderTarget->GetFrameBuffer(m_CurrentImageIndex), 0, nullptr);
+			return;
+		}
+
+		BeginRenderPass(commandBuffer, m_pSwapChain->GetResumeRenderPass(), m_pSwapChain->GetFrameBuffer(m_CurrentImageIndex), 0, nullptr);
+	}
+
+	VkImage Renderer::GetCurrentDepthImage() const
+	{
+		if (m_UseRenderTarget) return m_pRenderTarget->GetDepthImage(m_CurrentImageIndex);
+		return m_pSwapChain->GetDepthImage(static_cast<int>(m_CurrentImageIndex));
+	}
+
+	VkImageView Renderer::GetCurrentDepthImageView() const
+	{
+		if (m_UseRenderTarget) return m_pRenderTarget->GetDepthImageView(m_CurrentImageIndex);
+		return m_pSwapChain->GetDepthImageView(static_cast<int>(m_CurrentImageIndex));
+	}
+
+	void Renderer::SetDynamicResolutionSettings(const DynamicResolutionSettings& settings)
+	{
+		assert((!settings.enabled || m_RenderPath == RenderPath::Forward) && "Dynamic resolution is only supported by the forward path");
+		if (m_RenderPath != RenderPath::Forward) return;
+
+		m_DynamicResolution.SetSettings(settings);
+
+		if (!settings.enabled || m_pRenderTarget) return;
+
+		if (!m_pSwapChain->SupportsTransferDestination())
+		{
+			throw std::runtime_error("Failed to enable dynamic resolution, the swap chain images cannot be blitted into");
+		}
+
+		m_pRenderTarget = std::make_unique<OffscreenRenderTarget>(m_Device, *m_pSwapChain);
+	}
+
+	void Renderer::UpdateRenderExtent()
+	{
+		m_RenderExtent = m_pSwapChain->GetSwapChainExtent();
+		if (!m_UseRenderTarget) return;
+
+		const float scale = m_DynamicResolution.GetScale();
+		m_RenderExtent.width = std::max(static_cast<uint32_t>(std::lround(static_cast<float>(m_RenderExtent.width) * scale)), 1u);
+		m_RenderExtent.height = std::max(static_cast<uint32_t>(std::lround(static_cast<float>(m_RenderExtent.height) * scale)), 1u);
+	}
+
+	void Renderer::BlitRenderTarget(VkCommandBuffer commandBuffer)
+	{
+		const VkImage swapChainImage = m_pSwapChain->GetImage(static_cast<int>(m_CurrentImageIndex));
+
+		// Waits on the color output stage like the acquire semaphore, which chains the two together
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = swapChainImage;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		const VkExtent2D fullExtent = m_pSwapChain->GetSwapChainExtent();
+
+		VkImageBlit blit{};
+		blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		blit.srcOffsets[1] = { static_cast<int32_t>(m_RenderExtent.width), static_cast<int32_t>(m_RenderExtent.height), 1 };
+		blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		blit.dstOffsets[1] = { static_cast<int32_t>(fullExtent.width), static_cast<int32_t>(fullExtent.height), 1 };
+
+		// The offscreen pass already left its color in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+		vkCmdBlitImage(commandBuffer,
+			m_pRenderTarget->GetColorImage(m_CurrentImageIndex), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			swapChainImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &blit, m_pRenderTarget->GetBlitFilter());
+
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = m_pSwapChain->GetFinalLayout();
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	void Renderer::EndSwapChainRenderPass(VkCommandBuffer commandBuffer)
+	{
+		assert(m_FrameStarted && "Cannot begin render pass when frame is not in progress");
+		assert(commandBuffer == GetCurrentCommandBuffer() && "You can only end the render pass on a command buffer from the same frame");
+
+
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	void Renderer::BeginDeferredRenderPass(VkCommandBuffer commandBuffer)
+	{
+		assert(m_FrameStarted && "Cannot begin render pass when frame is not in progress");
+		assert(commandBuffer == GetCurrentCommandBuffer() && "You can only begin the render pass on a command buffer from the same frame");
+		assert(m_pGBuffer && "The deferred render pass only exists when the renderer uses the deferred path");
+
+		const auto clearValues = m_pGBuffer->GetClearValues();
+		BeginRenderPass(commandBuffer, m_pGBuffer->GetRenderPass(), m_pGBuffer->GetFrameBuffer(m_CurrentImageIndex),
+			static_cast<uint32_t>(clearValues.size()), clearValues.data());
+	}
+
+	void Renderer::BeginOverlayRenderPass(VkCommandBuffer commandBuffer)
+	{
+		assert(m_FrameStarted && "Cannot begin render pass when frame is not in progress");
+		assert(commandBuffer == GetCurrentCommandBuffer() && "You can only begin the render pass on a command buffer from the same frame");
+
+		if (m_UseRenderTarget && !m_HasBlittedRenderTarget)
+		{
+			BlitRenderTarget(commandBuffer);
+			m_HasBlittedRenderTarget = true;
+		}
+
 		VkRenderPassBeginInfo renderPassInfo{};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = m_pSwapChain->GetRenderPass();
-		renderPassInfo.framebuffer = m_pSwapChain->GetFrameBuffer(m_CurrentImageIndex);
+		renderPassInfo.renderPass = m_pSwapChain->GetOverlayRenderPass();
+		renderPassInfo.framebuffer = m_pSwapChain->GetOverlayFrameBuffer(static_cast<int>(m_CurrentImageIndex));
 		renderPassInfo.renderArea.offset = { 0, 0 };
 		renderPassInfo.renderArea.extent = m_pSwapChain->GetSwapChainExtent();
 
-		std::array<VkClearValue, 2> clearValues{};
-		clearValues[0].color = { 0.013f, 0.012f, 0.015f, 1.0f };
-		clearValues[1].depthStencil = { 1.0f, 0 };
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	}
 
-		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-		renderPassInfo.pClearValues = clearValues.data();
+	void Renderer::EndOverlayRenderPass(VkCommandBuffer commandBuffer)
+	{
+		assert(m_FrameStarted && "Cannot end render pass when frame is not in progress");
+		assert(commandBuffer == GetCurrentCommandBuffer() && "You can only end the render pass on a command buffer from the same frame");
+
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	void Renderer::NextDeferredSubpass(VkCommandBuffer commandBuffer)
+	{
+		assert(m_FrameStarted && "Cannot advance the render pass when frame is not in progress");
+		assert(commandBuffer == GetCurrentCommandBuffer() && "You can only advance the render pass on a command buffer from the same frame");
+
+		vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+	}
+
+	void Renderer::EndDeferredRenderPass(VkCommandBuffer commandBuffer)
+	{
+		assert(m_FrameStarted && "Cannot end render pass when frame is not in progress");
+		assert(commandBuffer == GetCurrentCommandBuffer() && "You can only end the render pass on a command buffer from the same frame");
+
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	void Renderer::BeginRenderPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFramebuffer framebuffer,
+		uint32_t clearValueCount, const VkClearValue* pClearValues)
+	{
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = renderPass;
+		renderPassInfo.framebuffer = framebuffer;
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = m_RenderExtent;
+
+		renderPassInfo.clearValueCount = clearValueCount;
+		renderPassInfo.pClearValues = pClearValues;
 
 		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 		VkViewport viewport{};
 		viewport.x = 0.0f;
 		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(m_pSwapChain->GetSwapChainExtent().width);
-		viewport.height = static_cast<float>(m_pSwapChain->GetSwapChainExtent().height);
+		viewport.width = static_cast<float>(m_RenderExtent.width);
+		viewport.height = static_cast<float>(m_RenderExtent.height);
 		viewport.minDepth = 0.0f;
 		viewport.maxDepth = 1.0f;
 
-		const VkRect2D scissor{ {0, 0}, m_pSwapChain->GetSwapChainExtent() };
+		const VkRect2D scissor{ {0, 0}, m_RenderExtent };
 		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
 	}
 
-	void Renderer::EndSwapChainRenderPass(VkCommandBuffer commandBuffer)
-	{
-		assert(m_FrameStarted && "Cannot begin render pass when frame is not in progress");
-		assert(commandBuffer == GetCurrentCommandBuffer() && "You can only end the render pass on a command buffer from the same frame");
-
-
-		vkCmdEndRenderPass(commandBuffer);
-	}
-
 	void Renderer::CreateCommandBuffers()
 	{
 		m_CommandBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
@@ -140,15 +362,19 @@ namespace ili
 
 	void Renderer::RecreateSwapChain()
 	{
-		auto extent = m_Window->GetExtent();
+		auto extent = m_Window ? m_Window->GetExtent() : m_HeadlessExtent;
 
-		while (extent.width == 0 || extent.height == 0)
+		while (m_Window && (extent.width == 0 || extent.height == 0))
 		{
 			extent = m_Window->GetExtent();
-			glfwWaitEvents();
+
+			// GLFW only handles events on the main thread, frames may be recorded on another one
+			JobCounter counter{};
+			JobSystem::GetInstance().RunOnMainThread([]() { glfwWaitEvents(); }, &counter);
+			JobSystem::GetInstance().Wait(counter);
 		}
 
-		vkDeviceWaitIdle(m_Device.GetDevice());
+		m_Device.WaitIdle();
 
 		if (!m_pSwapChain) 
 		{
@@ -163,6 +389,26 @@ namespace ili
 				throw std::runtime_error("Swap chain image(or depth) format has changed!");
 			}
 		}
+
+		if (m_RenderPath == RenderPath::Deferred)
+		{
+			if (!m_pGBuffer) m_pGBuffer = std::make_unique<GBuffer>(m_Device, *m_pSwapChain);
+			else m_pGBuffer->Recreate(*m_pSwapChain);
+		}
+
+		if (m_pRenderTarget) m_pRenderTarget->Recreate(*m_pSwapChain);
+	}
+
+	bool Renderer::SaveFrame(const std::string& filePath) const
+	{
+		assert(!m_FrameStarted && "Cannot save a frame that is still being recorded");
+
+		std::vector<uint8_t> pixels{};
+		m_pSwapChain->ReadImage(static_cast<int>(m_CurrentImageIndex), pixels);
+
+		const int width = static_cast<int>(m_pSwapChain->GetWidth());
+		const int height = static_cast<int>(m_pSwapChain->GetHeight());
+		return stbi_write_png(filePath.c_str(), width, height, 4, pixels.data(), width * 4) != 0;
 	}
 
 	void Renderer::FreeCommandBuffers()
@@ -3,14 +3,27 @@
 
 #include "../Graphics/Device.h"
 #include "../Graphics/SwapChain.h"
+#include "../Graphics/GBuffer.h"
+#include "../Graphics/OffscreenRenderTarget.h"
+#include "../Graphics/TimestampQueryPool.h"
+#include "DynamicResolution.h"
 #include "Graphics/Model.h"
 
 namespace ili
 {
+	// Chosen once at startup, see IliadGame::SetRenderPath
+	enum class RenderPath
+	{
+		Forward,	// Clustered forward shading in a single subpass
+		Deferred	// G-buffer subpass followed by a lighting subpass reading it through input attachments
+	};
+
 	class Renderer
 	{
 	public:
-		Renderer(Window* window, Device& device);
+		Renderer(Window* window, Device& device, RenderPath renderPath = RenderPath::Forward);
+		// Headless, renders into offscreen images of a fixed size. The device has to be created without a window
+		Renderer(VkExtent2D extent, Device& device, RenderPath renderPath = RenderPath::Forward);
 		~Renderer();
 
 		Renderer(const Renderer&) = delete;
@@ -24,16 +37,67 @@ namespace ili
 		void BeginSwapChainRenderPass(VkCommandBuffer commandBuffer);
 		void EndSwapChainRenderPass(VkCommandBuffer commandBuffer);
 		VkRenderPass GetSwapChainRenderPass() const { return m_pSwapChain->GetRenderPass(); }
+		// Begins the swap chain render pass again after it was ended mid-frame, keeping color and depth
+		void ResumeSwapChainRenderPass(VkCommandBuffer commandBuffer);
+
+		// Depth attachment of the swap chain image being rendered, or of the offscreen target while it is in use
+		VkImage GetCurrentDepthImage() const;
+		VkImageView GetCurrentDepthImageView() const;
+		VkFormat GetDepthFormat() const { return m_pSwapChain->GetDepthFormat(); }
+
+		/**
+		 * Draws on top of the finished frame at the full swap chain resolution, after the dynamic resolution upscale.
+		 * Must come after all scene render passes of the frame. Viewport and scissor are left to the caller
+		 */
+		void BeginOverlayRenderPass(VkCommandBuffer commandBuffer);
+		void EndOverlayRenderPass(VkCommandBuffer commandBuffer);
+		VkRenderPass GetOverlayRenderPass() const { return m_pSwapChain->GetOverlayRenderPass(); }
+		uint32_t GetSwapChainImageCount() const { return static_cast<uint32_t>(m_pSwapChain->ImageCount()); }
+
+		// Deferred path only, begins in the geometry subpass
+		void BeginDeferredRenderPass(VkCommandBuffer commandBuffer);
+		// Moves from the geometry subpass to the lighting subpass
+		void NextDeferredSubpass(VkCommandBuffer commandBuffer);
+		void EndDeferredRenderPass(VkCommandBuffer commandBuffer);
+		VkRenderPass GetDeferredRenderPass() const { return m_pGBuffer->GetRenderPass(); }
+		const GBuffer& GetGBuffer() const { return *m_pGBuffer; }
+		RenderPath GetRenderPath() const { return m_RenderPath; }
+
 		float GetAspectRatio() const { return m_pSwapChain->ExtentAspectRatio(); }
+		VkExtent2D GetSwapChainExtent() const { return m_pSwapChain->GetSwapChainExtent(); }
+		// Part of the attachments that is rendered this frame, smaller than the swap chain under dynamic resolution
+		VkExtent2D GetRenderExtent() const { return m_RenderExtent; }
+
+		/**
+		 * Forward path only. While enabled, the frame is rendered into an offscreen target at a scaled resolution
+		 * and blitted into the swap chain image at the end of the frame.
+		 * The scale follows the GPU frame time measured with timestamp queries, it stays at the maximum if the
+		 * device has no timestamp support.
+		 */
+		void SetDynamicResolutionSettings(const DynamicResolutionSettings& settings);
+		const DynamicResolutionSettings& GetDynamicResolutionSettings() const { return m_DynamicResolution.GetSettings(); }
+		float GetResolutionScale() const { return m_UseRenderTarget ? m_DynamicResolution.GetScale() : 1.f; }
+		// Milliseconds from the start to the end of the command buffer, a few frames old. Zero without timestamp support
+		float GetGpuFrameTime() const { return m_GpuFrameTime; }
 
 		bool IsFrameInProgress() const { return m_FrameStarted; }
 
+		// Writes the image of the last finished frame as a PNG, false if the file could not be written.
+		// Headless only, waits for the device to go idle
+		bool SaveFrame(const std::string& filePath) const;
+
 		int GetFrameIndex() const 
 		{
 			assert(m_FrameStarted && "Cannot get command buffer when frame not in progress.");
 			return m_CurrentFrameIndex; 
 		}
 
+		uint32_t GetCurrentImageIndex() const
+		{
+			assert(m_FrameStarted && "Cannot get the swap chain image when frame not in progress.");
+			return m_CurrentImageIndex;
+		}
+
 		VkCommandBuffer GetCurrentCommandBuffer() const 
 		{
 			assert(m_FrameStarted && "Cannot get command buffer when frame not in progress.");
@@ -41,16 +105,39 @@ namespace ili
 		}
 
 	private:
+		void Initialize();
 		void CreateCommandBuffers();
 		void FreeCommandBuffers();
 
 		void RecreateSwapChain();
+		void UpdateRenderExtent();
+		// Upscales the offscreen color into the swap chain image and leaves it ready for presentation
+		void BlitRenderTarget(VkCommandBuffer commandBuffer);
+		void BeginRenderPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFramebuffer framebuffer,
+			uint32_t clearValueCount, const VkClearValue* pClearValues);
 
+		// Null when headless
 		Window* m_Window;
+		VkExtent2D m_HeadlessExtent{};
 		Device& m_Device;
+		RenderPath m_RenderPath;
 		std::unique_ptr<SwapChain> m_pSwapChain{};
+		// Only created for the deferred path
+		std::unique_ptr<GBuffer> m_pGBuffer{};
 		std::vector<VkCommandBuffer> m_CommandBuffers{};
 
+		DynamicResolutionController m_DynamicResolution{};
+		// Created the first time dynamic resolution is enabled
+		std::unique_ptr<OffscreenRenderTarget> m_pRenderTarget{};
+		// Start and end of every frame in flight, null when timestamps are not supported
+		std::unique_ptr<TimestampQueryPool> m_pTimestampQueryPool{};
+		float m_GpuFrameTime{};
+		VkExtent2D m_RenderExtent{};
+		// Fixed at the start of a frame, so a settings change never switches targets halfway through
+		bool m_UseRenderTarget{ false };
+		// The overlay pass blits early, EndFrame must not do it a second time
+		bool m_HasBlittedRenderTarget{ false };
+
 		uint32_t m_CurrentImageIndex{ 0 };
 		int m_CurrentFrameIndex{ 0 };
 		bool m_FrameStarted{ false };
@@ -0,0 +1,170 @@
+﻿#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define ILI_SIMD_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define ILI_SIMD_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+	#include <arm_neon.h>
+	#define ILI_SIMD_NEON
+#endif
+
+/**
+ * The few lane operations the CPU kernels need, so a kernel is written once for every instruction set.
+ * Float4 has four lanes on every target, with scalar code when neither SSE2 nor NEON is available, which then only
+ * offers the arithmetic, Min, Max and LessEqualMask. Float8 is there with AVX2.
+ * Set and Load name the lane type, Set<Float4>(1.f), everything else is overloaded on it
+ */
+namespace ili::simd
+{
+	template <typename Lanes>
+	Lanes Set(float value);
+	// Unaligned
+	template <typename Lanes>
+	Lanes Load(const float* pValues);
+
+#if defined(ILI_SIMD_SSE2)
+	using Float4 = __m128;
+	using Int4 = __m128i;
+
+	template <>
+	inline Float4 Set<Float4>(float value) { return _mm_set1_ps(value); }
+	template <>
+	inline Float4 Load<Float4>(const float* pValues) { return _mm_loadu_ps(pValues); }
+	inline void Store(float* pValues, Float4 lanes) { _mm_storeu_ps(pValues, lanes); }
+	inline Float4 Add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+	inline Float4 Sub(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+	inline Float4 Mul(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+	inline Float4 Div(Float4 a, Float4 b) { return _mm_div_ps(a, b); }
+	// Return the second operand when either one is NaN
+	inline Float4 Max(Float4 value, Float4 accumulated) { return _mm_max_ps(value, accumulated); }
+	inline Float4 Min(Float4 value, Float4 accumulated) { return _mm_min_ps(value, accumulated); }
+	// A bit per lane where a <= b
+	inline uint32_t LessEqualMask(Float4 a, Float4 b) { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(a, b))); }
+	inline Float4 And(Float4 a, Float4 b) { return _mm_and_ps(a, b); }
+	// ~a & b
+	inline Float4 AndNot(Float4 a, Float4 b) { return _mm_andnot_ps(a, b); }
+	inline Float4 Xor(Float4 a, Float4 b) { return _mm_xor_ps(a, b); }
+	inline Float4 Equal(Float4 a, Float4 b) { return _mm_cmpeq_ps(a, b); }
+	inline Float4 Select(Float4 mask, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	inline Int4 Truncate(Float4 a) { return _mm_cvttps_epi32(a); }
+	inline Float4 ToFloat(Int4 a) { return _mm_cvtepi32_ps(a); }
+	inline Int4 AddInt(Int4 a, int32_t b) { return _mm_add_epi32(a, _mm_set1_epi32(b)); }
+	inline Int4 SubInt(Int4 a, int32_t b) { return _mm_sub_epi32(a, _mm_set1_epi32(b)); }
+	inline Int4 AndInt(Int4 a, int32_t b) { return _mm_and_si128(a, _mm_set1_epi32(b)); }
+	inline Int4 AndNotInt(Int4 a, int32_t b) { return _mm_andnot_si128(a, _mm_set1_epi32(b)); }
+	inline Float4 IsZero(Int4 a) { return _mm_castsi128_ps(_mm_cmpeq_epi32(a, _mm_setzero_si128())); }
+	// Bit 2 becomes the sign bit
+	inline Float4 ToSign(Int4 a) { return _mm_castsi128_ps(_mm_slli_epi32(a, 29)); }
+#elif defined(ILI_SIMD_NEON)
+	using Float4 = float32x4_t;
+	using Int4 = int32x4_t;
+
+	template <>
+	inline Float4 Set<Float4>(float value) { return vdupq_n_f32(value); }
+	template <>
+	inline Float4 Load<Float4>(const float* pValues) { return vld1q_f32(pValues); }
+	inline void Store(float* pValues, Float4 lanes) { vst1q_f32(pValues, lanes); }
+	inline Float4 Add(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+	inline Float4 Sub(Float4 a, Float4 b) { return vsubq_f32(a, b); }
+	inline Float4 Mul(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+	inline Float4 Div(Float4 a, Float4 b) { return vdivq_f32(a, b); }
+	// The IEEE maxNum and minNum, the number wins against NaN
+	inline Float4 Max(Float4 value, Float4 accumulated) { return vmaxnmq_f32(value, accumulated); }
+	inline Float4 Min(Float4 value, Float4 accumulated) { return vminnmq_f32(value, accumulated); }
+	// A bit per lane where a <= b
+	inline uint32_t LessEqualMask(Float4 a, Float4 b)
+	{
+		static constexpr uint32_t LANE_BITS[4]{ 1u, 2u, 4u, 8u };
+		return vaddvq_u32(vandq_u32(vcleq_f32(a, b), vld1q_u32(LANE_BITS)));
+	}
+	inline Float4 And(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+	// ~a & b
+	inline Float4 AndNot(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(b), vreinterpretq_u32_f32(a))); }
+	inline Float4 Xor(Float4 a, Float4 b) { return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+	inline Float4 Equal(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vceqq_f32(a, b)); }
+	inline Float4 Select(Float4 mask, Float4 a, Float4 b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+	inline Int4 Truncate(Float4 a) { return vcvtq_s32_f32(a); }
+	inline Float4 ToFloat(Int4 a) { return vcvtq_f32_s32(a); }
+	inline Int4 AddInt(Int4 a, int32_t b) { return vaddq_s32(a, vdupq_n_s32(b)); }
+	inline Int4 SubInt(Int4 a, int32_t b) { return vsubq_s32(a, vdupq_n_s32(b)); }
+	inline Int4 AndInt(Int4 a, int32_t b) { return vandq_s32(a, vdupq_n_s32(b)); }
+	inline Int4 AndNotInt(Int4 a, int32_t b) { return vbicq_s32(vdupq_n_s32(b), a); }
+	inline Float4 IsZero(Int4 a) { return vreinterpretq_f32_u32(vceqq_s32(a, vdupq_n_s32(0))); }
+	// Bit 2 becomes the sign bit
+	inline Float4 ToSign(Int4 a) { return vreinterpretq_f32_s32(vshlq_n_s32(a, 29)); }
+#else
+	struct Float4
+	{
+		std::array<float, 4> values{};
+	};
+
+	template <typename Operation>
+	Float4 Apply(Float4 a, Float4 b, Operation operation)
+	{
+		for (size_t i{}; i < a.values.size(); ++i) a.values[i] = operation(a.values[i], b.values[i]);
+		return a;
+	}
+
+	template <>
+	inline Float4 Set<Float4>(float value) { return Float4{ { value, value, value, value } }; }
+	template <>
+	inline Float4 Load<Float4>(const float* pValues) { return Float4{ { pValues[0], pValues[1], pValues[2], pValues[3] } }; }
+	inline void Store(float* pValues, Float4 lanes) { for (size_t i{}; i < lanes.values.size(); ++i) pValues[i] = lanes.values[i]; }
+	inline Float4 Add(Float4 a, Float4 b) { return Apply(a, b, [](float x, float y) { return x + y; }); }
+	inline Float4 Sub(Float4 a, Float4 b) { return Apply(a, b, [](float x, float y) { return x - y; }); }
+	inline Float4 Mul(Float4 a, Float4 b) { return Apply(a, b, [](float x, float y) { return x * y; }); }
+	inline Float4 Div(Float4 a, Float4 b) { return Apply(a, b, [](float x, float y) { return x / y; }); }
+	// Comparisons with NaN are false, so the accumulated value is kept
+	inline Float4 Max(Float4 value, Float4 accumulated) { return Apply(value, accumulated, [](float x, float y) { return x > y ? x : y; }); }
+	inline Float4 Min(Float4 value, Float4 accumulated) { return Apply(value, accumulated, [](float x, float y) { return x < y ? x : y; }); }
+	// A bit per lane where a <= b
+	inline uint32_t LessEqualMask(Float4 a, Float4 b)
+	{
+		uint32_t mask{};
+		for (size_t i{}; i < a.values.size(); ++i)
+		{
+			if (a.values[i] <= b.values[i]) mask |= 1u << i;
+		}
+		return mask;
+	}
+#endif
+
+#if defined(ILI_SIMD_AVX2)
+	using Float8 = __m256;
+	using Int8 = __m256i;
+
+	template <>
+	inline Float8 Set<Float8>(float value) { return _mm256_set1_ps(value); }
+	template <>
+	inline Float8 Load<Float8>(const float* pValues) { return _mm256_loadu_ps(pValues); }
+	inline void Store(float* pValues, Float8 lanes) { _mm256_storeu_ps(pValues, lanes); }
+	inline Float8 Add(Float8 a, Float8 b) { return _mm256_add_ps(a, b); }
+	inline Float8 Sub(Float8 a, Float8 b) { return _mm256_sub_ps(a, b); }
+	inline Float8 Mul(Float8 a, Float8 b) { return _mm256_mul_ps(a, b); }
+	inline Float8 Div(Float8 a, Float8 b) { return _mm256_div_ps(a, b); }
+	inline Float8 And(Float8 a, Float8 b) { return _mm256_and_ps(a, b); }
+	// ~a & b
+	inline Float8 AndNot(Float8 a, Float8 b) { return _mm256_andnot_ps(a, b); }
+	inline Float8 Xor(Float8 a, Float8 b) { return _mm256_xor_ps(a, b); }
+	inline Float8 Equal(Float8 a, Float8 b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+	inline Float8 Select(Float8 mask, Float8 a, Float8 b) { return _mm256_blendv_ps(b, a, mask); }
+	inline Int8 Truncate(Float8 a) { return _mm256_cvttps_epi32(a); }
+	inline Float8 ToFloat(Int8 a) { return _mm256_cvtepi32_ps(a); }
+	inline Int8 AddInt(Int8 a, int32_t b) { return _mm256_add_epi32(a, _mm256_set1_epi32(b)); }
+	inline Int8 SubInt(Int8 a, int32_t b) { return _mm256_sub_epi32(a, _mm256_set1_epi32(b)); }
+	inline Int8 AndInt(Int8 a, int32_t b) { return _mm256_and_si256(a, _mm256_set1_epi32(b)); }
+	inline Int8 AndNotInt(Int8 a, int32_t b) { return _mm256_andnot_si256(a, _mm256_set1_epi32(b)); }
+	inline Float8 IsZero(Int8 a) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, _mm256_setzero_si256())); }
+	// Bit 2 becomes the sign bit
+	inline Float8 ToSign(Int8 a) { return _mm256_castsi256_ps(_mm256_slli_epi32(a, 29)); }
+#endif
+}
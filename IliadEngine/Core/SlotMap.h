@@ -0,0 +1,109 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ili
+{
+	// Refers to a value of a SlotMap. A handle whose value was removed is stale and is rejected, even after its slot is reused
+	struct SlotHandle final
+	{
+		uint32_t index{ UINT32_MAX };
+		uint32_t generation{};
+
+		bool IsNull() const { return index == UINT32_MAX; }
+		bool operator==(const SlotHandle& other) const = default;
+	};
+
+	/**
+	 * Values packed into one array, addressed through generational handles. Insert, Remove and Get are O(1):
+	 * a removal moves the last value into the gap and bumps the generation of the freed slot, the next insert
+	 * reuses it. Pointers into the value array do not survive an insert or remove, handles do
+	 */
+	template <typename T>
+	class SlotMap final
+	{
+	public:
+		SlotMap() = default;
+		~SlotMap() = default;
+
+		SlotMap(const SlotMap& other) = delete;
+		SlotMap(SlotMap&& other) noexcept = default;
+		SlotMap& operator=(const SlotMap& other) = delete;
+		SlotMap& operator=(SlotMap&& other) noexcept = default;
+
+		// Slot index the next Insert will use
+		uint32_t GetNextIndex() const { return m_FreeHead != NO_SLOT ? m_FreeHead : static_cast<uint32_t>(m_Slots.size()); }
+
+		SlotHandle Insert(T value)
+		{
+			uint32_t index = m_FreeHead;
+			if (index != NO_SLOT)
+			{
+				m_FreeHead = m_Slots[index].denseIndex;
+			}
+			else
+			{
+				index = static_cast<uint32_t>(m_Slots.size());
+				m_Slots.emplace_back();
+			}
+
+			Slot& slot = m_Slots[index];
+			slot.denseIndex = static_cast<uint32_t>(m_Values.size());
+			m_Values.push_back(std::move(value));
+			m_SlotIndices.push_back(index);
+			return { index, slot.generation };
+		}
+
+		// Returns false for a stale handle
+		bool Remove(SlotHandle handle)
+		{
+			if (!Contains(handle)) return false;
+
+			Slot& slot = m_Slots[handle.index];
+			const uint32_t denseIndex = slot.denseIndex;
+			const uint32_t lastIndex = static_cast<uint32_t>(m_Values.size()) - 1;
+			if (denseIndex != lastIndex)
+			{
+				m_Values[denseIndex] = std::move(m_Values[lastIndex]);
+				m_SlotIndices[denseIndex] = m_SlotIndices[lastIndex];
+				m_Slots[m_SlotIndices[denseIndex]].denseIndex = denseIndex;
+			}
+			m_Values.pop_back();
+			m_SlotIndices.pop_back();
+
+			++slot.generation;
+			slot.denseIndex = m_FreeHead;
+			m_FreeHead = handle.index;
+			return true;
+		}
+
+		// A free slot's generation is ahead of every handle that was given out for it
+		bool Contains(SlotHandle handle) const { return handle.index < m_Slots.size() && m_Slots[handle.index].generation == handle.generation; }
+
+		// Null for a stale handle
+		T* Get(SlotHandle handle) { return Contains(handle) ? &m_Values[m_Slots[handle.index].denseIndex] : nullptr; }
+		const T* Get(SlotHandle handle) const { return Contains(handle) ? &m_Values[m_Slots[handle.index].denseIndex] : nullptr; }
+
+		// Packed, in no particular order
+		const std::vector<T>& GetValues() const { return m_Values; }
+		uint32_t GetSize() const { return static_cast<uint32_t>(m_Values.size()); }
+
+	private:
+		static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+		struct Slot
+		{
+			// Index into m_Values, or the next free slot while the slot is free
+			uint32_t denseIndex{ NO_SLOT };
+			uint32_t generation{};
+		};
+
+		std::vector<T> m_Values{};
+		// Slot of every value, parallel to m_Values
+		std::vector<uint32_t> m_SlotIndices{};
+		std::vector<Slot> m_Slots{};
+		uint32_t m_FreeHead{ NO_SLOT };
+	};
+}
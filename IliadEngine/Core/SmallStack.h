@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace ili
+{
+	// Stack for tree traversals that lives on the call stack, only very deep trees spill over to the heap
+	template <typename T, size_t LocalCapacity = 64>
+	class SmallStack final
+	{
+	public:
+		void Push(const T& value)
+		{
+			if (m_Size < m_Local.size()) m_Local[m_Size] = value;
+			else m_Overflow.push_back(value);
+			++m_Size;
+		}
+
+		T Pop()
+		{
+			--m_Size;
+			if (m_Size < m_Local.size()) return m_Local[m_Size];
+
+			const T value = m_Overflow.back();
+			m_Overflow.pop_back();
+			return value;
+		}
+
+		bool IsEmpty() const { return m_Size == 0; }
+
+	private:
+		std::array<T, LocalCapacity> m_Local{};
+		std::vector<T> m_Overflow{};
+		size_t m_Size{};
+	};
+}
@@ -0,0 +1,397 @@
+﻿#include "SoftwareOcclusionCuller.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define ILI_SOFTWARE_OCCLUSION_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define ILI_SOFTWARE_OCCLUSION_SSE2
+#endif
+
+namespace ili
+{
+	namespace
+	{
+#if defined(ILI_SOFTWARE_OCCLUSION_AVX2)
+		constexpr uint32_t LANE_COUNT = 8;
+#elif defined(ILI_SOFTWARE_OCCLUSION_SSE2)
+		constexpr uint32_t LANE_COUNT = 4;
+#else
+		constexpr uint32_t LANE_COUNT = 1;
+#endif
+
+		// Screen space plane equations of a triangle, value = a * x + b * y + c
+		struct TriangleSetup
+		{
+			// Positive inside for all three edges
+			std::array<float, 3> edgeA{};
+			std::array<float, 3> edgeB{};
+			std::array<float, 3> edgeC{};
+			float depthA{};
+			float depthB{};
+			float depthC{};
+		};
+
+#if defined(ILI_SOFTWARE_OCCLUSION_AVX2)
+		// Pixels [beginX, endX) of one row, beginX is a multiple of LANE_COUNT
+		void RasterizeRow(float* pRow, uint32_t beginX, uint32_t endX, float pixelY, const TriangleSetup& setup)
+		{
+			const __m256 laneOffsets = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+			const __m256 half = _mm256_set1_ps(.5f);
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256 end = _mm256_set1_ps(static_cast<float>(endX));
+
+			__m256 edgeA[3]{};
+			__m256 edgeRow[3]{};
+			for (size_t i{}; i < 3; ++i)
+			{
+				edgeA[i] = _mm256_set1_ps(setup.edgeA[i]);
+				edgeRow[i] = _mm256_set1_ps(setup.edgeB[i] * pixelY + setup.edgeC[i]);
+			}
+			const __m256 depthA = _mm256_set1_ps(setup.depthA);
+			const __m256 depthRow = _mm256_set1_ps(setup.depthB * pixelY + setup.depthC);
+
+			for (uint32_t x = beginX; x < endX; x += LANE_COUNT)
+			{
+				const __m256 laneX = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), laneOffsets);
+				const __m256 centerX = _mm256_add_ps(laneX, half);
+
+				__m256 mask = _mm256_cmp_ps(laneX, end, _CMP_LT_OQ);
+				for (size_t i{}; i < 3; ++i)
+				{
+					const __m256 edge = _mm256_add_ps(_mm256_mul_ps(edgeA[i], centerX), edgeRow[i]);
+					mask = _mm256_and_ps(mask, _mm256_cmp_ps(edge, zero, _CMP_GE_OQ));
+				}
+				if (_mm256_movemask_ps(mask) == 0) continue;
+
+				const __m256 depth = _mm256_add_ps(_mm256_mul_ps(depthA, centerX), depthRow);
+				const __m256 stored = _mm256_loadu_ps(pRow + x);
+				_mm256_storeu_ps(pRow + x, _mm256_blendv_ps(stored, _mm256_min_ps(stored, depth), mask));
+			}
+		}
+
+		bool IsRowVisible(const float* pRow, uint32_t beginX, uint32_t endX, float nearestDepth)
+		{
+			const __m256 laneOffsets = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+			const __m256 end = _mm256_set1_ps(static_cast<float>(endX));
+			const __m256 nearest = _mm256_set1_ps(nearestDepth);
+
+			for (uint32_t x = beginX; x < endX; x += LANE_COUNT)
+			{
+				const __m256 laneX = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), laneOffsets);
+				const __m256 inRange = _mm256_cmp_ps(laneX, end, _CMP_LT_OQ);
+				const __m256 notHidden = _mm256_cmp_ps(_mm256_loadu_ps(pRow + x), nearest, _CMP_GE_OQ);
+				if (_mm256_movemask_ps(_mm256_and_ps(inRange, notHidden)) != 0) return true;
+			}
+
+			return false;
+		}
+#elif defined(ILI_SOFTWARE_OCCLUSION_SSE2)
+		// Pixels [beginX, endX) of one row, beginX is a multiple of LANE_COUNT
+		void RasterizeRow(float* pRow, uint32_t beginX, uint32_t endX, float pixelY, const TriangleSetup& setup)
+		{
+			const __m128 laneOffsets = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+			const __m128 half = _mm_set1_ps(.5f);
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 end = _mm_set1_ps(static_cast<float>(endX));
+
+			__m128 edgeA[3]{};
+			__m128 edgeRow[3]{};
+			for (size_t i{}; i < 3; ++i)
+			{
+				edgeA[i] = _mm_set1_ps(setup.edgeA[i]);
+				edgeRow[i] = _mm_set1_ps(setup.edgeB[i] * pixelY + setup.edgeC[i]);
+			}
+			const __m128 depthA = _mm_set1_ps(setup.depthA);
+			const __m128 depthRow = _mm_set1_ps(setup.depthB * pixelY + setup.depthC);
+
+			for (uint32_t x = beginX; x < endX; x += LANE_COUNT)
+			{
+				const __m128 laneX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+				const __m128 centerX = _mm_add_ps(laneX, half);
+
+				__m128 mask = _mm_cmplt_ps(laneX, end);
+				for (size_t i{}; i < 3; ++i)
+				{
+					const __m128 edge = _mm_add_ps(_mm_mul_ps(edgeA[i], centerX), edgeRow[i]);
+					mask = _mm_and_ps(mask, _mm_cmpge_ps(edge, zero));
+				}
+				if (_mm_movemask_ps(mask) == 0) continue;
+
+				// SSE2 has no blend instruction, select with and/andnot
+				const __m128 depth = _mm_add_ps(_mm_mul_ps(depthA, centerX), depthRow);
+				const __m128 stored = _mm_loadu_ps(pRow + x);
+				const __m128 nearest = _mm_min_ps(stored, depth);
+				_mm_storeu_ps(pRow + x, _mm_or_ps(_mm_and_ps(mask, nearest), _mm_andnot_ps(mask, stored)));
+			}
+		}
+
+		bool IsRowVisible(const float* pRow, uint32_t beginX, uint32_t endX, float nearestDepth)
+		{
+			const __m128 laneOffsets = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+			const __m128 end = _mm_set1_ps(static_cast<float>(endX));
+			const __m128 nearest = _mm_set1_ps(nearestDepth);
+
+			for (uint32_t x = beginX; x < endX; x += LANE_COUNT)
+			{
+				const __m128 laneX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+				const __m128 inRange = _mm_cmplt_ps(laneX, end);
+				const __m128 notHidden = _mm_cmpge_ps(_mm_loadu_ps(pRow + x), nearest);
+				if (_mm_movemask_ps(_mm_and_ps(inRange, notHidden)) != 0) return true;
+			}
+
+			return false;
+		}
+#else
+		void RasterizeRow(float* pRow, uint32_t beginX, uint32_t endX, float pixelY, const TriangleSetup& setup)
+		{
+			for (uint32_t x = beginX; x < endX; ++x)
+			{
+				const float centerX = static_cast<float>(x) + .5f;
+
+				bool isInside = true;
+				for (size_t i{}; i < 3; ++i)
+				{
+					isInside &= setup.edgeA[i] * centerX + setup.edgeB[i] * pixelY + setup.edgeC[i] >= 0.f;
+				}
+				if (!isInside) continue;
+
+				const float depth = setup.depthA * centerX + setup.depthB * pixelY + setup.depthC;
+				pRow[x] = std::min(pRow[x], depth);
+			}
+		}
+
+		bool IsRowVisible(const float* pRow, uint32_t beginX, uint32_t endX, float nearestDepth)
+		{
+			for (uint32_t x = beginX; x < endX; ++x)
+			{
+				if (pRow[x] >= nearestDepth) return true;
+			}
+
+			return false;
+		}
+#endif
+
+		glm::vec3 ToScreen(const glm::vec4& clipPosition, float width, float height)
+		{
+			const glm::vec3 ndc = glm::vec3(clipPosition) / clipPosition.w;
+			return { (ndc.x * .5f + .5f) * width, (ndc.y * .5f + .5f) * height, ndc.z };
+		}
+	}
+
+	OccluderMesh OccluderMesh::CreateBox(const glm::vec3& halfExtents)
+	{
+		OccluderMesh box{};
+		for (int corner{}; corner < 8; ++corner)
+		{
+			box.positions.emplace_back(
+				(corner & 1) ? halfExtents.x : -halfExtents.x,
+				(corner & 2) ? halfExtents.y : -halfExtents.y,
+				(corner & 4) ? halfExtents.z : -halfExtents.z);
+		}
+
+		// Both windings are rasterized, so the orientation of the faces does not matter
+		box.indices = {
+			0, 1, 3, 0, 3, 2, // -z
+			4, 6, 7, 4, 7, 5, // +z
+			0, 4, 5, 0, 5, 1, // -y
+			2, 3, 7, 2, 7, 6, // +y
+			0, 2, 6, 0, 6, 4, // -x
+			1, 5, 7, 1, 7, 3, // +x
+		};
+
+		return box;
+	}
+
+	SoftwareOcclusionCuller::SoftwareOcclusionCuller(uint32_t width, uint32_t height) :
+		m_Width(width),
+		m_Height(height),
+		m_Stride((width + LANE_COUNT - 1) / LANE_COUNT * LANE_COUNT)
+	{
+		assert(width > 0 && height > 0 && "The occlusion buffer needs at least one pixel");
+
+		m_Depth.resize(static_cast<size_t>(m_Stride) * m_Height, 1.f);
+	}
+
+	const char* SoftwareOcclusionCuller::GetInstructionSet()
+	{
+#if defined(ILI_SOFTWARE_OCCLUSION_AVX2)
+		return "AVX2";
+#elif defined(ILI_SOFTWARE_OCCLUSION_SSE2)
+		return "SSE2";
+#else
+		return "Scalar";
+#endif
+	}
+
+	void SoftwareOcclusionCuller::BeginFrame(const glm::mat4& viewProjection)
+	{
+		m_ViewProjection = viewProjection;
+		m_Stats = {};
+		m_TestedCount.store(0, std::memory_order_relaxed);
+		m_CulledCount.store(0, std::memory_order_relaxed);
+		std::fill(m_Depth.begin(), m_Depth.end(), 1.f);
+	}
+
+	void SoftwareOcclusionCuller::RasterizeOccluder(const OccluderMesh& occluder, const glm::mat4& modelMatrix)
+	{
+		assert(occluder.indices.size() % 3 == 0 && "Occluders are triangle lists");
+
+		const glm::mat4 modelViewProjection = m_ViewProjection * modelMatrix;
+
+		m_ClipPositions.clear();
+		for (const glm::vec3& position : occluder.positions)
+		{
+			m_ClipPositions.push_back(modelViewProjection * glm::vec4(position, 1.f));
+		}
+
+		for (size_t i{}; i + 2 < occluder.indices.size(); i += 3)
+		{
+			RasterizeTriangle(m_ClipPositions[occluder.indices[i]], m_ClipPositions[occluder.indices[i + 1]], m_ClipPositions[occluder.indices[i + 2]]);
+		}
+
+		m_Stats.occluderTriangleCount += static_cast<uint32_t>(occluder.indices.size() / 3);
+	}
+
+	void SoftwareOcclusionCuller::RasterizeTriangle(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2)
+	{
+		// Behind or crossing the near plane, 0 <= z also guarantees a positive w
+		if (clip0.z < 0.f || clip1.z < 0.f || clip2.z < 0.f) return;
+
+		// Completely outside one of the side planes
+		if (clip0.x > clip0.w && clip1.x > clip1.w && clip2.x > clip2.w) return;
+		if (clip0.x < -clip0.w && clip1.x < -clip1.w && clip2.x < -clip2.w) return;
+		if (clip0.y > clip0.w && clip1.y > clip1.w && clip2.y > clip2.w) return;
+		if (clip0.y < -clip0.w && clip1.y < -clip1.w && clip2.y < -clip2.w) return;
+
+		const float width = static_cast<float>(m_Width);
+		const float height = static_cast<float>(m_Height);
+		glm::vec3 v0 = ToScreen(clip0, width, height);
+		glm::vec3 v1 = ToScreen(clip1, width, height);
+		glm::vec3 v2 = ToScreen(clip2, width, height);
+
+		float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+		if (std::abs(area) < 1e-6f) return;
+
+		// Rasterize both windings, flipping the triangle keeps all edge functions positive inside
+		if (area < 0.f)
+		{
+			std::swap(v1, v2);
+			area = -area;
+		}
+
+		// Clamped before converting, vertices close to the near plane can land far outside of the buffer
+		const float boundsMaxX = std::max({ v0.x, v1.x, v2.x });
+		const float boundsMaxY = std::max({ v0.y, v1.y, v2.y });
+		if (boundsMaxX < 0.f || boundsMaxY < 0.f) return;
+
+		const int minX = static_cast<int>(std::clamp(std::min({ v0.x, v1.x, v2.x }), 0.f, width - 1.f));
+		const int maxX = static_cast<int>(std::min(boundsMaxX, width - 1.f));
+		const int minY = static_cast<int>(std::clamp(std::min({ v0.y, v1.y, v2.y }), 0.f, height - 1.f));
+		const int maxY = static_cast<int>(std::min(boundsMaxY, height - 1.f));
+		if (minX > maxX || minY > maxY) return;
+
+		TriangleSetup setup{};
+		const std::array<const glm::vec3*, 3> vertices{ &v0, &v1, &v2 };
+		for (size_t i{}; i < 3; ++i)
+		{
+			const glm::vec3& a = *vertices[i];
+			const glm::vec3& b = *vertices[(i + 1) % 3];
+			setup.edgeA[i] = a.y - b.y;
+			setup.edgeB[i] = b.x - a.x;
+			setup.edgeC[i] = a.x * b.y - a.y * b.x;
+		}
+
+		// Depth is linear in screen space after the perspective divide
+		setup.depthA = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+		setup.depthB = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+		setup.depthC = v0.z - setup.depthA * v0.x - setup.depthB * v0.y;
+
+		const uint32_t beginX = static_cast<uint32_t>(minX) / LANE_COUNT * LANE_COUNT;
+		const uint32_t endX = static_cast<uint32_t>(maxX) + 1;
+		for (int y = minY; y <= maxY; ++y)
+		{
+			RasterizeRow(&m_Depth[static_cast<size_t>(y) * m_Stride], beginX, endX, static_cast<float>(y) + .5f, setup);
+		}
+
+		++m_Stats.rasterizedTriangleCount;
+	}
+
+	bool SoftwareOcclusionCuller::IsVisible(const Sphere& worldSphere, RenderStats& stats) const
+	{
+		++stats.occlusionTestCount;
+		if (IsVisible(worldSphere)) return true;
+
+		++stats.occlusionCullCount;
+		return false;
+	}
+
+	bool SoftwareOcclusionCuller::IsVisible(const Sphere& worldSphere) const
+	{
+		m_TestedCount.fetch_add(1, std::memory_order_relaxed);
+		if (IsSphereVisible(worldSphere)) return true;
+
+		m_CulledCount.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	SoftwareOcclusionStats SoftwareOcclusionCuller::GetStats() const
+	{
+		SoftwareOcclusionStats stats = m_Stats;
+		stats.testedCount = m_TestedCount.load(std::memory_order_relaxed);
+		stats.culledCount = m_CulledCount.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	bool SoftwareOcclusionCuller::IsSphereVisible(const Sphere& worldSphere) const
+	{
+		const float width = static_cast<float>(m_Width);
+		const float height = static_cast<float>(m_Height);
+
+		glm::vec2 screenMin{ std::numeric_limits<float>::max() };
+		glm::vec2 screenMax{ std::numeric_limits<float>::lowest() };
+		float nearestDepth = 1.f;
+
+		// Corners of the box around the sphere
+		for (int corner{}; corner < 8; ++corner)
+		{
+			const glm::vec3 offset{
+				(corner & 1) ? worldSphere.radius : -worldSphere.radius,
+				(corner & 2) ? worldSphere.radius : -worldSphere.radius,
+				(corner & 4) ? worldSphere.radius : -worldSphere.radius };
+			const glm::vec4 clipPosition = m_ViewProjection * glm::vec4(worldSphere.center + offset, 1.f);
+
+			// Reaches in front of the near plane, the projected rectangle would be meaningless
+			if (clipPosition.z < 0.f) return true;
+
+			const glm::vec3 screen = ToScreen(clipPosition, width, height);
+			screenMin = glm::min(screenMin, glm::vec2(screen));
+			screenMax = glm::max(screenMax, glm::vec2(screen));
+			nearestDepth = std::min(nearestDepth, screen.z);
+		}
+
+		const bool isOffScreen = screenMax.x < 0.f || screenMax.y < 0.f || screenMin.x >= width || screenMin.y >= height;
+		if (!isOffScreen)
+		{
+			const uint32_t minX = static_cast<uint32_t>(std::max(screenMin.x, 0.f));
+			const uint32_t maxX = static_cast<uint32_t>(std::min(screenMax.x, width - 1.f));
+			const uint32_t minY = static_cast<uint32_t>(std::max(screenMin.y, 0.f));
+			const uint32_t maxY = static_cast<uint32_t>(std::min(screenMax.y, height - 1.f));
+
+			const uint32_t beginX = minX / LANE_COUNT * LANE_COUNT;
+			for (uint32_t y = minY; y <= maxY; ++y)
+			{
+				if (IsRowVisible(&m_Depth[static_cast<size_t>(y) * m_Stride], beginX, maxX + 1, nearestDepth)) return true;
+			}
+		}
+
+		return false;
+	}
+}
@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "SceneGraph/Bounds.h"
+#include "Structs/RenderStats.h"
+
+namespace ili
+{
+	// Low polygon stand-in for a mesh, rasterized into the depth buffer of the SoftwareOcclusionCuller.
+	// It must lie inside the visible mesh, an occluder that sticks out hides objects that are actually visible
+	struct OccluderMesh final
+	{
+		std::vector<glm::vec3> positions{};
+		std::vector<uint32_t> indices{};
+
+		// Axis aligned box around the origin, 12 triangles
+		static OccluderMesh CreateBox(const glm::vec3& halfExtents);
+	};
+
+	struct SoftwareOcclusionStats
+	{
+		uint32_t occluderTriangleCount{};
+		// Triangles that survived clipping and touched at least one pixel row
+		uint32_t rasterizedTriangleCount{};
+		// Spheres tested since BeginFrame. Every test counts, an object drawn by both the depth pre-pass and a shading pass is tested twice
+		uint32_t testedCount{};
+		// Occluded or completely off screen
+		uint32_t culledCount{};
+	};
+
+	/**
+	 * CPU occlusion culling for when GPU-driven culling is not available.
+	 * A few designated occluders are rasterized into a small depth buffer, several pixels at a time with
+	 * AVX2 (8 lanes) or SSE2 (4 lanes) when the build targets them, falling back to scalar code otherwise.
+	 * Coverage is computed per lane from the edge functions and turned into a mask, so a whole span of
+	 * pixels is depth tested and written with a single masked blend.
+	 * The screen rectangle and nearest depth of a bounding sphere are then compared against the buffer.
+	 *
+	 * Pure CPU code without any Vulkan dependency, the depth range is 0..1 like the rest of the renderer.
+	 */
+	class SoftwareOcclusionCuller final
+	{
+	public:
+		static constexpr uint32_t DEFAULT_WIDTH = 320;
+		static constexpr uint32_t DEFAULT_HEIGHT = 180;
+
+		SoftwareOcclusionCuller(uint32_t width = DEFAULT_WIDTH, uint32_t height = DEFAULT_HEIGHT);
+		~SoftwareOcclusionCuller() = default;
+
+		SoftwareOcclusionCuller(const SoftwareOcclusionCuller&) = delete;
+		SoftwareOcclusionCuller& operator=(const SoftwareOcclusionCuller&) = delete;
+		SoftwareOcclusionCuller(SoftwareOcclusionCuller&&) = delete;
+		SoftwareOcclusionCuller& operator=(SoftwareOcclusionCuller&&) = delete;
+
+		// Clears the depth buffer and the statistics, every following call uses this (projection * view) matrix
+		void BeginFrame(const glm::mat4& viewProjection);
+
+		// Triangles crossing the near plane are skipped, which only ever makes the occluder smaller
+		void RasterizeOccluder(const OccluderMesh& occluder, const glm::mat4& modelMatrix);
+
+		// False when the world space sphere lies behind the occluders or completely off screen.
+		// Only reads the depth buffer and counts atomically, so any number of threads may test once the occluders are rasterized
+		bool IsVisible(const Sphere& worldSphere) const;
+		// Same test, also counted into the stats of the calling render system
+		bool IsVisible(const Sphere& worldSphere, RenderStats& stats) const;
+
+		uint32_t GetWidth() const { return m_Width; }
+		uint32_t GetHeight() const { return m_Height; }
+		// Nearest occluder depth of a pixel, 1.0 where nothing was rasterized
+		float GetDepth(uint32_t x, uint32_t y) const { return m_Depth[y * m_Stride + x]; }
+
+		// Counts of the current frame
+		SoftwareOcclusionStats GetStats() const;
+
+		// Name of the instruction set the kernels were compiled for
+		static const char* GetInstructionSet();
+
+	private:
+		void RasterizeTriangle(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2);
+		bool IsSphereVisible(const Sphere& worldSphere) const;
+
+		uint32_t m_Width{};
+		uint32_t m_Height{};
+		// Row pitch in pixels, padded so that every row can be processed in whole SIMD spans
+		uint32_t m_Stride{};
+		std::vector<float> m_Depth{};
+
+		glm::mat4 m_ViewProjection{ 1.f };
+		std::vector<glm::vec4> m_ClipPositions{};
+
+		// The tested and culled counts are kept in the atomics below
+		SoftwareOcclusionStats m_Stats{};
+		mutable std::atomic<uint32_t> m_TestedCount{};
+		mutable std::atomic<uint32_t> m_CulledCount{};
+	};
+}
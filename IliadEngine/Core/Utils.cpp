@@ -1 +1,16 @@
 ﻿#include "Utils.h"
+
+namespace ili
+{
+    std::string Utils::EscapeJson(const std::string& text)
+    {
+        std::string escaped{};
+        escaped.reserve(text.size());
+        for (const char character : text)
+        {
+            if (character == '"' || character == '\\') escaped += '\\';
+            escaped += character;
+        }
+        return escaped;
+    }
+}
@@ -1,6 +1,8 @@
 ﻿#pragma once
 
 #include <functional>
+#include <string>
+
 namespace ili
 {
     class Utils
@@ -14,6 +16,9 @@ namespace ili
             (HashCombine(seed, rest), ...);
         }
 
+        // Escapes the quotes and backslashes of a string written into a JSON string literal
+        static std::string EscapeJson(const std::string& text);
+
 
     };
 }
\ No newline at end of file
@@ -38,8 +38,8 @@ namespace ili
 	void Window::FrameBufferResizeCallback(GLFWwindow* window, int width, int height)
 	{
 		const auto appWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
-		appWindow->m_WindowResized = true;
 		appWindow->m_Width = width;
 		appWindow->m_Height = height;
+		appWindow->m_WindowResized = true;
 	}
 }
@@ -1,4 +1,5 @@
 ﻿#pragma once
+#include <atomic>
 #include <memory>
 
 #include <string>
@@ -14,10 +15,10 @@ namespace ili
 		Window(const int width, const int height, const std::string& name);
 		~Window();
 
-		Window(const Window&) = default;
-		Window& operator=(const Window&) = default;
-		Window& operator=(Window&&) = default;
-		Window(Window&&) = default;
+		Window(const Window&) = delete;
+		Window& operator=(const Window&) = delete;
+		Window& operator=(Window&&) = delete;
+		Window(Window&&) = delete;
 
 		GLFWwindow* GetWindow() const { return m_pWindow; }
 
@@ -36,9 +37,10 @@ namespace ili
 		GLFWwindow* m_pWindow{};
 
 		std::string m_Title{};
-		int m_Width{};
-		int m_Height{};
+		// Written by the resize callback on the main thread, read by the renderer while it records on another one
+		std::atomic<int> m_Width{};
+		std::atomic<int> m_Height{};
 
-		bool m_WindowResized{false};
+		std::atomic<bool> m_WindowResized{false};
 	};
 }
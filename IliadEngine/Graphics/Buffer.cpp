@@ -52,7 +52,7 @@ namespace ili
     {
         Unmap();
         vkDestroyBuffer(m_Device.GetDevice(), m_Buffer, nullptr);
-        vkFreeMemory(m_Device.GetDevice(), m_Memory, nullptr);
+        m_Device.FreeMemory(m_Memory);
     }
 
     /**
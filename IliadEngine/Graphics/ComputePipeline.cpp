@@ -0,0 +1,39 @@
+﻿#include "ComputePipeline.h"
+
+#include <stdexcept>
+
+namespace ili
+{
+	ComputePipeline::ComputePipeline(Device& device, VkShaderModule computeShaderModule, VkPipelineLayout pipelineLayout) :
+		m_Device(device),
+		m_PipelineLayout(pipelineLayout)
+	{
+		VkPipelineShaderStageCreateInfo shaderStage{};
+		shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		shaderStage.module = computeShaderModule;
+		shaderStage.pName = "main"; //The name of the entry point function in the COMPUTE shader
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage = shaderStage;
+		pipelineInfo.layout = pipelineLayout;
+		pipelineInfo.basePipelineIndex = -1;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+		if (vkCreateComputePipelines(m_Device.GetDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_ComputePipeline) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create compute pipeline!");
+		}
+	}
+
+	ComputePipeline::~ComputePipeline()
+	{
+		vkDestroyPipeline(m_Device.GetDevice(), m_ComputePipeline, nullptr);
+	}
+
+	void ComputePipeline::Bind(VkCommandBuffer commandBuffer)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputePipeline);
+	}
+}
@@ -0,0 +1,27 @@
+﻿#pragma once
+
+#include "Device.h"
+
+namespace ili
+{
+	class ComputePipeline
+	{
+	public:
+		// The shader module and layout are owned by the caller (usually the PipelineRegistry)
+		ComputePipeline(Device& device, VkShaderModule computeShaderModule, VkPipelineLayout pipelineLayout);
+		~ComputePipeline();
+
+		ComputePipeline(const ComputePipeline& other) = delete;
+		ComputePipeline(ComputePipeline&& other) noexcept = delete;
+		ComputePipeline& operator=(const ComputePipeline& other) = delete;
+		ComputePipeline& operator=(ComputePipeline&& other) noexcept = delete;
+
+		void Bind(VkCommandBuffer commandBuffer);
+
+		VkPipelineLayout GetPipelineLayout() const { return m_PipelineLayout; }
+	private:
+		Device& m_Device;
+		VkPipeline m_ComputePipeline{};
+		VkPipelineLayout m_PipelineLayout{};
+	};
+}
@@ -121,6 +121,7 @@ namespace ili
         {
             return false;
         }
+        ++m_AllocatedSetCount;
         return true;
     }
 
@@ -136,6 +137,7 @@ namespace ili
     void DescriptorPool::ResetPool() 
     {
         vkResetDescriptorPool(m_Device.GetDevice(), m_DescriptorPool, 0);
+        m_AllocatedSetCount = 0;
     }
 
     // *************** Descriptor Writer *********************
@@ -25,6 +25,8 @@ namespace ili
                 uint32_t count = 1);
             std::unique_ptr<DescriptorSetLayout> Build() const;
 
+            const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& GetBindings() const { return m_Bindings; }
+
         private:
             Device& m_Device;
             std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> m_Bindings{};
@@ -82,9 +84,15 @@ namespace ili
 
         void ResetPool();
 
+        VkDescriptorPool GetDescriptorPool() const { return m_DescriptorPool; }
+
+        // Sets allocated since the pool was created or last reset
+        uint32_t GetAllocatedSetCount() const { return m_AllocatedSetCount; }
+
     private:
         Device& m_Device;
         VkDescriptorPool m_DescriptorPool;
+        mutable uint32_t m_AllocatedSetCount{};
 
         friend class DescriptorWriter;
     };
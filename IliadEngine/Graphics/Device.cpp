@@ -60,13 +60,14 @@ namespace ili
     Device::~Device()
     {
         vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
+        vkDestroyCommandPool(m_Device, m_SingleTimeCommandPool, nullptr);
         vkDestroyDevice(m_Device, nullptr);
 
         if (m_EnableValidationLayers) {
             DestroyDebugUtilsMessengerEXT(m_Instance, m_DebugMessenger, nullptr);
         }
 
-        vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
+        if (m_Surface != VK_NULL_HANDLE) vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
         vkDestroyInstance(m_Instance, nullptr);
     }
 
@@ -137,6 +138,14 @@ namespace ili
 
         vkGetPhysicalDeviceProperties(m_PhysicalDevice, &Properties);
         std::cout << "Physical device: " << Properties.deviceName << std::endl;
+
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &memoryProperties);
+        m_HeapUsage.resize(memoryProperties.memoryHeapCount);
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+            m_HeapUsage[i].heapSize = memoryProperties.memoryHeaps[i].size;
+            m_HeapUsage[i].isDeviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        }
     }
 
     void Device::CreateLogicalDevice()
@@ -156,8 +165,14 @@ namespace ili
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        VkPhysicalDeviceFeatures supportedFeatures = {};
+        vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &supportedFeatures);
+
         VkPhysicalDeviceFeatures deviceFeatures = {};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
+        // Optional, only used to measure overdraw. Enabled when the GPU offers it
+        deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+        EnabledFeatures = deviceFeatures;
 
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -166,8 +181,9 @@ namespace ili
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(m_DeviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = m_DeviceExtensions.data();
+        // Nothing is presented without a window, so the swap chain extension is not needed
+        createInfo.enabledExtensionCount = IsHeadless() ? 0 : static_cast<uint32_t>(m_DeviceExtensions.size());
+        createInfo.ppEnabledExtensionNames = IsHeadless() ? nullptr : m_DeviceExtensions.data();
 
         // Device-specific validation layers have been deprecated
         if (m_EnableValidationLayers) {
@@ -198,10 +214,16 @@ namespace ili
         if (vkCreateCommandPool(m_Device, &poolInfo, nullptr, &m_CommandPool) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create command pool!");
         }
+
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        if (vkCreateCommandPool(m_Device, &poolInfo, nullptr, &m_SingleTimeCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create single time command pool!");
+        }
     }
 
     void Device::CreateSurface()
     {
+        if (IsHeadless()) return;
         m_pWindow->CreateWindowSurface(m_Instance, &m_Surface);
     }
 
@@ -211,8 +233,8 @@ namespace ili
 
         bool extensionsSupported = CheckDeviceExtensionSupport(device);
 
-        bool swapChainAdequate = false;
-        if (extensionsSupported) {
+        bool swapChainAdequate = IsHeadless();
+        if (extensionsSupported && !IsHeadless()) {
             SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device);
             swapChainAdequate = !swapChainSupport.Formats.empty() && !swapChainSupport.PresentModes.empty();
         }
@@ -280,11 +302,15 @@ namespace ili
 
     std::vector<const char*> Device::GetRequiredExtensions()
     {
-        uint32_t glfwExtensionCount = 0;
-        const char** glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        std::vector<const char*> extensions{};
 
-        std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        // GLFW is never initialized in headless mode, and the surface extensions it asks for are not needed
+        if (!IsHeadless()) {
+            uint32_t glfwExtensionCount = 0;
+            const char** glfwExtensions;
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+            extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        }
 
         if (m_EnableValidationLayers) {
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -325,6 +351,8 @@ namespace ili
         std::vector<VkExtensionProperties> availableExtensions(extensionCount);
         vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
+        if (IsHeadless()) return true;
+
         std::set<std::string> requiredExtensions(m_DeviceExtensions.begin(), m_DeviceExtensions.end());
 
         for (const auto& extension : availableExtensions) {
@@ -346,12 +374,15 @@ namespace ili
 
         int i = 0;
         for (const auto& queueFamily : queueFamilies) {
-            if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            // The graphics queue also records the compute passes (light clustering)
+            if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
                 indices.GraphicsFamily = i;
                 indices.GraphicsFamilyHasValue = true;
             }
+            // Headless frames are never presented, the graphics queue stands in for the present queue
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_Surface, &presentSupport);
+            if (IsHeadless()) presentSupport = indices.GraphicsFamilyHasValue && indices.GraphicsFamily == static_cast<uint32_t>(i);
+            else vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_Surface, &presentSupport);
             if (queueFamily.queueCount > 0 && presentSupport) {
                 indices.PresentFamily = i;
                 indices.PresentFamilyHasValue = true;
@@ -425,6 +456,62 @@ namespace ili
         throw std::runtime_error("Failed to find suitable memory type!");
     }
 
+    bool Device::HasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+    {
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &memProperties);
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+            if ((typeFilter & (1 << i)) &&
+                (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    VkFormatProperties Device::GetFormatProperties(VkFormat format) const
+    {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(m_PhysicalDevice, format, &properties);
+        return properties;
+    }
+
+    void Device::FreeMemory(VkDeviceMemory memory)
+    {
+        if (memory == VK_NULL_HANDLE) return;
+
+        {
+            const std::lock_guard lock{ m_AllocationMutex };
+            if (const auto it = m_Allocations.find(memory); it != m_Allocations.end()) {
+                MemoryHeapUsage& heap = m_HeapUsage[it->second.heapIndex];
+                heap.allocatedBytes -= it->second.size;
+                --heap.allocationCount;
+                m_Allocations.erase(it);
+            }
+        }
+
+        vkFreeMemory(m_Device, memory, nullptr);
+    }
+
+    std::vector<MemoryHeapUsage> Device::GetMemoryHeapUsage() const
+    {
+        const std::lock_guard lock{ m_AllocationMutex };
+        return m_HeapUsage;
+    }
+
+    void Device::TrackAllocation(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size)
+    {
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &memoryProperties);
+        const uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+
+        const std::lock_guard lock{ m_AllocationMutex };
+        m_Allocations[memory] = { heapIndex, size };
+        m_HeapUsage[heapIndex].allocatedBytes += size;
+        ++m_HeapUsage[heapIndex].allocationCount;
+    }
+
     void Device::CreateBuffer(
         VkDeviceSize size,
         VkBufferUsageFlags usage,
@@ -453,6 +540,7 @@ namespace ili
         if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
             throw std::runtime_error("Failed to allocate buffer memory!");
         }
+        TrackAllocation(bufferMemory, allocInfo.memoryTypeIndex, allocInfo.allocationSize);
 
         vkBindBufferMemory(m_Device, buffer, bufferMemory, 0);
     }
@@ -462,7 +550,7 @@ namespace ili
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool = m_CommandPool;
+        allocInfo.commandPool = m_SingleTimeCommandPool;
         allocInfo.commandBufferCount = 1;
 
         VkCommandBuffer commandBuffer;
@@ -485,10 +573,19 @@ namespace ili
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &commandBuffer;
 
-        vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(m_GraphicsQueue);
+        {
+            const std::lock_guard lock{ m_QueueMutex };
+            vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+            vkQueueWaitIdle(m_GraphicsQueue);
+        }
+
+        vkFreeCommandBuffers(m_Device, m_SingleTimeCommandPool, 1, &commandBuffer);
+    }
 
-        vkFreeCommandBuffers(m_Device, m_CommandPool, 1, &commandBuffer);
+    void Device::WaitIdle() const
+    {
+        const std::lock_guard lock{ m_QueueMutex };
+        vkDeviceWaitIdle(m_Device);
     }
 
     void Device::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
@@ -536,7 +633,8 @@ namespace ili
         const VkImageCreateInfo& imageInfo,
         VkMemoryPropertyFlags properties,
         VkImage& image,
-        VkDeviceMemory& imageMemory)
+        VkDeviceMemory& imageMemory,
+        VkMemoryPropertyFlags preferredProperties)
     {
         if (vkCreateImage(m_Device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create image!");
@@ -545,6 +643,10 @@ namespace ili
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(m_Device, image, &memRequirements);
 
+        if (preferredProperties != 0 && HasMemoryType(memRequirements.memoryTypeBits, properties | preferredProperties)) {
+            properties |= preferredProperties;
+        }
+
         VkMemoryAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
         allocInfo.allocationSize = memRequirements.size;
@@ -553,6 +655,7 @@ namespace ili
         if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
             throw std::runtime_error("Failed to allocate image memory!");
         }
+        TrackAllocation(imageMemory, allocInfo.memoryTypeIndex, allocInfo.allocationSize);
 
         if (vkBindImageMemory(m_Device, image, imageMemory, 0) != VK_SUCCESS) {
             throw std::runtime_error("Failed to bind image memory!");
@@ -3,7 +3,9 @@
 #include "../Core/Window.h"
 
 // Standard Library Headers
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace ili
@@ -26,6 +28,15 @@ namespace ili
         bool IsComplete() const { return GraphicsFamilyHasValue && PresentFamilyHasValue; }
     };
 
+    // Memory the engine allocated through the device from one heap
+    struct MemoryHeapUsage
+    {
+        VkDeviceSize heapSize{};
+        VkDeviceSize allocatedBytes{};
+        uint32_t allocationCount{};
+        bool isDeviceLocal{};
+    };
+
     class Device
     {
     public:
@@ -35,6 +46,7 @@ namespace ili
         const bool m_EnableValidationLayers = true;
 #endif
 
+        // Without a window the device is headless: no surface, no swap chain extension and any graphics queue will do
         Device(Window* window);
         ~Device();
 
@@ -44,14 +56,28 @@ namespace ili
         Device(Device&&) = delete;
         Device& operator=(Device&&) = delete;
 
+        VkInstance GetInstance() const { return m_Instance; }
+        VkPhysicalDevice GetPhysicalDevice() const { return m_PhysicalDevice; }
         VkCommandPool GetCommandPool() const { return m_CommandPool; }
         VkDevice GetDevice() const { return m_Device; }
         VkSurfaceKHR GetSurface() const { return m_Surface; }
         VkQueue GetGraphicsQueue() const { return m_GraphicsQueue; }
         VkQueue GetPresentQueue() const { return m_PresentQueue; }
+        // Held around every submission, frames may be submitted from another thread than the one loading content
+        std::mutex& GetQueueMutex() const { return m_QueueMutex; }
+        // vkDeviceWaitIdle under the queue mutex
+        void WaitIdle() const;
+        bool IsHeadless() const { return m_pWindow == nullptr; }
 
         SwapChainSupportDetails GetSwapChainSupport() { return QuerySwapChainSupport(m_PhysicalDevice); }
         uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+        bool HasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+        VkFormatProperties GetFormatProperties(VkFormat format) const;
+
+        // Frees memory from CreateBuffer or CreateImageWithInfo and removes it from the heap usage
+        void FreeMemory(VkDeviceMemory memory);
+        // One entry per memory heap, only counts the allocations made through this class
+        std::vector<MemoryHeapUsage> GetMemoryHeapUsage() const;
         QueueFamilyIndices FindPhysicalQueueFamilies() { return FindQueueFamilies(m_PhysicalDevice); }
         VkFormat FindSupportedFormat(
             const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
@@ -68,11 +94,13 @@ namespace ili
         void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
         void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
+        // preferredProperties are added to properties when one of the memory types the image supports has both
         void CreateImageWithInfo(
             const VkImageCreateInfo& imageInfo,
             VkMemoryPropertyFlags properties,
             VkImage& image,
-            VkDeviceMemory& imageMemory);
+            VkDeviceMemory& imageMemory,
+            VkMemoryPropertyFlags preferredProperties = 0);
 
         void TransitionImageLayout(
             VkImage image,
@@ -83,6 +111,7 @@ namespace ili
             uint32_t layerCount = 1);
 
         VkPhysicalDeviceProperties Properties;
+        VkPhysicalDeviceFeatures EnabledFeatures{};
 
     private:
         void CreateInstance();
@@ -101,6 +130,7 @@ namespace ili
         void HasGlfwRequiredInstanceExtensions();
         bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
         SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device);
+        void TrackAllocation(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size);
 
         // Member Variables
         VkInstance m_Instance;
@@ -108,12 +138,26 @@ namespace ili
         VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
         Window* m_pWindow;
         VkCommandPool m_CommandPool;
+        // Apart from the pool the frames are recorded from, so content can be uploaded while a frame is recorded
+        VkCommandPool m_SingleTimeCommandPool;
 
         VkDevice m_Device;
-        VkSurfaceKHR m_Surface;
+        VkSurfaceKHR m_Surface = VK_NULL_HANDLE;
         VkQueue m_GraphicsQueue;
         VkQueue m_PresentQueue;
 
+        struct TrackedAllocation
+        {
+            uint32_t heapIndex{};
+            VkDeviceSize size{};
+        };
+
+        // Resources may be created from other threads than the render thread
+        mutable std::mutex m_AllocationMutex{};
+        mutable std::mutex m_QueueMutex{};
+        std::unordered_map<VkDeviceMemory, TrackedAllocation> m_Allocations{};
+        std::vector<MemoryHeapUsage> m_HeapUsage{};
+
         const std::vector<const char*> m_ValidationLayers = { "VK_LAYER_KHRONOS_validation" };
         const std::vector<const char*> m_DeviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
     };
@@ -0,0 +1,273 @@
+﻿#include "GBuffer.h"
+
+#include <stdexcept>
+
+namespace ili
+{
+    namespace
+    {
+        constexpr std::array<VkFormat, GBuffer::GEOMETRY_COLOR_ATTACHMENT_COUNT> GEOMETRY_FORMATS
+        {
+            VK_FORMAT_R8G8B8A8_UNORM, // Albedo
+            VK_FORMAT_R16G16B16A16_SFLOAT, // Normal
+            VK_FORMAT_R8G8B8A8_UNORM // Metallic, roughness, ambient occlusion
+        };
+    }
+
+    GBuffer::GBuffer(Device& device, const SwapChain& swapChain) : m_Device{ device }
+    {
+        CreateRenderPass(swapChain);
+        CreateAttachments(swapChain);
+        CreateFramebuffers(swapChain);
+    }
+
+    GBuffer::~GBuffer()
+    {
+        Cleanup();
+        vkDestroyRenderPass(m_Device.GetDevice(), m_RenderPass, nullptr);
+    }
+
+    void GBuffer::Recreate(const SwapChain& swapChain)
+    {
+        Cleanup();
+        CreateAttachments(swapChain);
+        CreateFramebuffers(swapChain);
+    }
+
+    std::array<VkClearValue, GBuffer::AttachmentCount> GBuffer::GetClearValues() const
+    {
+        std::array<VkClearValue, AttachmentCount> clearValues{};
+        clearValues[SwapChainColorAttachment].color = { 0.013f, 0.012f, 0.015f, 1.0f };
+        clearValues[DepthAttachment].depthStencil = { 1.0f, 0 };
+        // A zero albedo keeps the background unlit, so it shows the swap chain clear color
+        clearValues[AlbedoAttachment].color = { 0.0f, 0.0f, 0.0f, 0.0f };
+        clearValues[NormalAttachment].color = { 0.0f, 0.0f, 0.0f, 0.0f };
+        clearValues[MaterialAttachment].color = { 0.0f, 0.0f, 0.0f, 0.0f };
+        return clearValues;
+    }
+
+    std::array<VkDescriptorImageInfo, 4> GBuffer::GetInputAttachmentInfos(uint32_t imageIndex) const
+    {
+        const auto& attachments = m_Attachments[imageIndex];
+        return {
+            VkDescriptorImageInfo{ VK_NULL_HANDLE, attachments[0].view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+            VkDescriptorImageInfo{ VK_NULL_HANDLE, attachments[1].view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+            VkDescriptorImageInfo{ VK_NULL_HANDLE, attachments[2].view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+            VkDescriptorImageInfo{ VK_NULL_HANDLE, m_DepthViews[imageIndex], VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL }
+        };
+    }
+
+    void GBuffer::CreateRenderPass(const SwapChain& swapChain)
+    {
+        std::array<VkAttachmentDescription, AttachmentCount> attachments{};
+
+        VkAttachmentDescription& colorAttachment = attachments[SwapChainColorAttachment];
+        colorAttachment.format = swapChain.GetSwapChainImageFormat();
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout = swapChain.GetFinalLayout();
+
+        VkAttachmentDescription& depthAttachment = attachments[DepthAttachment];
+        depthAttachment.format = swapChain.GetDepthFormat();
+        depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+        // Written and consumed inside the render pass, the contents are never stored
+        for (uint32_t i{}; i < GEOMETRY_COLOR_ATTACHMENT_COUNT; ++i)
+        {
+            VkAttachmentDescription& attachment = attachments[AlbedoAttachment + i];
+            attachment.format = GEOMETRY_FORMATS[i];
+            attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+            attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        }
+
+        // Geometry subpass
+        const std::array<VkAttachmentReference, GEOMETRY_COLOR_ATTACHMENT_COUNT> geometryColorRefs
+        {
+            VkAttachmentReference{ AlbedoAttachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+            VkAttachmentReference{ NormalAttachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+            VkAttachmentReference{ MaterialAttachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL }
+        };
+        const VkAttachmentReference geometryDepthRef{ DepthAttachment, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+        // Lighting subpass, depth stays bound read-only so the light volumes can still be depth tested
+        const VkAttachmentReference lightingColorRef{ SwapChainColorAttachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        const std::array<VkAttachmentReference, 4> lightingInputRefs
+        {
+            VkAttachmentReference{ AlbedoAttachment, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+            VkAttachmentReference{ NormalAttachment, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+            VkAttachmentReference{ MaterialAttachment, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+            VkAttachmentReference{ DepthAttachment, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL }
+        };
+        const VkAttachmentReference lightingDepthRef{ DepthAttachment, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+        std::array<VkSubpassDescription, 2> subpasses{};
+        subpasses[GEOMETRY_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpasses[GEOMETRY_SUBPASS].colorAttachmentCount = static_cast<uint32_t>(geometryColorRefs.size());
+        subpasses[GEOMETRY_SUBPASS].pColorAttachments = geometryColorRefs.data();
+        subpasses[GEOMETRY_SUBPASS].pDepthStencilAttachment = &geometryDepthRef;
+
+        subpasses[LIGHTING_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpasses[LIGHTING_SUBPASS].colorAttachmentCount = 1;
+        subpasses[LIGHTING_SUBPASS].pColorAttachments = &lightingColorRef;
+        subpasses[LIGHTING_SUBPASS].inputAttachmentCount = static_cast<uint32_t>(lightingInputRefs.size());
+        subpasses[LIGHTING_SUBPASS].pInputAttachments = lightingInputRefs.data();
+        subpasses[LIGHTING_SUBPASS].pDepthStencilAttachment = &lightingDepthRef;
+
+        std::array<VkSubpassDependency, 2> dependencies{};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = GEOMETRY_SUBPASS;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[0].srcAccessMask = 0;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        // Each pixel of the lighting subpass only reads its own G-buffer texel, which is what keeps it in tile memory
+        dependencies[1].srcSubpass = GEOMETRY_SUBPASS;
+        dependencies[1].dstSubpass = LIGHTING_SUBPASS;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+        renderPassInfo.pSubpasses = subpasses.data();
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
+
+        if (vkCreateRenderPass(m_Device.GetDevice(), &renderPassInfo, nullptr, &m_RenderPass) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create deferred render pass");
+        }
+    }
+
+    void GBuffer::CreateAttachments(const SwapChain& swapChain)
+    {
+        m_Attachments.resize(swapChain.ImageCount());
+        m_DepthViews.resize(swapChain.ImageCount());
+
+        for (size_t i{}; i < m_Attachments.size(); ++i)
+        {
+            for (uint32_t j{}; j < GEOMETRY_COLOR_ATTACHMENT_COUNT; ++j)
+            {
+                m_Attachments[i][j] = CreateAttachmentImage(GEOMETRY_FORMATS[j], swapChain.GetSwapChainExtent());
+            }
+
+            // Owned by the swap chain
+            m_DepthViews[i] = swapChain.GetDepthImageView(static_cast<int>(i));
+        }
+    }
+
+    void GBuffer::CreateFramebuffers(const SwapChain& swapChain)
+    {
+        m_Framebuffers.resize(swapChain.ImageCount());
+
+        for (size_t i{}; i < m_Framebuffers.size(); ++i)
+        {
+            const std::array<VkImageView, AttachmentCount> attachments
+            {
+                swapChain.GetImageView(static_cast<int>(i)),
+                m_DepthViews[i],
+                m_Attachments[i][0].view,
+                m_Attachments[i][1].view,
+                m_Attachments[i][2].view
+            };
+
+            VkFramebufferCreateInfo framebufferInfo{};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = m_RenderPass;
+            framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+            framebufferInfo.pAttachments = attachments.data();
+            framebufferInfo.width = swapChain.GetSwapChainExtent().width;
+            framebufferInfo.height = swapChain.GetSwapChainExtent().height;
+            framebufferInfo.layers = 1;
+
+            if (vkCreateFramebuffer(m_Device.GetDevice(), &framebufferInfo, nullptr, &m_Framebuffers[i]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create G-buffer framebuffer");
+            }
+        }
+    }
+
+    void GBuffer::Cleanup()
+    {
+        for (const auto framebuffer : m_Framebuffers)
+        {
+            vkDestroyFramebuffer(m_Device.GetDevice(), framebuffer, nullptr);
+        }
+        m_Framebuffers.clear();
+
+        for (const auto& attachments : m_Attachments)
+        {
+            for (const auto& attachment : attachments)
+            {
+                vkDestroyImageView(m_Device.GetDevice(), attachment.view, nullptr);
+                vkDestroyImage(m_Device.GetDevice(), attachment.image, nullptr);
+                m_Device.FreeMemory(attachment.memory);
+            }
+        }
+        m_Attachments.clear();
+        m_DepthViews.clear();
+    }
+
+    GBuffer::AttachmentImage GBuffer::CreateAttachmentImage(VkFormat format, VkExtent2D extent) const
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = extent.width;
+        imageInfo.extent.height = extent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        // Lazily allocated only if a memory type the image accepts has it,
+        // desktop GPUs usually have none and the attachments get regular device memory instead
+        AttachmentImage attachment{};
+        m_Device.CreateImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, attachment.image, attachment.memory,
+            VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = attachment.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(m_Device.GetDevice(), &viewInfo, nullptr, &attachment.view) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create G-buffer image view");
+        }
+
+        return attachment;
+    }
+}
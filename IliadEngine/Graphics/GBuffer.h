@@ -0,0 +1,74 @@
+﻿#pragma once
+#include <array>
+#include <vector>
+
+#include "Device.h"
+#include "SwapChain.h"
+
+namespace ili
+{
+    /**
+     * Render pass and attachments of the deferred path.
+     * Subpass 0 fills the G-buffer, subpass 1 reads it back through input attachments and writes the lit result
+     * into the swap chain image. The G-buffer never leaves the render pass, so its images are transient and
+     * use lazily allocated memory where the device offers it, which lets tile based GPUs keep them on chip.
+     */
+    class GBuffer final
+    {
+    public:
+        enum Attachment : uint32_t
+        {
+            SwapChainColorAttachment = 0,
+            DepthAttachment,
+            AlbedoAttachment, // rgb: albedo
+            NormalAttachment, // xyz: world space normal
+            MaterialAttachment, // r: metallic, g: roughness, b: ambient occlusion
+            AttachmentCount
+        };
+
+        static constexpr uint32_t GEOMETRY_SUBPASS = 0;
+        static constexpr uint32_t LIGHTING_SUBPASS = 1;
+        static constexpr uint32_t GEOMETRY_COLOR_ATTACHMENT_COUNT = 3;
+
+        GBuffer(Device& device, const SwapChain& swapChain);
+        ~GBuffer();
+
+        GBuffer(const GBuffer&) = delete;
+        GBuffer& operator=(const GBuffer&) = delete;
+        GBuffer(GBuffer&&) = delete;
+        GBuffer& operator=(GBuffer&&) = delete;
+
+        // Rebuilds the images and framebuffers for a new swap chain, the render pass stays valid
+        void Recreate(const SwapChain& swapChain);
+
+        VkRenderPass GetRenderPass() const { return m_RenderPass; }
+        VkFramebuffer GetFrameBuffer(uint32_t imageIndex) const { return m_Framebuffers[imageIndex]; }
+        std::array<VkClearValue, AttachmentCount> GetClearValues() const;
+
+        // Albedo, normal, material and depth, in the input attachment order of the lighting subpass
+        std::array<VkDescriptorImageInfo, 4> GetInputAttachmentInfos(uint32_t imageIndex) const;
+
+    private:
+        struct AttachmentImage
+        {
+            VkImage image{};
+            VkDeviceMemory memory{};
+            VkImageView view{};
+        };
+
+        void CreateRenderPass(const SwapChain& swapChain);
+        void CreateAttachments(const SwapChain& swapChain);
+        void CreateFramebuffers(const SwapChain& swapChain);
+        void Cleanup();
+
+        AttachmentImage CreateAttachmentImage(VkFormat format, VkExtent2D extent) const;
+
+        Device& m_Device;
+        VkRenderPass m_RenderPass{};
+
+        // One set of G-buffer images per swap chain image, like the depth buffers
+        std::vector<std::array<AttachmentImage, GEOMETRY_COLOR_ATTACHMENT_COUNT>> m_Attachments{};
+        std::vector<VkImageView> m_DepthViews{};
+        std::vector<VkFramebuffer> m_Framebuffers{};
+    };
+}
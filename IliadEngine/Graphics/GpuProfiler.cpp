@@ -0,0 +1,181 @@
+﻿#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "Core/Utils.h"
+
+namespace ili
+{
+    namespace
+    {
+        std::string EscapeCsv(const std::string& text)
+        {
+            if (text.find_first_of(",\"\n") == std::string::npos) return text;
+
+            std::string escaped{ "\"" };
+            for (const char character : text)
+            {
+                if (character == '"') escaped += '"';
+                escaped += character;
+            }
+            return escaped + '"';
+        }
+    }
+
+    GpuProfiler::GpuProfiler(Device& device, uint32_t maxScopesPerFrame)
+        : m_QueryPool{ device, 2 * maxScopesPerFrame * SwapChain::MAX_FRAMES_IN_FLIGHT },
+        m_MaxScopesPerFrame{ maxScopesPerFrame }
+    {
+    }
+
+    void GpuProfiler::BeginFrame(VkCommandBuffer commandBuffer, int frameIndex)
+    {
+        m_CurrentFrameIndex = frameIndex;
+        auto& frameScopes = m_FrameScopes[frameIndex];
+        const uint32_t firstQuery = static_cast<uint32_t>(frameIndex) * 2 * m_MaxScopesPerFrame;
+
+        std::vector<uint64_t> timestamps{};
+        if (!frameScopes.empty() && m_QueryPool.GetResults(firstQuery, static_cast<uint32_t>(frameScopes.size()) * 2, timestamps))
+        {
+            // Scopes recorded several times in one frame count as a single sample
+            std::vector<float> frameTimes(m_Histories.size(), -1.f);
+            for (size_t scope{}; scope < frameScopes.size(); ++scope)
+            {
+                const uint64_t begin = timestamps[scope * 2];
+                const uint64_t end = timestamps[scope * 2 + 1];
+                if (end < begin) continue;
+
+                float& frameTime = frameTimes[frameScopes[scope]];
+                frameTime = std::max(frameTime, 0.f) + static_cast<float>(static_cast<double>(end - begin) * m_QueryPool.GetPeriod() / 1'000'000.0);
+            }
+
+            for (size_t i{}; i < frameTimes.size(); ++i)
+            {
+                if (frameTimes[i] < 0.f) continue;
+
+                ScopeHistory& history = m_Histories[i];
+                history.samples[history.nextSample] = frameTimes[i];
+                history.nextSample = (history.nextSample + 1) % HISTORY_SIZE;
+                history.sampleCount = std::min(history.sampleCount + 1, HISTORY_SIZE);
+            }
+        }
+
+        frameScopes.clear();
+        m_QueryPool.Reset(commandBuffer, firstQuery, 2 * m_MaxScopesPerFrame);
+    }
+
+    uint32_t GpuProfiler::BeginScope(VkCommandBuffer commandBuffer, const std::string& name)
+    {
+        auto& frameScopes = m_FrameScopes[m_CurrentFrameIndex];
+        if (frameScopes.size() >= m_MaxScopesPerFrame) return INVALID_SCOPE;
+
+        const uint32_t scope = static_cast<uint32_t>(frameScopes.size());
+        frameScopes.push_back(GetHistoryIndex(name));
+
+        const uint32_t firstQuery = static_cast<uint32_t>(m_CurrentFrameIndex) * 2 * m_MaxScopesPerFrame;
+        m_QueryPool.WriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, firstQuery + scope * 2);
+
+        return scope;
+    }
+
+    void GpuProfiler::EndScope(VkCommandBuffer commandBuffer, uint32_t scope)
+    {
+        if (scope == INVALID_SCOPE) return;
+
+        const uint32_t firstQuery = static_cast<uint32_t>(m_CurrentFrameIndex) * 2 * m_MaxScopesPerFrame;
+        m_QueryPool.WriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, firstQuery + scope * 2 + 1);
+    }
+
+    std::vector<GpuScopeStats> GpuProfiler::GetScopeStats() const
+    {
+        std::vector<GpuScopeStats> stats{};
+        stats.reserve(m_Histories.size());
+
+        for (const auto& history : m_Histories)
+        {
+            GpuScopeStats scopeStats{};
+            scopeStats.name = history.name;
+            scopeStats.sampleCount = history.sampleCount;
+
+            if (history.sampleCount > 0)
+            {
+                scopeStats.lastTime = history.samples[(history.nextSample + HISTORY_SIZE - 1) % HISTORY_SIZE];
+                scopeStats.minTime = history.samples[0];
+                scopeStats.maxTime = history.samples[0];
+
+                float total{};
+                for (uint32_t i{}; i < history.sampleCount; ++i)
+                {
+                    total += history.samples[i];
+                    scopeStats.minTime = std::min(scopeStats.minTime, history.samples[i]);
+                    scopeStats.maxTime = std::max(scopeStats.maxTime, history.samples[i]);
+                }
+                scopeStats.averageTime = total / static_cast<float>(history.sampleCount);
+            }
+
+            stats.push_back(scopeStats);
+        }
+
+        return stats;
+    }
+
+    void GpuProfiler::ClearStats()
+    {
+        for (auto& history : m_Histories)
+        {
+            history.sampleCount = 0;
+            history.nextSample = 0;
+        }
+    }
+
+    void GpuProfiler::ExportJson(const std::string& filePath) const
+    {
+        std::ofstream file(filePath);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open file: " + filePath);
+        }
+
+        const auto stats = GetScopeStats();
+
+        file << "{\n  \"unit\": \"ms\",\n  \"scopes\": [\n";
+        for (size_t i{}; i < stats.size(); ++i)
+        {
+            file << "    { \"name\": \"" << Utils::EscapeJson(stats[i].name) << "\""
+                << ", \"last\": " << stats[i].lastTime
+                << ", \"average\": " << stats[i].averageTime
+                << ", \"min\": " << stats[i].minTime
+                << ", \"max\": " << stats[i].maxTime
+                << ", \"samples\": " << stats[i].sampleCount << " }"
+                << (i + 1 < stats.size() ? ",\n" : "\n");
+        }
+        file << "  ]\n}\n";
+    }
+
+    void GpuProfiler::ExportCsv(const std::string& filePath) const
+    {
+        std::ofstream file(filePath);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open file: " + filePath);
+        }
+
+        file << "name,last_ms,average_ms,min_ms,max_ms,samples\n";
+        for (const auto& scopeStats : GetScopeStats())
+        {
+            file << EscapeCsv(scopeStats.name) << ',' << scopeStats.lastTime << ',' << scopeStats.averageTime << ','
+                << scopeStats.minTime << ',' << scopeStats.maxTime << ',' << scopeStats.sampleCount << '\n';
+        }
+    }
+
+    size_t GpuProfiler::GetHistoryIndex(const std::string& name)
+    {
+        if (const auto it = m_HistoryIndices.find(name); it != m_HistoryIndices.end()) return it->second;
+
+        m_Histories.push_back({ name });
+        m_HistoryIndices.emplace(name, m_Histories.size() - 1);
+        return m_Histories.size() - 1;
+    }
+}
@@ -0,0 +1,110 @@
+﻿#pragma once
+
+#include "Device.h"
+#include "SwapChain.h"
+#include "TimestampQueryPool.h"
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ili
+{
+    // Timings of a named scope in milliseconds, over the last GpuProfiler::HISTORY_SIZE frames it was recorded in
+    struct GpuScopeStats
+    {
+        std::string name{};
+        float lastTime{};
+        float averageTime{};
+        float minTime{};
+        float maxTime{};
+        uint32_t sampleCount{};
+    };
+
+    /**
+     * Measures the GPU time of named scopes with a pair of timestamps each.
+     * Every frame in flight owns its own range of queries, which is read back when the frame slot comes around again,
+     * so the results are MAX_FRAMES_IN_FLIGHT frames old but reading them never stalls.
+     * Scopes may nest, and scopes with the same name in one frame are added up, e.g. the two halves of a split pass.
+     */
+    class GpuProfiler final
+    {
+    public:
+        static constexpr uint32_t DEFAULT_MAX_SCOPES = 32;
+        static constexpr uint32_t HISTORY_SIZE = 120;
+        // Returned by BeginScope when the frame ran out of queries, EndScope ignores it
+        static constexpr uint32_t INVALID_SCOPE = ~0u;
+
+        explicit GpuProfiler(Device& device, uint32_t maxScopesPerFrame = DEFAULT_MAX_SCOPES);
+        ~GpuProfiler() = default;
+
+        GpuProfiler(const GpuProfiler&) = delete;
+        GpuProfiler& operator=(const GpuProfiler&) = delete;
+        GpuProfiler(GpuProfiler&&) = delete;
+        GpuProfiler& operator=(GpuProfiler&&) = delete;
+
+        static bool IsSupported(const Device& device) { return TimestampQueryPool::IsSupported(device); }
+
+        // Collects the results this frame slot recorded last time and resets its queries, must be recorded outside of a render pass
+        void BeginFrame(VkCommandBuffer commandBuffer, int frameIndex);
+
+        // Can be recorded inside and outside of render passes
+        uint32_t BeginScope(VkCommandBuffer commandBuffer, const std::string& name);
+        void EndScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+        // In the order the scopes were first recorded
+        std::vector<GpuScopeStats> GetScopeStats() const;
+        void ClearStats();
+
+        // Both write the current GetScopeStats, times are in milliseconds
+        void ExportJson(const std::string& filePath) const;
+        void ExportCsv(const std::string& filePath) const;
+
+    private:
+        struct ScopeHistory
+        {
+            std::string name{};
+            std::array<float, HISTORY_SIZE> samples{};
+            uint32_t sampleCount{};
+            uint32_t nextSample{};
+        };
+
+        size_t GetHistoryIndex(const std::string& name);
+
+        TimestampQueryPool m_QueryPool;
+        uint32_t m_MaxScopesPerFrame{};
+
+        // History of every scope recorded in each frame slot, in recording order
+        std::array<std::vector<size_t>, SwapChain::MAX_FRAMES_IN_FLIGHT> m_FrameScopes{};
+        int m_CurrentFrameIndex{};
+
+        std::vector<ScopeHistory> m_Histories{};
+        std::unordered_map<std::string, size_t> m_HistoryIndices{};
+    };
+
+    // Brackets its lifetime with a GPU profiler scope, does nothing without a profiler
+    class GpuProfileScope final
+    {
+    public:
+        GpuProfileScope(GpuProfiler* pProfiler, VkCommandBuffer commandBuffer, const std::string& name)
+            : m_pProfiler{ pProfiler }, m_CommandBuffer{ commandBuffer }
+        {
+            if (m_pProfiler) m_Scope = m_pProfiler->BeginScope(m_CommandBuffer, name);
+        }
+        ~GpuProfileScope()
+        {
+            if (m_pProfiler) m_pProfiler->EndScope(m_CommandBuffer, m_Scope);
+        }
+
+        GpuProfileScope(const GpuProfileScope&) = delete;
+        GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+        GpuProfileScope(GpuProfileScope&&) = delete;
+        GpuProfileScope& operator=(GpuProfileScope&&) = delete;
+
+    private:
+        GpuProfiler* m_pProfiler;
+        VkCommandBuffer m_CommandBuffer;
+        uint32_t m_Scope{ GpuProfiler::INVALID_SCOPE };
+    };
+}
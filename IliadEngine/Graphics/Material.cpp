@@ -1,13 +1,31 @@
 ﻿#include "Material.h"
 
+#include <atomic>
+
+namespace
+{
+	std::atomic<uint32_t> g_MaterialIdCounter{};
+}
+
 ili::Material::Material()
 {
 	//todo: probably optimize this, because every time you create a new material it will create a new texture
 	//Initialize all the texture maps to their default values
-	m_AlbedoMap = ContentLoader::GetInstance().CreateTextureFromColor({ 1.f, 1.f, 1.f, 1.f });
-	m_NormalMap = ContentLoader::GetInstance().CreateTextureFromColor({ 0.5f, 0.5f, 1.f, 1.f });
-	m_MetallicMap = ContentLoader::GetInstance().CreateTextureFromColor({ 0.f, 0.f, 0.f, 1.f });
-	m_RoughnessMap = ContentLoader::GetInstance().CreateTextureFromColor({ 0.5f, 0.5f, 0.5f, 1.f });
-	m_AOMap = ContentLoader::GetInstance().CreateTextureFromColor({ 1.f, 1.f, 1.f, 1.f });
+	auto pTextures = std::make_shared<MaterialTextures>();
+	pTextures->materialId = g_MaterialIdCounter++;
+	pTextures->albedoMap = ContentLoader::GetInstance().CreateTextureFromColor({ 1.f, 1.f, 1.f, 1.f });
+	pTextures->normalMap = ContentLoader::GetInstance().CreateTextureFromColor({ 0.5f, 0.5f, 1.f, 1.f });
+	pTextures->metallicMap = ContentLoader::GetInstance().CreateTextureFromColor({ 0.f, 0.f, 0.f, 1.f });
+	pTextures->roughnessMap = ContentLoader::GetInstance().CreateTextureFromColor({ 0.5f, 0.5f, 0.5f, 1.f });
+	pTextures->aoMap = ContentLoader::GetInstance().CreateTextureFromColor({ 1.f, 1.f, 1.f, 1.f });
+	m_pTextures = std::move(pTextures);
+}
+
+ili::MaterialTextures& ili::Material::ModifyTextures()
+{
+	auto pTextures = std::make_shared<MaterialTextures>(*m_pTextures);
+	MaterialTextures& textures = *pTextures;
+	m_pTextures = std::move(pTextures);
+	return textures;
 }
 
@@ -11,6 +11,16 @@
 
 namespace ili
 {
+    // The textures of a Material at one point in time. Never changed once created, a frame that is being recorded keeps using its copy
+    struct MaterialTextures final
+    {
+        uint32_t materialId{};
+        std::shared_ptr<Texture> albedoMap{};
+        std::shared_ptr<Texture> normalMap{};
+        std::shared_ptr<Texture> metallicMap{};
+        std::shared_ptr<Texture> roughnessMap{};
+        std::shared_ptr<Texture> aoMap{};
+    };
 
     //I don't know if I like this as a class. It's just a container.
 	// I will leave it for now in case I want to add more functionality to it.
@@ -28,36 +38,40 @@ namespace ili
 		Material& operator=(Material&&) = delete;
 
         // Albedo (Diffuse)
-		void SetAlbedo(const std::shared_ptr<Texture>& albedoMap) { m_AlbedoMap = albedoMap; }
-        void SetAlbedo(const glm::vec3& color) { m_AlbedoMap = ContentLoader::GetInstance().CreateTextureFromColor({ color, 1.f }); }
+		void SetAlbedo(const std::shared_ptr<Texture>& albedoMap) { ModifyTextures().albedoMap = albedoMap; }
+        void SetAlbedo(const glm::vec3& color) { ModifyTextures().albedoMap = ContentLoader::GetInstance().CreateTextureFromColor({ color, 1.f }); }
 
         // Normal Map
-		void SetNormal(const std::shared_ptr<Texture>& normalMap) { m_NormalMap = normalMap; }
+		void SetNormal(const std::shared_ptr<Texture>& normalMap) { ModifyTextures().normalMap = normalMap; }
 
         // Metallic
-		void SetMetallic(const std::shared_ptr<Texture>& metallicMap) { m_MetallicMap = metallicMap; }
-		void SetMetallic(float value) { m_MetallicMap = ContentLoader::GetInstance().CreateTextureFromColor({ value, value, value, 1.f }); }
+		void SetMetallic(const std::shared_ptr<Texture>& metallicMap) { ModifyTextures().metallicMap = metallicMap; }
+		void SetMetallic(float value) { ModifyTextures().metallicMap = ContentLoader::GetInstance().CreateTextureFromColor({ value, value, value, 1.f }); }
 
         // Roughness
-		void SetRoughness(const std::shared_ptr<Texture>& roughnessMap) { m_RoughnessMap = roughnessMap; }
-		void SetRoughness(float value) { m_RoughnessMap = ContentLoader::GetInstance().CreateTextureFromColor({ value, value, value, 1.f }); }
+		void SetRoughness(const std::shared_ptr<Texture>& roughnessMap) { ModifyTextures().roughnessMap = roughnessMap; }
+		void SetRoughness(float value) { ModifyTextures().roughnessMap = ContentLoader::GetInstance().CreateTextureFromColor({ value, value, value, 1.f }); }
         
         // Ambient Occlusion (AO)
-		void SetAO(const std::shared_ptr<Texture>& aoMap) { m_AOMap = aoMap; }
-		void SetAO(float value) { m_AOMap = ContentLoader::GetInstance().CreateTextureFromColor({ value, value, value, 1.f }); }
+		void SetAO(const std::shared_ptr<Texture>& aoMap) { ModifyTextures().aoMap = aoMap; }
+		void SetAO(float value) { ModifyTextures().aoMap = ContentLoader::GetInstance().CreateTextureFromColor({ value, value, value, 1.f }); }
+
+        // Unique per material, used to group draws in the render queue
+        uint32_t GetId() const { return m_pTextures->materialId; }
 
-        std::shared_ptr<Texture> GetAlbedoMap() const { return m_AlbedoMap; }
-		std::shared_ptr<Texture> GetNormalMap() const { return m_NormalMap; }
-		std::shared_ptr<Texture> GetMetallicMap() const { return m_MetallicMap; }
-		std::shared_ptr<Texture> GetRoughnessMap() const { return m_RoughnessMap; }
-		std::shared_ptr<Texture> GetAOMap() const { return m_AOMap; }
+        std::shared_ptr<Texture> GetAlbedoMap() const { return m_pTextures->albedoMap; }
+		std::shared_ptr<Texture> GetNormalMap() const { return m_pTextures->normalMap; }
+		std::shared_ptr<Texture> GetMetallicMap() const { return m_pTextures->metallicMap; }
+		std::shared_ptr<Texture> GetRoughnessMap() const { return m_pTextures->roughnessMap; }
+		std::shared_ptr<Texture> GetAOMap() const { return m_pTextures->aoMap; }
+
+        // What a render snapshot holds on to, later changes to the material do not affect it
+        std::shared_ptr<const MaterialTextures> GetTextures() const { return m_pTextures; }
 
     private:
-        // Texture maps
-        std::shared_ptr<Texture> m_AlbedoMap{};
-        std::shared_ptr<Texture> m_NormalMap{};
-        std::shared_ptr<Texture> m_MetallicMap{};
-        std::shared_ptr<Texture> m_RoughnessMap{};
-        std::shared_ptr<Texture> m_AOMap{};
+        // Replaces the textures with a copy to change, the old ones may still be in use by a frame
+        MaterialTextures& ModifyTextures();
+
+        std::shared_ptr<const MaterialTextures> m_pTextures{};
     };
 }
@@ -1,5 +1,6 @@
 #include "Model.h"
 #include "../Core/Utils.h"
+#include <atomic>
 #include <stdexcept>
 #include <cassert>
 
@@ -8,6 +9,11 @@
 
 namespace ili
 {
+    namespace
+    {
+        std::atomic<uint32_t> g_ModelIdCounter{};
+    }
+
     std::vector<VkVertexInputBindingDescription> Model::Vertex::GetBindingDescriptions()
     {
         std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
@@ -30,11 +36,23 @@ namespace ili
         return attributeDescriptions;
     }
 
-    Model::Model(Device& device, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
-        : m_Device(device)
+    Model::Model(Device& device, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, bool buildMeshBvh)
+        : m_Device(device), m_Id(g_ModelIdCounter++)
     {
         CreateVertexBuffers(vertices);
         CreateIndexBuffers(indices);
+        CalculateBoundingSphere(vertices);
+
+        if (buildMeshBvh)
+        {
+            std::vector<glm::vec3> positions{};
+            positions.reserve(vertices.size());
+            for (const auto& vertex : vertices)
+            {
+                positions.push_back(vertex.position);
+            }
+            m_pMeshBvh = std::make_unique<MeshBvh>(positions, indices);
+        }
     }
 
     Model::~Model()
@@ -104,4 +122,51 @@ namespace ili
             vkCmdDraw(commandBuffer, m_VertexCount, 1, 0, 0);
         }
     }
+
+    void Model::DrawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset) const
+    {
+        if (m_HasIndexBuffer)
+        {
+            vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset, 1, sizeof(VkDrawIndexedIndirectCommand));
+        }
+        else
+        {
+            vkCmdDrawIndirect(commandBuffer, buffer, offset, 1, sizeof(VkDrawIndirectCommand));
+        }
+    }
+
+    VkDrawIndexedIndirectCommand Model::GetIndexedIndirectCommand() const
+    {
+        assert(m_HasIndexBuffer && "Models without an index buffer are drawn with a VkDrawIndirectCommand");
+
+        // indexCount, instanceCount, firstIndex, vertexOffset, firstInstance
+        return { m_IndexCount, 1, 0, 0, 0 };
+    }
+
+    VkDrawIndirectCommand Model::GetIndirectCommand() const
+    {
+        assert(!m_HasIndexBuffer && "Models with an index buffer are drawn with a VkDrawIndexedIndirectCommand");
+
+        // vertexCount, instanceCount, firstVertex, firstInstance
+        return { m_VertexCount, 1, 0, 0 };
+    }
+
+    void Model::CalculateBoundingSphere(const std::vector<Vertex>& vertices)
+    {
+        // Centered on the bounding box, which is tight enough for culling
+        glm::vec3 minimum{ vertices[0].position };
+        glm::vec3 maximum{ vertices[0].position };
+        for (const auto& vertex : vertices)
+        {
+            minimum = glm::min(minimum, vertex.position);
+            maximum = glm::max(maximum, vertex.position);
+        }
+
+        m_BoundingSphere.center = (minimum + maximum) * 0.5f;
+        m_BoundingSphere.radius = 0.f;
+        for (const auto& vertex : vertices)
+        {
+            m_BoundingSphere.radius = glm::max(m_BoundingSphere.radius, glm::length(vertex.position - m_BoundingSphere.center));
+        }
+    }
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include "Graphics/Device.h"
 #include "Graphics/Buffer.h"
+#include "SceneGraph/Bounds.h"
+#include "SceneGraph/MeshBvh.h"
 #include <glm/glm.hpp>
 #include <vector>
 #include <vulkan/vulkan.h>
@@ -28,7 +30,8 @@ namespace ili
             }
         };
 
-        Model(Device& device, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+        // With buildMeshBvh the triangles are also kept on the CPU in a MeshBvh, for ray queries against the geometry
+        Model(Device& device, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, bool buildMeshBvh = false);
         ~Model();
 
         Model(const Model&) = delete;
@@ -36,11 +39,33 @@ namespace ili
 
         void Bind(VkCommandBuffer commandBuffer) const;
         void Draw(VkCommandBuffer commandBuffer) const;
+
+        // Draws with the parameters stored at offset in the buffer, written from GetIndexedIndirectCommand or GetIndirectCommand
+        void DrawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset) const;
+        // Parameters of a single instance draw of the whole model, the first for models with an index buffer
+        VkDrawIndexedIndirectCommand GetIndexedIndirectCommand() const;
+        VkDrawIndirectCommand GetIndirectCommand() const;
+
+        bool HasIndexBuffer() const { return m_HasIndexBuffer; }
+
+        uint32_t GetTriangleCount() const { return (m_HasIndexBuffer ? m_IndexCount : m_VertexCount) / 3; }
+
+        // Encloses all vertices, in model space
+        const Sphere& GetBoundingSphere() const { return m_BoundingSphere; }
+        // In model space, null unless the model was created with buildMeshBvh
+        const MeshBvh* GetMeshBvh() const { return m_pMeshBvh.get(); }
+
+        // Unique per model, used to group draws in the render queue
+        uint32_t GetId() const { return m_Id; }
     private:
         void CreateVertexBuffers(const std::vector<Vertex>& vertices);
         void CreateIndexBuffers(const std::vector<uint32_t>& indices);
+        void CalculateBoundingSphere(const std::vector<Vertex>& vertices);
 
         Device& m_Device;
+        uint32_t m_Id{};
+        Sphere m_BoundingSphere{};
+        std::unique_ptr<MeshBvh> m_pMeshBvh{};
 
         std::unique_ptr<Buffer> m_pVertexBuffer;
         uint32_t m_VertexCount;
@@ -0,0 +1,214 @@
+﻿#include "OffscreenRenderTarget.h"
+
+#include <array>
+#include <stdexcept>
+
+namespace ili
+{
+    OffscreenRenderTarget::OffscreenRenderTarget(Device& device, const SwapChain& swapChain) : m_Device{ device }
+    {
+        m_ColorFormat = swapChain.GetSwapChainImageFormat();
+        m_DepthFormat = swapChain.GetDepthFormat();
+
+        const VkFormatProperties formatProperties = m_Device.GetFormatProperties(m_ColorFormat);
+        if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)
+        {
+            m_BlitFilter = VK_FILTER_LINEAR;
+        }
+
+        CreateRenderPasses(swapChain);
+        CreateAttachments(swapChain);
+        CreateFramebuffers(swapChain);
+    }
+
+    OffscreenRenderTarget::~OffscreenRenderTarget()
+    {
+        Cleanup();
+        vkDestroyRenderPass(m_Device.GetDevice(), m_ResumeRenderPass, nullptr);
+        vkDestroyRenderPass(m_Device.GetDevice(), m_RenderPass, nullptr);
+    }
+
+    void OffscreenRenderTarget::Recreate(const SwapChain& swapChain)
+    {
+        Cleanup();
+        CreateAttachments(swapChain);
+        CreateFramebuffers(swapChain);
+    }
+
+    void OffscreenRenderTarget::CreateRenderPasses(const SwapChain& swapChain)
+    {
+        // Attachment order, formats and sample counts match the swap chain render pass
+        std::array<VkAttachmentDescription, 2> attachments{};
+        attachments[0].format = swapChain.GetSwapChainImageFormat();
+        attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+        attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachments[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+        attachments[1].format = swapChain.GetDepthFormat();
+        attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+        attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        // Stored for the depth pyramid of the occlusion culling and for the resume pass
+        attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference colorAttachmentRef{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        VkAttachmentReference depthAttachmentRef{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorAttachmentRef;
+        subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+        std::array<VkSubpassDependency, 2> dependencies{};
+
+        // The previous use of the images, a blit reading color or an earlier pass of the same frame
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        // Color is blitted into the swap chain image afterwards
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
+
+        if (vkCreateRenderPass(m_Device.GetDevice(), &renderPassInfo, nullptr, &m_RenderPass) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create offscreen render pass");
+        }
+
+        // Same attachments, picking up where the first pass left them
+        attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        attachments[0].initialLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        if (vkCreateRenderPass(m_Device.GetDevice(), &renderPassInfo, nullptr, &m_ResumeRenderPass) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create offscreen resume render pass");
+        }
+    }
+
+    void OffscreenRenderTarget::CreateAttachments(const SwapChain& swapChain)
+    {
+        m_Extent = swapChain.GetSwapChainExtent();
+        m_ColorImages.resize(swapChain.ImageCount());
+        m_DepthImages.resize(swapChain.ImageCount());
+
+        for (size_t i{}; i < m_ColorImages.size(); ++i)
+        {
+            m_ColorImages[i] = CreateAttachmentImage(m_ColorFormat,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+            // Sampled by the depth pyramid of the occlusion culling
+            m_DepthImages[i] = CreateAttachmentImage(m_DepthFormat,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
+        }
+    }
+
+    void OffscreenRenderTarget::CreateFramebuffers(const SwapChain& swapChain)
+    {
+        m_Framebuffers.resize(swapChain.ImageCount());
+
+        for (size_t i{}; i < m_Framebuffers.size(); ++i)
+        {
+            const std::array<VkImageView, 2> attachments{ m_ColorImages[i].view, m_DepthImages[i].view };
+
+            VkFramebufferCreateInfo framebufferInfo{};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = m_RenderPass;
+            framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+            framebufferInfo.pAttachments = attachments.data();
+            framebufferInfo.width = m_Extent.width;
+            framebufferInfo.height = m_Extent.height;
+            framebufferInfo.layers = 1;
+
+            if (vkCreateFramebuffer(m_Device.GetDevice(), &framebufferInfo, nullptr, &m_Framebuffers[i]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create offscreen framebuffer");
+            }
+        }
+    }
+
+    void OffscreenRenderTarget::Cleanup()
+    {
+        for (const auto framebuffer : m_Framebuffers)
+        {
+            vkDestroyFramebuffer(m_Device.GetDevice(), framebuffer, nullptr);
+        }
+        m_Framebuffers.clear();
+
+        for (auto* pImages : { &m_ColorImages, &m_DepthImages })
+        {
+            for (const auto& attachment : *pImages)
+            {
+                vkDestroyImageView(m_Device.GetDevice(), attachment.view, nullptr);
+                vkDestroyImage(m_Device.GetDevice(), attachment.image, nullptr);
+                m_Device.FreeMemory(attachment.memory);
+            }
+            pImages->clear();
+        }
+    }
+
+    OffscreenRenderTarget::AttachmentImage OffscreenRenderTarget::CreateAttachmentImage(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect) const
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = m_Extent.width;
+        imageInfo.extent.height = m_Extent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = usage;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        AttachmentImage attachment{};
+        m_Device.CreateImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, attachment.image, attachment.memory);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = attachment.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange.aspectMask = aspect;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(m_Device.GetDevice(), &viewInfo, nullptr, &attachment.view) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create offscreen attachment view");
+        }
+
+        return attachment;
+    }
+}
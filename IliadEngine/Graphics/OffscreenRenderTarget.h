@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <vector>
+
+#include "Device.h"
+#include "SwapChain.h"
+
+namespace ili
+{
+    /**
+     * Color and depth images at the full swap chain extent that the forward path renders into when it does not
+     * render straight into the swap chain, e.g. for dynamic resolution where only part of the target is used.
+     * The render passes use the same formats as the swap chain render pass, so every pipeline created for the
+     * swap chain stays compatible. Color ends up in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, ready to be blitted.
+     */
+    class OffscreenRenderTarget final
+    {
+    public:
+        OffscreenRenderTarget(Device& device, const SwapChain& swapChain);
+        ~OffscreenRenderTarget();
+
+        OffscreenRenderTarget(const OffscreenRenderTarget&) = delete;
+        OffscreenRenderTarget& operator=(const OffscreenRenderTarget&) = delete;
+        OffscreenRenderTarget(OffscreenRenderTarget&&) = delete;
+        OffscreenRenderTarget& operator=(OffscreenRenderTarget&&) = delete;
+
+        // Rebuilds the images and framebuffers for a new swap chain, the render passes stay valid
+        void Recreate(const SwapChain& swapChain);
+
+        VkRenderPass GetRenderPass() const { return m_RenderPass; }
+        // Loads color and depth instead of clearing them
+        VkRenderPass GetResumeRenderPass() const { return m_ResumeRenderPass; }
+        VkFramebuffer GetFrameBuffer(uint32_t imageIndex) const { return m_Framebuffers[imageIndex]; }
+
+        VkImage GetColorImage(uint32_t imageIndex) const { return m_ColorImages[imageIndex].image; }
+        VkImage GetDepthImage(uint32_t imageIndex) const { return m_DepthImages[imageIndex].image; }
+        VkImageView GetDepthImageView(uint32_t imageIndex) const { return m_DepthImages[imageIndex].view; }
+        VkExtent2D GetExtent() const { return m_Extent; }
+
+        // Linear when the color format supports filtered blits
+        VkFilter GetBlitFilter() const { return m_BlitFilter; }
+
+    private:
+        struct AttachmentImage
+        {
+            VkImage image{};
+            VkDeviceMemory memory{};
+            VkImageView view{};
+        };
+
+        void CreateRenderPasses(const SwapChain& swapChain);
+        void CreateAttachments(const SwapChain& swapChain);
+        void CreateFramebuffers(const SwapChain& swapChain);
+        void Cleanup();
+
+        AttachmentImage CreateAttachmentImage(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect) const;
+
+        Device& m_Device;
+        VkRenderPass m_RenderPass{};
+        VkRenderPass m_ResumeRenderPass{};
+        VkFilter m_BlitFilter{ VK_FILTER_NEAREST };
+
+        // One set per swap chain image, like the swap chain's depth buffers
+        std::vector<AttachmentImage> m_ColorImages{};
+        std::vector<AttachmentImage> m_DepthImages{};
+        std::vector<VkFramebuffer> m_Framebuffers{};
+        VkExtent2D m_Extent{};
+        VkFormat m_ColorFormat{};
+        VkFormat m_DepthFormat{};
+    };
+}
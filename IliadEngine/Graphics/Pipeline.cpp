@@ -1,5 +1,6 @@
 ﻿#include "Pipeline.h"
 
+#include <atomic>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -8,16 +9,40 @@
 
 namespace ili
 {
+	namespace
+	{
+		std::atomic<uint32_t> g_PipelineIdCounter{};
+	}
+
 	Pipeline::Pipeline(Device& device, const std::string& vertFilepath, const std::string& fragFilepath,
-		const PipelineConfigInfo& info) : m_Device(device)
+		const PipelineConfigInfo& info) : m_Device(device), m_Id(g_PipelineIdCounter++)
 	{
-		CreateGraphicsPipeline(vertFilepath, fragFilepath, info);
+		const auto vertCode = ReadFile(vertFilepath);
+		const auto fragCode = ReadFile(fragFilepath);
+
+		CreateShaderModule(m_Device, vertCode, &m_VertexShaderModule);
+		CreateShaderModule(m_Device, fragCode, &m_FragmentShaderModule);
+
+		CreateGraphicsPipeline(info);
+	}
+
+	Pipeline::Pipeline(Device& device, VkShaderModule vertShaderModule, VkShaderModule fragShaderModule,
+		const PipelineConfigInfo& info) : m_Device(device),
+		m_VertexShaderModule(vertShaderModule),
+		m_FragmentShaderModule(fragShaderModule),
+		m_OwnsShaderModules(false),
+		m_Id(g_PipelineIdCounter++)
+	{
+		CreateGraphicsPipeline(info);
 	}
 
 	Pipeline::~Pipeline()
 	{
-		vkDestroyShaderModule(m_Device.GetDevice(), m_VertexShaderModule, nullptr);
-		vkDestroyShaderModule(m_Device.GetDevice(), m_FragmentShaderModule, nullptr);
+		if (m_OwnsShaderModules)
+		{
+			vkDestroyShaderModule(m_Device.GetDevice(), m_VertexShaderModule, nullptr);
+			vkDestroyShaderModule(m_Device.GetDevice(), m_FragmentShaderModule, nullptr);
+		}
 		vkDestroyPipeline(m_Device.GetDevice(), m_GraphicsPipeline, nullptr);
 	}
 
@@ -46,16 +71,8 @@ namespace ili
 		return buffer;
 	}
 
-	void Pipeline::CreateGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo)
+	void Pipeline::CreateGraphicsPipeline(const PipelineConfigInfo& configInfo)
 	{
-		std::string test = std::filesystem::current_path().string();
-
-		const auto vertCode = ReadFile(vertFilepath);
-		const auto fragCode = ReadFile(fragFilepath);
-
-		CreateShaderModule(vertCode, &m_VertexShaderModule);
-		CreateShaderModule(fragCode, &m_FragmentShaderModule);
-
 		VkPipelineShaderStageCreateInfo shaderStages[2]{};
 		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -85,7 +102,8 @@ namespace ili
 
 		VkGraphicsPipelineCreateInfo pipelineInfo{};
 		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-		pipelineInfo.stageCount = 2;
+		// Depth-only pipelines have no fragment stage
+		pipelineInfo.stageCount = m_FragmentShaderModule != VK_NULL_HANDLE ? 2 : 1;
 		pipelineInfo.pStages = shaderStages;
 		pipelineInfo.pVertexInputState = &vertexInputInfo;
 		pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
@@ -110,14 +128,14 @@ namespace ili
 
     }
 
-	void Pipeline::CreateShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule)
+	void Pipeline::CreateShaderModule(Device& device, const std::vector<char>& code, VkShaderModule* shaderModule)
 	{
 		VkShaderModuleCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 		createInfo.codeSize = code.size();
 		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
 
-		if (vkCreateShaderModule(m_Device.GetDevice(), &createInfo, nullptr, shaderModule) != VK_SUCCESS)
+		if (vkCreateShaderModule(device.GetDevice(), &createInfo, nullptr, shaderModule) != VK_SUCCESS)
 		{
 			throw std::runtime_error("Failed to create shader module!");
 		}
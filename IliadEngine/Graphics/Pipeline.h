@@ -31,6 +31,9 @@ namespace ili
 	{
 	public:
 		Pipeline(Device& device, const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& info);
+		// Builds the pipeline from shader modules owned by someone else (e.g. the PipelineRegistry).
+		// The fragment module may be VK_NULL_HANDLE for depth-only pipelines
+		Pipeline(Device& device, VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, const PipelineConfigInfo& info);
 		~Pipeline();
 
 		Pipeline(const Pipeline& other) = delete;
@@ -41,15 +44,20 @@ namespace ili
 		static void GetDefaultPipelineConfigInfo(PipelineConfigInfo& configInfoInOut);
 
 		void Bind(VkCommandBuffer commandBuffer);
-	private:
-		static std::vector<char> ReadFile(const std::string& filepath);
 
-		void CreateGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo);
-		void CreateShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
+		// Unique per pipeline, used to group draws in the render queue
+		uint32_t GetId() const { return m_Id; }
+
+		static std::vector<char> ReadFile(const std::string& filepath);
+		static void CreateShaderModule(Device& device, const std::vector<char>& code, VkShaderModule* shaderModule);
+	private:
+		void CreateGraphicsPipeline(const PipelineConfigInfo& configInfo);
 
 		Device& m_Device;
 		VkPipeline m_GraphicsPipeline{};
 		VkShaderModule m_VertexShaderModule{};
 		VkShaderModule m_FragmentShaderModule{};
+		bool m_OwnsShaderModules{ true };
+		uint32_t m_Id{};
 	};
 }
@@ -0,0 +1,267 @@
+﻿#include "PipelineRegistry.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <type_traits>
+
+#include "Core/Utils.h"
+
+namespace ili
+{
+    namespace
+    {
+        // Non-dispatchable handles are pointers on 64-bit platforms and plain integers on 32-bit ones
+        template <typename T>
+        uint64_t HandleToWord(T handle)
+        {
+            if constexpr (std::is_pointer_v<T>)
+                return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle));
+            else
+                return static_cast<uint64_t>(handle);
+        }
+
+        uint64_t FloatToWord(float value)
+        {
+            return std::bit_cast<uint32_t>(value);
+        }
+
+        void AppendStencilOp(std::vector<uint64_t>& words, const VkStencilOpState& state)
+        {
+            words.insert(words.end(), {
+                static_cast<uint64_t>(state.failOp), static_cast<uint64_t>(state.passOp),
+                static_cast<uint64_t>(state.depthFailOp), static_cast<uint64_t>(state.compareOp),
+                state.compareMask, state.writeMask, state.reference });
+        }
+
+        // Flattens every field of the config that affects the resulting pipeline.
+        // Pointers inside the create infos are followed rather than hashed, because they point into the config itself
+        void AppendConfigInfo(std::vector<uint64_t>& words, const PipelineConfigInfo& configInfo)
+        {
+            words.push_back(configInfo.vertexBindingDescriptions.size());
+            for (const auto& binding : configInfo.vertexBindingDescriptions)
+            {
+                words.insert(words.end(), { binding.binding, binding.stride, static_cast<uint64_t>(binding.inputRate) });
+            }
+
+            words.push_back(configInfo.vertexAttributeDescriptions.size());
+            for (const auto& attribute : configInfo.vertexAttributeDescriptions)
+            {
+                words.insert(words.end(), { attribute.location, attribute.binding, static_cast<uint64_t>(attribute.format), attribute.offset });
+            }
+
+            words.insert(words.end(), { configInfo.viewportInfo.viewportCount, configInfo.viewportInfo.scissorCount });
+
+            words.insert(words.end(), {
+                static_cast<uint64_t>(configInfo.inputAssemblyInfo.topology),
+                configInfo.inputAssemblyInfo.primitiveRestartEnable });
+
+            const auto& raster = configInfo.rasterizationInfo;
+            words.insert(words.end(), {
+                raster.depthClampEnable, raster.rasterizerDiscardEnable, static_cast<uint64_t>(raster.polygonMode),
+                raster.cullMode, static_cast<uint64_t>(raster.frontFace), raster.depthBiasEnable,
+                FloatToWord(raster.depthBiasConstantFactor), FloatToWord(raster.depthBiasClamp),
+                FloatToWord(raster.depthBiasSlopeFactor), FloatToWord(raster.lineWidth) });
+
+            const auto& multisample = configInfo.multisampleInfo;
+            words.insert(words.end(), {
+                static_cast<uint64_t>(multisample.rasterizationSamples), multisample.sampleShadingEnable,
+                FloatToWord(multisample.minSampleShading), multisample.alphaToCoverageEnable, multisample.alphaToOneEnable });
+
+            const auto& blend = configInfo.colorBlendInfo;
+            words.insert(words.end(), {
+                blend.logicOpEnable, static_cast<uint64_t>(blend.logicOp), blend.attachmentCount,
+                FloatToWord(blend.blendConstants[0]), FloatToWord(blend.blendConstants[1]),
+                FloatToWord(blend.blendConstants[2]), FloatToWord(blend.blendConstants[3]) });
+            for (uint32_t i{}; i < blend.attachmentCount && blend.pAttachments; ++i)
+            {
+                const auto& attachment = blend.pAttachments[i];
+                words.insert(words.end(), {
+                    attachment.blendEnable,
+                    static_cast<uint64_t>(attachment.srcColorBlendFactor), static_cast<uint64_t>(attachment.dstColorBlendFactor),
+                    static_cast<uint64_t>(attachment.colorBlendOp),
+                    static_cast<uint64_t>(attachment.srcAlphaBlendFactor), static_cast<uint64_t>(attachment.dstAlphaBlendFactor),
+                    static_cast<uint64_t>(attachment.alphaBlendOp), attachment.colorWriteMask });
+            }
+
+            const auto& depth = configInfo.depthStencilInfo;
+            words.insert(words.end(), {
+                depth.depthTestEnable, depth.depthWriteEnable, static_cast<uint64_t>(depth.depthCompareOp),
+                depth.depthBoundsTestEnable, depth.stencilTestEnable,
+                FloatToWord(depth.minDepthBounds), FloatToWord(depth.maxDepthBounds) });
+            AppendStencilOp(words, depth.front);
+            AppendStencilOp(words, depth.back);
+
+            words.push_back(configInfo.dynamicStateInfo.dynamicStateCount);
+            for (uint32_t i{}; i < configInfo.dynamicStateInfo.dynamicStateCount; ++i)
+            {
+                words.push_back(static_cast<uint64_t>(configInfo.dynamicStateInfo.pDynamicStates[i]));
+            }
+
+            words.insert(words.end(), {
+                HandleToWord(configInfo.pipelineLayout), HandleToWord(configInfo.renderPass), configInfo.subpass });
+        }
+    }
+
+    PipelineRegistry::PipelineRegistry(Device& device) : m_Device{ device }
+    {
+    }
+
+    PipelineRegistry::~PipelineRegistry()
+    {
+        // Pipelines first, they were built from the modules and layouts below
+        m_Pipelines.clear();
+        m_ComputePipelines.clear();
+
+        for (const auto& [key, layout] : m_PipelineLayouts)
+        {
+            vkDestroyPipelineLayout(m_Device.GetDevice(), layout, nullptr);
+        }
+        m_DescriptorSetLayouts.clear();
+
+        for (const auto& [path, shaderModule] : m_ShaderModules)
+        {
+            vkDestroyShaderModule(m_Device.GetDevice(), shaderModule, nullptr);
+        }
+    }
+
+    void PipelineRegistry::FinalizeKey(StateKey& key)
+    {
+        key.hash = 0;
+        for (const uint64_t word : key.words)
+        {
+            Utils::HashCombine(key.hash, word);
+        }
+    }
+
+    VkShaderModule PipelineRegistry::GetShaderModule(const std::string& filepath)
+    {
+        if (const auto it = m_ShaderModules.find(filepath); it != m_ShaderModules.end())
+        {
+            ++m_CacheHits;
+            return it->second;
+        }
+
+        VkShaderModule shaderModule{};
+        Pipeline::CreateShaderModule(m_Device, Pipeline::ReadFile(filepath), &shaderModule);
+
+        m_ShaderModules.emplace(filepath, shaderModule);
+        return shaderModule;
+    }
+
+    DescriptorSetLayout& PipelineRegistry::GetDescriptorSetLayout(const DescriptorSetLayout::Builder& builder)
+    {
+        // Sorted, the builder keeps its bindings in no particular order
+        std::vector<VkDescriptorSetLayoutBinding> bindings{};
+        for (const auto& [index, binding] : builder.GetBindings()) bindings.push_back(binding);
+        std::ranges::sort(bindings, {}, &VkDescriptorSetLayoutBinding::binding);
+
+        StateKey key{};
+        key.words.push_back(bindings.size());
+        for (const auto& binding : bindings)
+        {
+            key.words.insert(key.words.end(), { binding.binding, static_cast<uint64_t>(binding.descriptorType), binding.descriptorCount, binding.stageFlags });
+        }
+        FinalizeKey(key);
+
+        if (const auto it = m_DescriptorSetLayouts.find(key); it != m_DescriptorSetLayouts.end())
+        {
+            ++m_CacheHits;
+            return *it->second;
+        }
+
+        auto setLayout = builder.Build();
+        DescriptorSetLayout& setLayoutRef = *setLayout;
+
+        m_DescriptorSetLayouts.emplace(std::move(key), std::move(setLayout));
+        return setLayoutRef;
+    }
+
+    VkPipelineLayout PipelineRegistry::GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts,
+        const std::vector<VkPushConstantRange>& pushConstantRanges)
+    {
+        StateKey key{};
+        key.words.push_back(setLayouts.size());
+        for (const auto setLayout : setLayouts)
+        {
+            key.words.push_back(HandleToWord(setLayout));
+        }
+        key.words.push_back(pushConstantRanges.size());
+        for (const auto& range : pushConstantRanges)
+        {
+            key.words.insert(key.words.end(), { range.stageFlags, range.offset, range.size });
+        }
+        FinalizeKey(key);
+
+        if (const auto it = m_PipelineLayouts.find(key); it != m_PipelineLayouts.end())
+        {
+            ++m_CacheHits;
+            return it->second;
+        }
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+        pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+        VkPipelineLayout pipelineLayout{};
+        if (vkCreatePipelineLayout(m_Device.GetDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create pipeline layout");
+        }
+
+        m_PipelineLayouts.emplace(std::move(key), pipelineLayout);
+        return pipelineLayout;
+    }
+
+    Pipeline* PipelineRegistry::GetPipeline(const std::string& vertFilepath, const std::string& fragFilepath,
+        const PipelineConfigInfo& configInfo)
+    {
+        // Shader modules are deduplicated by path, so their handles identify the shaders
+        const VkShaderModule vertModule = GetShaderModule(vertFilepath);
+        const VkShaderModule fragModule = fragFilepath.empty() ? VK_NULL_HANDLE : GetShaderModule(fragFilepath);
+
+        StateKey key{};
+        key.words.reserve(128);
+        key.words.push_back(HandleToWord(vertModule));
+        key.words.push_back(HandleToWord(fragModule));
+        AppendConfigInfo(key.words, configInfo);
+        FinalizeKey(key);
+
+        if (const auto it = m_Pipelines.find(key); it != m_Pipelines.end())
+        {
+            ++m_CacheHits;
+            return it->second.get();
+        }
+
+        auto pipeline = std::make_unique<Pipeline>(m_Device, vertModule, fragModule, configInfo);
+        Pipeline* pPipeline = pipeline.get();
+
+        m_Pipelines.emplace(std::move(key), std::move(pipeline));
+        return pPipeline;
+    }
+
+    ComputePipeline* PipelineRegistry::GetComputePipeline(const std::string& compFilepath, VkPipelineLayout pipelineLayout)
+    {
+        const VkShaderModule compModule = GetShaderModule(compFilepath);
+
+        StateKey key{};
+        key.words.push_back(HandleToWord(compModule));
+        key.words.push_back(HandleToWord(pipelineLayout));
+        FinalizeKey(key);
+
+        if (const auto it = m_ComputePipelines.find(key); it != m_ComputePipelines.end())
+        {
+            ++m_CacheHits;
+            return it->second.get();
+        }
+
+        auto pipeline = std::make_unique<ComputePipeline>(m_Device, compModule, pipelineLayout);
+        ComputePipeline* pPipeline = pipeline.get();
+
+        m_ComputePipelines.emplace(std::move(key), std::move(pipeline));
+        return pPipeline;
+    }
+}
@@ -0,0 +1,84 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ComputePipeline.h"
+#include "Descriptors.h"
+#include "Device.h"
+#include "Pipeline.h"
+
+namespace ili
+{
+    /**
+     * Owns every graphics pipeline, pipeline layout, shader module and per-system descriptor set layout used by the render systems.
+     * Requests are hashed on the full description, so two systems (or two material variants) asking
+     * for identical state receive the same Vulkan object instead of a new one.
+     */
+    class PipelineRegistry final
+    {
+    public:
+        explicit PipelineRegistry(Device& device);
+        ~PipelineRegistry();
+
+        PipelineRegistry(const PipelineRegistry&) = delete;
+        PipelineRegistry& operator=(const PipelineRegistry&) = delete;
+        PipelineRegistry(PipelineRegistry&&) = delete;
+        PipelineRegistry& operator=(PipelineRegistry&&) = delete;
+
+        // Returns the shader module for the given SPIR-V file, loading it the first time it is requested
+        VkShaderModule GetShaderModule(const std::string& filepath);
+
+        // Returns a descriptor set layout with the bindings of the builder, owned by the registry.
+        // Systems that describe the same bindings share one layout, and with it their pipeline layouts
+        DescriptorSetLayout& GetDescriptorSetLayout(const DescriptorSetLayout::Builder& builder);
+
+        // Returns a pipeline layout matching the given set layouts and push constant ranges
+        VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts,
+            const std::vector<VkPushConstantRange>& pushConstantRanges);
+
+        // Returns a pipeline for the shaders and state, creating it only if no identical pipeline exists yet.
+        // An empty fragment path creates a depth-only pipeline. The pipeline stays owned by the registry
+        Pipeline* GetPipeline(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo);
+
+        // Returns a compute pipeline for the shader and layout, owned by the registry
+        ComputePipeline* GetComputePipeline(const std::string& compFilepath, VkPipelineLayout pipelineLayout);
+
+        size_t GetPipelineCount() const { return m_Pipelines.size(); }
+        size_t GetComputePipelineCount() const { return m_ComputePipelines.size(); }
+        size_t GetPipelineLayoutCount() const { return m_PipelineLayouts.size(); }
+        size_t GetDescriptorSetLayoutCount() const { return m_DescriptorSetLayouts.size(); }
+        size_t GetShaderModuleCount() const { return m_ShaderModules.size(); }
+        // Number of requests that were answered with an already existing object
+        uint32_t GetCacheHitCount() const { return m_CacheHits; }
+
+    private:
+        // The key keeps every hashed word so that hash collisions can never hand out the wrong object
+        struct StateKey
+        {
+            std::vector<uint64_t> words{};
+            size_t hash{};
+
+            bool operator==(const StateKey& other) const { return hash == other.hash && words == other.words; }
+        };
+
+        struct StateKeyHasher
+        {
+            size_t operator()(const StateKey& key) const { return key.hash; }
+        };
+
+        static void FinalizeKey(StateKey& key);
+
+        Device& m_Device;
+
+        std::unordered_map<std::string, VkShaderModule> m_ShaderModules{};
+        std::unordered_map<StateKey, std::unique_ptr<DescriptorSetLayout>, StateKeyHasher> m_DescriptorSetLayouts{};
+        std::unordered_map<StateKey, VkPipelineLayout, StateKeyHasher> m_PipelineLayouts{};
+        std::unordered_map<StateKey, std::unique_ptr<Pipeline>, StateKeyHasher> m_Pipelines{};
+        std::unordered_map<StateKey, std::unique_ptr<ComputePipeline>, StateKeyHasher> m_ComputePipelines{};
+
+        uint32_t m_CacheHits{};
+    };
+}
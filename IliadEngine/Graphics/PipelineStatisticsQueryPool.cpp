@@ -0,0 +1,65 @@
+﻿#include "PipelineStatisticsQueryPool.h"
+
+#include <bit>
+#include <cassert>
+#include <stdexcept>
+
+namespace ili
+{
+    PipelineStatisticsQueryPool::PipelineStatisticsQueryPool(Device& device, VkQueryPipelineStatisticFlags statistics, uint32_t queryCount)
+        : m_Device{ device },
+        m_StatisticCount{ static_cast<uint32_t>(std::popcount(statistics)) },
+        m_HasBeenRecorded(queryCount, false)
+    {
+        assert(device.EnabledFeatures.pipelineStatisticsQuery && "Pipeline statistics queries are not enabled on this device");
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        poolInfo.queryCount = queryCount;
+        poolInfo.pipelineStatistics = statistics;
+
+        if (vkCreateQueryPool(m_Device.GetDevice(), &poolInfo, nullptr, &m_QueryPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create pipeline statistics query pool!");
+        }
+    }
+
+    PipelineStatisticsQueryPool::~PipelineStatisticsQueryPool()
+    {
+        vkDestroyQueryPool(m_Device.GetDevice(), m_QueryPool, nullptr);
+    }
+
+    void PipelineStatisticsQueryPool::Reset(VkCommandBuffer commandBuffer, uint32_t query)
+    {
+        vkCmdResetQueryPool(commandBuffer, m_QueryPool, query, 1);
+    }
+
+    void PipelineStatisticsQueryPool::Begin(VkCommandBuffer commandBuffer, uint32_t query)
+    {
+        vkCmdBeginQuery(commandBuffer, m_QueryPool, query, 0);
+    }
+
+    void PipelineStatisticsQueryPool::End(VkCommandBuffer commandBuffer, uint32_t query)
+    {
+        vkCmdEndQuery(commandBuffer, m_QueryPool, query);
+        m_HasBeenRecorded[query] = true;
+    }
+
+    bool PipelineStatisticsQueryPool::GetResults(uint32_t query, std::vector<uint64_t>& results) const
+    {
+        if (!m_HasBeenRecorded[query]) return false;
+
+        // The statistics are followed by the availability word
+        std::vector<uint64_t> data(m_StatisticCount + 1);
+        const VkDeviceSize stride = data.size() * sizeof(uint64_t);
+
+        const VkResult result = vkGetQueryPoolResults(m_Device.GetDevice(), m_QueryPool, query, 1,
+            stride, data.data(), stride, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+        if ((result != VK_SUCCESS && result != VK_NOT_READY) || data.back() == 0) return false;
+
+        results.assign(data.begin(), data.end() - 1);
+        return true;
+    }
+}
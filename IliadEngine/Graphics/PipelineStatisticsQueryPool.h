@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include "Device.h"
+
+#include <vector>
+
+namespace ili
+{
+    /**
+     * Small wrapper around a VK_QUERY_TYPE_PIPELINE_STATISTICS pool.
+     * Usually one query per frame in flight, read back once the frame's fence has been waited on.
+     * Requires the pipelineStatisticsQuery device feature (see Device::EnabledFeatures).
+     */
+    class PipelineStatisticsQueryPool
+    {
+    public:
+        PipelineStatisticsQueryPool(Device& device, VkQueryPipelineStatisticFlags statistics, uint32_t queryCount);
+        ~PipelineStatisticsQueryPool();
+
+        PipelineStatisticsQueryPool(const PipelineStatisticsQueryPool&) = delete;
+        PipelineStatisticsQueryPool& operator=(const PipelineStatisticsQueryPool&) = delete;
+        PipelineStatisticsQueryPool(PipelineStatisticsQueryPool&&) = delete;
+        PipelineStatisticsQueryPool& operator=(PipelineStatisticsQueryPool&&) = delete;
+
+        // Must be recorded outside of a render pass
+        void Reset(VkCommandBuffer commandBuffer, uint32_t query);
+        void Begin(VkCommandBuffer commandBuffer, uint32_t query);
+        void End(VkCommandBuffer commandBuffer, uint32_t query);
+
+        /**
+         * Reads back a finished query without waiting on the GPU.
+         *
+         * @param results Receives one counter per enabled statistic, in the order of the flag bits
+         *
+         * @return false if the query was never recorded or its results are not available yet
+         */
+        bool GetResults(uint32_t query, std::vector<uint64_t>& results) const;
+
+    private:
+        Device& m_Device;
+        VkQueryPool m_QueryPool{};
+        uint32_t m_StatisticCount{};
+        std::vector<bool> m_HasBeenRecorded{};
+    };
+}
@@ -0,0 +1,91 @@
+﻿#include "RenderQueue.h"
+
+#include <array>
+#include <bit>
+
+namespace ili
+{
+    namespace
+    {
+        constexpr uint64_t DEPTH_BITS = 24;
+        constexpr uint64_t MESH_BITS = 16;
+        constexpr uint64_t MATERIAL_BITS = 16;
+        constexpr uint64_t PIPELINE_BITS = 8;
+
+        constexpr uint64_t Mask(uint64_t bits) { return (uint64_t{ 1 } << bits) - 1; }
+    }
+
+    uint32_t RenderQueue::QuantizeDepth(float viewDepth)
+    {
+        // Positive IEEE floats compare the same as their bit patterns, so the top 24 bits
+        // give a logarithmic quantization without needing the camera range
+        if (!(viewDepth > 0.f)) return 0;
+
+        return std::bit_cast<uint32_t>(viewDepth) >> (32 - DEPTH_BITS);
+    }
+
+    uint64_t RenderQueue::MakeOpaqueKey(uint32_t pipelineId, uint32_t materialId, uint32_t meshId, float viewDepth)
+    {
+        uint64_t key = pipelineId & Mask(PIPELINE_BITS);
+        key = (key << MATERIAL_BITS) | (materialId & Mask(MATERIAL_BITS));
+        key = (key << MESH_BITS) | (meshId & Mask(MESH_BITS));
+        key = (key << DEPTH_BITS) | QuantizeDepth(viewDepth);
+        return key;
+    }
+
+    uint64_t RenderQueue::MakeBlendedKey(uint32_t pipelineId, uint32_t materialId, uint32_t meshId, float viewDepth)
+    {
+        // Inverted so that the furthest draw gets the smallest key
+        uint64_t key = Mask(DEPTH_BITS) - QuantizeDepth(viewDepth);
+        key = (key << PIPELINE_BITS) | (pipelineId & Mask(PIPELINE_BITS));
+        key = (key << MATERIAL_BITS) | (materialId & Mask(MATERIAL_BITS));
+        key = (key << MESH_BITS) | (meshId & Mask(MESH_BITS));
+        return key;
+    }
+
+    void RenderQueue::Clear()
+    {
+        m_Packets.clear();
+    }
+
+    void RenderQueue::Sort()
+    {
+        const size_t count = m_Packets.size();
+        if (count < 2) return;
+
+        m_SortScratch.resize(count);
+
+        // Histograms for all 8 digits in a single pass over the keys
+        std::array<std::array<uint32_t, 256>, 8> histograms{};
+        for (const auto& packet : m_Packets)
+        {
+            for (size_t digit{}; digit < 8; ++digit)
+            {
+                ++histograms[digit][(packet.sortKey >> (digit * 8)) & 0xFF];
+            }
+        }
+
+        for (size_t digit{}; digit < 8; ++digit)
+        {
+            auto& histogram = histograms[digit];
+
+            // Every key has the same value for this digit (e.g. unused pipeline bits), the pass would not move anything
+            if (histogram[(m_Packets[0].sortKey >> (digit * 8)) & 0xFF] == count) continue;
+
+            uint32_t offset{};
+            for (auto& bucket : histogram)
+            {
+                const uint32_t bucketCount = bucket;
+                bucket = offset;
+                offset += bucketCount;
+            }
+
+            for (const auto& packet : m_Packets)
+            {
+                m_SortScratch[histogram[(packet.sortKey >> (digit * 8)) & 0xFF]++] = packet;
+            }
+
+            m_Packets.swap(m_SortScratch);
+        }
+    }
+}
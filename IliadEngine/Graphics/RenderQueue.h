@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ili
+{
+    class Pipeline;
+    class Model;
+    struct ModelInstance;
+    struct MaterialTextures;
+
+    // Points into the ModelList the queue was filled from, which has to outlive the submission
+    struct DrawPacket
+    {
+        uint64_t sortKey{};
+        const ModelInstance* pInstance{};
+        Pipeline* pPipeline{};
+        Model* pModel{};
+        const MaterialTextures* pMaterial{};
+    };
+
+    /**
+     * Per-frame list of draws that gets sorted on a packed 64-bit key before submission.
+     *
+     * Opaque key:  | pipeline 8 | material 16 | mesh 16 | view depth 24 |   (state first, then front-to-back)
+     * Blended key: | inverted view depth 24 | pipeline 8 | material 16 | mesh 16 |   (back-to-front first)
+     *
+     * Ids are truncated to their field width. Two different objects sharing a truncated id only end up
+     * less well grouped, submission always compares the real objects before skipping a bind.
+     */
+    class RenderQueue final
+    {
+    public:
+        RenderQueue() = default;
+        ~RenderQueue() = default;
+
+        RenderQueue(const RenderQueue&) = delete;
+        RenderQueue& operator=(const RenderQueue&) = delete;
+        RenderQueue(RenderQueue&&) = delete;
+        RenderQueue& operator=(RenderQueue&&) = delete;
+
+        static uint64_t MakeOpaqueKey(uint32_t pipelineId, uint32_t materialId, uint32_t meshId, float viewDepth);
+        static uint64_t MakeBlendedKey(uint32_t pipelineId, uint32_t materialId, uint32_t meshId, float viewDepth);
+
+        // Keeps the allocated memory, the queue is meant to be refilled every frame
+        void Clear();
+        void Add(const DrawPacket& packet) { m_Packets.push_back(packet); }
+
+        // Stable LSD radix sort on the sort keys, 8 bits per pass
+        void Sort();
+
+        const std::vector<DrawPacket>& GetPackets() const { return m_Packets; }
+        size_t GetSize() const { return m_Packets.size(); }
+
+    private:
+        // Maps a view depth onto 24 bits, preserving order for all non-negative depths
+        static uint32_t QuantizeDepth(float viewDepth);
+
+        std::vector<DrawPacket> m_Packets{};
+        std::vector<DrawPacket> m_SortScratch{};
+    };
+}
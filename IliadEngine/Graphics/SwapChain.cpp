@@ -1,10 +1,15 @@
 ﻿#include "SwapChain.h"
 
 #include <array>
+#include <cassert>
 #include <iostream>
 #include <limits>
 #include <set>
 #include <stdexcept>
+#include <utility>
+
+#include "Buffer.h"
+#include "Core/CpuProfiler.h"
 
 // This is because some header is including minwindef.h which is causing a conflict with the max and min macros
 #undef max
@@ -38,17 +43,27 @@ namespace ili
             m_SwapChain = VK_NULL_HANDLE;
         }
 
+        for (size_t i = 0; i < m_HeadlessImageMemorys.size(); i++) {
+            vkDestroyImage(m_Device.GetDevice(), m_SwapChainImages[i], nullptr);
+            m_Device.FreeMemory(m_HeadlessImageMemorys[i]);
+        }
+
         for (size_t i = 0; i < m_DepthImages.size(); i++) {
             vkDestroyImageView(m_Device.GetDevice(), m_DepthImageViews[i], nullptr);
             vkDestroyImage(m_Device.GetDevice(), m_DepthImages[i], nullptr);
-            vkFreeMemory(m_Device.GetDevice(), m_DepthImageMemorys[i], nullptr);
+            m_Device.FreeMemory(m_DepthImageMemorys[i]);
         }
 
         for (const auto framebuffer : m_SwapChainFramebuffers) {
             vkDestroyFramebuffer(m_Device.GetDevice(), framebuffer, nullptr);
         }
+        for (const auto framebuffer : m_OverlayFramebuffers) {
+            vkDestroyFramebuffer(m_Device.GetDevice(), framebuffer, nullptr);
+        }
 
         vkDestroyRenderPass(m_Device.GetDevice(), m_RenderPass, nullptr);
+        vkDestroyRenderPass(m_Device.GetDevice(), m_ResumeRenderPass, nullptr);
+        vkDestroyRenderPass(m_Device.GetDevice(), m_OverlayRenderPass, nullptr);
 
         // Cleanup synchronization objects
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
@@ -71,6 +86,8 @@ namespace ili
 
     VkResult SwapChain::AcquireNextImage(uint32_t* p_imageIndex)
     {
+        ILIAD_PROFILE_SCOPE("SwapChain::AcquireNextImage");
+
         vkWaitForFences(
             m_Device.GetDevice(),
             1,
@@ -79,6 +96,13 @@ namespace ili
             std::numeric_limits<uint32_t>::max()
         );
 
+        // Nothing to wait for, the fence above already covers the last use of the image
+        if (m_Device.IsHeadless()) {
+            *p_imageIndex = m_NextHeadlessImage;
+            m_NextHeadlessImage = (m_NextHeadlessImage + 1) % static_cast<uint32_t>(ImageCount());
+            return VK_SUCCESS;
+        }
+
         VkResult result = vkAcquireNextImageKHR(
             m_Device.GetDevice(),
             m_SwapChain,
@@ -93,6 +117,8 @@ namespace ili
 
     VkResult SwapChain::SubmitCommandBuffers(const VkCommandBuffer* p_buffers, uint32_t* p_imageIndex)
     {
+        ILIAD_PROFILE_SCOPE("SwapChain::SubmitCommandBuffers");
+
         if (m_ImagesInFlight[*p_imageIndex] != VK_NULL_HANDLE) {
             vkWaitForFences(m_Device.GetDevice(), 1, &m_ImagesInFlight[*p_imageIndex], VK_TRUE, UINT64_MAX);
         }
@@ -101,9 +127,12 @@ namespace ili
         VkSubmitInfo submitInfo = {};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+        // Headless images are neither acquired nor presented, so there are no semaphores to wait on or signal
+        const bool isHeadless = m_Device.IsHeadless();
+
         VkSemaphore waitSemaphores[] = { m_ImageAvailableSemaphores[m_CurrentFrame] };
         VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.waitSemaphoreCount = isHeadless ? 0 : 1;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
 
@@ -111,15 +140,21 @@ namespace ili
         submitInfo.pCommandBuffers = p_buffers;
 
         VkSemaphore signalSemaphores[] = { m_RenderFinishedSemaphores[m_CurrentFrame] };
-        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.signalSemaphoreCount = isHeadless ? 0 : 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
         vkResetFences(m_Device.GetDevice(), 1, &m_InFlightFences[m_CurrentFrame]);
+        std::unique_lock queueLock{ m_Device.GetQueueMutex() };
         if (vkQueueSubmit(m_Device.GetGraphicsQueue(), 1, &submitInfo, m_InFlightFences[m_CurrentFrame]) !=
             VK_SUCCESS) {
             throw std::runtime_error("Failed to submit draw command buffer!");
         }
 
+        if (isHeadless) {
+            m_CurrentFrame = (m_CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+            return VK_SUCCESS;
+        }
+
         VkPresentInfoKHR presentInfo = {};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -133,6 +168,7 @@ namespace ili
         presentInfo.pImageIndices = p_imageIndex;
 
         auto result = vkQueuePresentKHR(m_Device.GetPresentQueue(), &presentInfo);
+        queueLock.unlock();
 
         m_CurrentFrame = (m_CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 
@@ -141,6 +177,11 @@ namespace ili
 
     void SwapChain::CreateSwapChain()
     {
+        if (m_Device.IsHeadless()) {
+            CreateHeadlessImages();
+            return;
+        }
+
         SwapChainSupportDetails swapChainSupport = m_Device.GetSwapChainSupport();
 
         VkSurfaceFormatKHR surfaceFormat = ChooseSwapSurfaceFormat(swapChainSupport.Formats);
@@ -164,6 +205,9 @@ namespace ili
         createInfo.imageArrayLayers = 1;
         createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
+        m_SupportsTransferDestination = (swapChainSupport.Capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0;
+        if (m_SupportsTransferDestination) createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
         QueueFamilyIndices indices = m_Device.FindPhysicalQueueFamilies();
         uint32_t queueFamilyIndices[] = { indices.GraphicsFamily, indices.PresentFamily };
 
@@ -203,6 +247,97 @@ namespace ili
         m_SwapChainExtent = extent;
     }
 
+    void SwapChain::CreateHeadlessImages()
+    {
+        // Same format as a typical window surface, so the pipelines and the output match the windowed game
+        m_SwapChainImageFormat = m_Device.FindSupportedFormat(
+            { VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_SRGB },
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT);
+        m_SwapChainExtent = m_WindowExtent;
+        m_SupportsTransferDestination = true;
+
+        m_SwapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+        m_HeadlessImageMemorys.resize(MAX_FRAMES_IN_FLIGHT);
+        for (size_t i = 0; i < m_SwapChainImages.size(); i++) {
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent.width = m_SwapChainExtent.width;
+            imageInfo.extent.height = m_SwapChainExtent.height;
+            imageInfo.extent.depth = 1;
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.format = m_SwapChainImageFormat;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            m_Device.CreateImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_SwapChainImages[i], m_HeadlessImageMemorys[i]);
+        }
+    }
+
+    void SwapChain::ReadImage(int index, std::vector<uint8_t>& pixels) const
+    {
+        assert(m_Device.IsHeadless() && "Presentable images cannot be read back");
+
+        // The frame that wrote the image may still be in flight
+        vkDeviceWaitIdle(m_Device.GetDevice());
+
+        const uint32_t pixelCount = m_SwapChainExtent.width * m_SwapChainExtent.height;
+        Buffer stagingBuffer{ m_Device, 4, pixelCount, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+
+        const VkCommandBuffer commandBuffer = m_Device.BeginSingleTimeCommands();
+
+        // The layout stays the same, the barrier only makes the writes of the frame visible to the copy
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.oldLayout = GetFinalLayout();
+        barrier.newLayout = GetFinalLayout();
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = m_SwapChainImages[index];
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.imageExtent = { m_SwapChainExtent.width, m_SwapChainExtent.height, 1 };
+        vkCmdCopyImageToBuffer(commandBuffer, m_SwapChainImages[index], GetFinalLayout(), stagingBuffer.GetBuffer(), 1, &region);
+
+        VkBufferMemoryBarrier bufferBarrier{};
+        bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.buffer = stagingBuffer.GetBuffer();
+        bufferBarrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+            0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+        m_Device.EndSingleTimeCommands(commandBuffer);
+
+        if (stagingBuffer.Map() != VK_SUCCESS) {
+            throw std::runtime_error("Failed to map the read back buffer!");
+        }
+
+        const auto* pSource = static_cast<const uint8_t*>(stagingBuffer.GetMappedMemory());
+        pixels.assign(pSource, pSource + static_cast<size_t>(pixelCount) * 4);
+
+        if (m_SwapChainImageFormat == VK_FORMAT_B8G8R8A8_SRGB) {
+            for (size_t i = 0; i < pixels.size(); i += 4) {
+                std::swap(pixels[i], pixels[i + 2]);
+            }
+        }
+    }
+
     void SwapChain::CreateImageViews()
     {
         m_SwapChainImageViews.resize(m_SwapChainImages.size());
@@ -231,7 +366,8 @@ namespace ili
         depthAttachment.format = FindDepthFormat();
         depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
         depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        // Stored for the depth pyramid of the occlusion culling and for the resume pass
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -249,7 +385,7 @@ namespace ili
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachment.finalLayout = GetFinalLayout();
 
         VkAttachmentReference colorAttachmentRef = {};
         colorAttachmentRef.attachment = 0;
@@ -282,6 +418,49 @@ namespace ili
         if (vkCreateRenderPass(m_Device.GetDevice(), &renderPassInfo, nullptr, &m_RenderPass) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create render pass!");
         }
+
+        // Same attachments, picking up where the first pass left them
+        attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        attachments[0].initialLayout = GetFinalLayout();
+        attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkSubpassDependency resumeDependency = {};
+        resumeDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        resumeDependency.dstSubpass = 0;
+        resumeDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        resumeDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        resumeDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        resumeDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        renderPassInfo.pDependencies = &resumeDependency;
+
+        if (vkCreateRenderPass(m_Device.GetDevice(), &renderPassInfo, nullptr, &m_ResumeRenderPass) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create resume render pass!");
+        }
+
+        // Only the color attachment, drawn over whatever wrote the image before: a render pass or the dynamic resolution blit
+        VkSubpassDescription overlaySubpass = {};
+        overlaySubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        overlaySubpass.colorAttachmentCount = 1;
+        overlaySubpass.pColorAttachments = &colorAttachmentRef;
+
+        VkSubpassDependency overlayDependency = {};
+        overlayDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        overlayDependency.dstSubpass = 0;
+        overlayDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+        overlayDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        overlayDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        overlayDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+        renderPassInfo.attachmentCount = 1;
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.pSubpasses = &overlaySubpass;
+        renderPassInfo.pDependencies = &overlayDependency;
+
+        if (vkCreateRenderPass(m_Device.GetDevice(), &renderPassInfo, nullptr, &m_OverlayRenderPass) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create overlay render pass!");
+        }
     }
 
     void SwapChain::CreateFramebuffers()
@@ -308,6 +487,22 @@ namespace ili
                 throw std::runtime_error("Failed to create framebuffer!");
             }
         }
+
+        m_OverlayFramebuffers.resize(ImageCount());
+        for (size_t i = 0; i < ImageCount(); i++) {
+            VkFramebufferCreateInfo framebufferInfo = {};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = m_OverlayRenderPass;
+            framebufferInfo.attachmentCount = 1;
+            framebufferInfo.pAttachments = &m_SwapChainImageViews[i];
+            framebufferInfo.width = m_SwapChainExtent.width;
+            framebufferInfo.height = m_SwapChainExtent.height;
+            framebufferInfo.layers = 1;
+
+            if (vkCreateFramebuffer(m_Device.GetDevice(), &framebufferInfo, nullptr, &m_OverlayFramebuffers[i]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create overlay framebuffer!");
+            }
+        }
     }
 
     void SwapChain::CreateDepthResources()
@@ -332,7 +527,8 @@ namespace ili
             imageInfo.format = depthFormat;
             imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
             imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+            // The deferred lighting subpass reads depth back as an input attachment, the depth pyramid samples it
+            imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
             imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
             imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
             imageInfo.flags = 0;
@@ -449,7 +645,8 @@ namespace ili
         return m_Device.FindSupportedFormat(
             { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
             VK_IMAGE_TILING_OPTIMAL,
-            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+            // The depth pyramid samples the depth image
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
         );
     }
 
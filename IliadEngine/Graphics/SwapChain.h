@@ -3,11 +3,16 @@
 #include "Device.h"
 
 #include <vulkan/vulkan.h>
+#include <cstdint>
 #include <vector>
 
 namespace ili
 {
 
+    /**
+     * Presentable images of the window. On a headless device there is no surface, the swap chain then owns
+     * plain offscreen images of the requested extent instead, which are handed out in turn and never presented
+     */
     class SwapChain {
     public:
         static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
@@ -23,8 +28,18 @@ namespace ili
         VkFramebuffer GetFrameBuffer(int index) const { return m_SwapChainFramebuffers[index]; }
 
         VkRenderPass GetRenderPass() const { return m_RenderPass; }
-
+        // Compatible with GetRenderPass but loads color and depth instead of clearing them,
+        // for continuing the frame after work that has to run outside of a render pass
+        VkRenderPass GetResumeRenderPass() const { return m_ResumeRenderPass; }
+        // Color only, loads the finished image and leaves it ready for presentation. Used to draw overlays on top of the frame
+        VkRenderPass GetOverlayRenderPass() const { return m_OverlayRenderPass; }
+        VkFramebuffer GetOverlayFrameBuffer(int index) const { return m_OverlayFramebuffers[index]; }
+
+        VkImage GetImage(int index) const { return m_SwapChainImages[index]; }
         VkImageView GetImageView(int index) const { return m_SwapChainImageViews[index]; }
+        VkImageView GetDepthImageView(int index) const { return m_DepthImageViews[index]; }
+        VkImage GetDepthImage(int index) const { return m_DepthImages[index]; }
+        VkFormat GetDepthFormat() const { return m_SwapChainDepthFormat; }
 
         size_t ImageCount() const { return m_SwapChainImages.size(); }
         
@@ -33,6 +48,13 @@ namespace ili
 
         VkFormat GetSwapChainImageFormat() const { return m_SwapChainImageFormat; }
         VkExtent2D GetSwapChainExtent() const { return m_SwapChainExtent; }
+        // Whether the images can be the destination of a blit, e.g. to upscale an offscreen render target
+        bool SupportsTransferDestination() const { return m_SupportsTransferDestination; }
+        // Layout every pass writing the images has to leave them in, ready to present or, when headless, to be read back
+        VkImageLayout GetFinalLayout() const { return m_Device.IsHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; }
+
+        // Copies a finished image into tightly packed RGBA8 pixels. Waits for the device to go idle, headless only
+        void ReadImage(int index, std::vector<uint8_t>& pixels) const;
 
 
         float ExtentAspectRatio() const { return static_cast<float>(m_SwapChainExtent.width) / static_cast<float>(m_SwapChainExtent.height); }
@@ -48,6 +70,7 @@ namespace ili
 
     private:
         void CreateSwapChain();
+        void CreateHeadlessImages();
         void CreateImageViews();
         void CreateDepthResources();
         void CreateRenderPass();
@@ -65,15 +88,22 @@ namespace ili
         VkFormat m_SwapChainDepthFormat{};
 
         VkExtent2D m_SwapChainExtent{};
+        bool m_SupportsTransferDestination{};
 
         std::vector<VkFramebuffer> m_SwapChainFramebuffers{};
         VkRenderPass m_RenderPass{};
+        VkRenderPass m_ResumeRenderPass{};
+        VkRenderPass m_OverlayRenderPass{};
+        std::vector<VkFramebuffer> m_OverlayFramebuffers{};
 
         std::vector<VkImage> m_DepthImages{};
         std::vector<VkDeviceMemory> m_DepthImageMemorys{};
         std::vector<VkImageView> m_DepthImageViews{};
         std::vector<VkImage> m_SwapChainImages{};
         std::vector<VkImageView> m_SwapChainImageViews{};
+        // Only owned by the headless swap chain, the presentable images belong to the VkSwapchainKHR
+        std::vector<VkDeviceMemory> m_HeadlessImageMemorys{};
+        uint32_t m_NextHeadlessImage{};
 
         ili::Device& m_Device;
         VkExtent2D m_WindowExtent{};
@@ -142,7 +142,7 @@ namespace ili
         vkDestroySampler(m_Device.GetDevice(), m_pTextureSampler, nullptr);
         vkDestroyImageView(m_Device.GetDevice(), m_pTextureImageView, nullptr);
         vkDestroyImage(m_Device.GetDevice(), m_pTextureImage, nullptr);
-        vkFreeMemory(m_Device.GetDevice(), m_pTextureImageMemory, nullptr);
+        m_Device.FreeMemory(m_pTextureImageMemory);
     }
 
     std::unique_ptr<Texture> Texture::CreateTextureFromFile(
@@ -206,7 +206,7 @@ namespace ili
 
         // Clean up staging resources
         vkDestroyBuffer(m_Device.GetDevice(), stagingBuffer, nullptr);
-        vkFreeMemory(m_Device.GetDevice(), stagingBufferMemory, nullptr);
+        m_Device.FreeMemory(stagingBufferMemory);
     }
 
     void Texture::CreateTextureImage(const std::string& filepath)
@@ -292,7 +292,7 @@ namespace ili
         m_TextureLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
         vkDestroyBuffer(m_Device.GetDevice(), stagingBuffer, nullptr);
-        vkFreeMemory(m_Device.GetDevice(), stagingBufferMemory, nullptr);
+        m_Device.FreeMemory(stagingBufferMemory);
     }
 
     void Texture::CreateTextureImageView(VkImageViewType viewType)
@@ -6,6 +6,8 @@
 #include <cassert>
 #include <stdexcept>
 
+#include "Core/OcclusionCullingSystem.h"
+#include "Core/SoftwareOcclusionCuller.h"
 #include "SceneGraph/ModelComponent.h"
 
 namespace ili 
@@ -17,14 +19,11 @@ namespace ili
     };
 
     TextureRenderSystem::TextureRenderSystem(
-        Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
-        : m_Device{ device } {
+        Device& device, PipelineRegistry& pipelineRegistry, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+        : m_Device{ device }, m_PipelineRegistry{ pipelineRegistry } {
         CreatePipelineLayout(globalSetLayout);
         CreatePipeline(renderPass);
     }
-    TextureRenderSystem::~TextureRenderSystem() {
-        vkDestroyPipelineLayout(m_Device.GetDevice(), m_PipelineLayout, nullptr);
-    }
     void TextureRenderSystem::CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout) 
     {
         VkPushConstantRange pushConstantRange{};
@@ -32,31 +31,21 @@ namespace ili
         pushConstantRange.offset = 0;
         pushConstantRange.size = sizeof(TexturePushConstantData);
 
-        // Update the descriptor set layout
-        m_RenderSystemLayout = DescriptorSetLayout::Builder(m_Device)
+        // Same bindings as the G-buffer materials, so both systems share the layout from the registry
+        m_pMaterialSetLayout = &m_PipelineRegistry.GetDescriptorSetLayout(DescriptorSetLayout::Builder(m_Device)
             .AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // Albedo Map
             .AddBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // Normal Map
             .AddBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // Metallic Map
             .AddBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // Roughness Map
-            .AddBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // AO Map (Optional)
-            .Build();
+            .AddBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)); // AO Map (Optional)
 
         std::vector<VkDescriptorSetLayout> descriptorSetLayouts
         {
             globalSetLayout,
-            m_RenderSystemLayout->GetDescriptorSetLayout()
+            m_pMaterialSetLayout->GetDescriptorSetLayout()
         };
 
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-        pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-        if (vkCreatePipelineLayout(m_Device.GetDevice(), &pipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create pipeline layout!");
-        }
+        m_PipelineLayout = m_PipelineRegistry.GetPipelineLayout(descriptorSetLayouts, { pushConstantRange });
     }
     void TextureRenderSystem::CreatePipeline(VkRenderPass renderPass) 
     {
@@ -65,17 +54,50 @@ namespace ili
         Pipeline::GetDefaultPipelineConfigInfo(pipelineConfig);
         pipelineConfig.renderPass = renderPass;
         pipelineConfig.pipelineLayout = m_PipelineLayout;
-        m_pPipeline = std::make_unique<Pipeline>(
-            m_Device,
+        m_pPipeline = m_PipelineRegistry.GetPipeline(
+            "Assets/CompiledShaders/texture_shader.vert.spv",
+            "Assets/CompiledShaders/texture_shader.frag.spv",
+            pipelineConfig);
+
+        // Variant used after the depth pre-pass, only the visible surface gets shaded
+        pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+        pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+        m_pDepthEqualPipeline = m_PipelineRegistry.GetPipeline(
             "Assets/CompiledShaders/texture_shader.vert.spv",
             "Assets/CompiledShaders/texture_shader.frag.spv",
             pipelineConfig);
     }
 
     void TextureRenderSystem::RenderGameObjects(
-        const FrameInfo& frameInfo, const std::vector<std::unique_ptr<GameObject>>& gameObjects)
+        const FrameInfo& frameInfo, const ModelList& models)
     {
-        m_pPipeline->Bind(frameInfo.commandBuffer);
+        m_RenderQueue.Clear();
+
+        Pipeline* pPipeline = frameInfo.depthPrePass ? m_pDepthEqualPipeline : m_pPipeline;
+        const glm::mat4& view = frameInfo.camera.GetView();
+
+        for (const ModelInstance& instance : models)
+        {
+			const bool canRender = instance.pModel && instance.pMaterial;
+
+            if (!canRender) continue;
+
+            Model* pModel = instance.pModel.get();
+            const MaterialTextures* pMaterial = instance.pMaterial.get();
+            if (frameInfo.pSoftwareOcclusion &&
+                !frameInfo.pSoftwareOcclusion->IsVisible(pModel->GetBoundingSphere().GetTransformed(instance.modelMatrix), m_Stats)) continue;
+
+            const float viewDepth = (view * instance.modelMatrix[3]).z;
+
+            m_RenderQueue.Add({
+                RenderQueue::MakeOpaqueKey(pPipeline->GetId(), pMaterial->materialId, pModel->GetId(), viewDepth),
+                &instance, pPipeline, pModel, pMaterial });
+        }
+
+        if (m_RenderQueue.GetSize() == 0) return;
+
+        m_RenderQueue.Sort();
+
         vkCmdBindDescriptorSets(
             frameInfo.commandBuffer,
             VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -85,50 +107,59 @@ namespace ili
             &frameInfo.globalDescriptorSet,
             0,
             nullptr);
+        ++m_Stats.descriptorSetBinds;
 
-        for (const auto& gameObject : gameObjects)
+        const Pipeline* pBoundPipeline{};
+        const MaterialTextures* pBoundMaterial{};
+        const Model* pBoundModel{};
+        for (const auto& packet : m_RenderQueue.GetPackets())
         {
-            const auto modelComponent = gameObject->GetComponent<ModelComponent>();
-
-			const bool canRender = modelComponent && modelComponent->GetModel() && modelComponent->GetMaterial();
-
-            if (!canRender) continue;
-
-            const auto material = modelComponent->GetMaterial();
-            // Retrieve the image infos for all textures
-            VkDescriptorImageInfo albedoImageInfo = material->GetAlbedoMap()->GetImageInfo();
-            VkDescriptorImageInfo normalImageInfo = material->GetNormalMap()->GetImageInfo();
-            VkDescriptorImageInfo metallicImageInfo = material->GetMetallicMap()->GetImageInfo();
-            VkDescriptorImageInfo roughnessImageInfo = material->GetRoughnessMap()->GetImageInfo();
-            VkDescriptorImageInfo aoImageInfo = material->GetAOMap()->GetImageInfo();
-
-            std::array<VkWriteDescriptorSet, 4> descriptorWrites{};
-
-            VkDescriptorSet descriptorSet1;
-            DescriptorWriter writer(*m_RenderSystemLayout, frameInfo.frameDescriptorPool);
-
-            writer.WriteImage(0, &albedoImageInfo);
-            writer.WriteImage(1, &normalImageInfo);
-            writer.WriteImage(2, &metallicImageInfo);
-            writer.WriteImage(3, &roughnessImageInfo);
-            writer.WriteImage(4, &aoImageInfo);
-
-            writer.Build(descriptorSet1);
-
-            vkCmdBindDescriptorSets(
-                frameInfo.commandBuffer,
-                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                m_PipelineLayout,
-                1,  // first set
-                1,  // set count
-                &descriptorSet1,
-                0,
-                nullptr);
+            if (packet.pPipeline != pBoundPipeline)
+            {
+                packet.pPipeline->Bind(frameInfo.commandBuffer);
+                pBoundPipeline = packet.pPipeline;
+                ++m_Stats.pipelineBinds;
+            }
+
+            // Draws are grouped by material, so one descriptor set is written per material instead of per object
+            if (packet.pMaterial != pBoundMaterial)
+            {
+                // Retrieve the image infos for all textures
+                VkDescriptorImageInfo albedoImageInfo = packet.pMaterial->albedoMap->GetImageInfo();
+                VkDescriptorImageInfo normalImageInfo = packet.pMaterial->normalMap->GetImageInfo();
+                VkDescriptorImageInfo metallicImageInfo = packet.pMaterial->metallicMap->GetImageInfo();
+                VkDescriptorImageInfo roughnessImageInfo = packet.pMaterial->roughnessMap->GetImageInfo();
+                VkDescriptorImageInfo aoImageInfo = packet.pMaterial->aoMap->GetImageInfo();
+
+                VkDescriptorSet materialDescriptorSet;
+                DescriptorWriter writer(*m_pMaterialSetLayout, frameInfo.frameDescriptorPool);
+
+                writer.WriteImage(0, &albedoImageInfo);
+                writer.WriteImage(1, &normalImageInfo);
+                writer.WriteImage(2, &metallicImageInfo);
+                writer.WriteImage(3, &roughnessImageInfo);
+                writer.WriteImage(4, &aoImageInfo);
+
+                writer.Build(materialDescriptorSet);
+
+                vkCmdBindDescriptorSets(
+                    frameInfo.commandBuffer,
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    m_PipelineLayout,
+                    1,  // first set
+                    1,  // set count
+                    &materialDescriptorSet,
+                    0,
+                    nullptr);
+
+                pBoundMaterial = packet.pMaterial;
+                ++m_Stats.descriptorSetBinds;
+            }
 
             // Push constants
             TexturePushConstantData push{};
-            push.modelMatrix = gameObject->GetTransform()->GetMatrix();
-            push.normalMatrix = gameObject->GetTransform()->GetNormalMatrix();
+            push.modelMatrix = packet.pInstance->modelMatrix;
+            push.normalMatrix = packet.pInstance->normalMatrix;
             vkCmdPushConstants(
                 frameInfo.commandBuffer,
                 m_PipelineLayout,
@@ -137,8 +168,20 @@ namespace ili
                 sizeof(TexturePushConstantData),
                 &push);
 
-            modelComponent->GetModel()->Bind(frameInfo.commandBuffer);
-            modelComponent->GetModel()->Draw(frameInfo.commandBuffer);
+            if (packet.pModel != pBoundModel)
+            {
+                packet.pModel->Bind(frameInfo.commandBuffer);
+                pBoundModel = packet.pModel;
+                ++m_Stats.meshBinds;
+            }
+
+            if (frameInfo.pOcclusionCulling)
+                frameInfo.pOcclusionCulling->Draw(frameInfo, *packet.pInstance);
+            else
+                packet.pModel->Draw(frameInfo.commandBuffer);
+            ++m_Stats.drawCalls;
+            ++m_Stats.instanceCount;
+            m_Stats.triangleCount += packet.pModel->GetTriangleCount();
         }
     }
 
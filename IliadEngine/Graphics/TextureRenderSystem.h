@@ -1,9 +1,13 @@
 ﻿#pragma once
 #include "SceneGraph/GameObject.h"
+#include "SceneGraph/ModelComponent.h"
 #include "Graphics/Descriptors.h"
 #include "Graphics/Device.h"
 #include "Graphics/Pipeline.h"
+#include "Graphics/PipelineRegistry.h"
+#include "Graphics/RenderQueue.h"
 #include "Structs/FrameInfo.h"
+#include "Structs/RenderStats.h"
 
 #include <memory>
 #include <vector>
@@ -13,17 +17,26 @@ namespace ili
     {
     public:
         TextureRenderSystem(
-            Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
-        ~TextureRenderSystem();
+            Device& device, PipelineRegistry& pipelineRegistry, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+        ~TextureRenderSystem() = default;
         TextureRenderSystem(const TextureRenderSystem&) = delete;
         TextureRenderSystem& operator=(const TextureRenderSystem&) = delete;
-        void RenderGameObjects(const FrameInfo& frameInfo, const std::vector<std::unique_ptr<GameObject>>& gameObjects);
+        void RenderGameObjects(const FrameInfo& frameInfo, const ModelList& models);
+
+        void ResetStats() { m_Stats = {}; }
+        const RenderStats& GetStats() const { return m_Stats; }
     private:
         void CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout);
         void CreatePipeline(VkRenderPass renderPass);
         Device& m_Device;
-        std::unique_ptr<Pipeline> m_pPipeline{};
+        PipelineRegistry& m_PipelineRegistry;
+        // All owned by the pipeline registry
+        Pipeline* m_pPipeline{};
+        Pipeline* m_pDepthEqualPipeline{};
         VkPipelineLayout m_PipelineLayout{};
-        std::unique_ptr<DescriptorSetLayout> m_RenderSystemLayout;
+        DescriptorSetLayout* m_pMaterialSetLayout{};
+
+        RenderQueue m_RenderQueue{};
+        RenderStats m_Stats{};
     };
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+﻿#include "TimestampQueryPool.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace ili
+{
+    TimestampQueryPool::TimestampQueryPool(Device& device, uint32_t queryCount)
+        : m_Device{ device },
+        m_Period{ device.Properties.limits.timestampPeriod },
+        m_HasBeenWritten(queryCount, false)
+    {
+        assert(IsSupported(device) && "Timestamp queries are not supported on this device");
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = queryCount;
+
+        if (vkCreateQueryPool(m_Device.GetDevice(), &poolInfo, nullptr, &m_QueryPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create timestamp query pool!");
+        }
+    }
+
+    TimestampQueryPool::~TimestampQueryPool()
+    {
+        vkDestroyQueryPool(m_Device.GetDevice(), m_QueryPool, nullptr);
+    }
+
+    void TimestampQueryPool::Reset(VkCommandBuffer commandBuffer, uint32_t firstQuery, uint32_t queryCount)
+    {
+        vkCmdResetQueryPool(commandBuffer, m_QueryPool, firstQuery, queryCount);
+    }
+
+    void TimestampQueryPool::WriteTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage, uint32_t query)
+    {
+        vkCmdWriteTimestamp(commandBuffer, stage, m_QueryPool, query);
+        m_HasBeenWritten[query] = true;
+    }
+
+    bool TimestampQueryPool::GetResults(uint32_t firstQuery, uint32_t queryCount, std::vector<uint64_t>& timestamps) const
+    {
+        for (uint32_t query = firstQuery; query < firstQuery + queryCount; ++query)
+        {
+            if (!m_HasBeenWritten[query]) return false;
+        }
+
+        // Every timestamp is followed by its availability word
+        std::vector<uint64_t> data(static_cast<size_t>(queryCount) * 2);
+        const VkDeviceSize stride = 2 * sizeof(uint64_t);
+
+        const VkResult result = vkGetQueryPoolResults(m_Device.GetDevice(), m_QueryPool, firstQuery, queryCount,
+            data.size() * sizeof(uint64_t), data.data(), stride, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+        if (result != VK_SUCCESS && result != VK_NOT_READY) return false;
+
+        timestamps.resize(queryCount);
+        for (uint32_t i{}; i < queryCount; ++i)
+        {
+            if (data[i * 2 + 1] == 0) return false;
+            timestamps[i] = data[i * 2];
+        }
+
+        return true;
+    }
+}
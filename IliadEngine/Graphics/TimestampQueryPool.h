@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include "Device.h"
+
+#include <vector>
+
+namespace ili
+{
+    /**
+     * Small wrapper around a VK_QUERY_TYPE_TIMESTAMP pool, the timestamp counterpart of PipelineStatisticsQueryPool.
+     * Results are read back without waiting, once the frame that wrote them has finished.
+     */
+    class TimestampQueryPool
+    {
+    public:
+        TimestampQueryPool(Device& device, uint32_t queryCount);
+        ~TimestampQueryPool();
+
+        TimestampQueryPool(const TimestampQueryPool&) = delete;
+        TimestampQueryPool& operator=(const TimestampQueryPool&) = delete;
+        TimestampQueryPool(TimestampQueryPool&&) = delete;
+        TimestampQueryPool& operator=(TimestampQueryPool&&) = delete;
+
+        // Graphics and compute queues of the device support timestamps
+        static bool IsSupported(const Device& device) { return device.Properties.limits.timestampComputeAndGraphics == VK_TRUE; }
+
+        // Must be recorded outside of a render pass
+        void Reset(VkCommandBuffer commandBuffer, uint32_t firstQuery, uint32_t queryCount);
+        void WriteTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage, uint32_t query);
+
+        /**
+         * Reads back consecutive finished queries without waiting on the GPU.
+         *
+         * @param timestamps Receives one raw timestamp per query, see GetPeriod
+         *
+         * @return false if any of the queries was never written or its result is not available yet
+         */
+        bool GetResults(uint32_t firstQuery, uint32_t queryCount, std::vector<uint64_t>& timestamps) const;
+
+        // Nanoseconds per timestamp tick
+        float GetPeriod() const { return m_Period; }
+        uint32_t GetQueryCount() const { return static_cast<uint32_t>(m_HasBeenWritten.size()); }
+
+    private:
+        Device& m_Device;
+        VkQueryPool m_QueryPool{};
+        float m_Period{};
+        std::vector<bool> m_HasBeenWritten{};
+    };
+}
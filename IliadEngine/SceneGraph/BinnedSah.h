@@ -0,0 +1,108 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+
+#include "Bounds.h"
+
+namespace ili
+{
+	/**
+	 * Split of a range of boxes for top-down tree builds with the surface area heuristic. The centroids are sorted into
+	 * BIN_COUNT bins along the axis they spread the most on and the planes between the bins are priced by sweeping
+	 * from both ends, which is much cheaper than sorting. The getters take an element of the range
+	 */
+	class BinnedSahSplit final
+	{
+	public:
+		static constexpr uint32_t BIN_COUNT = 16;
+
+		template <typename Iterator, typename GetCentroid, typename GetBounds>
+		BinnedSahSplit(Iterator first, Iterator last, const GetCentroid& getCentroid, const GetBounds& getBounds);
+
+		// False when every centroid is the same, then no plane separates them
+		bool IsValid() const { return m_BinScale > 0.f; }
+		// Surface area times element count, summed over both sides. Over the area of the parent it is the expected cost of the children
+		float GetCost() const { return m_Cost; }
+
+		// Moves the elements in front of the cheapest plane to the front and returns the first one behind it, both sides are
+		// never empty. Without a valid plane the range is split in half, elements that share a centroid end up on either side
+		template <typename Iterator, typename GetCentroid>
+		Iterator Partition(Iterator first, Iterator last, const GetCentroid& getCentroid) const;
+
+	private:
+		uint32_t GetBin(const glm::vec3& centroid) const
+		{
+			const uint32_t bin = static_cast<uint32_t>((centroid[m_Axis] - m_BinMin) * m_BinScale);
+			return std::min(bin, BIN_COUNT - 1);
+		}
+
+		int m_Axis{};
+		float m_BinMin{};
+		float m_BinScale{};
+		uint32_t m_BestBin{};
+		float m_Cost{ std::numeric_limits<float>::max() };
+	};
+
+	template <typename Iterator, typename GetCentroid, typename GetBounds>
+	BinnedSahSplit::BinnedSahSplit(Iterator first, Iterator last, const GetCentroid& getCentroid, const GetBounds& getBounds)
+	{
+		AABB centroidBounds = AABB::Empty();
+		for (Iterator it = first; it != last; ++it)
+		{
+			const glm::vec3 centroid = getCentroid(*it);
+			centroidBounds.min = glm::min(centroidBounds.min, centroid);
+			centroidBounds.max = glm::max(centroidBounds.max, centroid);
+		}
+
+		const glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+		m_Axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		if (!(extent[m_Axis] > 0.f)) return;
+
+		m_BinMin = centroidBounds.min[m_Axis];
+		m_BinScale = static_cast<float>(BIN_COUNT) / extent[m_Axis];
+
+		std::array<AABB, BIN_COUNT> binBounds{};
+		std::array<uint32_t, BIN_COUNT> binCounts{};
+		binBounds.fill(AABB::Empty());
+		for (Iterator it = first; it != last; ++it)
+		{
+			const uint32_t bin = GetBin(getCentroid(*it));
+			binBounds[bin] = binBounds[bin].GetMerged(getBounds(*it));
+			++binCounts[bin];
+		}
+
+		// Cost of splitting after each bin, both sides weighted by their element count
+		std::array<float, BIN_COUNT - 1> costs{};
+		AABB sweepBounds = AABB::Empty();
+		uint32_t sweepCount{};
+		for (uint32_t bin{}; bin < BIN_COUNT - 1; ++bin)
+		{
+			sweepBounds = sweepBounds.GetMerged(binBounds[bin]);
+			sweepCount += binCounts[bin];
+			costs[bin] = sweepCount > 0 ? sweepBounds.GetSurfaceArea() * static_cast<float>(sweepCount) : 0.f;
+		}
+		sweepBounds = AABB::Empty();
+		sweepCount = 0;
+		for (uint32_t bin = BIN_COUNT - 1; bin > 0; --bin)
+		{
+			sweepBounds = sweepBounds.GetMerged(binBounds[bin]);
+			sweepCount += binCounts[bin];
+			if (sweepCount > 0) costs[bin - 1] += sweepBounds.GetSurfaceArea() * static_cast<float>(sweepCount);
+		}
+
+		// The first and last bins always hold a centroid, so every plane has elements on both sides
+		m_BestBin = static_cast<uint32_t>(std::ranges::min_element(costs) - costs.begin());
+		m_Cost = costs[m_BestBin];
+	}
+
+	template <typename Iterator, typename GetCentroid>
+	Iterator BinnedSahSplit::Partition(Iterator first, Iterator last, const GetCentroid& getCentroid) const
+	{
+		if (!IsValid()) return first + (last - first) / 2;
+
+		return std::partition(first, last, [&](const auto& element) { return GetBin(getCentroid(element)) <= m_BestBin; });
+	}
+}
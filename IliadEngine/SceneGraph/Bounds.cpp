@@ -0,0 +1,128 @@
+﻿#include "Bounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ili
+{
+	namespace
+	{
+		Plane MakeNormalizedPlane(const glm::vec4& coefficients)
+		{
+			const float length = glm::length(glm::vec3(coefficients));
+			return Plane{ glm::vec3(coefficients) / length, coefficients.w / length };
+		}
+	}
+
+	Sphere Sphere::GetTransformed(const glm::mat4& matrix) const
+	{
+		const float maxScaleSquared = std::max({ glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+			glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1])), glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2])) });
+
+		return Sphere{ glm::vec3(matrix * glm::vec4(center, 1.f)), radius * std::sqrt(maxScaleSquared) };
+	}
+
+	float AABB::GetSurfaceArea() const
+	{
+		const glm::vec3 size = max - min;
+		return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	AABB AABB::GetTransformed(const glm::mat4& matrix) const
+	{
+		// Arvo's method, every axis of the matrix moves the box by the extents projected onto it
+		const glm::vec3 center = glm::vec3(matrix * glm::vec4(GetCenter(), 1.f));
+		const glm::vec3 extents = GetExtents();
+		const glm::vec3 transformedExtents = glm::abs(glm::vec3(matrix[0])) * extents.x +
+			glm::abs(glm::vec3(matrix[1])) * extents.y + glm::abs(glm::vec3(matrix[2])) * extents.z;
+
+		return AABB{ center - transformedExtents, center + transformedExtents };
+	}
+
+	bool AABB::Contains(const AABB& other) const
+	{
+		return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+	}
+
+	bool AABB::Intersects(const AABB& other) const
+	{
+		return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+	}
+
+	bool AABB::Intersects(const Sphere& sphere) const
+	{
+		const glm::vec3 closestPoint = glm::clamp(sphere.center, min, max);
+		const glm::vec3 offset = sphere.center - closestPoint;
+		return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+	}
+
+	bool Ray::IntersectsBox(const glm::vec3& origin, const glm::vec3& inverseDirection, const AABB& box, float maxDistance, float& entryDistance)
+	{
+		const glm::vec3 t0 = (box.min - origin) * inverseDirection;
+		const glm::vec3 t1 = (box.max - origin) * inverseDirection;
+		const glm::vec3 tNear = glm::min(t0, t1);
+		const glm::vec3 tFar = glm::max(t0, t1);
+
+		// A parallel axis gives 0 * inf = NaN for a ray on the slab border, std::min and std::max skip it
+		const float enter = std::max({ 0.f, tNear.x, tNear.y, tNear.z });
+		const float exit = std::min({ maxDistance, tFar.x, tFar.y, tFar.z });
+		if (enter > exit) return false;
+
+		entryDistance = enter;
+		return true;
+	}
+
+	Frustum::Frustum(const glm::mat4& viewProjection)
+	{
+		// Rows of the matrix, glm stores columns
+		const glm::vec4 row0{ viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0] };
+		const glm::vec4 row1{ viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1] };
+		const glm::vec4 row2{ viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2] };
+		const glm::vec4 row3{ viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3] };
+
+		// -w <= x, y <= w and 0 <= z <= w
+		m_Planes[Left] = MakeNormalizedPlane(row3 + row0);
+		m_Planes[Right] = MakeNormalizedPlane(row3 - row0);
+		m_Planes[Bottom] = MakeNormalizedPlane(row3 + row1);
+		m_Planes[Top] = MakeNormalizedPlane(row3 - row1);
+		m_Planes[Near] = MakeNormalizedPlane(row2);
+		m_Planes[Far] = MakeNormalizedPlane(row3 - row2);
+	}
+
+	bool Frustum::Intersects(const Sphere& sphere) const
+	{
+		for (const Plane& plane : m_Planes)
+		{
+			if (plane.GetSignedDistance(sphere.center) < -sphere.radius) return false;
+		}
+
+		return true;
+	}
+
+	bool Frustum::Intersects(const AABB& box) const
+	{
+		const glm::vec3 center = box.GetCenter();
+		const glm::vec3 extents = box.GetExtents();
+		for (const Plane& plane : m_Planes)
+		{
+			// The corner furthest along the normal is outside, so is the whole box
+			const float projectedRadius = glm::dot(extents, glm::abs(plane.normal));
+			if (plane.GetSignedDistance(center) < -projectedRadius) return false;
+		}
+
+		return true;
+	}
+
+	bool Frustum::Contains(const AABB& box) const
+	{
+		const glm::vec3 center = box.GetCenter();
+		const glm::vec3 extents = box.GetExtents();
+		for (const Plane& plane : m_Planes)
+		{
+			const float projectedRadius = glm::dot(extents, glm::abs(plane.normal));
+			if (plane.GetSignedDistance(center) < projectedRadius) return false;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,98 @@
+﻿#pragma once
+
+#include <array>
+#include <limits>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+namespace ili
+{
+	struct Sphere final
+	{
+		glm::vec3 center{};
+		float radius{};
+
+		// Encloses the sphere after the transform, non-uniform scales grow the radius by the largest axis scale
+		Sphere GetTransformed(const glm::mat4& matrix) const;
+	};
+
+	// Axis aligned, min is never above max except for Empty()
+	struct AABB final
+	{
+		glm::vec3 min{};
+		glm::vec3 max{};
+
+		// Inside out, merging a box into it gives that box
+		static AABB Empty() { return AABB{ glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest()) }; }
+		static AABB FromSphere(const Sphere& sphere) { return AABB{ sphere.center - sphere.radius, sphere.center + sphere.radius }; }
+
+		glm::vec3 GetCenter() const { return (min + max) * .5f; }
+		glm::vec3 GetExtents() const { return (max - min) * .5f; }
+		float GetSurfaceArea() const;
+		// Encloses both boxes
+		AABB GetMerged(const AABB& other) const { return AABB{ glm::min(min, other.min), glm::max(max, other.max) }; }
+		// Encloses the box after the transform
+		AABB GetTransformed(const glm::mat4& matrix) const;
+
+		bool Contains(const AABB& other) const;
+		bool Intersects(const AABB& other) const;
+		bool Intersects(const Sphere& sphere) const;
+	};
+
+	// Starts at the origin, the direction does not have to be normalized, distances along it are in multiples of its length
+	struct Ray final
+	{
+		glm::vec3 origin{};
+		glm::vec3 direction{ 0.f, 0.f, 1.f };
+
+		glm::vec3 GetPoint(float distance) const { return origin + direction * distance; }
+		// Componentwise 1 / direction, what IntersectsBox expects, axes the ray is parallel to give infinity
+		glm::vec3 GetInverseDirection() const { return 1.f / direction; }
+
+		// Slab test, sets the distance where the ray enters the box, zero when it starts inside
+		static bool IntersectsBox(const glm::vec3& origin, const glm::vec3& inverseDirection, const AABB& box, float maxDistance, float& entryDistance);
+	};
+
+	// Points with a positive signed distance lie on the side the normal points to
+	struct Plane final
+	{
+		glm::vec3 normal{ 0.f, 1.f, 0.f };
+		float distance{};
+
+		float GetSignedDistance(const glm::vec3& point) const { return glm::dot(normal, point) + distance; }
+	};
+
+	// The six planes of a view volume, all facing inwards
+	class Frustum final
+	{
+	public:
+		enum PlaneIndex
+		{
+			Left = 0,
+			Right,
+			Bottom,
+			Top,
+			Near,
+			Far,
+			PlaneCount
+		};
+
+		Frustum() = default;
+		// Extracts the planes from a (projection * view) matrix with a 0..1 depth range, giving world space planes
+		explicit Frustum(const glm::mat4& viewProjection);
+
+		// Conservative, spheres near a corner outside of the frustum can still pass
+		bool Intersects(const Sphere& sphere) const;
+		// Exact for every plane on its own, boxes outside of a corner can still pass
+		bool Intersects(const AABB& box) const;
+		// The box lies inside of all six planes
+		bool Contains(const AABB& box) const;
+
+		const Plane& GetPlane(PlaneIndex index) const { return m_Planes[index]; }
+
+	private:
+		std::array<Plane, PlaneCount> m_Planes{};
+	};
+}
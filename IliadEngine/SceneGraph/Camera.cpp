@@ -13,6 +13,9 @@ namespace ili
 		m_ProjectionMatrix[3][0] = -(right + left) / (right - left);
 		m_ProjectionMatrix[3][1] = -(top + bottom) / (top - bottom);
 		m_ProjectionMatrix[3][2] = -near / (far - near);
+
+		m_NearPlane = near;
+		m_FarPlane = far;
 	}
 
 	void Camera::SetPerspectiveProjection(float fov, float aspect, float near, float far)
@@ -26,6 +29,9 @@ namespace ili
 		m_ProjectionMatrix[2][2] = far / (far - near);
 		m_ProjectionMatrix[2][3] = 1.f;
 		m_ProjectionMatrix[3][2] = -(far * near) / (far - near);
+
+		m_NearPlane = near;
+		m_FarPlane = far;
 	}
 
 	void Camera::SetViewDirection(const glm::vec3& cameraPosition, const glm::vec3& cameraDirection, const glm::vec3& up)
@@ -111,4 +117,16 @@ namespace ili
 		m_InverseViewMatrix[3][1] = position.y;
 		m_InverseViewMatrix[3][2] = position.z;
 	}
+
+	Ray Camera::GetRay(const glm::vec2& normalizedDeviceCoordinates) const
+	{
+		// Points on the near and far plane in view space, then into the world
+		const glm::mat4 inverseProjection = glm::inverse(m_ProjectionMatrix);
+		const glm::vec4 nearPoint = inverseProjection * glm::vec4{ normalizedDeviceCoordinates, 0.f, 1.f };
+		const glm::vec4 farPoint = inverseProjection * glm::vec4{ normalizedDeviceCoordinates, 1.f, 1.f };
+
+		const glm::vec3 origin{ m_InverseViewMatrix * glm::vec4{ glm::vec3{ nearPoint } / nearPoint.w, 1.f } };
+		const glm::vec3 target{ m_InverseViewMatrix * glm::vec4{ glm::vec3{ farPoint } / farPoint.w, 1.f } };
+		return Ray{ origin, glm::normalize(target - origin) };
+	}
 }
\ No newline at end of file
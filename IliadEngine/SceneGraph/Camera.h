@@ -6,6 +6,8 @@
 
 #include "glm/ext/matrix_transform.hpp"
 
+#include "Bounds.h"
+
 namespace ili
 {
 	class Camera final
@@ -22,9 +24,20 @@ namespace ili
 		const glm::mat4& GetProjection() const { return m_ProjectionMatrix; }
 		const glm::mat4& GetView() const { return m_ViewMatrix; }
 		const glm::mat4& GetInverseView() const { return m_InverseViewMatrix; }
+		// World space view volume of the current projection and view
+		Frustum GetFrustum() const { return Frustum(m_ProjectionMatrix * m_ViewMatrix); }
+		// World space ray from the near plane through a point given in normalized device coordinates, for picking with Scene::Raycast.
+		// The top left corner of the screen is (-1, -1), the direction is normalized so hit distances are in world units
+		Ray GetRay(const glm::vec2& normalizedDeviceCoordinates) const;
+
+		float GetNearPlane() const { return m_NearPlane; }
+		float GetFarPlane() const { return m_FarPlane; }
 	private:
 		glm::mat4 m_ProjectionMatrix{ 1.f };
 		glm::mat4 m_ViewMatrix{ 1.f };
 		glm::mat4 m_InverseViewMatrix{ 1.f };
+
+		float m_NearPlane{ 0.1f };
+		float m_FarPlane{ 10.f };
 	};
 }
\ No newline at end of file
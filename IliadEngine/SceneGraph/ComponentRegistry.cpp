@@ -0,0 +1,45 @@
+﻿#include "ComponentRegistry.h"
+
+namespace ili
+{
+	void ComponentPool::Add(uint32_t gameObjectId, BaseComponent* pComponent)
+	{
+		if (Contains(gameObjectId)) return;
+
+		if (gameObjectId >= m_Sparse.size()) m_Sparse.resize(gameObjectId + 1, INVALID_INDEX);
+		m_Sparse[gameObjectId] = GetSize();
+		m_GameObjectIds.push_back(gameObjectId);
+		m_pComponents.push_back(pComponent);
+	}
+
+	void ComponentPool::Remove(uint32_t gameObjectId)
+	{
+		if (!Contains(gameObjectId)) return;
+
+		const uint32_t denseIndex = m_Sparse[gameObjectId];
+		const uint32_t lastGameObjectId = m_GameObjectIds.back();
+
+		m_GameObjectIds[denseIndex] = lastGameObjectId;
+		m_pComponents[denseIndex] = m_pComponents.back();
+		m_Sparse[lastGameObjectId] = denseIndex;
+
+		m_GameObjectIds.pop_back();
+		m_pComponents.pop_back();
+		m_Sparse[gameObjectId] = INVALID_INDEX;
+	}
+
+	void ComponentRegistry::Add(ComponentTypeId typeId, uint32_t gameObjectId, BaseComponent* pComponent)
+	{
+		if (typeId >= m_pPools.size()) m_pPools.resize(typeId + 1);
+		if (!m_pPools[typeId]) m_pPools[typeId] = std::make_unique<ComponentPool>();
+		m_pPools[typeId]->Add(gameObjectId, pComponent);
+	}
+
+	void ComponentRegistry::RemoveAll(uint32_t gameObjectId)
+	{
+		for (const std::unique_ptr<ComponentPool>& pPool : m_pPools)
+		{
+			if (pPool) pPool->Remove(gameObjectId);
+		}
+	}
+}
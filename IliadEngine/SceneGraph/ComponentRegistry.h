@@ -0,0 +1,188 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "BaseComponent.h"
+
+namespace ili
+{
+	using ComponentTypeId = uint32_t;
+
+	// Dense ids in the order the types are first used, component lookups index an array with them instead of comparing typeid
+	class ComponentTypeIds final
+	{
+	public:
+		template <typename T>
+		static ComponentTypeId Get()
+		{
+			static const ComponentTypeId id = s_NextId.fetch_add(1, std::memory_order_relaxed);
+			return id;
+		}
+
+	private:
+		static inline std::atomic<ComponentTypeId> s_NextId{};
+	};
+
+	template <typename T>
+	ComponentTypeId GetComponentTypeId()
+	{
+		static_assert(std::is_base_of_v<BaseComponent, T>, "T must derive from BaseComponent");
+		return ComponentTypeIds::Get<std::remove_cv_t<T>>();
+	}
+
+	/**
+	 * Sparse set holding pointers to the components of one type. The dense arrays are packed without holes and
+	 * the sparse array maps a GameObject id to its dense index. Iterating dereferences each pointer, the components
+	 * live in their type's pool of the scene allocator, next to each other in the order they were created
+	 */
+	class ComponentPool final
+	{
+	public:
+		ComponentPool() = default;
+		~ComponentPool() = default;
+
+		ComponentPool(const ComponentPool& other) = delete;
+		ComponentPool(ComponentPool&& other) noexcept = delete;
+		ComponentPool& operator=(const ComponentPool& other) = delete;
+		ComponentPool& operator=(ComponentPool&& other) noexcept = delete;
+
+		// Keeps the first component when the object already has one of this type
+		void Add(uint32_t gameObjectId, BaseComponent* pComponent);
+		// The last component takes the place of the removed one
+		void Remove(uint32_t gameObjectId);
+
+		BaseComponent* Get(uint32_t gameObjectId) const
+		{
+			if (gameObjectId >= m_Sparse.size()) return nullptr;
+			const uint32_t denseIndex = m_Sparse[gameObjectId];
+			return denseIndex != INVALID_INDEX ? m_pComponents[denseIndex] : nullptr;
+		}
+		bool Contains(uint32_t gameObjectId) const { return gameObjectId < m_Sparse.size() && m_Sparse[gameObjectId] != INVALID_INDEX; }
+
+		uint32_t GetSize() const { return static_cast<uint32_t>(m_pComponents.size()); }
+		const std::vector<uint32_t>& GetGameObjectIds() const { return m_GameObjectIds; }
+		const std::vector<BaseComponent*>& GetComponents() const { return m_pComponents; }
+
+	private:
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+		std::vector<uint32_t> m_Sparse{};
+		// Parallel dense arrays
+		std::vector<uint32_t> m_GameObjectIds{};
+		std::vector<BaseComponent*> m_pComponents{};
+	};
+
+	/**
+	 * Every object that has all of the component types, iterated as a tuple of component pointers:
+	 * for (auto [pTransform, pModel] : scene.View<TransformComponent, ModelComponent>())
+	 * Walks the smallest of the pools and probes the others. Adding or removing components of the viewed
+	 * types while iterating is not supported
+	 */
+	template <typename... Ts>
+	class ComponentView final
+	{
+	public:
+		using Pools = std::array<const ComponentPool*, sizeof...(Ts)>;
+
+		// A missing pool means no object has that component yet, the view is empty then
+		explicit ComponentView(const Pools& pPools) : m_pPools(pPools)
+		{
+			if (std::ranges::any_of(m_pPools, [](const ComponentPool* pPool) { return pPool == nullptr; })) return;
+			m_pDriver = *std::ranges::min_element(m_pPools, {}, &ComponentPool::GetSize);
+		}
+
+		class Iterator final
+		{
+		public:
+			Iterator(const ComponentView* pView, uint32_t index) : m_pView(pView), m_Index(index) { SkipIncomplete(); }
+
+			std::tuple<Ts*...> operator*() const { return m_pView->GetComponents(m_Index, std::index_sequence_for<Ts...>{}); }
+			Iterator& operator++()
+			{
+				++m_Index;
+				SkipIncomplete();
+				return *this;
+			}
+			bool operator==(const Iterator& other) const { return m_Index == other.m_Index; }
+
+		private:
+			void SkipIncomplete()
+			{
+				while (m_Index < m_pView->GetDriverSize() && !m_pView->HasAll(m_Index)) ++m_Index;
+			}
+
+			const ComponentView* m_pView;
+			uint32_t m_Index;
+		};
+
+		Iterator begin() const { return Iterator{ this, 0 }; }
+		Iterator end() const { return Iterator{ this, GetDriverSize() }; }
+
+		// Upper bound of the number of objects in the view
+		uint32_t GetSizeHint() const { return GetDriverSize(); }
+
+	private:
+		uint32_t GetDriverSize() const { return m_pDriver ? m_pDriver->GetSize() : 0; }
+
+		bool HasAll(uint32_t driverIndex) const
+		{
+			const uint32_t gameObjectId = m_pDriver->GetGameObjectIds()[driverIndex];
+			return std::ranges::all_of(m_pPools, [gameObjectId](const ComponentPool* pPool) { return pPool->Contains(gameObjectId); });
+		}
+
+		template <size_t... Indices>
+		std::tuple<Ts*...> GetComponents(uint32_t driverIndex, std::index_sequence<Indices...>) const
+		{
+			const uint32_t gameObjectId = m_pDriver->GetGameObjectIds()[driverIndex];
+			return { static_cast<Ts*>(m_pPools[Indices] == m_pDriver ? m_pDriver->GetComponents()[driverIndex] : m_pPools[Indices]->Get(gameObjectId))... };
+		}
+
+		Pools m_pPools;
+		const ComponentPool* m_pDriver{};
+	};
+
+	// One component pool per type for all objects of a scene. Does not own the components, their GameObjects do
+	class ComponentRegistry final
+	{
+	public:
+		ComponentRegistry() = default;
+		~ComponentRegistry() = default;
+
+		ComponentRegistry(const ComponentRegistry& other) = delete;
+		ComponentRegistry(ComponentRegistry&& other) noexcept = delete;
+		ComponentRegistry& operator=(const ComponentRegistry& other) = delete;
+		ComponentRegistry& operator=(ComponentRegistry&& other) noexcept = delete;
+
+		void Add(ComponentTypeId typeId, uint32_t gameObjectId, BaseComponent* pComponent);
+		// Removes every component of the object
+		void RemoveAll(uint32_t gameObjectId);
+
+		template <typename T>
+		T* Get(uint32_t gameObjectId) const
+		{
+			const ComponentPool* pPool = GetPool(GetComponentTypeId<T>());
+			return pPool ? static_cast<T*>(pPool->Get(gameObjectId)) : nullptr;
+		}
+
+		template <typename... Ts>
+		ComponentView<Ts...> View() const
+		{
+			return ComponentView<Ts...>{ { GetPool(GetComponentTypeId<Ts>())... } };
+		}
+
+		// Null when no component of the type was ever added
+		const ComponentPool* GetPool(ComponentTypeId typeId) const { return typeId < m_pPools.size() ? m_pPools[typeId].get() : nullptr; }
+
+	private:
+		// Indexed by component type id, null for types that never had a component in this scene
+		std::vector<std::unique_ptr<ComponentPool>> m_pPools{};
+	};
+}
@@ -1,10 +1,11 @@
 #include "GameObject.h"
+#include "ModelComponent.h"
 
 namespace ili
 {
-	GameObject::GameObject(const unsigned id) : m_Id(id)
+	GameObject::GameObject(const unsigned id) : m_pTransformComponent(&m_TransformComponent), m_Id(id)
 	{
-		m_pTransformComponent = AddComponent<TransformComponent>();
+		m_TransformComponent.m_pGameObject = this;
 	}
 
 	void GameObject::RootUpdate()
@@ -12,6 +13,26 @@ namespace ili
 		Update();
 	}
 
+	void GameObject::AddToScene(ComponentRegistry* pComponentRegistry, SceneAllocator* pAllocator)
+	{
+		m_pComponentRegistry = pComponentRegistry;
+		m_pAllocator = pAllocator;
+
+		m_pComponentRegistry->Add(GetComponentTypeId<TransformComponent>(), m_Id, &m_TransformComponent);
+		for (const ComponentEntry& component : m_pComponents)
+		{
+			m_pComponentRegistry->Add(component.typeId, m_Id, component.pComponent.get());
+		}
+	}
+
+	std::optional<Sphere> GameObject::GetWorldBounds()
+	{
+		const ModelComponent* pModelComponent = GetComponent<ModelComponent>();
+		if (!pModelComponent || !pModelComponent->GetModel()) return std::nullopt;
+
+		return pModelComponent->GetModel()->GetBoundingSphere().GetTransformed(m_pTransformComponent->GetMatrix());
+	}
+
 	//GameObject GameObject::MakePointLight(float intensity, float radius, glm::vec3 color)
 	//{
 	//	/*GameObject pointLight = GameObject::Create();
@@ -1,5 +1,12 @@
 #pragma once
 
+#include <optional>
+
+#include "ComponentRegistry.h"
+#include "Core/PoolAllocator.h"
+#include "Core/SlotMap.h"
+#include "SceneAllocator.h"
+#include "SpatialIndex.h"
 #include "TransformComponent.h"
 #include "../Graphics/Model.h"
 #include "glm/ext/matrix_transform.hpp"
@@ -7,14 +14,17 @@
 
 namespace ili
 {
+	// Stays safe to hold after the object is removed, Scene::GetGameObject returns null for it then
+	using GameObjectHandle = SlotHandle;
+
 	class GameObject
 	{
 	public:
 		virtual ~GameObject() = default;
 
-		// Enable move semantics
-		GameObject(GameObject&&) noexcept = default;
-		GameObject& operator=(GameObject&&) noexcept = default;
+		// Objects stay where their scene's pool put them, handles and component pointers refer to them
+		GameObject(GameObject&&) noexcept = delete;
+		GameObject& operator=(GameObject&&) noexcept = delete;
 
 		// Delete copy semantics
 		GameObject(const GameObject&) = delete;
@@ -31,10 +41,15 @@ namespace ili
 		T* AddComponent(Args&&... args)
 		{
 			static_assert(std::is_base_of<BaseComponent, T>::value, "T must derive from BaseComponent");
-			auto component = std::make_unique<T>(std::forward<Args>(args)...);
+			// Components added before the object is in a scene come from the heap
+			auto component = m_pAllocator ? m_pAllocator->New<T>(std::forward<Args>(args)...) : PoolPtr<T>{ new T(std::forward<Args>(args)...), PoolDeleter{} };
 			auto ptr = component.get();
 			ptr->m_pGameObject = this;
-			m_pComponents.push_back(std::move(component));
+			const ComponentTypeId typeId = GetComponentTypeId<T>();
+			if (m_pComponentRegistry) m_pComponentRegistry->Add(typeId, m_Id, ptr);
+			m_pComponents.push_back({ typeId, std::move(component) });
+			// The component can give the object bounds, a model for instance
+			m_TransformComponent.MarkBoundsDirty();
 			return ptr;
 		}
 
@@ -42,31 +57,63 @@ namespace ili
 		T* GetComponent()
 		{
 			static_assert(std::is_base_of<BaseComponent, T>::value, "T must derive from BaseComponent");
-			for (auto& component : m_pComponents)
+			if constexpr (std::is_same_v<T, TransformComponent>)
 			{
-				if (typeid(*component) == typeid(T))
-				{
-					return static_cast<T*>(component.get());
-				}
+				return m_pTransformComponent;
+			}
+			else
+			{
+				if (m_pComponentRegistry) return m_pComponentRegistry->Get<T>(m_Id);
+
+				// Not added to a scene yet
+				const auto it = std::ranges::find(m_pComponents, GetComponentTypeId<T>(), &ComponentEntry::typeId);
+				return it != m_pComponents.end() ? static_cast<T*>(it->pComponent.get()) : nullptr;
 			}
-			return nullptr;
 		}
 
+		// The slot of the object in its scene, reused once the object is destroyed. Hold a handle to refer to an object across frames
 		unsigned int GetId() const { return m_Id; }
+		GameObjectHandle GetHandle() const { return m_Handle; }
+		// Removed from the scene, destroyed at the end of the frame
+		bool IsPendingRemoval() const { return m_IsPendingRemoval; }
+
+		// What the scene's spatial index holds the object with, the model's bounds by default. Objects without bounds are not indexed
+		virtual std::optional<Sphere> GetWorldBounds();
 
 	protected:
 		virtual void Update() {}
 		GameObject(const unsigned int id);
 	private:
 		friend class Scene;
+		friend class SceneAllocator;
+
+		struct ComponentEntry
+		{
+			ComponentTypeId typeId{};
+			PoolPtr<BaseComponent> pComponent{};
+		};
 
 		void RootUpdate();
+		// Called by the scene the object is created in, registers the components added so far
+		void AddToScene(ComponentRegistry* pComponentRegistry, SceneAllocator* pAllocator);
 
 		//glm::vec3 m_Color{};
+		// Part of the object itself, every object has exactly one
+		TransformComponent m_TransformComponent{};
 		TransformComponent* m_pTransformComponent{};
 
-		std::vector<std::unique_ptr<BaseComponent>> m_pComponents{};
+		// Every component besides the transform
+		std::vector<ComponentEntry> m_pComponents{};
+		// Null until the object is added to a scene
+		ComponentRegistry* m_pComponentRegistry{};
+		SceneAllocator* m_pAllocator{};
+
+		// The index the scene puts the object in, and its proxy there once it has bounds
+		SpatialIndex* m_pSpatialIndex{};
+		uint32_t m_SpatialProxy{ SpatialIndex::NULL_PROXY };
 
 		unsigned int m_Id{};
+		GameObjectHandle m_Handle{};
+		bool m_IsPendingRemoval{ false };
 	};
 }
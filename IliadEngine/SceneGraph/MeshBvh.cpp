@@ -0,0 +1,362 @@
+﻿#include "MeshBvh.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <limits>
+
+#include "BinnedSah.h"
+#include "Core/SimdLanes.h"
+#include "Core/SmallStack.h"
+
+namespace ili
+{
+	namespace
+	{
+		// Cost of visiting a node relative to testing a triangle
+		constexpr float TRAVERSAL_COST = 1.f;
+
+		// Four lanes, one per child of a node. Max and Min ignore NaN values, which slab tests produce
+		// when the ray lies in the plane of a box face, and keep the accumulated value instead
+		using Lanes = simd::Float4;
+		using namespace simd;
+
+		Lanes Set(float value) { return simd::Set<Lanes>(value); }
+		Lanes Load(const float* pValues) { return simd::Load<Lanes>(pValues); }
+
+		// The ray broadcast to every lane, with the box faces it enters and leaves through picked by its direction
+		struct RayLanes
+		{
+			explicit RayLanes(const Ray& ray)
+			{
+				const glm::vec3 inverseDirection = ray.GetInverseDirection();
+				for (int axis{}; axis < 3; ++axis)
+				{
+					origin[axis] = Set(ray.origin[axis]);
+					this->inverseDirection[axis] = Set(inverseDirection[axis]);
+
+					// Rows 0..2 hold the minimum, 3..5 the maximum
+					const bool isNegative = inverseDirection[axis] < 0.f;
+					entryRows[axis] = isNegative ? axis + 3 : axis;
+					exitRows[axis] = isNegative ? axis : axis + 3;
+				}
+			}
+
+			Lanes origin[3]{};
+			Lanes inverseDirection[3]{};
+			std::array<int, 3> entryRows{};
+			std::array<int, 3> exitRows{};
+		};
+
+		// Slab test against four boxes, writes where the ray enters each and returns a bit per box it hits before maxDistance
+		uint32_t IntersectBoxes(const float (&bounds)[6][4], const RayLanes& ray, float maxDistance, float* pEntryDistances)
+		{
+			Lanes entry = Set(0.f);
+			Lanes exit = Set(maxDistance);
+			for (int axis{}; axis < 3; ++axis)
+			{
+				entry = Max(Mul(Sub(Load(bounds[ray.entryRows[axis]]), ray.origin[axis]), ray.inverseDirection[axis]), entry);
+				exit = Min(Mul(Sub(Load(bounds[ray.exitRows[axis]]), ray.origin[axis]), ray.inverseDirection[axis]), exit);
+			}
+
+			Store(pEntryDistances, entry);
+			return LessEqualMask(entry, exit);
+		}
+
+		struct BuildTriangle
+		{
+			AABB bounds{};
+			glm::vec3 centroid{};
+			uint32_t index{};
+		};
+
+		// Node of the binary tree the four wide one is collapsed from
+		struct BuildNode
+		{
+			AABB bounds{};
+			uint32_t begin{};
+			// Zero for inner nodes
+			uint32_t triangleCount{};
+			// The second child follows the first one
+			uint32_t firstChild{};
+		};
+
+		AABB GetBounds(const std::vector<BuildTriangle>& triangles, uint32_t begin, uint32_t end)
+		{
+			AABB bounds = AABB::Empty();
+			for (uint32_t i = begin; i < end; ++i) bounds = bounds.GetMerged(triangles[i].bounds);
+			return bounds;
+		}
+
+		// Top-down without recursion, reorders the triangles so every node covers a contiguous range of them
+		std::vector<BuildNode> BuildBinaryTree(std::vector<BuildTriangle>& triangles, uint32_t maxLeafTriangles)
+		{
+			const uint32_t triangleCount = static_cast<uint32_t>(triangles.size());
+
+			std::vector<BuildNode> nodes{};
+			nodes.reserve(2 * triangles.size());
+			nodes.push_back({ GetBounds(triangles, 0, triangleCount), 0, triangleCount, 0 });
+
+			std::vector<uint32_t> tasks{ 0 };
+			while (!tasks.empty())
+			{
+				const uint32_t nodeIndex = tasks.back();
+				tasks.pop_back();
+
+				const uint32_t begin = nodes[nodeIndex].begin;
+				const uint32_t end = begin + nodes[nodeIndex].triangleCount;
+				if (end - begin == 1) continue;
+
+				const auto first = triangles.begin() + begin;
+				const auto last = triangles.begin() + end;
+				const auto getCentroid = [](const BuildTriangle& triangle) { return triangle.centroid; };
+				const BinnedSahSplit sahSplit{ first, last, getCentroid, [](const BuildTriangle& triangle) { return triangle.bounds; } };
+
+				// Triangles that all share a centroid only end up together in a leaf when they fit
+				float splitCost = std::numeric_limits<float>::max();
+				const float area = nodes[nodeIndex].bounds.GetSurfaceArea();
+				if (sahSplit.IsValid() && area > 0.f) splitCost = TRAVERSAL_COST + sahSplit.GetCost() / area;
+				if (end - begin <= maxLeafTriangles && static_cast<float>(end - begin) <= splitCost) continue;
+
+				const uint32_t split = static_cast<uint32_t>(sahSplit.Partition(first, last, getCentroid) - triangles.begin());
+
+				const uint32_t firstChild = static_cast<uint32_t>(nodes.size());
+				nodes[nodeIndex].triangleCount = 0;
+				nodes[nodeIndex].firstChild = firstChild;
+				nodes.push_back({ GetBounds(triangles, begin, split), begin, split - begin, 0 });
+				nodes.push_back({ GetBounds(triangles, split, end), split, end - split, 0 });
+
+				tasks.push_back(firstChild);
+				tasks.push_back(firstChild + 1);
+			}
+			return nodes;
+		}
+
+		// Möller-Trumbore, counts hits on both sides of the triangle
+		bool IntersectTriangle(const Ray& ray, const glm::vec3& vertex0, const glm::vec3& edge1, const glm::vec3& edge2,
+			float maxDistance, float& distance, glm::vec2& barycentrics)
+		{
+			const glm::vec3 p = glm::cross(ray.direction, edge2);
+			const float determinant = glm::dot(edge1, p);
+			// The ray runs parallel to the triangle
+			if (determinant == 0.f) return false;
+
+			const float inverseDeterminant = 1.f / determinant;
+			const glm::vec3 s = ray.origin - vertex0;
+			const float u = glm::dot(s, p) * inverseDeterminant;
+			if (u < 0.f || u > 1.f) return false;
+
+			const glm::vec3 q = glm::cross(s, edge1);
+			const float v = glm::dot(ray.direction, q) * inverseDeterminant;
+			if (v < 0.f || u + v > 1.f) return false;
+
+			const float t = glm::dot(edge2, q) * inverseDeterminant;
+			if (t < 0.f || t >= maxDistance) return false;
+
+			distance = t;
+			barycentrics = { u, v };
+			return true;
+		}
+
+		struct StackEntry
+		{
+			// A node, or the first triangle of a leaf
+			uint32_t index{};
+			uint32_t triangleCount{};
+			// Where the ray enters the box
+			float distance{};
+		};
+	}
+
+	MeshBvh::MeshBvh(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices)
+	{
+		const size_t indexCount = indices.empty() ? positions.size() : indices.size();
+		assert(indexCount % 3 == 0 && "Every triangle needs three indices");
+
+		const auto getPosition = [&](size_t index) { return positions[indices.empty() ? index : indices[index]]; };
+
+		const uint32_t triangleCount = static_cast<uint32_t>(indexCount / 3);
+		if (triangleCount == 0) return;
+
+		std::vector<BuildTriangle> buildTriangles(triangleCount);
+		m_Bounds = AABB::Empty();
+		for (uint32_t triangleIndex{}; triangleIndex < triangleCount; ++triangleIndex)
+		{
+			const glm::vec3 vertex0 = getPosition(3 * size_t{ triangleIndex });
+			const glm::vec3 vertex1 = getPosition(3 * size_t{ triangleIndex } + 1);
+			const glm::vec3 vertex2 = getPosition(3 * size_t{ triangleIndex } + 2);
+
+			BuildTriangle& triangle = buildTriangles[triangleIndex];
+			triangle.bounds = AABB{ glm::min(vertex0, glm::min(vertex1, vertex2)), glm::max(vertex0, glm::max(vertex1, vertex2)) };
+			triangle.centroid = triangle.bounds.GetCenter();
+			triangle.index = triangleIndex;
+			m_Bounds = m_Bounds.GetMerged(triangle.bounds);
+		}
+
+		const std::vector<BuildNode> buildNodes = BuildBinaryTree(buildTriangles, MAX_LEAF_TRIANGLES);
+
+		// Leaves refer to ranges of the reordered triangles
+		m_Triangles.reserve(triangleCount);
+		m_TriangleIndices.reserve(triangleCount);
+		for (const BuildTriangle& buildTriangle : buildTriangles)
+		{
+			const size_t firstIndex = 3 * size_t{ buildTriangle.index };
+			const glm::vec3 vertex0 = getPosition(firstIndex);
+			m_Triangles.push_back({ vertex0, getPosition(firstIndex + 1) - vertex0, getPosition(firstIndex + 2) - vertex0 });
+			m_TriangleIndices.push_back(buildTriangle.index);
+		}
+
+		struct CollapseTask
+		{
+			uint32_t buildNode{};
+			uint32_t node{};
+		};
+
+		// Every node takes the children of its largest inner children until it has four, which skips every other level of the binary tree
+		m_Nodes.reserve(buildNodes.size() / 2 + 1);
+		m_Nodes.emplace_back();
+		std::vector<CollapseTask> tasks{ { 0, 0 } };
+		while (!tasks.empty())
+		{
+			const CollapseTask task = tasks.back();
+			tasks.pop_back();
+
+			std::array<uint32_t, 4> children{};
+			uint32_t childCount{};
+			const BuildNode& buildNode = buildNodes[task.buildNode];
+			if (buildNode.triangleCount > 0)
+			{
+				// Only the root can be a leaf, when the whole mesh fits into one
+				children[childCount++] = task.buildNode;
+			}
+			else
+			{
+				children[childCount++] = buildNode.firstChild;
+				children[childCount++] = buildNode.firstChild + 1;
+			}
+
+			while (childCount < children.size())
+			{
+				uint32_t largestChild = UINT32_MAX;
+				float largestArea = -1.f;
+				for (uint32_t i{}; i < childCount; ++i)
+				{
+					const BuildNode& child = buildNodes[children[i]];
+					if (child.triangleCount > 0 || child.bounds.GetSurfaceArea() <= largestArea) continue;
+
+					largestChild = i;
+					largestArea = child.bounds.GetSurfaceArea();
+				}
+				if (largestChild == UINT32_MAX) break;
+
+				const uint32_t firstGrandchild = buildNodes[children[largestChild]].firstChild;
+				children[largestChild] = firstGrandchild;
+				children[childCount++] = firstGrandchild + 1;
+			}
+
+			// Filled on the side, adding children can move m_Nodes
+			Node node{};
+			node.childCount = static_cast<uint8_t>(childCount);
+			for (uint32_t i{}; i < children.size(); ++i)
+			{
+				const AABB bounds = i < childCount ? buildNodes[children[i]].bounds : AABB::Empty();
+				for (int axis{}; axis < 3; ++axis)
+				{
+					node.bounds[axis][i] = bounds.min[axis];
+					node.bounds[axis + 3][i] = bounds.max[axis];
+				}
+				if (i >= childCount) continue;
+
+				const BuildNode& child = buildNodes[children[i]];
+				if (child.triangleCount > 0)
+				{
+					node.children[i] = child.begin;
+					node.triangleCounts[i] = static_cast<uint8_t>(child.triangleCount);
+				}
+				else
+				{
+					node.children[i] = static_cast<uint32_t>(m_Nodes.size());
+					m_Nodes.emplace_back();
+					tasks.push_back({ children[i], node.children[i] });
+				}
+			}
+			m_Nodes[task.node] = node;
+		}
+	}
+
+	bool MeshBvh::Raycast(const Ray& ray, float maxDistance, MeshRayHit& hit) const
+	{
+		if (m_Nodes.empty()) return false;
+
+		const RayLanes rayLanes{ ray };
+		uint32_t closestTriangle = UINT32_MAX;
+
+		SmallStack<StackEntry> stack{};
+		stack.Push({ 0, 0, 0.f });
+		while (!stack.IsEmpty())
+		{
+			const StackEntry entry = stack.Pop();
+			// A closer hit was found since the entry was pushed
+			if (entry.distance >= maxDistance) continue;
+
+			if (entry.triangleCount > 0)
+			{
+				for (uint32_t triangleIndex = entry.index; triangleIndex < entry.index + entry.triangleCount; ++triangleIndex)
+				{
+					const Triangle& triangle = m_Triangles[triangleIndex];
+					if (IntersectTriangle(ray, triangle.vertex0, triangle.edge1, triangle.edge2, maxDistance, maxDistance, hit.barycentrics))
+					{
+						closestTriangle = triangleIndex;
+					}
+				}
+				continue;
+			}
+
+			const Node& node = m_Nodes[entry.index];
+			alignas(16) std::array<float, 4> entryDistances{};
+			uint32_t hitMask = IntersectBoxes(node.bounds, rayLanes, maxDistance, entryDistances.data()) & ((1u << node.childCount) - 1);
+
+			// Sorted by distance and pushed farthest first, so the nearest child is visited next and a hit in it skips the rest
+			std::array<StackEntry, 4> hitChildren{};
+			uint32_t hitCount{};
+			for (; hitMask != 0; hitMask &= hitMask - 1)
+			{
+				const uint32_t child = static_cast<uint32_t>(std::countr_zero(hitMask));
+				const StackEntry childEntry{ node.children[child], node.triangleCounts[child], entryDistances[child] };
+
+				uint32_t position = hitCount++;
+				for (; position > 0 && hitChildren[position - 1].distance < childEntry.distance; --position)
+				{
+					hitChildren[position] = hitChildren[position - 1];
+				}
+				hitChildren[position] = childEntry;
+			}
+			for (uint32_t i{}; i < hitCount; ++i) stack.Push(hitChildren[i]);
+		}
+
+		if (closestTriangle == UINT32_MAX) return false;
+
+		const Triangle& triangle = m_Triangles[closestTriangle];
+		hit.distance = maxDistance;
+		hit.triangleIndex = m_TriangleIndices[closestTriangle];
+		hit.normal = glm::cross(triangle.edge1, triangle.edge2);
+		return true;
+	}
+
+	size_t MeshBvh::GetMemorySize() const
+	{
+		return m_Nodes.size() * sizeof(Node) + m_Triangles.size() * sizeof(Triangle) + m_TriangleIndices.size() * sizeof(uint32_t);
+	}
+
+	const char* MeshBvh::GetInstructionSet()
+	{
+#if defined(ILI_SIMD_SSE2)
+		return "SSE2";
+#elif defined(ILI_SIMD_NEON)
+		return "NEON";
+#else
+		return "Scalar";
+#endif
+	}
+}
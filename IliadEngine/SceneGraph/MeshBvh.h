@@ -0,0 +1,81 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Bounds.h"
+
+namespace ili
+{
+	// Where a ray hit a MeshBvh, in the space of the mesh
+	struct MeshRayHit final
+	{
+		// Along the ray, in multiples of its direction
+		float distance{};
+		// Index of the triangle in the index list the mesh was built from
+		uint32_t triangleIndex{};
+		// Weights of the second and third vertex, the first one gets 1 - x - y
+		glm::vec2 barycentrics{};
+		// Not normalized, (v1 - v0) x (v2 - v0)
+		glm::vec3 normal{};
+	};
+
+	/**
+	 * CPU copy of the triangles of a mesh with a bounding volume hierarchy over them, for ray queries against the actual geometry.
+	 * A binary tree is built with a binned surface area heuristic and collapsed into nodes of four children, whose boxes are
+	 * stored side by side so a ray is tested against all four with one SSE2 or NEON instruction per slab, or with scalar code otherwise.
+	 * The triangles are stored in leaf order with their edges precomputed.
+	 * Immutable once built, so any thread can query it
+	 */
+	class MeshBvh final
+	{
+	public:
+		// Every three indices form a triangle, without indices every three positions do
+		MeshBvh(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+		~MeshBvh() = default;
+
+		MeshBvh(const MeshBvh& other) = delete;
+		MeshBvh(MeshBvh&& other) noexcept = delete;
+		MeshBvh& operator=(const MeshBvh& other) = delete;
+		MeshBvh& operator=(MeshBvh&& other) noexcept = delete;
+
+		// Closest hit nearer than maxDistance, triangles are hit from both sides
+		bool Raycast(const Ray& ray, float maxDistance, MeshRayHit& hit) const;
+
+		const AABB& GetBounds() const { return m_Bounds; }
+		uint32_t GetTriangleCount() const { return static_cast<uint32_t>(m_Triangles.size()); }
+		uint32_t GetNodeCount() const { return static_cast<uint32_t>(m_Nodes.size()); }
+		// Bytes held by the nodes and triangles
+		size_t GetMemorySize() const;
+
+		static const char* GetInstructionSet();
+
+	private:
+		static constexpr uint32_t MAX_LEAF_TRIANGLES = 4;
+
+		// Four children, a lane per child
+		struct alignas(64) Node
+		{
+			// min x, y, z then max x, y, z
+			float bounds[6][4]{};
+			// The child node, or the first triangle of a leaf
+			uint32_t children[4]{};
+			// Zero for inner children
+			uint8_t triangleCounts[4]{};
+			uint8_t childCount{};
+		};
+
+		struct Triangle
+		{
+			glm::vec3 vertex0{};
+			glm::vec3 edge1{};
+			glm::vec3 edge2{};
+		};
+
+		std::vector<Node> m_Nodes{};
+		std::vector<Triangle> m_Triangles{};
+		// Index in the original index list for every stored triangle
+		std::vector<uint32_t> m_TriangleIndices{};
+		AABB m_Bounds{};
+	};
+}
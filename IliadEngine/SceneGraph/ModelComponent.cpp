@@ -1,5 +1,6 @@
 ﻿#include "ModelComponent.h"
 
+#include "GameObject.h"
 #include "Core/ContentLoader.h"
 
 namespace ili
@@ -9,10 +10,22 @@ namespace ili
 		m_pMaterial = std::make_shared<Material>();
 	}
 
-	ModelComponent::ModelComponent(const std::string& modelPath)
+	ModelComponent::ModelComponent(const std::string& modelPath, bool buildMeshBvh)
 	{
 		m_pMaterial = std::make_shared<Material>();
-		m_pModel = ContentLoader::GetInstance().LoadModelFromFile("Assets/Models/" + modelPath + ".obj");
+		m_pModel = ContentLoader::GetInstance().LoadModelFromFile("Assets/Models/" + modelPath + ".obj", buildMeshBvh);
+	}
+
+	void ModelComponent::SetModel(const std::shared_ptr<Model>& pModel)
+	{
+		m_pModel = pModel;
+		if (m_pGameObject) m_pGameObject->GetTransform()->MarkBoundsDirty();
+	}
+
+	ModelInstance ModelComponent::GetInstance() const
+	{
+		const TransformComponent* pTransform = m_pGameObject->GetTransform();
+		return { pTransform->GetMatrix(), pTransform->GetNormalMatrix(), m_pModel, m_pMaterial ? m_pMaterial->GetTextures() : nullptr };
 	}
 
 	void ModelComponent::Initialize()
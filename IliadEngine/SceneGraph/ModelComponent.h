@@ -1,8 +1,10 @@
 ﻿#pragma once
 #include "./Graphics/Model.h"
 #include "BaseComponent.h"
+#include "ComponentRegistry.h"
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "Graphics/Material.h"
 
@@ -10,11 +12,24 @@ namespace ili
 {
     class Texture;
 
+    // An object with a model as the render systems see it. A copy rather than pointers into the scene,
+    // so a frame can be recorded from it while the game thread already changes the scene for the next one
+    struct ModelInstance final
+    {
+        glm::mat4 modelMatrix{ 1.f };
+        glm::mat3 normalMatrix{ 1.f };
+        // Shared, removing the object cannot free the model of a frame that is still being recorded
+        std::shared_ptr<Model> pModel{};
+        // Null without a material
+        std::shared_ptr<const MaterialTextures> pMaterial{};
+    };
+
     class ModelComponent final : public BaseComponent
     {
     public:
         ModelComponent(const std::shared_ptr<Model>& pModel);
-        ModelComponent(const std::string& modelPath);
+        // buildMeshBvh makes the object hittable by Scene::Raycast down to its triangles instead of only its bounds
+        ModelComponent(const std::string& modelPath, bool buildMeshBvh = false);
         ModelComponent() = default;
         virtual ~ModelComponent() override = default;
 
@@ -25,14 +40,20 @@ namespace ili
 
         virtual void Initialize() override;
 
-        void SetModel(const std::shared_ptr<Model>& pModel) { m_pModel = pModel; }
+        void SetModel(const std::shared_ptr<Model>& pModel);
         std::shared_ptr<Model> GetModel() const { return m_pModel; }
 
 		std::shared_ptr<Material> GetMaterial() const { return m_pMaterial; }
 		void SetMaterial(const std::shared_ptr<Material>& pMaterial) { m_pMaterial = pMaterial; }
 
+        // Copies the world matrices of the object, the model and the current textures of the material
+        ModelInstance GetInstance() const;
+
     private:
         std::shared_ptr<Model> m_pModel{};
 		std::shared_ptr<Material> m_pMaterial{};
     };
+
+    // The objects with a model the camera can see, what the mesh render systems and the occlusion culling walk each frame
+    using ModelList = std::vector<ModelInstance>;
 }
@@ -0,0 +1,20 @@
+﻿#include "OccluderComponent.h"
+
+#include "Core/ContentLoader.h"
+
+namespace ili
+{
+	OccluderComponent::OccluderComponent(const std::shared_ptr<OccluderMesh>& pMesh) : m_pMesh(pMesh)
+	{
+	}
+
+	OccluderComponent::OccluderComponent(const std::string& modelPath)
+	{
+		m_pMesh = ContentLoader::GetInstance().LoadOccluderFromFile("Assets/Models/" + modelPath + ".obj");
+	}
+
+	void OccluderComponent::Initialize()
+	{
+
+	}
+}
@@ -0,0 +1,32 @@
+﻿#pragma once
+#include "BaseComponent.h"
+#include <memory>
+#include <string>
+
+#include "Core/SoftwareOcclusionCuller.h"
+
+namespace ili
+{
+    // Marks the game object as an occluder for the software occlusion culling, the mesh follows the object's transform
+    class OccluderComponent final : public BaseComponent
+    {
+    public:
+        OccluderComponent(const std::shared_ptr<OccluderMesh>& pMesh);
+        // Loads Assets/Models/<modelPath>.obj, only the positions are kept
+        OccluderComponent(const std::string& modelPath);
+        virtual ~OccluderComponent() override = default;
+
+        OccluderComponent(const OccluderComponent&) = delete;
+        OccluderComponent(OccluderComponent&&) = delete;
+        OccluderComponent& operator=(const OccluderComponent&) = delete;
+        OccluderComponent& operator=(OccluderComponent&&) = delete;
+
+        virtual void Initialize() override;
+
+        void SetMesh(const std::shared_ptr<OccluderMesh>& pMesh) { m_pMesh = pMesh; }
+        std::shared_ptr<OccluderMesh> GetMesh() const { return m_pMesh; }
+
+    private:
+        std::shared_ptr<OccluderMesh> m_pMesh{};
+    };
+}
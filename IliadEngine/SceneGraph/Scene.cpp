@@ -4,18 +4,131 @@ namespace ili
 {
 	PointLightGameObject* Scene::CreatePointLight(float intensity, float radius, glm::vec3 color)
 	{
-		const auto light = new PointLightGameObject(m_IdCounter++, intensity, radius, color);
-		m_pPointLights.push_back(std::unique_ptr<PointLightGameObject>(light));
+		const auto light = CreateGameObject<PointLightGameObject>(intensity, radius, color);
+		light->m_pSpatialIndex = &m_LightSpatialIndex;
+		light->m_LightIndex = static_cast<uint32_t>(m_pPointLights.size());
+		m_pPointLights.push_back(light);
 		return light;
 	}
 
-    void Scene::RemoveGameObject(unsigned int id) 
+    void Scene::RemoveGameObject(GameObjectHandle handle) 
 	{
-		const auto it = std::ranges::find_if(m_pGameObjects, [id](const std::unique_ptr<GameObject>& pGameObject) { return pGameObject->GetId() == id; });
+		GameObject* pGameObject = GetGameObject(handle);
+		if (!pGameObject || pGameObject->m_IsPendingRemoval) return;
 
-		if (it != m_pGameObjects.end())
+		pGameObject->m_IsPendingRemoval = true;
+		m_RemovedGameObjects.push_back(handle);
+    }
+
+	void Scene::DestroyRemovedGameObjects()
+	{
+		for (const GameObjectHandle handle : m_RemovedGameObjects)
 		{
-			m_pGameObjects.erase(it);
+			GameObject* pGameObject = GetGameObject(handle);
+
+			m_TransformHierarchy.Remove(pGameObject->GetTransform());
+			if (pGameObject->m_SpatialProxy != SpatialIndex::NULL_PROXY) pGameObject->m_pSpatialIndex->Remove(pGameObject->m_SpatialProxy);
+			m_ComponentRegistry.RemoveAll(pGameObject->GetId());
+
+			// Only point lights are in the light index
+			if (pGameObject->m_pSpatialIndex == &m_LightSpatialIndex)
+			{
+				const uint32_t lightIndex = static_cast<PointLightGameObject*>(pGameObject)->m_LightIndex;
+				m_pPointLights[lightIndex] = m_pPointLights.back();
+				m_pPointLights[lightIndex]->m_LightIndex = lightIndex;
+				m_pPointLights.pop_back();
+			}
+			m_GameObjects.Remove(handle);
 		}
-    }
+		m_RemovedGameObjects.clear();
+	}
+
+	void Scene::UpdateTransforms()
+	{
+		m_TransformHierarchy.Update();
+
+		// Objects that did not move keep their proxies untouched
+		for (TransformComponent* pTransform : m_TransformHierarchy.GetMovedTransforms())
+		{
+			UpdateSpatialProxy(*pTransform->GetGameObject());
+		}
+		m_TransformHierarchy.ClearMovedTransforms();
+
+		m_SpatialIndex.RebuildIfDegraded();
+		m_LightSpatialIndex.RebuildIfDegraded();
+	}
+
+	void Scene::QueryModels(const Frustum& frustum, ModelList& models) const
+	{
+		m_SpatialIndex.QueryFrustum(frustum, [&models](GameObject* pGameObject)
+		{
+			models.push_back(pGameObject->GetComponent<ModelComponent>()->GetInstance());
+		});
+	}
+
+	bool Scene::Raycast(const Ray& ray, float maxDistance, RaycastHit& hit) const
+	{
+		hit.pGameObject = nullptr;
+
+		// Bounds come in no particular order, each hit shortens the ray for the rest
+		m_SpatialIndex.QueryRay(ray, maxDistance, [&ray, &maxDistance, &hit](GameObject* pGameObject, float boundsDistance)
+		{
+			const MeshBvh* pMeshBvh = pGameObject->GetComponent<ModelComponent>()->GetModel()->GetMeshBvh();
+			if (!pMeshBvh)
+			{
+				hit = { pGameObject, boundsDistance, ray.GetPoint(boundsDistance), -glm::normalize(ray.direction), RaycastHit::NO_TRIANGLE };
+				maxDistance = boundsDistance;
+				return maxDistance;
+			}
+
+			// The direction is transformed without normalizing, so distances along the model space ray match the world space ones
+			const TransformComponent* pTransform = pGameObject->GetTransform();
+			const glm::mat4 inverseMatrix = glm::inverse(pTransform->GetMatrix());
+			const Ray modelRay{ glm::vec3{ inverseMatrix * glm::vec4{ ray.origin, 1.f } }, glm::mat3{ inverseMatrix } * ray.direction };
+
+			MeshRayHit meshHit{};
+			if (!pMeshBvh->Raycast(modelRay, maxDistance, meshHit)) return maxDistance;
+
+			glm::vec3 normal = glm::normalize(pTransform->GetNormalMatrix() * meshHit.normal);
+			if (glm::dot(normal, ray.direction) > 0.f) normal = -normal;
+
+			hit = { pGameObject, meshHit.distance, ray.GetPoint(meshHit.distance), normal, meshHit.triangleIndex };
+			maxDistance = meshHit.distance;
+			return maxDistance;
+		});
+
+		return hit.pGameObject != nullptr;
+	}
+
+	void Scene::QueryPointLights(const Frustum& frustum, std::vector<PointLightGameObject*>& pointLights) const
+	{
+		// Only point lights go into the light index
+		m_LightSpatialIndex.QueryFrustum(frustum, [&pointLights](GameObject* pGameObject)
+		{
+			pointLights.push_back(static_cast<PointLightGameObject*>(pGameObject));
+		});
+	}
+
+	void Scene::UpdateSpatialProxy(GameObject& gameObject)
+	{
+		const std::optional<Sphere> bounds = gameObject.GetWorldBounds();
+		uint32_t& proxy = gameObject.m_SpatialProxy;
+
+		if (!bounds)
+		{
+			if (proxy != SpatialIndex::NULL_PROXY) gameObject.m_pSpatialIndex->Remove(proxy);
+			proxy = SpatialIndex::NULL_PROXY;
+			return;
+		}
+
+		const AABB box = AABB::FromSphere(*bounds);
+		if (proxy == SpatialIndex::NULL_PROXY) proxy = gameObject.m_pSpatialIndex->Insert(box, &gameObject);
+		else gameObject.m_pSpatialIndex->Move(proxy, box);
+	}
+
+	GameObject* Scene::GetGameObject(GameObjectHandle handle) const
+	{
+		const PoolPtr<GameObject>* ppGameObject = m_GameObjects.Get(handle);
+		return ppGameObject ? ppGameObject->get() : nullptr;
+	}
 }
@@ -2,11 +2,30 @@
 
 #include <vector>
 #include <memory>
+#include "ComponentRegistry.h"
 #include "GameObject.h"
+#include "ModelComponent.h"
+#include "SceneAllocator.h"
+#include "SpatialIndex.h"
+#include "TransformHierarchy.h"
 #include "../Core/PointLight.h"
 
 namespace ili 
 {
+    struct RaycastHit final
+    {
+        static constexpr uint32_t NO_TRIANGLE = UINT32_MAX;
+
+        GameObject* pGameObject{};
+        // Along the ray, in multiples of its direction
+        float distance{};
+        glm::vec3 point{};
+        // Normalized and facing against the ray
+        glm::vec3 normal{};
+        // Into the index list of the model, NO_TRIANGLE when the model has no MeshBvh and only its bounds were hit
+        uint32_t triangleIndex{ NO_TRIANGLE };
+    };
+
 	class Scene 
     {
     public:
@@ -22,22 +41,62 @@ namespace ili
             // Ensure T is derived from GameObject
             //static_assert(std::is_base_of<GameObject, T>::value, "T must inherit from GameObject");
 
-            // Create a raw pointer to the new object
-            // Pass m_IdCounter++ as the first argument to the constructor
-            T* obj = new T(m_IdCounter++, std::forward<Args>(args)...);
+            // Create the object in the pool of its type
+            // The slot it is about to take is its id
+            PoolPtr<T> pObject = m_Allocator.New<T>(m_GameObjects.GetNextIndex(), std::forward<Args>(args)...);
+            T* obj = pObject.get();
 
-            // Wrap the raw pointer in a unique_ptr and store it
-            m_pGameObjects.push_back(std::unique_ptr<GameObject>(obj));
+            // Store it in the slot map, which owns it from now on
+            obj->m_Handle = m_GameObjects.Insert(std::move(pObject));
+            obj->m_pSpatialIndex = &m_SpatialIndex;
+            obj->AddToScene(&m_ComponentRegistry, &m_Allocator);
+            m_TransformHierarchy.Add(obj->GetTransform());
 
-            // Return the raw pointer to the created object
+            // Return the raw pointer to the created object, valid until the object is destroyed
             return obj;
         }
 
         PointLightGameObject* CreatePointLight(float intensity = 10.f, float radius = 0.1f, glm::vec3 color = glm::vec3(1.f, 1.f, 1.f));
 
-        void RemoveGameObject(unsigned int id);
-        std::vector<std::unique_ptr<GameObject>>& GetGameObjects() { return m_pGameObjects; }
-		std::vector<std::unique_ptr<PointLightGameObject>>& GetPointLights() { return m_pPointLights; }
+        /**
+         * The object stays in the scene until DestroyRemovedGameObjects, so removing while iterating is safe.
+         * Its children stay in the scene as roots. Stale handles and objects that are already removed are ignored
+         */
+        void RemoveGameObject(GameObjectHandle handle);
+        // Destroys the objects removed since the last call, IliadGame calls it once a frame is submitted
+        void DestroyRemovedGameObjects();
+
+        // Null once the object is destroyed, the handle may not be reused for another object
+        GameObject* GetGameObject(GameObjectHandle handle) const;
+        bool IsValid(GameObjectHandle handle) const { return m_GameObjects.Contains(handle); }
+
+        // Every object of the scene, point lights included, packed in no particular order
+        const std::vector<PoolPtr<GameObject>>& GetGameObjects() const { return m_GameObjects.GetValues(); }
+		const std::vector<PointLightGameObject*>& GetPointLights() const { return m_pPointLights; }
+
+        // Propagates the moved transforms to their world matrices and refits their bounds, once per frame before rendering
+        void UpdateTransforms();
+        const TransformHierarchy& GetTransformHierarchy() const { return m_TransformHierarchy; }
+        SceneAllocatorStats GetAllocatorStats() const { return m_Allocator.GetStats(); }
+
+        // Appends the objects with a model whose bounds intersect the frustum
+        void QueryModels(const Frustum& frustum, ModelList& models) const;
+        // Appends the lights whose range intersects the frustum
+        void QueryPointLights(const Frustum& frustum, std::vector<PointLightGameObject*>& pointLights) const;
+        /**
+         * Closest object with a model the ray hits before maxDistance. Bounds are tested through the spatial index first,
+         * then the ray is taken into model space for the triangles of the model's MeshBvh. Models without one are hit at their bounds.
+         * A ray from one point with the offset to another as its direction and a maxDistance of 1 tests the line of sight between them
+         */
+        bool Raycast(const Ray& ray, float maxDistance, RaycastHit& hit) const;
+        // The bounds of every object with a model, for sphere, box and ray queries
+        const SpatialIndex& GetSpatialIndex() const { return m_SpatialIndex; }
+        // The range of every point light
+        const SpatialIndex& GetLightSpatialIndex() const { return m_LightSpatialIndex; }
+
+        // Every object of the scene, point lights included, that has all of the component types
+        template <typename... Ts>
+        ComponentView<Ts...> View() const { return m_ComponentRegistry.View<Ts...>(); }
 
 
         virtual void Initialize() = 0;
@@ -48,8 +107,20 @@ namespace ili
 
         virtual void Update(float deltaTime) = 0;
 
-        std::vector<std::unique_ptr<GameObject>> m_pGameObjects{};
-        std::vector<std::unique_ptr<PointLightGameObject>> m_pPointLights{};
-		unsigned int m_IdCounter{};
+        // Declared first, the pools have to outlive the objects in them
+        SceneAllocator m_Allocator{};
+        ComponentRegistry m_ComponentRegistry{};
+        // Owns every object, point lights included
+        SlotMap<PoolPtr<GameObject>> m_GameObjects{};
+        std::vector<PointLightGameObject*> m_pPointLights{};
+        // Lists the moved transforms, the spatial indices are refitted from them
+        TransformHierarchy m_TransformHierarchy{ true };
+        SpatialIndex m_SpatialIndex{};
+        SpatialIndex m_LightSpatialIndex{};
+        std::vector<GameObjectHandle> m_RemovedGameObjects{};
+
+    private:
+        // Inserts, refits or removes the object's proxy to match its current bounds
+        void UpdateSpatialProxy(GameObject& gameObject);
     };
 }
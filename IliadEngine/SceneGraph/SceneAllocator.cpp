@@ -0,0 +1,22 @@
+﻿#include "SceneAllocator.h"
+
+namespace ili
+{
+	SceneAllocatorStats SceneAllocator::GetStats() const
+	{
+		SceneAllocatorStats stats{};
+		for (const std::unique_ptr<PoolAllocator>& pPool : m_pPools)
+		{
+			if (!pPool) continue;
+
+			const PoolStats& poolStats = pPool->GetStats();
+			++stats.poolCount;
+			stats.allocationCount += poolStats.allocationCount;
+			stats.chunkCount += poolStats.chunkCount;
+			stats.liveObjectCount += poolStats.liveBlockCount;
+			stats.reservedBytes += poolStats.GetReservedBytes();
+			stats.usedBytes += poolStats.GetUsedBytes();
+		}
+		return stats;
+	}
+}
@@ -0,0 +1,82 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Core/PoolAllocator.h"
+
+namespace ili
+{
+	// Totals over all pools of a scene, see PoolStats
+	struct SceneAllocatorStats
+	{
+		uint32_t poolCount{};
+		uint64_t allocationCount{};
+		uint32_t chunkCount{};
+		uint32_t liveObjectCount{};
+		size_t reservedBytes{};
+		size_t usedBytes{};
+
+		float GetFragmentation() const { return reservedBytes > 0 ? 1.f - static_cast<float>(usedBytes) / static_cast<float>(reservedBytes) : 0.f; }
+	};
+
+	/**
+	 * One pool per type for the objects and components of a scene, so objects of the same type sit next to
+	 * each other and unloading a scene returns a few chunks instead of every object separately
+	 */
+	class SceneAllocator final
+	{
+	public:
+		SceneAllocator() = default;
+		~SceneAllocator() = default;
+
+		SceneAllocator(const SceneAllocator& other) = delete;
+		SceneAllocator(SceneAllocator&& other) noexcept = delete;
+		SceneAllocator& operator=(const SceneAllocator& other) = delete;
+		SceneAllocator& operator=(SceneAllocator&& other) noexcept = delete;
+
+		template <typename T, typename... Args>
+		PoolPtr<T> New(Args&&... args)
+		{
+			PoolAllocator& pool = GetPool<T>();
+			void* pBlock = pool.Allocate();
+			try
+			{
+				return PoolPtr<T>{ new (pBlock) T(std::forward<Args>(args)...), PoolDeleter{ &pool } };
+			}
+			catch (...)
+			{
+				pool.Deallocate(pBlock);
+				throw;
+			}
+		}
+
+		SceneAllocatorStats GetStats() const;
+
+	private:
+		// Dense index per type, shared by all scenes
+		template <typename T>
+		static uint32_t GetTypeIndex()
+		{
+			static const uint32_t index = s_NextTypeIndex.fetch_add(1, std::memory_order_relaxed);
+			return index;
+		}
+
+		template <typename T>
+		PoolAllocator& GetPool()
+		{
+			const uint32_t typeIndex = GetTypeIndex<T>();
+			if (typeIndex >= m_pPools.size()) m_pPools.resize(typeIndex + 1);
+			if (!m_pPools[typeIndex]) m_pPools[typeIndex] = std::make_unique<PoolAllocator>(sizeof(T), alignof(T));
+			return *m_pPools[typeIndex];
+		}
+
+		static inline std::atomic<uint32_t> s_NextTypeIndex{};
+
+		// Indexed by type index, null for types this scene never allocated
+		std::vector<std::unique_ptr<PoolAllocator>> m_pPools{};
+	};
+}
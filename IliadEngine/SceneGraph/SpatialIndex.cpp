@@ -0,0 +1,350 @@
+﻿#include "SpatialIndex.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "BinnedSah.h"
+
+namespace ili
+{
+	namespace
+	{
+		// A leaf box larger than this many times a fresh one is shrunk back down
+		constexpr float MAX_LEAF_AREA_GROWTH = 4.f;
+		// How far the area ratio may grow past the one of the last rebuild, a rebuild costs about as much as reinserting every object
+		constexpr float MAX_AREA_RATIO_GROWTH = 1.5f;
+	}
+
+	SpatialIndex::SpatialIndex(float margin) : m_Margin(margin)
+	{
+	}
+
+	uint32_t SpatialIndex::Insert(const AABB& bounds, GameObject* pGameObject)
+	{
+		const uint32_t leaf = AllocateNode();
+		Node& node = m_Nodes[leaf];
+		node.bounds = GetFatBounds(bounds);
+		node.tightBounds = bounds;
+		node.pGameObject = pGameObject;
+		node.height = 0;
+
+		InsertLeaf(leaf);
+		++m_ProxyCount;
+		m_HasChanged = true;
+		return leaf;
+	}
+
+	void SpatialIndex::Remove(uint32_t proxy)
+	{
+		assert(proxy < m_Nodes.size() && m_Nodes[proxy].height == 0 && "Not a proxy of this index");
+
+		RemoveLeaf(proxy);
+		FreeNode(proxy);
+		--m_ProxyCount;
+		m_HasChanged = true;
+	}
+
+	void SpatialIndex::Move(uint32_t proxy, const AABB& bounds)
+	{
+		assert(proxy < m_Nodes.size() && m_Nodes[proxy].height == 0 && "Not a proxy of this index");
+
+		Node& node = m_Nodes[proxy];
+		node.tightBounds = bounds;
+
+		const AABB fatBounds = GetFatBounds(bounds);
+		if (node.bounds.Contains(bounds) && node.bounds.GetSurfaceArea() <= MAX_LEAF_AREA_GROWTH * fatBounds.GetSurfaceArea()) return;
+
+		RemoveLeaf(proxy);
+		m_Nodes[proxy].bounds = fatBounds;
+		InsertLeaf(proxy);
+		m_HasChanged = true;
+	}
+
+	void SpatialIndex::RebuildIfDegraded()
+	{
+		if (!m_HasChanged) return;
+		m_HasChanged = false;
+
+		// A tree that is filled again after it was emptied gets a good tree on its first update as well
+		if (m_Root == NULL_NODE)
+		{
+			m_RebuildAreaRatio = 0.f;
+			return;
+		}
+
+		// Objects that move together grow the root as much as the inner nodes, only a tree that got worse is rebuilt
+		if (m_RebuildAreaRatio <= 0.f || GetAreaRatio() > MAX_AREA_RATIO_GROWTH * m_RebuildAreaRatio) Rebuild();
+	}
+
+	void SpatialIndex::Rebuild()
+	{
+		m_HasChanged = false;
+		m_RebuildAreaRatio = 0.f;
+		if (m_Root == NULL_NODE) return;
+
+		struct BuildLeaf
+		{
+			uint32_t nodeIndex{};
+			glm::vec3 centroid{};
+		};
+
+		// Keeps the leaves, so the proxies stay valid, and frees exactly the inner nodes the new tree needs
+		std::vector<BuildLeaf> leaves{};
+		leaves.reserve(m_ProxyCount);
+		for (uint32_t nodeIndex{}; nodeIndex < m_Nodes.size(); ++nodeIndex)
+		{
+			const Node& node = m_Nodes[nodeIndex];
+			if (node.height < 0) continue;
+
+			if (node.IsLeaf()) leaves.push_back({ nodeIndex, node.bounds.GetCenter() });
+			else FreeNode(nodeIndex);
+		}
+
+		struct BuildTask
+		{
+			uint32_t begin{};
+			uint32_t end{};
+			uint32_t parent{};
+			bool isFirstChild{};
+		};
+
+		// Top-down without recursion, a poor split on every level can make the tree as deep as it has leaves
+		std::vector<BuildTask> tasks{ { 0, static_cast<uint32_t>(leaves.size()), NULL_NODE, true } };
+		std::vector<uint32_t> innerNodes{};
+		innerNodes.reserve(leaves.size());
+		while (!tasks.empty())
+		{
+			const BuildTask task = tasks.back();
+			tasks.pop_back();
+
+			uint32_t nodeIndex{};
+			if (task.end - task.begin == 1)
+			{
+				nodeIndex = leaves[task.begin].nodeIndex;
+			}
+			else
+			{
+				const auto first = leaves.begin() + task.begin;
+				const auto last = leaves.begin() + task.end;
+				const auto getCentroid = [](const BuildLeaf& leaf) { return leaf.centroid; };
+				const BinnedSahSplit sahSplit{ first, last, getCentroid, [this](const BuildLeaf& leaf) { return m_Nodes[leaf.nodeIndex].bounds; } };
+				const uint32_t split = static_cast<uint32_t>(sahSplit.Partition(first, last, getCentroid) - leaves.begin());
+
+				// The old tree had exactly as many inner nodes, none of these allocations grow m_Nodes
+				nodeIndex = AllocateNode();
+				m_Nodes[nodeIndex].height = 1;
+				innerNodes.push_back(nodeIndex);
+
+				tasks.push_back({ split, task.end, nodeIndex, false });
+				tasks.push_back({ task.begin, split, nodeIndex, true });
+			}
+
+			m_Nodes[nodeIndex].parent = task.parent;
+			if (task.parent == NULL_NODE) m_Root = nodeIndex;
+			else if (task.isFirstChild) m_Nodes[task.parent].child1 = nodeIndex;
+			else m_Nodes[task.parent].child2 = nodeIndex;
+		}
+
+		// Children are created after their parents, so walking back fits every node after its children
+		for (auto it = innerNodes.rbegin(); it != innerNodes.rend(); ++it)
+		{
+			Node& node = m_Nodes[*it];
+			const Node& child1 = m_Nodes[node.child1];
+			const Node& child2 = m_Nodes[node.child2];
+			node.bounds = child1.bounds.GetMerged(child2.bounds);
+			node.height = 1 + std::max(child1.height, child2.height);
+		}
+
+		m_RebuildAreaRatio = GetAreaRatio();
+	}
+
+	float SpatialIndex::GetAreaRatio() const
+	{
+		if (m_Root == NULL_NODE) return 0.f;
+
+		const float rootArea = m_Nodes[m_Root].bounds.GetSurfaceArea();
+		if (rootArea <= 0.f) return 0.f;
+
+		float totalArea{};
+		for (const Node& node : m_Nodes)
+		{
+			if (node.height > 0) totalArea += node.bounds.GetSurfaceArea();
+		}
+		return totalArea / rootArea;
+	}
+
+	uint32_t SpatialIndex::AllocateNode()
+	{
+		if (m_FreeList == NULL_NODE)
+		{
+			m_Nodes.emplace_back();
+			return static_cast<uint32_t>(m_Nodes.size() - 1);
+		}
+
+		const uint32_t nodeIndex = m_FreeList;
+		m_FreeList = m_Nodes[nodeIndex].parent;
+		m_Nodes[nodeIndex] = Node{};
+		return nodeIndex;
+	}
+
+	void SpatialIndex::FreeNode(uint32_t nodeIndex)
+	{
+		m_Nodes[nodeIndex] = Node{};
+		m_Nodes[nodeIndex].parent = m_FreeList;
+		m_FreeList = nodeIndex;
+	}
+
+	void SpatialIndex::InsertLeaf(uint32_t leaf)
+	{
+		if (m_Root == NULL_NODE)
+		{
+			m_Root = leaf;
+			m_Nodes[leaf].parent = NULL_NODE;
+			return;
+		}
+
+		// Descends while pushing the leaf further down costs less than pairing it with the current node
+		const AABB leafBounds = m_Nodes[leaf].bounds;
+		uint32_t sibling = m_Root;
+		while (!m_Nodes[sibling].IsLeaf())
+		{
+			const Node& node = m_Nodes[sibling];
+			const float area = node.bounds.GetSurfaceArea();
+			const float combinedArea = node.bounds.GetMerged(leafBounds).GetSurfaceArea();
+
+			// A new parent for this node and the leaf
+			const float cost = 2.f * combinedArea;
+			// Every ancestor below here grows by the leaf as well
+			const float inheritanceCost = 2.f * (combinedArea - area);
+
+			const auto getDescendCost = [&](uint32_t childIndex)
+			{
+				const Node& child = m_Nodes[childIndex];
+				const float mergedArea = child.bounds.GetMerged(leafBounds).GetSurfaceArea();
+				return (child.IsLeaf() ? mergedArea : mergedArea - child.bounds.GetSurfaceArea()) + inheritanceCost;
+			};
+
+			const float cost1 = getDescendCost(node.child1);
+			const float cost2 = getDescendCost(node.child2);
+			if (cost < cost1 && cost < cost2) break;
+
+			sibling = cost1 < cost2 ? node.child1 : node.child2;
+		}
+
+		const uint32_t oldParent = m_Nodes[sibling].parent;
+		const uint32_t newParent = AllocateNode();
+
+		Node& parentNode = m_Nodes[newParent];
+		parentNode.parent = oldParent;
+		parentNode.bounds = m_Nodes[sibling].bounds.GetMerged(leafBounds);
+		parentNode.height = m_Nodes[sibling].height + 1;
+		parentNode.child1 = sibling;
+		parentNode.child2 = leaf;
+
+		if (oldParent == NULL_NODE) m_Root = newParent;
+		else if (m_Nodes[oldParent].child1 == sibling) m_Nodes[oldParent].child1 = newParent;
+		else m_Nodes[oldParent].child2 = newParent;
+
+		m_Nodes[sibling].parent = newParent;
+		m_Nodes[leaf].parent = newParent;
+
+		RefitAncestors(newParent);
+	}
+
+	void SpatialIndex::RemoveLeaf(uint32_t leaf)
+	{
+		if (leaf == m_Root)
+		{
+			m_Root = NULL_NODE;
+			return;
+		}
+
+		// The sibling takes the place of the parent
+		const uint32_t parent = m_Nodes[leaf].parent;
+		const uint32_t grandParent = m_Nodes[parent].parent;
+		const uint32_t sibling = m_Nodes[parent].child1 == leaf ? m_Nodes[parent].child2 : m_Nodes[parent].child1;
+
+		if (grandParent == NULL_NODE) m_Root = sibling;
+		else if (m_Nodes[grandParent].child1 == parent) m_Nodes[grandParent].child1 = sibling;
+		else m_Nodes[grandParent].child2 = sibling;
+
+		m_Nodes[sibling].parent = grandParent;
+		FreeNode(parent);
+
+		RefitAncestors(grandParent);
+	}
+
+	void SpatialIndex::RefitAncestors(uint32_t nodeIndex)
+	{
+		while (nodeIndex != NULL_NODE)
+		{
+			nodeIndex = Balance(nodeIndex);
+
+			Node& node = m_Nodes[nodeIndex];
+			const Node& child1 = m_Nodes[node.child1];
+			const Node& child2 = m_Nodes[node.child2];
+			node.bounds = child1.bounds.GetMerged(child2.bounds);
+			node.height = 1 + std::max(child1.height, child2.height);
+
+			nodeIndex = node.parent;
+		}
+	}
+
+	uint32_t SpatialIndex::Balance(uint32_t indexA)
+	{
+		// A left or right rotation of A, the taller child takes its place
+		Node& a = m_Nodes[indexA];
+		if (a.IsLeaf() || a.height < 2) return indexA;
+
+		const uint32_t indexB = a.child1;
+		const uint32_t indexC = a.child2;
+		Node& b = m_Nodes[indexB];
+		Node& c = m_Nodes[indexC];
+
+		const int32_t balance = c.height - b.height;
+		if (balance >= -1 && balance <= 1) return indexA;
+
+		const bool isCUp = balance > 1;
+		const uint32_t indexUp = isCUp ? indexC : indexB;
+		Node& up = isCUp ? c : b;
+		const Node& stay = isCUp ? b : c;
+
+		const uint32_t indexF = up.child1;
+		const uint32_t indexG = up.child2;
+		Node& f = m_Nodes[indexF];
+		Node& g = m_Nodes[indexG];
+
+		// The risen node takes A's place under A's parent
+		up.child1 = indexA;
+		up.parent = a.parent;
+		a.parent = indexUp;
+
+		if (up.parent == NULL_NODE) m_Root = indexUp;
+		else if (m_Nodes[up.parent].child1 == indexA) m_Nodes[up.parent].child1 = indexUp;
+		else m_Nodes[up.parent].child2 = indexUp;
+
+		// The taller grandchild stays with the risen node, the other one moves under A
+		const bool keepsF = f.height > g.height;
+		const uint32_t indexKept = keepsF ? indexF : indexG;
+		const uint32_t indexMoved = keepsF ? indexG : indexF;
+		Node& kept = keepsF ? f : g;
+		Node& moved = keepsF ? g : f;
+
+		up.child2 = indexKept;
+		if (isCUp) a.child2 = indexMoved;
+		else a.child1 = indexMoved;
+		moved.parent = indexA;
+
+		a.bounds = stay.bounds.GetMerged(moved.bounds);
+		a.height = 1 + std::max(stay.height, moved.height);
+		up.bounds = a.bounds.GetMerged(kept.bounds);
+		up.height = 1 + std::max(a.height, kept.height);
+
+		return indexUp;
+	}
+
+	AABB SpatialIndex::GetFatBounds(const AABB& bounds) const
+	{
+		return AABB{ bounds.min - m_Margin, bounds.max + m_Margin };
+	}
+}
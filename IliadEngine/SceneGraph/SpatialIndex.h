@@ -0,0 +1,209 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Bounds.h"
+#include "Core/SmallStack.h"
+
+namespace ili
+{
+	class GameObject;
+
+	/**
+	 * Dynamic bounding volume tree over the bounds of scene objects. Leaves store a box grown by a margin,
+	 * so an object that moves a little keeps its leaf and only objects that leave their box are reinserted.
+	 * Inserts descend towards the sibling with the lowest surface area cost and rotations on the way back up
+	 * keep the tree balanced. Once the summed area of the inner nodes grew too far past the one of the last rebuild
+	 * the tree is rebuilt top-down with a binned surface area heuristic. Queries only open the nodes whose box they touch
+	 */
+	class SpatialIndex final
+	{
+	public:
+		// A proxy is the index of its leaf, it stays the same until the object is removed
+		static constexpr uint32_t NULL_PROXY = UINT32_MAX;
+
+		// The margin every leaf box is grown by on each side
+		explicit SpatialIndex(float margin = .2f);
+		~SpatialIndex() = default;
+
+		SpatialIndex(const SpatialIndex& other) = delete;
+		SpatialIndex(SpatialIndex&& other) noexcept = delete;
+		SpatialIndex& operator=(const SpatialIndex& other) = delete;
+		SpatialIndex& operator=(SpatialIndex&& other) noexcept = delete;
+
+		uint32_t Insert(const AABB& bounds, GameObject* pGameObject);
+		void Remove(uint32_t proxy);
+		// Reinserts the object when the bounds left its leaf box, or when the box grew far too large for them
+		void Move(uint32_t proxy, const AABB& bounds);
+
+		// Rebuilds the tree with the surface area heuristic once its area ratio grew too far past the one of the last rebuild,
+		// a scene that was just filled gets a good tree on its first update
+		void RebuildIfDegraded();
+		void Rebuild();
+
+		// The callbacks take the GameObject*, results are exact against the bounds the objects were inserted with
+		template <typename Callback>
+		void QueryFrustum(const Frustum& frustum, Callback&& callback) const;
+		template <typename Callback>
+		void QuerySphere(const Sphere& sphere, Callback&& callback) const;
+		template <typename Callback>
+		void QueryAABB(const AABB& box, Callback&& callback) const;
+		/**
+		 * Visits the objects whose bounds the ray hits closer than maxDistance, in no particular order.
+		 * The callback takes the GameObject* and the distance the ray enters the bounds at and returns the new
+		 * maximum distance, return the distance of a closer hit to skip everything behind it
+		 */
+		template <typename Callback>
+		void QueryRay(const Ray& ray, float maxDistance, Callback&& callback) const;
+
+		GameObject* GetGameObject(uint32_t proxy) const { return m_Nodes[proxy].pGameObject; }
+		const AABB& GetBounds(uint32_t proxy) const { return m_Nodes[proxy].tightBounds; }
+
+		uint32_t GetProxyCount() const { return m_ProxyCount; }
+		// Zero for a single object, the number of nodes on the longest path below the root otherwise
+		uint32_t GetHeight() const { return m_Root == NULL_NODE ? 0 : static_cast<uint32_t>(m_Nodes[m_Root].height); }
+		// The sum of the surface areas of all inner nodes over the one of the root, lower is better
+		float GetAreaRatio() const;
+
+	private:
+		static constexpr uint32_t NULL_NODE = UINT32_MAX;
+
+		struct Node
+		{
+			// Grown by the margin for leaves
+			AABB bounds{};
+			// What the object was inserted with, only set for leaves
+			AABB tightBounds{};
+			// Null for inner nodes
+			GameObject* pGameObject{};
+			// The next free node while the node is unused
+			uint32_t parent{ NULL_NODE };
+			uint32_t child1{ NULL_NODE };
+			uint32_t child2{ NULL_NODE };
+			// Zero for leaves, -1 while the node is unused
+			int32_t height{ -1 };
+
+			bool IsLeaf() const { return child1 == NULL_NODE; }
+		};
+
+		uint32_t AllocateNode();
+		void FreeNode(uint32_t nodeIndex);
+		void InsertLeaf(uint32_t leaf);
+		void RemoveLeaf(uint32_t leaf);
+		// Refits the boxes and heights from the node up to the root, rotating where the heights got unbalanced
+		void RefitAncestors(uint32_t nodeIndex);
+		// Returns the node that took the place of nodeIndex
+		uint32_t Balance(uint32_t nodeIndex);
+		AABB GetFatBounds(const AABB& bounds) const;
+
+		// Visits the leaves whose boxes pass the test, the test also has to accept every tight box it is called with
+		template <typename Overlaps, typename Callback>
+		void Query(const Overlaps& overlaps, Callback&& callback) const;
+
+		std::vector<Node> m_Nodes{};
+		uint32_t m_Root{ NULL_NODE };
+		uint32_t m_FreeList{ NULL_NODE };
+		uint32_t m_ProxyCount{};
+		// The area ratio right after the last rebuild, zero before the first one and after the tree was emptied
+		float m_RebuildAreaRatio{};
+		// Set by inserts, reinserts and removals, the area ratio is only measured again after the tree changed
+		bool m_HasChanged{};
+		float m_Margin;
+	};
+
+	template <typename Overlaps, typename Callback>
+	void SpatialIndex::Query(const Overlaps& overlaps, Callback&& callback) const
+	{
+		if (m_Root == NULL_NODE) return;
+
+		SmallStack<uint32_t> stack{};
+		stack.Push(m_Root);
+		while (!stack.IsEmpty())
+		{
+			const Node& node = m_Nodes[stack.Pop()];
+			if (!overlaps(node.bounds)) continue;
+
+			if (node.IsLeaf())
+			{
+				if (overlaps(node.tightBounds)) callback(node.pGameObject);
+				continue;
+			}
+			stack.Push(node.child1);
+			stack.Push(node.child2);
+		}
+	}
+
+	template <typename Callback>
+	void SpatialIndex::QueryFrustum(const Frustum& frustum, Callback&& callback) const
+	{
+		if (m_Root == NULL_NODE) return;
+
+		// The high bit marks a node inside of the frustum, its whole subtree is visited without further tests
+		static constexpr uint32_t INSIDE_BIT = 1u << 31;
+
+		SmallStack<uint32_t> stack{};
+		stack.Push(m_Root);
+		while (!stack.IsEmpty())
+		{
+			const uint32_t entry = stack.Pop();
+			const Node& node = m_Nodes[entry & ~INSIDE_BIT];
+			bool isInside = entry & INSIDE_BIT;
+
+			if (node.IsLeaf())
+			{
+				if (isInside || frustum.Intersects(node.tightBounds)) callback(node.pGameObject);
+				continue;
+			}
+			if (!isInside)
+			{
+				if (!frustum.Intersects(node.bounds)) continue;
+				isInside = frustum.Contains(node.bounds);
+			}
+			stack.Push(node.child1 | (isInside ? INSIDE_BIT : 0));
+			stack.Push(node.child2 | (isInside ? INSIDE_BIT : 0));
+		}
+	}
+
+	template <typename Callback>
+	void SpatialIndex::QuerySphere(const Sphere& sphere, Callback&& callback) const
+	{
+		Query([&sphere](const AABB& bounds) { return bounds.Intersects(sphere); }, std::forward<Callback>(callback));
+	}
+
+	template <typename Callback>
+	void SpatialIndex::QueryAABB(const AABB& box, Callback&& callback) const
+	{
+		Query([&box](const AABB& bounds) { return bounds.Intersects(box); }, std::forward<Callback>(callback));
+	}
+
+	template <typename Callback>
+	void SpatialIndex::QueryRay(const Ray& ray, float maxDistance, Callback&& callback) const
+	{
+		if (m_Root == NULL_NODE) return;
+
+		const glm::vec3 inverseDirection = ray.GetInverseDirection();
+
+		SmallStack<uint32_t> stack{};
+		stack.Push(m_Root);
+		while (!stack.IsEmpty())
+		{
+			const Node& node = m_Nodes[stack.Pop()];
+
+			float entryDistance{};
+			if (!Ray::IntersectsBox(ray.origin, inverseDirection, node.bounds, maxDistance, entryDistance)) continue;
+
+			if (node.IsLeaf())
+			{
+				if (Ray::IntersectsBox(ray.origin, inverseDirection, node.tightBounds, maxDistance, entryDistance))
+				{
+					maxDistance = callback(node.pGameObject, entryDistance);
+				}
+				continue;
+			}
+			stack.Push(node.child1);
+			stack.Push(node.child2);
+		}
+	}
+}
@@ -1,4 +1,7 @@
 ﻿#include "TransformComponent.h"
+#include "TransformHierarchy.h"
+#include "TransformKernels.h"
+#include <cassert>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/constants.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -30,60 +33,98 @@ namespace ili
     void TransformComponent::SetPosition(const glm::vec3& newPosition)
     {
         m_Position = newPosition;
+        MarkDirty();
     }
 
     void TransformComponent::SetScale(const glm::vec3& newScale)
     {
         m_Scale = newScale;
+        MarkDirty();
     }
 
     void TransformComponent::SetRotationDegrees(const glm::vec3& newRotationDegrees)
     {
         m_RotationRadians = glm::radians(newRotationDegrees);
+        MarkDirty();
     }
 
     // Transformation Methods
     void TransformComponent::Translate(const glm::vec3& delta)
     {
         m_Position += delta;
+        MarkDirty();
     }
 
     void TransformComponent::ScaleBy(const glm::vec3& scaleFactor)
     {
         m_Scale *= scaleFactor;
+        MarkDirty();
     }
 
     void TransformComponent::RotateDegrees(const glm::vec3& deltaDegrees)
     {
         m_RotationRadians += glm::radians(deltaDegrees);
+        MarkDirty();
     }
 
-    // Matrix Calculations
-    glm::mat4 TransformComponent::GetMatrix() const
+    void TransformComponent::SetParent(TransformComponent* pParent)
     {
-        // Start with an identity matrix
-        glm::mat4 modelMatrix = glm::mat4(1.0f);
+        assert(m_pHierarchy && "Only transforms of scene objects can have a parent");
+        m_pHierarchy->SetParent(this, pParent);
+    }
 
-        // Apply translation
-        modelMatrix = glm::translate(modelMatrix, m_Position);
+    void TransformComponent::MarkDirty()
+    {
+        m_IsDirty = true;
+        if (m_pHierarchy) m_pHierarchy->MarkDirty(*this);
+    }
 
-        // Apply rotation in Y-X-Z order
-        modelMatrix = glm::rotate(modelMatrix, m_RotationRadians.y, glm::vec3(0.0f, 1.0f, 0.0f)); // Y-axis
-        modelMatrix = glm::rotate(modelMatrix, m_RotationRadians.x, glm::vec3(1.0f, 0.0f, 0.0f)); // X-axis
-        modelMatrix = glm::rotate(modelMatrix, m_RotationRadians.z, glm::vec3(0.0f, 0.0f, 1.0f)); // Z-axis
+    void TransformComponent::MarkBoundsDirty()
+    {
+        // Not in a scene yet, it gets its bounds with the first update after it is added
+        if (m_pHierarchy) m_pHierarchy->MarkMoved(this);
+    }
 
-        // Apply scaling
-        modelMatrix = glm::scale(modelMatrix, m_Scale);
+    // Matrix Calculations
+    const glm::mat4& TransformComponent::GetMatrix() const
+    {
+        if (m_pHierarchy) return m_pHierarchy->GetWorldMatrix(*this);
+
+        if (m_IsDirty)
+        {
+            RecomputeMatrices();
+            s_RecomputeCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        return m_Matrix;
+    }
 
-        return modelMatrix;
+    const glm::mat3& TransformComponent::GetNormalMatrix() const
+    {
+        if (m_pHierarchy) return m_pHierarchy->GetWorldNormalMatrix(*this);
+
+        if (m_IsDirty)
+        {
+            RecomputeMatrices();
+            s_RecomputeCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        return m_NormalMatrix;
     }
 
+    const glm::mat4& TransformComponent::GetLocalMatrix() const
+    {
+        if (m_IsDirty) RecomputeMatrices();
+        return m_Matrix;
+    }
+
+    const glm::mat3& TransformComponent::GetLocalNormalMatrix() const
+    {
+        if (m_IsDirty) RecomputeMatrices();
+        return m_NormalMatrix;
+    }
 
-    glm::mat3 TransformComponent::GetNormalMatrix() const
+    void TransformComponent::RecomputeMatrices() const
     {
-        // The normal matrix is the transpose of the inverse of the upper-left 3x3 of the model matrix
-        const glm::mat4 modelMatrix = GetMatrix();
-        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
-        return normalMatrix;
+        ComputeTransformMatrix(m_Position, m_RotationRadians, m_Scale, m_Matrix, m_NormalMatrix);
+        m_IsDirty = false;
     }
 }
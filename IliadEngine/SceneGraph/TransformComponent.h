@@ -1,10 +1,20 @@
 ﻿#pragma once
 
 #include "BaseComponent.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
 #include <glm/glm.hpp>
 
 namespace ili
 {
+    class TransformHierarchy;
+
+    /**
+     * Position, rotation and scale relative to the parent, or to the world without one.
+     * Caches its matrices, they are only rebuilt on the first request after the transform changed.
+     * Transforms of scene objects live in the scene's TransformHierarchy, which propagates the world matrices
+     */
     class TransformComponent : public BaseComponent
     {
     public:
@@ -17,33 +27,68 @@ namespace ili
         TransformComponent(TransformComponent&&) noexcept = delete;
         TransformComponent& operator=(TransformComponent&&) noexcept = delete;
 
-        // Getters
+        // Getters, all relative to the parent
         glm::vec3 GetPosition() const;
         glm::vec3 GetScale() const;
         glm::vec3 GetRotationDegrees() const;
 		glm::vec3 GetRotationRadians() const { return m_RotationRadians; }
+        glm::vec3 GetWorldPosition() const { return glm::vec3{ GetMatrix()[3] }; }
 
         // Setters
         void SetPosition(const glm::vec3& newPosition);
         void SetScale(const glm::vec3& newScale);
         void SetRotationDegrees(const glm::vec3& newRotationDegrees);
-		void SetRotationRadians(const glm::vec3& newRotationRadians) { m_RotationRadians = newRotationRadians; }
+		void SetRotationRadians(const glm::vec3& newRotationRadians) { m_RotationRadians = newRotationRadians; MarkDirty(); }
 
         // Transformation Methods
         void Translate(const glm::vec3& delta);
         void ScaleBy(const glm::vec3& scaleFactor);
         void RotateDegrees(const glm::vec3& deltaDegrees);
 
-        // Matrix Calculations
-        glm::mat4 GetMatrix() const;
-        glm::mat3 GetNormalMatrix() const;
+        // Attaches to the parent, the local transform is kept and becomes relative to it. Null detaches.
+        // Both transforms have to belong to the same scene
+        void SetParent(TransformComponent* pParent);
+        TransformComponent* GetParent() const { return m_pParent; }
+        const std::vector<TransformComponent*>& GetChildren() const { return m_pChildren; }
+
+        // Matrix Calculations, world space
+        const glm::mat4& GetMatrix() const;
+        const glm::mat3& GetNormalMatrix() const;
+        // Relative to the parent
+        const glm::mat4& GetLocalMatrix() const;
+        const glm::mat3& GetLocalNormalMatrix() const;
+
+        // For bounds that changed without a move, a new model for instance. The scene refits them on its next transform update
+        void MarkBoundsDirty();
+
+        // Number of transforms that rebuilt their matrices since the last call, the game reads it once per frame
+        static uint32_t ConsumeRecomputeCount() { return s_RecomputeCount.exchange(0, std::memory_order_relaxed); }
 
     protected:
         void Initialize() override;
 
     private:
+        friend class TransformHierarchy;
+
+        void MarkDirty();
+        void RecomputeMatrices() const;
+
         glm::vec3 m_Position{ 0.0f, 0.0f, 0.0f };
         glm::vec3 m_Scale{ 1.0f, 1.0f, 1.0f };
         glm::vec3 m_RotationRadians{ 0.0f, 0.0f, 0.0f }; // Stored internally in radians
+
+        mutable glm::mat4 m_Matrix{ 1.0f };
+        mutable glm::mat3 m_NormalMatrix{ 1.0f };
+        mutable bool m_IsDirty{ true };
+
+        // Set while the transform belongs to a scene, together with its position in the hierarchy's arrays
+        TransformHierarchy* m_pHierarchy{};
+        uint32_t m_NodeIndex{};
+        // Position in the hierarchy's moved transforms, UINT32_MAX while the transform is not listed
+        uint32_t m_MovedIndex{ UINT32_MAX };
+        TransformComponent* m_pParent{};
+        std::vector<TransformComponent*> m_pChildren{};
+
+        static inline std::atomic<uint32_t> s_RecomputeCount{};
     };
 }
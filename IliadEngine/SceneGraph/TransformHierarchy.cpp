@@ -0,0 +1,427 @@
+﻿#include "TransformHierarchy.h"
+#include "TransformComponent.h"
+#include "TransformKernels.h"
+#include "Core/JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <ranges>
+
+namespace ili
+{
+	TransformHierarchy::TransformHierarchy(bool tracksMovedTransforms) : m_TracksMovedTransforms(tracksMovedTransforms)
+	{
+	}
+
+	void TransformHierarchy::Add(TransformComponent* pTransform)
+	{
+		assert(!pTransform->m_pHierarchy && "The transform already belongs to a hierarchy");
+		pTransform->m_pHierarchy = this;
+
+		// A new root can go after every other subtree without changing the layout
+		const uint32_t nodeIndex = static_cast<uint32_t>(m_pTransforms.size());
+		pTransform->m_NodeIndex = nodeIndex;
+		m_pTransforms.push_back(pTransform);
+		m_Parents.push_back(NO_PARENT);
+		m_SubtreeEnds.push_back(nodeIndex + 1);
+		m_WorldMatrices.emplace_back(1.f);
+		m_NormalMatrices.emplace_back(1.f);
+		m_Dirty.push_back(1);
+		m_DirtyRoots.push_back(nodeIndex);
+		m_HasDirtyNodes = true;
+
+		if (!m_ParallelRanges.empty())
+		{
+			if (m_ParallelRanges.back().second == nodeIndex) ++m_ParallelRanges.back().second;
+			else m_SerialNodes.push_back(nodeIndex);
+		}
+
+		// The ranges are split again once the hierarchy has doubled, so growing it stays linear overall
+		if (m_pTransforms.size() >= PARALLEL_NODE_THRESHOLD && m_pTransforms.size() >= 2 * m_SplitNodeCount) m_IsStructureDirty = true;
+	}
+
+	void TransformHierarchy::Remove(TransformComponent* pTransform)
+	{
+		assert(pTransform->m_pHierarchy == this && "The transform belongs to another hierarchy");
+
+		// Unlinked without touching the layout, the children become roots where they are
+		if (pTransform->m_pParent)
+		{
+			std::erase(pTransform->m_pParent->m_pChildren, pTransform);
+			pTransform->m_pParent = nullptr;
+		}
+		for (TransformComponent* pChild : pTransform->m_pChildren)
+		{
+			pChild->m_pParent = nullptr;
+			m_Parents[pChild->m_NodeIndex] = NO_PARENT;
+			MarkDirty(*pChild);
+		}
+		pTransform->m_pChildren.clear();
+
+		const uint32_t movedIndex = pTransform->m_MovedIndex;
+		if (movedIndex != NOT_MOVED)
+		{
+			m_pMovedTransforms[movedIndex] = m_pMovedTransforms.back();
+			m_pMovedTransforms[movedIndex]->m_MovedIndex = movedIndex;
+			m_pMovedTransforms.pop_back();
+			pTransform->m_MovedIndex = NOT_MOVED;
+		}
+
+		// The node stays behind as a gap that is never updated, the gaps are closed once they make up a quarter of the nodes
+		const uint32_t nodeIndex = pTransform->m_NodeIndex;
+		m_pTransforms[nodeIndex] = nullptr;
+		m_Dirty[nodeIndex] = 0;
+		++m_RemovedCount;
+		if (4 * m_RemovedCount > m_pTransforms.size()) m_IsStructureDirty = true;
+
+		pTransform->m_pHierarchy = nullptr;
+		pTransform->m_IsDirty = true;
+	}
+
+	void TransformHierarchy::SetParent(TransformComponent* pChild, TransformComponent* pParent)
+	{
+		assert((!pParent || pParent->m_pHierarchy == this) && "Parent and child have to belong to the same scene");
+		if (pChild->m_pParent == pParent) return;
+
+		for (const TransformComponent* pAncestor = pParent; pAncestor; pAncestor = pAncestor->m_pParent)
+		{
+			assert(pAncestor != pChild && "A transform cannot become a child of its own descendant");
+		}
+
+		// Marked in the current layout, the rebuild carries the dirty nodes over to the new one
+		MarkDirty(*pChild);
+
+		if (pChild->m_pParent) std::erase(pChild->m_pParent->m_pChildren, pChild);
+		pChild->m_pParent = pParent;
+		if (pParent) pParent->m_pChildren.push_back(pChild);
+
+		m_IsStructureDirty = true;
+	}
+
+	void TransformHierarchy::MarkDirty(const TransformComponent& transform)
+	{
+		const uint32_t nodeIndex = transform.m_NodeIndex;
+		if (m_Dirty[nodeIndex]) return;
+
+		std::memset(m_Dirty.data() + nodeIndex, 1, m_SubtreeEnds[nodeIndex] - nodeIndex);
+		m_DirtyRoots.push_back(nodeIndex);
+		m_HasDirtyNodes = true;
+	}
+
+	void TransformHierarchy::MarkMoved(TransformComponent* pTransform)
+	{
+		if (m_TracksMovedTransforms) AddMovedTransform(pTransform);
+	}
+
+	void TransformHierarchy::AddMovedTransform(TransformComponent* pTransform)
+	{
+		if (pTransform->m_MovedIndex != NOT_MOVED) return;
+
+		pTransform->m_MovedIndex = static_cast<uint32_t>(m_pMovedTransforms.size());
+		m_pMovedTransforms.push_back(pTransform);
+	}
+
+	void TransformHierarchy::ClearMovedTransforms()
+	{
+		for (TransformComponent* pTransform : m_pMovedTransforms) pTransform->m_MovedIndex = NOT_MOVED;
+		m_pMovedTransforms.clear();
+	}
+
+	const glm::mat4& TransformHierarchy::GetWorldMatrix(const TransformComponent& transform)
+	{
+		if (m_IsStructureDirty) Rebuild();
+		UpdateNode(transform.m_NodeIndex);
+		return m_WorldMatrices[transform.m_NodeIndex];
+	}
+
+	const glm::mat3& TransformHierarchy::GetWorldNormalMatrix(const TransformComponent& transform)
+	{
+		if (m_IsStructureDirty) Rebuild();
+		UpdateNode(transform.m_NodeIndex);
+		return m_NormalMatrices[transform.m_NodeIndex];
+	}
+
+	void TransformHierarchy::Rebuild()
+	{
+		const size_t nodeCount = GetNodeCount();
+
+		std::vector<TransformComponent*> pOrdered{};
+		pOrdered.reserve(nodeCount);
+		std::vector<glm::mat4> worldMatrices(nodeCount);
+		std::vector<glm::mat3> normalMatrices(nodeCount);
+		std::vector<uint8_t> dirty(nodeCount);
+		m_Parents.assign(nodeCount, NO_PARENT);
+		m_SubtreeEnds.assign(nodeCount, 0);
+		m_DirtyRoots.clear();
+		m_HasDirtyNodes = false;
+
+		// Iterative depth-first walk from every root, in the order the roots are stored
+		std::vector<std::pair<TransformComponent*, uint32_t>> stack{};
+		for (TransformComponent* pRoot : m_pTransforms)
+		{
+			if (!pRoot || pRoot->m_pParent) continue;
+
+			stack.emplace_back(pRoot, NO_PARENT);
+			while (!stack.empty())
+			{
+				const auto [pTransform, parentIndex] = stack.back();
+				stack.pop_back();
+
+				// Matrices and dirty state move along with the node, only nodes that were marked dirty are recomputed.
+				// Children of a dirty node are dirty as well, whatever they were before they were moved under it
+				const uint32_t nodeIndex = static_cast<uint32_t>(pOrdered.size());
+				const uint32_t previousIndex = pTransform->m_NodeIndex;
+				worldMatrices[nodeIndex] = m_WorldMatrices[previousIndex];
+				normalMatrices[nodeIndex] = m_NormalMatrices[previousIndex];
+				dirty[nodeIndex] = m_Dirty[previousIndex] || (parentIndex != NO_PARENT && dirty[parentIndex]);
+				m_HasDirtyNodes = m_HasDirtyNodes || dirty[nodeIndex];
+				if (dirty[nodeIndex] && (parentIndex == NO_PARENT || !dirty[parentIndex])) m_DirtyRoots.push_back(nodeIndex);
+
+				pTransform->m_NodeIndex = nodeIndex;
+				pOrdered.push_back(pTransform);
+				m_Parents[nodeIndex] = parentIndex;
+
+				// Reversed so the children keep their order
+				for (auto it = pTransform->m_pChildren.rbegin(); it != pTransform->m_pChildren.rend(); ++it)
+				{
+					stack.emplace_back(*it, nodeIndex);
+				}
+			}
+		}
+		assert(pOrdered.size() == nodeCount && "Every transform has to be reachable from a root");
+		m_pTransforms = std::move(pOrdered);
+		m_WorldMatrices = std::move(worldMatrices);
+		m_NormalMatrices = std::move(normalMatrices);
+		m_Dirty = std::move(dirty);
+		m_RemovedCount = 0;
+
+		// A subtree ends where its parent's ends, or where the next sibling begins
+		for (uint32_t nodeIndex = static_cast<uint32_t>(nodeCount); nodeIndex-- > 0;)
+		{
+			if (m_SubtreeEnds[nodeIndex] == 0) m_SubtreeEnds[nodeIndex] = nodeIndex + 1;
+			const uint32_t parentIndex = m_Parents[nodeIndex];
+			if (parentIndex != NO_PARENT) m_SubtreeEnds[parentIndex] = std::max(m_SubtreeEnds[parentIndex], m_SubtreeEnds[nodeIndex]);
+		}
+
+		SplitIntoRanges();
+		m_IsStructureDirty = false;
+	}
+
+	void TransformHierarchy::SplitIntoRanges()
+	{
+		m_SerialNodes.clear();
+		m_ParallelRanges.clear();
+
+		const uint32_t nodeCount = GetNodeCount();
+		m_SplitNodeCount = nodeCount;
+		const uint32_t threadCount = JobSystem::GetInstance().GetThreadCount();
+		if (nodeCount < PARALLEL_NODE_THRESHOLD || threadCount == 1) return;
+
+		std::vector<uint32_t> depths(nodeCount);
+		uint32_t maxDepth{};
+		for (uint32_t nodeIndex{}; nodeIndex < nodeCount; ++nodeIndex)
+		{
+			const uint32_t parentIndex = m_Parents[nodeIndex];
+			depths[nodeIndex] = parentIndex == NO_PARENT ? 0 : depths[parentIndex] + 1;
+			maxDepth = std::max(maxDepth, depths[nodeIndex]);
+		}
+
+		// The shallowest depth with enough subtrees to keep every thread busy, a single chain cannot be split
+		std::vector<uint32_t> nodesPerDepth(maxDepth + 1);
+		for (const uint32_t depth : depths) ++nodesPerDepth[depth];
+		const auto splitIt = std::ranges::find_if(nodesPerDepth, [threadCount](uint32_t count) { return count >= 4 * threadCount; });
+		if (splitIt == nodesPerDepth.end()) return;
+		const uint32_t splitDepth = static_cast<uint32_t>(splitIt - nodesPerDepth.begin());
+
+		// Neighbouring subtrees are merged until a range holds about a quarter of a thread's share
+		const uint32_t targetRangeSize = std::max(nodeCount / (4 * threadCount), 1u);
+		for (uint32_t nodeIndex{}; nodeIndex < nodeCount;)
+		{
+			if (depths[nodeIndex] < splitDepth)
+			{
+				m_SerialNodes.push_back(nodeIndex++);
+				continue;
+			}
+
+			const uint32_t end = m_SubtreeEnds[nodeIndex];
+			if (!m_ParallelRanges.empty() && m_ParallelRanges.back().second == nodeIndex &&
+				m_ParallelRanges.back().second - m_ParallelRanges.back().first < targetRangeSize)
+			{
+				m_ParallelRanges.back().second = end;
+			}
+			else
+			{
+				m_ParallelRanges.emplace_back(nodeIndex, end);
+			}
+			nodeIndex = end;
+		}
+	}
+
+	bool TransformHierarchy::CollectDirtyRanges()
+	{
+		m_DirtyRanges.clear();
+		if (static_cast<size_t>(NODES_PER_DIRTY_ROOT) * m_DirtyRoots.size() > m_pTransforms.size()) return false;
+
+		// Subtrees are either nested or disjoint, also those of removed nodes and of roots added since the last rebuild,
+		// so a root inside of the previous range adds nothing
+		std::ranges::sort(m_DirtyRoots);
+		uint32_t dirtyCount{};
+		for (const uint32_t nodeIndex : m_DirtyRoots)
+		{
+			if (!m_DirtyRanges.empty() && nodeIndex < m_DirtyRanges.back().second) continue;
+
+			const uint32_t end = m_SubtreeEnds[nodeIndex];
+			dirtyCount += end - nodeIndex;
+			if (!m_DirtyRanges.empty() && nodeIndex == m_DirtyRanges.back().second) m_DirtyRanges.back().second = end;
+			else m_DirtyRanges.emplace_back(nodeIndex, end);
+		}
+
+		// Enough work to be worth the threads, the parallel ranges share it out evenly
+		return m_ParallelRanges.empty() || dirtyCount < PARALLEL_NODE_THRESHOLD;
+	}
+
+	void TransformHierarchy::Update()
+	{
+		if (m_IsStructureDirty) Rebuild();
+		if (!m_HasDirtyNodes) return;
+
+		uint32_t updatedCount{};
+		if (CollectDirtyRanges())
+		{
+			// Parents come before their children within a range, and no range holds the parent of a node in another one
+			m_RangeMovedTransforms.resize(1);
+			ComputeLocalMatrices(m_DirtyRanges | std::views::transform([](const std::pair<uint32_t, uint32_t>& range)
+			{
+				return std::views::iota(range.first, range.second);
+			}) | std::views::join);
+			for (const auto& [begin, end] : m_DirtyRanges) updatedCount += UpdateWorldMatrices(begin, end, m_RangeMovedTransforms.front());
+		}
+		else if (m_ParallelRanges.empty())
+		{
+			m_RangeMovedTransforms.resize(1);
+			updatedCount = UpdateRange(0, static_cast<uint32_t>(m_pTransforms.size()), m_RangeMovedTransforms.front());
+		}
+		else
+		{
+			ComputeLocalMatrices(m_SerialNodes);
+			for (const uint32_t nodeIndex : m_SerialNodes)
+			{
+				if (!m_Dirty[nodeIndex] || !m_pTransforms[nodeIndex]) continue;
+				UpdateWorldMatrix(nodeIndex);
+				if (m_TracksMovedTransforms) AddMovedTransform(m_pTransforms[nodeIndex]);
+				++updatedCount;
+			}
+
+			// Every thread of the job system takes ranges until none are left, the calling thread works along
+			m_RangeMovedTransforms.resize(m_ParallelRanges.size());
+			std::atomic<uint32_t> parallelCount{};
+			JobSystem::GetInstance().ParallelFor(static_cast<uint32_t>(m_ParallelRanges.size()), 1, [this, &parallelCount](uint32_t begin, uint32_t end)
+			{
+				uint32_t count{};
+				for (uint32_t rangeIndex = begin; rangeIndex < end; ++rangeIndex)
+				{
+					count += UpdateRange(m_ParallelRanges[rangeIndex].first, m_ParallelRanges[rangeIndex].second, m_RangeMovedTransforms[rangeIndex]);
+				}
+				parallelCount += count;
+			});
+			updatedCount += parallelCount;
+		}
+
+		for (std::vector<TransformComponent*>& pRangeMovedTransforms : m_RangeMovedTransforms)
+		{
+			for (TransformComponent* pTransform : pRangeMovedTransforms) AddMovedTransform(pTransform);
+			pRangeMovedTransforms.clear();
+		}
+
+		m_DirtyRoots.clear();
+		m_HasDirtyNodes = false;
+		TransformComponent::s_RecomputeCount.fetch_add(updatedCount, std::memory_order_relaxed);
+	}
+
+	template <typename NodeIndices>
+	void TransformHierarchy::ComputeLocalMatrices(NodeIndices&& nodeIndices)
+	{
+		// One batch per thread that updates ranges, kept to reuse its memory
+		thread_local std::vector<TransformComponent*> pStaleTransforms{};
+		thread_local TransformBatch batch{};
+
+		pStaleTransforms.clear();
+		batch.Clear();
+		for (const uint32_t nodeIndex : nodeIndices)
+		{
+			TransformComponent* pTransform = m_pTransforms[nodeIndex];
+			if (!m_Dirty[nodeIndex] || !pTransform || !pTransform->m_IsDirty) continue;
+
+			pStaleTransforms.push_back(pTransform);
+			batch.Add(pTransform->m_Position, pTransform->m_RotationRadians, pTransform->m_Scale);
+		}
+		if (pStaleTransforms.empty()) return;
+
+		ComputeTransformMatrices(batch);
+		for (size_t i{}; i < pStaleTransforms.size(); ++i)
+		{
+			pStaleTransforms[i]->m_Matrix = batch.matrices[i];
+			pStaleTransforms[i]->m_NormalMatrix = batch.normalMatrices[i];
+			pStaleTransforms[i]->m_IsDirty = false;
+		}
+	}
+
+	void TransformHierarchy::UpdateNode(uint32_t nodeIndex)
+	{
+		if (!m_Dirty[nodeIndex]) return;
+
+		// Dirty ancestors first, the topmost one has a clean parent. Not recursive, chains can be very deep
+		m_Path.clear();
+		for (uint32_t index = nodeIndex; index != NO_PARENT && m_Dirty[index]; index = m_Parents[index])
+		{
+			m_Path.push_back(index);
+		}
+		for (auto it = m_Path.rbegin(); it != m_Path.rend(); ++it)
+		{
+			UpdateWorldMatrix(*it);
+			if (m_TracksMovedTransforms) AddMovedTransform(m_pTransforms[*it]);
+		}
+
+		TransformComponent::s_RecomputeCount.fetch_add(static_cast<uint32_t>(m_Path.size()), std::memory_order_relaxed);
+	}
+
+	void TransformHierarchy::UpdateWorldMatrix(uint32_t nodeIndex)
+	{
+		const TransformComponent& transform = *m_pTransforms[nodeIndex];
+		const uint32_t parentIndex = m_Parents[nodeIndex];
+
+		if (parentIndex == NO_PARENT)
+		{
+			m_WorldMatrices[nodeIndex] = transform.GetLocalMatrix();
+			m_NormalMatrices[nodeIndex] = transform.GetLocalNormalMatrix();
+		}
+		else
+		{
+			// The inverse transpose of a product is the product of the inverse transposes
+			m_WorldMatrices[nodeIndex] = m_WorldMatrices[parentIndex] * transform.GetLocalMatrix();
+			m_NormalMatrices[nodeIndex] = m_NormalMatrices[parentIndex] * transform.GetLocalNormalMatrix();
+		}
+		m_Dirty[nodeIndex] = 0;
+	}
+
+	uint32_t TransformHierarchy::UpdateRange(uint32_t begin, uint32_t end, std::vector<TransformComponent*>& pMovedTransforms)
+	{
+		ComputeLocalMatrices(std::views::iota(begin, end));
+		return UpdateWorldMatrices(begin, end, pMovedTransforms);
+	}
+
+	uint32_t TransformHierarchy::UpdateWorldMatrices(uint32_t begin, uint32_t end, std::vector<TransformComponent*>& pMovedTransforms)
+	{
+		uint32_t count{};
+		for (uint32_t nodeIndex = begin; nodeIndex < end; ++nodeIndex)
+		{
+			if (!m_Dirty[nodeIndex] || !m_pTransforms[nodeIndex]) continue;
+			UpdateWorldMatrix(nodeIndex);
+			if (m_TracksMovedTransforms) pMovedTransforms.push_back(m_pTransforms[nodeIndex]);
+			++count;
+		}
+		return count;
+	}
+}
@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace ili
+{
+	class TransformComponent;
+
+	/**
+	 * World matrices of all transforms of a scene, stored as parallel arrays in depth-first order.
+	 * A parent always comes before its children and every subtree is one contiguous range, so a change
+	 * marks its subtree dirty with a single fill and Update sweeps forward over just the dirty subtrees,
+	 * or over everything when so much changed that finding them costs more than it saves.
+	 * New transforms are appended as roots and removed ones leave gaps, which are closed once they make up a quarter of the nodes.
+	 * Reparenting lays the nodes out again but keeps their matrices, so only the reparented subtree is recomputed.
+	 * Large hierarchies are split into independent subtree ranges that are updated on the threads of the JobSystem.
+	 * Local matrices that changed are computed in batches with the SIMD kernels of TransformKernels.h.
+	 * Reading a matrix brings just that node up to date, call Update before reading from several threads.
+	 * When tracking is on, every transform whose world matrix was recomputed is listed until the list is cleared
+	 */
+	class TransformHierarchy final
+	{
+	public:
+		explicit TransformHierarchy(bool tracksMovedTransforms = false);
+		~TransformHierarchy() = default;
+
+		TransformHierarchy(const TransformHierarchy& other) = delete;
+		TransformHierarchy(TransformHierarchy&& other) noexcept = delete;
+		TransformHierarchy& operator=(const TransformHierarchy& other) = delete;
+		TransformHierarchy& operator=(TransformHierarchy&& other) noexcept = delete;
+
+		// Adds the transform as a root
+		void Add(TransformComponent* pTransform);
+		// The children of the transform become roots, their local transforms are kept
+		void Remove(TransformComponent* pTransform);
+		void SetParent(TransformComponent* pChild, TransformComponent* pParent);
+
+		// Brings every dirty world matrix up to date
+		void Update();
+
+		const glm::mat4& GetWorldMatrix(const TransformComponent& transform);
+		const glm::mat3& GetWorldNormalMatrix(const TransformComponent& transform);
+
+		// Recomputed since the last clear, by Update or by reading a matrix. Every transform is listed once, in no particular order
+		const std::vector<TransformComponent*>& GetMovedTransforms() const { return m_pMovedTransforms; }
+		void ClearMovedTransforms();
+
+		uint32_t GetNodeCount() const { return static_cast<uint32_t>(m_pTransforms.size()) - m_RemovedCount; }
+
+	private:
+		friend class TransformComponent;
+
+		static constexpr uint32_t NO_PARENT = UINT32_MAX;
+		static constexpr uint32_t NOT_MOVED = UINT32_MAX;
+		// Below this many nodes handing out jobs costs more than it saves
+		static constexpr uint32_t PARALLEL_NODE_THRESHOLD = 16'384;
+		// With more than one dirty root per this many nodes the whole hierarchy is swept instead of sorting the roots
+		static constexpr uint32_t NODES_PER_DIRTY_ROOT = 8;
+
+		void MarkDirty(const TransformComponent& transform);
+		// Lists the transform as moved without touching its matrices
+		void MarkMoved(TransformComponent* pTransform);
+		// Skips transforms that are listed already
+		void AddMovedTransform(TransformComponent* pTransform);
+		// Lays the nodes out in depth-first order again and closes the gaps, the matrices and dirty state move with the nodes
+		void Rebuild();
+		void SplitIntoRanges();
+		// Merges the subtrees of the dirty roots into ordered disjoint ranges, false when sweeping the whole hierarchy is cheaper
+		bool CollectDirtyRanges();
+		// Updates the node after its dirty ancestors
+		void UpdateNode(uint32_t nodeIndex);
+		// Runs the stale local matrices of the dirty nodes through the batch kernels before the sweep reads them
+		template <typename NodeIndices>
+		void ComputeLocalMatrices(NodeIndices&& nodeIndices);
+		void UpdateWorldMatrix(uint32_t nodeIndex);
+		// Returns the number of updated nodes, which are added to the list when tracking is on
+		uint32_t UpdateRange(uint32_t begin, uint32_t end, std::vector<TransformComponent*>& pMovedTransforms);
+		// UpdateRange once the local matrices are computed
+		uint32_t UpdateWorldMatrices(uint32_t begin, uint32_t end, std::vector<TransformComponent*>& pMovedTransforms);
+
+		// Depth-first order, null where a transform was removed. A transform's node index is its position.
+		// While the structure is dirty the order is the one of the last rebuild, with the new roots after it
+		std::vector<TransformComponent*> m_pTransforms{};
+		std::vector<uint32_t> m_Parents{};
+		// One past the last node of the subtree
+		std::vector<uint32_t> m_SubtreeEnds{};
+		std::vector<glm::mat4> m_WorldMatrices{};
+		std::vector<glm::mat3> m_NormalMatrices{};
+		// A dirty node only has dirty descendants, uint8_t as std::vector<bool> cannot be written from several threads
+		std::vector<uint8_t> m_Dirty{};
+		// Nodes whose subtree was marked dirty since the last Update, every dirty node lies in the subtree of one of them.
+		// May hold duplicates, nested subtrees and gaps
+		std::vector<uint32_t> m_DirtyRoots{};
+		// Reused by Update
+		std::vector<std::pair<uint32_t, uint32_t>> m_DirtyRanges{};
+
+		// Nodes above the split depth, updated before the ranges below them
+		std::vector<uint32_t> m_SerialNodes{};
+		// Independent subtree ranges that can be updated in parallel
+		std::vector<std::pair<uint32_t, uint32_t>> m_ParallelRanges{};
+		// Reused by UpdateNode
+		std::vector<uint32_t> m_Path{};
+
+		// Every listed transform knows its position, so a removed transform is swapped out in constant time
+		std::vector<TransformComponent*> m_pMovedTransforms{};
+		// One list per range, merged into m_pMovedTransforms once all ranges are updated
+		std::vector<std::vector<TransformComponent*>> m_RangeMovedTransforms{};
+
+		// Gaps in m_pTransforms
+		uint32_t m_RemovedCount{};
+		// Node count the ranges were split for
+		uint32_t m_SplitNodeCount{};
+
+		bool m_TracksMovedTransforms;
+		bool m_IsStructureDirty{ false };
+		bool m_HasDirtyNodes{ false };
+	};
+}
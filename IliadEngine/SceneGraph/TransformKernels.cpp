@@ -0,0 +1,239 @@
+﻿#include "TransformKernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "Core/SimdLanes.h"
+
+#if defined(ILI_SIMD_SSE2) || defined(ILI_SIMD_NEON)
+	#define ILI_TRANSFORM_KERNELS_SIMD
+#endif
+
+namespace ili
+{
+	namespace
+	{
+		// The widest lanes of the target
+#if defined(ILI_SIMD_AVX2)
+		constexpr uint32_t LANE_COUNT = 8;
+		using Lanes = simd::Float8;
+		using IntLanes = simd::Int8;
+#elif defined(ILI_TRANSFORM_KERNELS_SIMD)
+		constexpr uint32_t LANE_COUNT = 4;
+		using Lanes = simd::Float4;
+		using IntLanes = simd::Int4;
+#else
+		constexpr uint32_t LANE_COUNT = 1;
+#endif
+
+#if defined(ILI_TRANSFORM_KERNELS_SIMD)
+		using namespace simd;
+
+		Lanes Set(float value) { return simd::Set<Lanes>(value); }
+		Lanes Load(const float* pValues) { return simd::Load<Lanes>(pValues); }
+
+		/**
+		 * Sine and cosine of every lane with the Cephes single precision polynomials. The angle is reduced to
+		 * [-pi/4, pi/4] around the nearest even multiple of pi/4 in three steps, accurate for angles up to a few thousand radians
+		 */
+		void SinCos(Lanes angle, Lanes& sine, Lanes& cosine)
+		{
+			const Lanes signMask = Set(-0.f);
+			Lanes sineSign = And(angle, signMask);
+			Lanes x = AndNot(signMask, angle);
+
+			IntLanes octant = Truncate(Mul(x, Set(1.27323954473516f)));
+			octant = AndInt(AddInt(octant, 1), ~1);
+			const Lanes y = ToFloat(octant);
+
+			// Octants 2 and 6 swap the polynomials, octants 4 to 7 flip the signs
+			const Lanes keepPolynomials = IsZero(AndInt(octant, 2));
+			sineSign = Xor(sineSign, ToSign(AndInt(octant, 4)));
+			const Lanes cosineSign = ToSign(AndNotInt(SubInt(octant, 2), 4));
+
+			x = Add(x, Mul(y, Set(-0.78515625f)));
+			x = Add(x, Mul(y, Set(-2.4187564849853515625e-4f)));
+			x = Add(x, Mul(y, Set(-3.77489497744594108e-8f)));
+			const Lanes z = Mul(x, x);
+
+			Lanes cosinePolynomial = Add(Mul(Set(2.443315711809948e-5f), z), Set(-1.388731625493765e-3f));
+			cosinePolynomial = Add(Mul(cosinePolynomial, z), Set(4.166664568298827e-2f));
+			cosinePolynomial = Mul(Mul(cosinePolynomial, z), z);
+			cosinePolynomial = Add(Sub(cosinePolynomial, Mul(z, Set(.5f))), Set(1.f));
+
+			Lanes sinePolynomial = Add(Mul(Set(-1.9515295891e-4f), z), Set(8.3321608736e-3f));
+			sinePolynomial = Add(Mul(sinePolynomial, z), Set(-1.6666654611e-1f));
+			sinePolynomial = Add(Mul(Mul(sinePolynomial, z), x), x);
+
+			sine = Xor(Select(keepPolynomials, sinePolynomial, cosinePolynomial), sineSign);
+			cosine = Xor(Select(keepPolynomials, cosinePolynomial, sinePolynomial), cosineSign);
+		}
+
+		// Inputs in TransformBatch order, positions, rotations and scales, each pointing at LANE_COUNT values
+		void ComputeLanes(const std::array<const float*, 9>& inputs, uint32_t count, glm::mat4* pMatrices, glm::mat3* pNormalMatrices)
+		{
+			Lanes s1{}, c1{}, s2{}, c2{}, s3{}, c3{};
+			SinCos(Load(inputs[4]), s1, c1);
+			SinCos(Load(inputs[3]), s2, c2);
+			SinCos(Load(inputs[5]), s3, c3);
+
+			// Same terms as ComputeTransformMatrix, one transform per lane
+			const Lanes rotation[9]
+			{
+				Add(Mul(c1, c3), Mul(Mul(s1, s2), s3)), Mul(c2, s3), Sub(Mul(Mul(c1, s2), s3), Mul(c3, s1)),
+				Sub(Mul(Mul(c3, s1), s2), Mul(c1, s3)), Mul(c2, c3), Add(Mul(Mul(c1, c3), s2), Mul(s1, s3)),
+				Mul(c2, s1), Sub(Set(0.f), s2), Mul(c1, c2)
+			};
+
+			const Lanes scaleX = Load(inputs[6]);
+			const Lanes scaleY = Load(inputs[7]);
+			const Lanes scaleZ = Load(inputs[8]);
+			const Lanes one = Set(1.f);
+			const Lanes isUniform = And(Equal(scaleX, scaleY), Equal(scaleY, scaleZ));
+			// A mirroring uniform scale keeps its sign, the normals flip with the winding
+			const Lanes uniformScale = Xor(one, And(scaleX, Set(-0.f)));
+			const Lanes scales[3]{ scaleX, scaleY, scaleZ };
+			const Lanes inverseScales[3]
+			{
+				Select(isUniform, uniformScale, Div(one, scaleX)),
+				Select(isUniform, uniformScale, Div(one, scaleY)),
+				Select(isUniform, uniformScale, Div(one, scaleZ))
+			};
+
+			// Column major like glm, the first 9 rows are the model matrix and the next 9 the normal matrix
+			alignas(32) float results[18][LANE_COUNT];
+			for (uint32_t element{}; element < 9; ++element)
+			{
+				Store(results[element], Mul(rotation[element], scales[element / 3]));
+				Store(results[9 + element], Mul(rotation[element], inverseScales[element / 3]));
+			}
+
+			for (uint32_t lane{}; lane < count; ++lane)
+			{
+				pMatrices[lane] = glm::mat4
+				{
+					glm::vec4{ results[0][lane], results[1][lane], results[2][lane], 0.f },
+					glm::vec4{ results[3][lane], results[4][lane], results[5][lane], 0.f },
+					glm::vec4{ results[6][lane], results[7][lane], results[8][lane], 0.f },
+					glm::vec4{ inputs[0][lane], inputs[1][lane], inputs[2][lane], 1.f }
+				};
+				pNormalMatrices[lane] = glm::mat3
+				{
+					glm::vec3{ results[9][lane], results[10][lane], results[11][lane] },
+					glm::vec3{ results[12][lane], results[13][lane], results[14][lane] },
+					glm::vec3{ results[15][lane], results[16][lane], results[17][lane] }
+				};
+			}
+		}
+#endif
+	}
+
+	void TransformBatch::Clear()
+	{
+		for (std::vector<float>* pInput : { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &scaleX, &scaleY, &scaleZ })
+		{
+			pInput->clear();
+		}
+	}
+
+	void TransformBatch::Add(const glm::vec3& position, const glm::vec3& rotationRadians, const glm::vec3& scale)
+	{
+		positionX.push_back(position.x);
+		positionY.push_back(position.y);
+		positionZ.push_back(position.z);
+		rotationX.push_back(rotationRadians.x);
+		rotationY.push_back(rotationRadians.y);
+		rotationZ.push_back(rotationRadians.z);
+		scaleX.push_back(scale.x);
+		scaleY.push_back(scale.y);
+		scaleZ.push_back(scale.z);
+	}
+
+	uint32_t GetTransformKernelWidth()
+	{
+		return LANE_COUNT;
+	}
+
+	void ComputeTransformMatrices(TransformBatch& batch)
+	{
+		const size_t size = batch.GetSize();
+		batch.matrices.resize(size);
+		batch.normalMatrices.resize(size);
+
+#if defined(ILI_TRANSFORM_KERNELS_SIMD)
+		const std::array<const float*, 9> inputs
+		{
+			batch.positionX.data(), batch.positionY.data(), batch.positionZ.data(),
+			batch.rotationX.data(), batch.rotationY.data(), batch.rotationZ.data(),
+			batch.scaleX.data(), batch.scaleY.data(), batch.scaleZ.data()
+		};
+
+		size_t first{};
+		for (; first + LANE_COUNT <= size; first += LANE_COUNT)
+		{
+			std::array<const float*, 9> laneInputs{};
+			for (size_t i{}; i < inputs.size(); ++i) laneInputs[i] = inputs[i] + first;
+			ComputeLanes(laneInputs, LANE_COUNT, batch.matrices.data() + first, batch.normalMatrices.data() + first);
+		}
+
+		// The remaining transforms go through the same lanes, padded with identity transforms
+		if (first < size)
+		{
+			float padded[9][LANE_COUNT]{};
+			std::array<const float*, 9> laneInputs{};
+			for (size_t i{}; i < inputs.size(); ++i)
+			{
+				if (i >= 6) std::fill(std::begin(padded[i]), std::end(padded[i]), 1.f);
+				std::copy(inputs[i] + first, inputs[i] + size, padded[i]);
+				laneInputs[i] = padded[i];
+			}
+			ComputeLanes(laneInputs, static_cast<uint32_t>(size - first), batch.matrices.data() + first, batch.normalMatrices.data() + first);
+		}
+#else
+		for (size_t i{}; i < size; ++i)
+		{
+			ComputeTransformMatrix({ batch.positionX[i], batch.positionY[i], batch.positionZ[i] },
+				{ batch.rotationX[i], batch.rotationY[i], batch.rotationZ[i] },
+				{ batch.scaleX[i], batch.scaleY[i], batch.scaleZ[i] },
+				batch.matrices[i], batch.normalMatrices[i]);
+		}
+#endif
+	}
+
+	void ComputeTransformMatrix(const glm::vec3& position, const glm::vec3& rotationRadians, const glm::vec3& scale,
+		glm::mat4& matrix, glm::mat3& normalMatrix)
+	{
+		const float c1 = glm::cos(rotationRadians.y);
+		const float s1 = glm::sin(rotationRadians.y);
+		const float c2 = glm::cos(rotationRadians.x);
+		const float s2 = glm::sin(rotationRadians.x);
+		const float c3 = glm::cos(rotationRadians.z);
+		const float s3 = glm::sin(rotationRadians.z);
+
+		const glm::vec3 rotationX{ c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1 };
+		const glm::vec3 rotationY{ c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3 };
+		const glm::vec3 rotationZ{ c2 * s1, -s2, c1 * c2 };
+
+		matrix = glm::mat4
+		{
+			glm::vec4{ rotationX * scale.x, 0.0f },
+			glm::vec4{ rotationY * scale.y, 0.0f },
+			glm::vec4{ rotationZ * scale.z, 0.0f },
+			glm::vec4{ position, 1.0f }
+		};
+
+		// The inverse transpose of rotation * scale is rotation * inverse scale, no general inverse needed.
+		// A uniform scale only changes the length of the normals, the rotation and the sign of a mirroring scale are enough then
+		if (scale.x == scale.y && scale.y == scale.z)
+		{
+			const float sign = std::signbit(scale.x) ? -1.0f : 1.0f;
+			normalMatrix = glm::mat3{ rotationX * sign, rotationY * sign, rotationZ * sign };
+		}
+		else
+		{
+			const glm::vec3 inverseScale = 1.0f / scale;
+			normalMatrix = glm::mat3{ rotationX * inverseScale.x, rotationY * inverseScale.y, rotationZ * inverseScale.z };
+		}
+	}
+}
@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace ili
+{
+	// Transforms as a structure of arrays, the input of ComputeTransformMatrices. Rotations in radians
+	struct TransformBatch final
+	{
+		std::vector<float> positionX{};
+		std::vector<float> positionY{};
+		std::vector<float> positionZ{};
+		std::vector<float> rotationX{};
+		std::vector<float> rotationY{};
+		std::vector<float> rotationZ{};
+		std::vector<float> scaleX{};
+		std::vector<float> scaleY{};
+		std::vector<float> scaleZ{};
+
+		// One per transform, written by ComputeTransformMatrices
+		std::vector<glm::mat4> matrices{};
+		std::vector<glm::mat3> normalMatrices{};
+
+		void Clear();
+		void Add(const glm::vec3& position, const glm::vec3& rotationRadians, const glm::vec3& scale);
+		size_t GetSize() const { return positionX.size(); }
+	};
+
+	// Transforms computed per kernel iteration, 8 with AVX2, 4 with SSE2 or NEON and 1 without SIMD
+	uint32_t GetTransformKernelWidth();
+
+	// Model and normal matrices of every transform in the batch, see ComputeTransformMatrix
+	void ComputeTransformMatrices(TransformBatch& batch);
+
+	// Translate * Ry * Rx * Rz * Scale, the same matrix a chain of glm::translate, glm::rotate and glm::scale builds.
+	// The normal matrix is the inverse transpose of its upper 3x3, without the magnitude of the scale when that is uniform
+	void ComputeTransformMatrix(const glm::vec3& position, const glm::vec3& rotationRadians, const glm::vec3& scale,
+		glm::mat4& matrix, glm::mat3& normalMatrix);
+}
@@ -0,0 +1,36 @@
+#ifndef CLUSTERED_LIGHTING_GLSL
+#define CLUSTERED_LIGHTING_GLSL
+
+#include "common.glsl"
+
+// The light lists written by cluster_lights.comp, read by the forward shaders
+
+layout(std430, set = 0, binding = 1) readonly buffer LightBuffer 
+{
+  PointLight lights[];
+} lightBuffer;
+
+layout(std430, set = 0, binding = 2) readonly buffer ClusterLightCounts 
+{
+  uint counts[];
+} clusterLightCounts;
+
+layout(std430, set = 0, binding = 3) readonly buffer ClusterLightIndices 
+{
+  uint indices[];
+} clusterLightIndices;
+
+// Fragment shaders only, the tile comes from gl_FragCoord
+uint GetClusterIndex(vec3 positionWorld)
+{
+  float viewDepth = (ubo.view * vec4(positionWorld, 1.0)).z;
+  float slice = floor(log(max(viewDepth, ubo.clusterDepthParams.x)) * ubo.clusterDepthParams.z + ubo.clusterDepthParams.w);
+  uint clusterZ = uint(clamp(slice, 0.0, float(CLUSTER_COUNT_Z - 1)));
+
+  uvec2 tile = uvec2(gl_FragCoord.xy / ubo.screenSize.xy * vec2(CLUSTER_COUNT_X, CLUSTER_COUNT_Y));
+  tile = min(tile, uvec2(CLUSTER_COUNT_X - 1, CLUSTER_COUNT_Y - 1));
+
+  return tile.x + tile.y * CLUSTER_COUNT_X + clusterZ * CLUSTER_COUNT_X * CLUSTER_COUNT_Y;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef COMMON_GLSL
+#define COMMON_GLSL
+
+// Declarations shared by the shaders that read the global descriptor set
+
+struct PointLight
+{
+  vec4 position; // xyz: position, w: range
+  vec4 color; // xyz: color, w: intensity
+};
+
+// Mirrors GlobalUbo in FrameInfo.h
+layout(set = 0, binding = 0) uniform GlobalUbo 
+{
+  mat4 projection;
+  mat4 view;
+  mat4 inverseViewMatrix;
+  vec4 ambientLightColor; // w is intensity
+  vec4 clusterDepthParams; // x: near, y: far, z/w: scale and bias turning log(view depth) into a cluster slice
+  vec4 screenSize; // xy: render extent in pixels
+  int numLights;
+} ubo;
+
+// Mirrors ClusteredLightingSystem
+const uint CLUSTER_COUNT_X = 16;
+const uint CLUSTER_COUNT_Y = 9;
+const uint CLUSTER_COUNT_Z = 24;
+const uint CLUSTER_COUNT = CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z;
+const uint MAX_LIGHTS_PER_CLUSTER = 128;
+
+// Brings the light smoothly to zero at its range, so a light never reaches outside its cluster or volume
+float GetRangeFalloff(float distanceSquared, float range)
+{
+  float ratio = distanceSquared / (range * range);
+  float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+  return window * window;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "common.glsl"
+
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput gbufferAlbedo;
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput gbufferMaterial;
+
+layout(location = 0) out vec4 outColor;
+
+void main() 
+{
+  vec3 albedo = subpassLoad(gbufferAlbedo).rgb;
+  float ao = subpassLoad(gbufferMaterial).b;
+
+  // Blended additively, the background has a zero albedo and keeps the clear color
+  outColor = vec4(albedo * ubo.ambientLightColor.rgb * ubo.ambientLightColor.w * ao, 0.0);
+}
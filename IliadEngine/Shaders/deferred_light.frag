@@ -0,0 +1,108 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "common.glsl"
+
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput gbufferAlbedo;
+layout(input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput gbufferNormal;
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput gbufferMaterial;
+layout(input_attachment_index = 3, set = 1, binding = 3) uniform subpassInput gbufferDepth;
+
+layout(location = 0) flat in uint lightIndex;
+
+layout(location = 0) out vec4 outColor;
+
+layout(std430, set = 0, binding = 1) readonly buffer LightBuffer 
+{
+    PointLight lights[];
+} lightBuffer;
+
+const float PI = 3.14159265359;
+
+// Inverts the perspective projection of the camera (view space +z forward, depth 0..1)
+vec3 ReconstructPositionWorld(float depth)
+{
+    vec2 ndc = gl_FragCoord.xy / ubo.screenSize.xy * 2.0 - 1.0;
+    float viewDepth = ubo.projection[3][2] / (depth - ubo.projection[2][2]);
+    vec3 positionView = vec3(ndc.x * viewDepth / ubo.projection[0][0], ndc.y * viewDepth / ubo.projection[1][1], viewDepth);
+    return (ubo.inverseViewMatrix * vec4(positionView, 1.0)).xyz;
+}
+
+// Normal Distribution Function (NDF)
+float DistributionGGX(vec3 N, vec3 H, float roughness) {
+    float a = roughness * roughness;
+    float a2 = a * a;
+    float NdotH = max(dot(N, H), 0.0);
+    float NdotH2 = NdotH * NdotH;
+
+    float num = a2;
+    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
+    denom = PI * denom * denom;
+
+    return num / denom;
+}
+
+// Geometry Function
+float GeometrySchlickGGX(float NdotV, float roughness) {
+    float r = (roughness + 1.0);
+    float k = (r * r) / 8.0;
+
+    float num = NdotV;
+    float denom = NdotV * (1.0 - k) + k;
+
+    return num / denom;
+}
+
+float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness) {
+    float NdotV = max(dot(N, V), 0.0);
+    float NdotL = max(dot(N, L), 0.0);
+    float ggx2 = GeometrySchlickGGX(NdotV, roughness);
+    float ggx1 = GeometrySchlickGGX(NdotL, roughness);
+
+    return ggx1 * ggx2;
+}
+
+// Fresnel Equation
+vec3 FresnelSchlick(float cosTheta, vec3 F0) {
+    return F0 + (1.0 - F0) * pow(1.0 - cosTheta, 5.0);
+}
+
+void main() 
+{
+    PointLight light = lightBuffer.lights[lightIndex];
+
+    // Nothing was drawn on the far plane, only the full-screen fallback of the vertex shader reaches it
+    float depth = subpassLoad(gbufferDepth).r;
+    if (depth >= 1.0) discard;
+
+    vec3 positionWorld = ReconstructPositionWorld(depth);
+    vec3 toLight = light.position.xyz - positionWorld;
+    float distanceSquared = dot(toLight, toLight);
+
+    // The volume is a cube around the light's sphere, the corners are outside its range
+    if (distanceSquared >= light.position.w * light.position.w) discard;
+
+    vec3 albedo = subpassLoad(gbufferAlbedo).rgb;
+    vec3 N = normalize(subpassLoad(gbufferNormal).xyz);
+    vec3 material = subpassLoad(gbufferMaterial).rgb;
+    float metallic = material.r;
+    float roughness = material.g;
+
+    vec3 V = normalize(ubo.inverseViewMatrix[3].xyz - positionWorld);
+    vec3 L = toLight * inversesqrt(distanceSquared);
+    vec3 H = normalize(V + L);
+    float NdotL = max(dot(N, L), 0.0);
+
+    vec3 F0 = mix(vec3(0.04), albedo, metallic);
+    vec3 F = FresnelSchlick(max(dot(H, V), 0.0), F0);
+    float NDF = DistributionGGX(N, H, roughness);
+    float G = GeometrySmith(N, V, L, roughness);
+    vec3 specular = NDF * G * F / (4.0 * max(dot(N, V), 0.0) * NdotL + 0.0001);
+    vec3 kD = (vec3(1.0) - F) * (1.0 - metallic);
+
+    // Quadratic falloff windowed to the light's range, the same as the forward shaders
+    float attenuation = GetRangeFalloff(distanceSquared, light.position.w) / (distanceSquared + 0.001);
+    vec3 radiance = light.color.xyz * light.color.w * attenuation;
+
+    outColor = vec4((kD * albedo / PI + specular) * radiance * NdotL, 0.0);
+}
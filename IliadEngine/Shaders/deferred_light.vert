@@ -0,0 +1,44 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "common.glsl"
+
+// Unit cube around the light, wound clockwise when seen from outside
+const vec3 CUBE_VERTICES[36] = vec3[](
+  vec3(1, -1, -1), vec3(1, -1, 1), vec3(1, 1, 1), vec3(1, -1, -1), vec3(1, 1, 1), vec3(1, 1, -1),
+  vec3(-1, -1, -1), vec3(-1, 1, -1), vec3(-1, 1, 1), vec3(-1, -1, -1), vec3(-1, 1, 1), vec3(-1, -1, 1),
+  vec3(-1, 1, -1), vec3(1, 1, -1), vec3(1, 1, 1), vec3(-1, 1, -1), vec3(1, 1, 1), vec3(-1, 1, 1),
+  vec3(-1, -1, -1), vec3(-1, -1, 1), vec3(1, -1, 1), vec3(-1, -1, -1), vec3(1, -1, 1), vec3(1, -1, -1),
+  vec3(-1, -1, 1), vec3(-1, 1, 1), vec3(1, 1, 1), vec3(-1, -1, 1), vec3(1, 1, 1), vec3(1, -1, 1),
+  vec3(-1, -1, -1), vec3(1, -1, -1), vec3(1, 1, -1), vec3(-1, -1, -1), vec3(1, 1, -1), vec3(-1, 1, -1)
+);
+
+layout(std430, set = 0, binding = 1) readonly buffer LightBuffer 
+{
+    PointLight lights[];
+} lightBuffer;
+
+layout(location = 0) flat out uint lightIndex;
+
+// Covers the screen at the far plane, wound so it is kept by the front face culling of the light volumes
+const vec2 FULLSCREEN_VERTICES[3] = vec2[](vec2(-1, -1), vec2(-1, 3), vec2(3, -1));
+
+void main() 
+{
+  // One instance per light, the cube bounds the sphere the light reaches
+  PointLight light = lightBuffer.lights[gl_InstanceIndex];
+  lightIndex = uint(gl_InstanceIndex);
+
+  // The back faces of a cube reaching past the far plane get clipped and its pixels would go unlit.
+  // Such a light shades the whole screen instead, the range falloff limits it to the pixels it reaches
+  float farthestDepth = (ubo.view * vec4(light.position.xyz, 1.0)).z + light.position.w * sqrt(3.0);
+  if (farthestDepth >= ubo.clusterDepthParams.y)
+  {
+    // The remaining vertices collapse into a point, so the other triangles are dropped
+    gl_Position = vec4(gl_VertexIndex < 3 ? FULLSCREEN_VERTICES[gl_VertexIndex] : vec2(-1.0), 1.0, 1.0);
+    return;
+  }
+
+  vec3 positionWorld = light.position.xyz + CUBE_VERTICES[gl_VertexIndex] * light.position.w;
+  gl_Position = ubo.projection * ubo.view * vec4(positionWorld, 1.0);
+}
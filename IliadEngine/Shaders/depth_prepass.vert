@@ -0,0 +1,21 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "common.glsl"
+
+// Position-only variant of the mesh vertex shaders, used to fill the depth buffer before shading.
+// gl_Position is invariant and computed exactly like the main passes so their EQUAL depth test matches
+layout(location = 0) in vec3 position;
+
+layout(push_constant) uniform Push 
+{
+  mat4 modelMatrix;
+  mat4 normalMatrix;
+} push;
+
+invariant gl_Position;
+
+void main() {
+  vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projection * ubo.view * positionWorld;
+}
@@ -0,0 +1,28 @@
+#version 450
+
+layout(location = 0) in vec3 fragColor; // Unused, the albedo map is the base color
+layout(location = 1) in vec3 fragNormalWorld;
+layout(location = 2) in vec2 fragUv;
+
+// G-buffer, see GBuffer
+layout(location = 0) out vec4 outAlbedo;
+layout(location = 1) out vec4 outNormal;
+layout(location = 2) out vec4 outMaterial; // r: metallic, g: roughness, b: ambient occlusion
+
+// PBR material textures
+layout(set = 1, binding = 0) uniform sampler2D albedoMap;
+layout(set = 1, binding = 1) uniform sampler2D normalMap; // Unused, the vertices carry no tangents
+layout(set = 1, binding = 2) uniform sampler2D metallicMap;
+layout(set = 1, binding = 3) uniform sampler2D roughnessMap;
+layout(set = 1, binding = 4) uniform sampler2D aoMap;
+
+void main() 
+{
+    outAlbedo = vec4(texture(albedoMap, fragUv).rgb, 1.0);
+    outNormal = vec4(normalize(fragNormalWorld), 0.0);
+    outMaterial = vec4(
+        texture(metallicMap, fragUv).r,
+        texture(roughnessMap, fragUv).r,
+        texture(aoMap, fragUv).r,
+        0.0);
+}
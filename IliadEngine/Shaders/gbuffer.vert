@@ -0,0 +1,27 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "common.glsl"
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragNormalWorld;
+layout(location = 2) out vec2 fragUv;
+
+layout(push_constant) uniform Push 
+{
+  mat4 modelMatrix;
+  mat4 normalMatrix;
+} push;
+
+void main() 
+{
+    gl_Position = ubo.projection * ubo.view * push.modelMatrix * vec4(position, 1.0);
+    fragColor = color;
+    fragNormalWorld = normalize(mat3(push.normalMatrix) * normal);
+    fragUv = uv;
+}
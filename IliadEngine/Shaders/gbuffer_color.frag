@@ -0,0 +1,20 @@
+#version 450
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragNormalWorld;
+layout(location = 2) in vec2 fragUv; // Unused
+
+// G-buffer, see GBuffer
+layout(location = 0) out vec4 outAlbedo;
+layout(location = 1) out vec4 outNormal;
+layout(location = 2) out vec4 outMaterial; // r: metallic, g: roughness, b: ambient occlusion
+
+// Objects without a material are shaded as a rough dielectric in their vertex color
+const float DEFAULT_ROUGHNESS = 0.5;
+
+void main() 
+{
+    outAlbedo = vec4(fragColor, 1.0);
+    outNormal = vec4(normalize(fragNormalWorld), 0.0);
+    outMaterial = vec4(0.0, DEFAULT_ROUGHNESS, 1.0, 0.0);
+}
@@ -1,4 +1,7 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "clustered_lighting.glsl"
 
 layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec3 fragPosWorld;
@@ -6,22 +9,6 @@ layout (location = 2) in vec3 fragNormalWorld;
 
 layout (location = 0) out vec4 outColor;
 
-struct PointLight 
-{
-	vec4 position; // ignore w
-	vec4 color; // w is intensity
-};
-
-layout(set = 0, binding = 0) uniform GlobalUbo 
-{
-	mat4 projection;
-	mat4 view;
-	mat4 inverseViewMatrix;
-	vec4 ambientLightColor; // w is intensity
-	PointLight pointLights[10];
-	int numLights;
-	} ubo;
-
 	layout(push_constant) uniform Push {
 	mat4 modelMatrix;
 	mat4 normalMatrix;
@@ -36,11 +23,15 @@ void main()
 	vec3 cameraPositionWorld = ubo.inverseViewMatrix[3].xyz;
 	vec3 viewDirection = normalize(cameraPositionWorld - fragPosWorld);
 
-	for (int i = 0; i < ubo.numLights; i++) 
+	uint clusterIndex = GetClusterIndex(fragPosWorld);
+	uint clusterLightCount = clusterLightCounts.counts[clusterIndex];
+
+	for (uint i = 0; i < clusterLightCount; i++) 
 	{
-		PointLight light = ubo.pointLights[i];
+		PointLight light = lightBuffer.lights[clusterLightIndices.indices[clusterIndex * MAX_LIGHTS_PER_CLUSTER + i]];
 		vec3 directionToLight = light.position.xyz - fragPosWorld;
-		float attenuation = 1.0 / dot(directionToLight, directionToLight); // distance squared
+		float distanceSquared = dot(directionToLight, directionToLight);
+		float attenuation = GetRangeFalloff(distanceSquared, light.position.w) / distanceSquared;
 		directionToLight = normalize(directionToLight);
 
 		float cosAngIncidence = max(dot(surfaceNormal, directionToLight), 0);
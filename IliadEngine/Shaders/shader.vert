@@ -1,4 +1,7 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "common.glsl"
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
@@ -9,27 +12,15 @@ layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragPosWorld;
 layout(location = 2) out vec3 fragNormalWorld;
 
-struct PointLight {
-  vec4 position; // ignore w
-  vec4 color; // w is intensity
-};
-
-layout(set = 0, binding = 0) uniform GlobalUbo 
-{
-  mat4 projection;
-  mat4 view;
-  mat4 inverseViewMatrix;
-  vec4 ambientLightColor; // w is intensity
-  PointLight pointLights[10];
-  int numLights;
-} ubo;
-
 layout(push_constant) uniform Push 
 {
   mat4 modelMatrix;
   mat4 normalMatrix;
 } push;
 
+// Must match depth_prepass.vert bit for bit, the main pass tests depth with EQUAL
+invariant gl_Position;
+
 void main() {
   vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
   gl_Position = ubo.projection * ubo.view * positionWorld;
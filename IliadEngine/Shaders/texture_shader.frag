@@ -1,4 +1,7 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "clustered_lighting.glsl"
 
 layout(location = 0) in vec3 fragPosWorld;
 layout(location = 1) in vec3 fragNormalWorld;
@@ -6,20 +9,6 @@ layout(location = 2) in vec2 fragUv;
 
 layout(location = 0) out vec4 outColor;
 
-struct PointLight {
-    vec4 position; // xyz: position, w: unused
-    vec4 color;    // xyz: color, w: intensity
-};
-
-layout(set = 0, binding = 0) uniform GlobalUbo {
-    mat4 projection;
-    mat4 view;
-    mat4 invView;
-    vec4 ambientLightColor;
-    PointLight pointLights[10];
-    int numLights;
-} ubo;
-
 // PBR material textures
 layout(set = 1, binding = 0) uniform sampler2D albedoMap;
 layout(set = 1, binding = 1) uniform sampler2D normalMap;
@@ -83,15 +72,18 @@ void main() {
     vec3 ambient = ubo.ambientLightColor.rgb * vec3(1.0, 1.0, 1.0); // White ambient
     vec3 lighting = ambient;
     
-    // Diffuse lighting from the first point light
-    if (ubo.numLights > 0) {
-        PointLight light = ubo.pointLights[0];
+    // Diffuse lighting from the point lights of this fragment's cluster
+    uint clusterIndex = GetClusterIndex(fragPosWorld);
+    uint clusterLightCount = clusterLightCounts.counts[clusterIndex];
+
+    for (uint i = 0; i < clusterLightCount; i++) {
+        PointLight light = lightBuffer.lights[clusterLightIndices.indices[clusterIndex * MAX_LIGHTS_PER_CLUSTER + i]];
         vec3 L = normalize(light.position.xyz - fragPosWorld);
         float NdotL = max(dot(N, L), 0.0);
         
-        // Compute attenuation (quadratic falloff)
+        // Compute attenuation (quadratic falloff, windowed to the light's range)
         float distance = length(light.position.xyz - fragPosWorld);
-        float attenuation = 1.0 / (distance * distance + 0.001); // Prevent division by zero
+        float attenuation = GetRangeFalloff(distance * distance, light.position.w) / (distance * distance + 0.001); // Prevent division by zero
         
         // Radiance (color * intensity * attenuation)
         vec3 radiance = light.color.xyz * light.color.w * attenuation;
@@ -6,14 +6,21 @@
 
 namespace ili
 {
-	#define MAX_POINT_LIGHTS 10
+	class GpuProfiler;
+	class OcclusionCullingSystem;
+	class SoftwareOcclusionCuller;
 
+	// Initial capacity of the light buffers, they grow when a frame has more lights. The shaders only loop over the lights of their cluster
+	#define INITIAL_POINT_LIGHT_CAPACITY 4096
+
+	// Layout of an entry in the light storage buffer (set 0, binding 1)
 	struct PointLight
 	{
-		glm::vec4 position{}; //Ignore the w component, it's just there for padding
+		glm::vec4 position{}; //The w component is the range of influence of the light
 		glm::vec4 color{}; //Alpha channel is intensity
 	};
 
+	// Mirrored in Shaders/common.glsl
 	struct GlobalUbo
 	{
 		glm::mat4 projectionMatrix{ 1.f };
@@ -21,8 +28,11 @@ namespace ili
 		glm::mat4 inverseViewMatrix{ 1.f };
 
 		glm::vec4 ambientColor{ 1.f, 1.f, 1.f, .20f }; //Alpha channel is intensity
-		
-		PointLight pointLights[MAX_POINT_LIGHTS];
+
+		// x: near plane, y: far plane, z/w: scale and bias that turn log(view depth) into a cluster depth slice
+		glm::vec4 clusterDepthParams{};
+		glm::vec4 screenSize{}; //xy is the render extent in pixels
+
 		int pointLightCount{};
 
 	};
@@ -32,8 +42,17 @@ namespace ili
 		int frameIndex{};
 		float frameTime{};
 		VkCommandBuffer commandBuffer{};
-		Camera& camera;
+		const Camera& camera;
 		VkDescriptorSet globalDescriptorSet{};
 		DescriptorPool& frameDescriptorPool;
+		// When set, depth has already been written by the DepthPrePassSystem and the shading passes test with EQUAL
+		bool depthPrePass{};
+		// When set, the mesh systems draw through the indirect commands of the culling system for cullPhase
+		const OcclusionCullingSystem* pOcclusionCulling{};
+		uint32_t cullPhase{};
+		// When set, the mesh systems skip objects whose bounds are hidden behind the rasterized occluders
+		const SoftwareOcclusionCuller* pSoftwareOcclusion{};
+		// When set, passes and systems are bracketed with timestamp scopes
+		GpuProfiler* pGpuProfiler{};
 	};
 }
\ No newline at end of file
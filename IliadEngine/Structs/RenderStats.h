@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include <cstdint>
+
+namespace ili
+{
+	// Counts of the commands a render system recorded in the last frame.
+	// Binds that were skipped because the state was already bound are not counted
+	struct RenderStats final
+	{
+		uint32_t drawCalls{};
+		uint32_t pipelineBinds{};
+		uint32_t descriptorSetBinds{};
+		uint32_t meshBinds{};
+		// Submitted by the draws, with GPU occlusion culling some of them end up with zero instances
+		uint32_t instanceCount{};
+		uint64_t triangleCount{};
+		// Bounding spheres tested against the SoftwareOcclusionCuller, and those of them it culled
+		uint32_t occlusionTestCount{};
+		uint32_t occlusionCullCount{};
+
+		uint32_t GetStateChanges() const { return pipelineBinds + descriptorSetBinds + meshBinds; }
+
+		RenderStats& operator+=(const RenderStats& other)
+		{
+			drawCalls += other.drawCalls;
+			pipelineBinds += other.pipelineBinds;
+			descriptorSetBinds += other.descriptorSetBinds;
+			meshBinds += other.meshBinds;
+			instanceCount += other.instanceCount;
+			triangleCount += other.triangleCount;
+			occlusionTestCount += other.occlusionTestCount;
+			occlusionCullCount += other.occlusionCullCount;
+			return *this;
+		}
+	};
+}
@@ -0,0 +1,57 @@
+﻿#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include "Core/ContentLoader.h"
+#include "Core/Utils.h"
+#include "MicroBenchmarkFixtures.h"
+
+// Parses the grid and merges the vertices it shares between faces, argument is the quads per side
+static void BM_LoadModel(benchmark::State& state)
+{
+	const std::string filePath = GetGridObjFile(static_cast<uint32_t>(state.range(0)));
+
+	ili::ContentLoader::Builder builder{};
+	for (auto _ : state)
+	{
+		builder.LoadModel(filePath);
+		benchmark::DoNotOptimize(builder.vertices.data());
+	}
+
+	state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(builder.indices.size()));
+	state.counters["vertices"] = static_cast<double>(builder.vertices.size());
+}
+BENCHMARK(BM_LoadModel)->RangeMultiplier(4)->Range(16, 256)->Unit(benchmark::kMillisecond);
+
+// The hash the model loader keys its unique vertex map with, argument is the vertex count
+static void BM_HashCombineVertex(benchmark::State& state)
+{
+	std::uniform_real_distribution<float> distribution{ -1.f, 1.f };
+	std::vector<ili::Model::Vertex> vertices(static_cast<size_t>(state.range(0)));
+	for (ili::Model::Vertex& vertex : vertices)
+	{
+		auto& random = GetBenchmarkRandom();
+		vertex.position = { distribution(random), distribution(random), distribution(random) };
+		vertex.color = { 1.f, 1.f, 1.f };
+		vertex.normal = glm::normalize(glm::vec3{ distribution(random), distribution(random), 1.f });
+		vertex.texCoord = { distribution(random), distribution(random) };
+	}
+
+	for (auto _ : state)
+	{
+		size_t combined{};
+		for (const ili::Model::Vertex& vertex : vertices)
+		{
+			size_t seed = 0;
+			ili::Utils::HashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.texCoord);
+			combined ^= seed;
+		}
+		benchmark::DoNotOptimize(combined);
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HashCombineVertex)->RangeMultiplier(8)->Range(64, 1 << 18);
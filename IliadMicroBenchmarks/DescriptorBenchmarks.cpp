@@ -0,0 +1,64 @@
+﻿#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "Graphics/Buffer.h"
+#include "Graphics/Descriptors.h"
+#include "MicroBenchmarkFixtures.h"
+
+// Writes and allocates a set of uniform buffer bindings like the render systems do per frame, argument is the binding count.
+// The layout and pool own Vulkan handles, so unlike the other benchmarks this one needs a device
+static void BM_DescriptorWriterBuild(benchmark::State& state)
+{
+	ili::Device* pDevice = GetBenchmarkDevice();
+	if (!pDevice)
+	{
+		state.SkipWithError("No Vulkan device available");
+		return;
+	}
+
+	static constexpr uint32_t MAX_SETS = 1024;
+	const uint32_t bindingCount = static_cast<uint32_t>(state.range(0));
+
+	ili::DescriptorSetLayout::Builder layoutBuilder{ *pDevice };
+	for (uint32_t binding{}; binding < bindingCount; ++binding)
+	{
+		layoutBuilder.AddBinding(binding, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS);
+	}
+	const auto pSetLayout = layoutBuilder.Build();
+
+	const auto pPool = ili::DescriptorPool::Builder(*pDevice)
+		.setMaxSets(MAX_SETS)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, MAX_SETS * bindingCount)
+		.build();
+
+	ili::Buffer buffer{ *pDevice, 256, bindingCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+		pDevice->Properties.limits.minUniformBufferOffsetAlignment };
+	std::vector<VkDescriptorBufferInfo> bufferInfos(bindingCount);
+	for (uint32_t binding{}; binding < bindingCount; ++binding)
+	{
+		bufferInfos[binding] = buffer.DescriptorInfoForIndex(static_cast<int>(binding));
+	}
+
+	for (auto _ : state)
+	{
+		if (pPool->GetAllocatedSetCount() == MAX_SETS)
+		{
+			state.PauseTiming();
+			pPool->ResetPool();
+			state.ResumeTiming();
+		}
+
+		ili::DescriptorWriter writer{ *pSetLayout, *pPool };
+		for (uint32_t binding{}; binding < bindingCount; ++binding)
+		{
+			writer.WriteBuffer(binding, &bufferInfos[binding]);
+		}
+
+		VkDescriptorSet descriptorSet{};
+		benchmark::DoNotOptimize(writer.Build(descriptorSet));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DescriptorWriterBuild)->DenseRange(1, 7, 2);
@@ -0,0 +1,96 @@
+﻿#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <vector>
+
+#include "Core/JobSystem.h"
+#include "MicroBenchmarkFixtures.h"
+
+namespace
+{
+	constexpr uint32_t SCALING_ITEM_COUNT = 1 << 20;
+	constexpr uint32_t SCALING_GRAIN_SIZE = 4096;
+
+	// A few dependent transcendental steps per item, bound by the cores rather than by memory
+	float ComputeItem(uint32_t index)
+	{
+		float value = static_cast<float>(index & 1023) * .001f;
+		for (int step{}; step < 16; ++step) value = std::sin(value) * .5f + std::sqrt(value + 1.f);
+		return value;
+	}
+}
+
+// ParallelFor over a million independent items, argument is the thread count including the calling one
+static void BM_ParallelForScaling(benchmark::State& state)
+{
+	const ScopedJobSystemThreads threads{ static_cast<uint32_t>(state.range(0)) };
+	ili::JobSystem& jobSystem = ili::JobSystem::GetInstance();
+
+	std::vector<float> results(SCALING_ITEM_COUNT);
+	for (auto _ : state)
+	{
+		jobSystem.ParallelFor(SCALING_ITEM_COUNT, SCALING_GRAIN_SIZE, [&results](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i) results[i] = ComputeItem(i);
+		});
+		benchmark::DoNotOptimize(results.data());
+		benchmark::ClobberMemory();
+	}
+
+	state.counters["threads"] = static_cast<double>(jobSystem.GetThreadCount());
+	state.SetItemsProcessed(state.iterations() * SCALING_ITEM_COUNT);
+}
+BENCHMARK(BM_ParallelForScaling)->Apply(ApplyThreadCountArguments)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Jobs that each start a ParallelFor of their own, as a scene update that fans out per system would.
+// Argument is the thread count including the calling one
+static void BM_NestedParallelForScaling(benchmark::State& state)
+{
+	constexpr uint32_t outerCount = 16;
+	const ScopedJobSystemThreads threads{ static_cast<uint32_t>(state.range(0)) };
+	ili::JobSystem& jobSystem = ili::JobSystem::GetInstance();
+
+	std::vector<float> results(SCALING_ITEM_COUNT);
+	for (auto _ : state)
+	{
+		ili::JobCounter counter{};
+		for (uint32_t outer{}; outer < outerCount; ++outer)
+		{
+			jobSystem.Run([&jobSystem, &results, outer]()
+			{
+				constexpr uint32_t innerCount = SCALING_ITEM_COUNT / outerCount;
+				float* pResults = results.data() + outer * innerCount;
+				jobSystem.ParallelFor(innerCount, SCALING_GRAIN_SIZE, [pResults](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t i = begin; i < end; ++i) pResults[i] = ComputeItem(i);
+				});
+			}, &counter);
+		}
+		jobSystem.Wait(counter);
+		benchmark::DoNotOptimize(results.data());
+		benchmark::ClobberMemory();
+	}
+
+	state.counters["threads"] = static_cast<double>(jobSystem.GetThreadCount());
+	state.SetItemsProcessed(state.iterations() * SCALING_ITEM_COUNT);
+}
+BENCHMARK(BM_NestedParallelForScaling)->Apply(ApplyThreadCountArguments)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Empty jobs started and waited for, the fixed cost a job has to earn back. Argument is the job count
+static void BM_JobRunWait(benchmark::State& state)
+{
+	const ScopedJobSystemThreads threads{};
+	ili::JobSystem& jobSystem = ili::JobSystem::GetInstance();
+	const int64_t jobCount = state.range(0);
+
+	for (auto _ : state)
+	{
+		ili::JobCounter counter{};
+		for (int64_t i{}; i < jobCount; ++i) jobSystem.Run([]() {}, &counter);
+		jobSystem.Wait(counter);
+	}
+
+	state.counters["threads"] = static_cast<double>(jobSystem.GetThreadCount());
+	state.SetItemsProcessed(state.iterations() * jobCount);
+}
+BENCHMARK(BM_JobRunWait)->RangeMultiplier(8)->Range(1, 4096)->UseRealTime();
@@ -0,0 +1,158 @@
+﻿#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <glm/gtc/constants.hpp>
+
+#include "SceneGraph/Bounds.h"
+#include "SceneGraph/MeshBvh.h"
+#include "MicroBenchmarkFixtures.h"
+
+namespace
+{
+	struct Mesh
+	{
+		std::vector<glm::vec3> positions{};
+		std::vector<uint32_t> indices{};
+	};
+
+	// Unit sphere of rings * 2 * rings quads with smooth bumps, so the triangles are not all the same size and orientation
+	Mesh CreateSphereMesh(uint32_t rings)
+	{
+		const uint32_t sectors = 2 * rings;
+		Mesh mesh{};
+		for (uint32_t ring{}; ring <= rings; ++ring)
+		{
+			const float polar = glm::pi<float>() * static_cast<float>(ring) / static_cast<float>(rings);
+			for (uint32_t sector{}; sector <= sectors; ++sector)
+			{
+				const float azimuth = glm::two_pi<float>() * static_cast<float>(sector) / static_cast<float>(sectors);
+				const glm::vec3 direction{ std::sin(polar) * std::cos(azimuth), std::cos(polar), std::sin(polar) * std::sin(azimuth) };
+				mesh.positions.push_back(direction * (1.f + .1f * std::sin(6.f * polar) * std::sin(6.f * azimuth)));
+			}
+		}
+
+		for (uint32_t ring{}; ring < rings; ++ring)
+		{
+			for (uint32_t sector{}; sector < sectors; ++sector)
+			{
+				const uint32_t first = ring * (sectors + 1) + sector;
+				const uint32_t below = first + sectors + 1;
+				mesh.indices.insert(mesh.indices.end(), { first, below, first + 1, first + 1, below, below + 1 });
+			}
+		}
+		return mesh;
+	}
+
+	// From outside of the mesh towards points inside of its bounds, roughly half of them hit
+	std::vector<ili::Ray> CreateRays(size_t count)
+	{
+		std::uniform_real_distribution<float> distribution{ -1.f, 1.f };
+		auto& random = GetBenchmarkRandom();
+
+		std::vector<ili::Ray> rays(count);
+		for (ili::Ray& ray : rays)
+		{
+			const glm::vec3 target{ distribution(random), distribution(random), distribution(random) };
+			ray.origin = glm::normalize(glm::vec3{ distribution(random), distribution(random), distribution(random) }) * 3.f;
+			ray.direction = glm::normalize(target - ray.origin);
+		}
+		return rays;
+	}
+
+	// Möller-Trumbore over every triangle, what a ray query costs without the hierarchy
+	bool RaycastTriangles(const Mesh& mesh, const ili::Ray& ray, float maxDistance, float& distance)
+	{
+		bool isHit{};
+		for (size_t i{}; i < mesh.indices.size(); i += 3)
+		{
+			const glm::vec3 vertex0 = mesh.positions[mesh.indices[i]];
+			const glm::vec3 edge1 = mesh.positions[mesh.indices[i + 1]] - vertex0;
+			const glm::vec3 edge2 = mesh.positions[mesh.indices[i + 2]] - vertex0;
+
+			const glm::vec3 p = glm::cross(ray.direction, edge2);
+			const float determinant = glm::dot(edge1, p);
+			if (determinant == 0.f) continue;
+
+			const float inverseDeterminant = 1.f / determinant;
+			const glm::vec3 s = ray.origin - vertex0;
+			const float u = glm::dot(s, p) * inverseDeterminant;
+			if (u < 0.f || u > 1.f) continue;
+
+			const glm::vec3 q = glm::cross(s, edge1);
+			const float v = glm::dot(ray.direction, q) * inverseDeterminant;
+			if (v < 0.f || u + v > 1.f) continue;
+
+			const float t = glm::dot(edge2, q) * inverseDeterminant;
+			if (t < 0.f || t >= maxDistance) continue;
+
+			maxDistance = t;
+			isHit = true;
+		}
+		distance = maxDistance;
+		return isHit;
+	}
+}
+
+// Argument is the ring count of the sphere, it has 4 * rings^2 triangles. Runs when a model is loaded with a MeshBvh
+static void BM_MeshBvhBuild(benchmark::State& state)
+{
+	const Mesh mesh = CreateSphereMesh(static_cast<uint32_t>(state.range(0)));
+
+	uint32_t nodeCount{};
+	for (auto _ : state)
+	{
+		const ili::MeshBvh bvh{ mesh.positions, mesh.indices };
+		nodeCount = bvh.GetNodeCount();
+		benchmark::DoNotOptimize(nodeCount);
+	}
+
+	state.counters["nodes"] = static_cast<double>(nodeCount);
+	state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(mesh.indices.size() / 3));
+}
+BENCHMARK(BM_MeshBvhBuild)->RangeMultiplier(4)->Range(8, 512)->Unit(benchmark::kMillisecond);
+
+// Closest hit through the four wide hierarchy, argument is the ring count of the sphere
+static void BM_MeshBvhRaycast(benchmark::State& state)
+{
+	const Mesh mesh = CreateSphereMesh(static_cast<uint32_t>(state.range(0)));
+	const std::vector<ili::Ray> rays = CreateRays(1024);
+	const ili::MeshBvh bvh{ mesh.positions, mesh.indices };
+
+	size_t rayIndex{};
+	size_t hitCount{};
+	for (auto _ : state)
+	{
+		ili::MeshRayHit hit{};
+		hitCount += bvh.Raycast(rays[rayIndex++ % rays.size()], 10.f, hit);
+		benchmark::DoNotOptimize(hit);
+	}
+
+	state.SetLabel(ili::MeshBvh::GetInstructionSet());
+	state.counters["triangles"] = static_cast<double>(bvh.GetTriangleCount());
+	state.counters["hitRate"] = static_cast<double>(hitCount) / static_cast<double>(std::max<int64_t>(state.iterations(), 1));
+	state.counters["bytes"] = static_cast<double>(bvh.GetMemorySize());
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MeshBvhRaycast)->RangeMultiplier(4)->Range(8, 512);
+
+// The same rays against every triangle, argument is the ring count of the sphere
+static void BM_BruteForceRaycast(benchmark::State& state)
+{
+	const Mesh mesh = CreateSphereMesh(static_cast<uint32_t>(state.range(0)));
+	const std::vector<ili::Ray> rays = CreateRays(1024);
+
+	size_t rayIndex{};
+	for (auto _ : state)
+	{
+		float distance{};
+		benchmark::DoNotOptimize(RaycastTriangles(mesh, rays[rayIndex++ % rays.size()], 10.f, distance));
+		benchmark::DoNotOptimize(distance);
+	}
+
+	state.counters["triangles"] = static_cast<double>(mesh.indices.size() / 3);
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BruteForceRaycast)->RangeMultiplier(4)->Range(8, 512);
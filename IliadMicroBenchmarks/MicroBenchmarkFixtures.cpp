@@ -0,0 +1,74 @@
+﻿#include "MicroBenchmarkFixtures.h"
+
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "Graphics/Device.h"
+
+std::string GetGridObjFile(uint32_t quadsPerSide)
+{
+	const std::filesystem::path filePath = std::filesystem::temp_directory_path() / ("iliad_grid_" + std::to_string(quadsPerSide) + ".obj");
+	if (std::filesystem::exists(filePath)) return filePath.string();
+
+	std::ofstream file{ filePath };
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Failed to open file: " + filePath.string());
+	}
+
+	const uint32_t verticesPerSide = quadsPerSide + 1;
+	const float step = 1.f / static_cast<float>(quadsPerSide);
+	for (uint32_t z{}; z < verticesPerSide; ++z)
+	{
+		for (uint32_t x{}; x < verticesPerSide; ++x)
+		{
+			file << "v " << static_cast<float>(x) * step << " 0 " << static_cast<float>(z) * step << '\n'
+				<< "vt " << static_cast<float>(x) * step << ' ' << static_cast<float>(z) * step << '\n';
+		}
+	}
+	file << "vn 0 1 0\n";
+
+	// OBJ indices start at one, position and texture coordinate share theirs
+	const auto corner = [verticesPerSide](uint32_t x, uint32_t z)
+	{
+		const uint32_t index = z * verticesPerSide + x + 1;
+		return std::to_string(index) + '/' + std::to_string(index) + "/1";
+	};
+	for (uint32_t z{}; z < quadsPerSide; ++z)
+	{
+		for (uint32_t x{}; x < quadsPerSide; ++x)
+		{
+			file << "f " << corner(x, z) << ' ' << corner(x, z + 1) << ' ' << corner(x + 1, z + 1) << '\n'
+				<< "f " << corner(x, z) << ' ' << corner(x + 1, z + 1) << ' ' << corner(x + 1, z) << '\n';
+		}
+	}
+
+	return filePath.string();
+}
+
+void ApplyThreadCountArguments(benchmark::internal::Benchmark* pBenchmark)
+{
+	const int64_t coreCount = std::max(std::thread::hardware_concurrency(), 1u);
+	for (int64_t threadCount = 1; threadCount <= coreCount; ++threadCount) pBenchmark->Arg(threadCount);
+}
+
+ili::Device* GetBenchmarkDevice()
+{
+	static const std::unique_ptr<ili::Device> pDevice = []() -> std::unique_ptr<ili::Device>
+	{
+		try
+		{
+			return std::make_unique<ili::Device>(nullptr);
+		}
+		catch (const std::exception&)
+		{
+			return nullptr;
+		}
+	}();
+	return pDevice.get();
+}
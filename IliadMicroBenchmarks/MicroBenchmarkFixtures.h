@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+#include "Core/JobSystem.h"
+#include "SceneGraph/Scene.h"
+
+namespace ili
+{
+	class Device;
+}
+
+// Scene that can be created without a SceneManager, filled by the benchmarks themselves
+class MicroBenchmarkScene final : public ili::Scene
+{
+public:
+	MicroBenchmarkScene() = default;
+	virtual ~MicroBenchmarkScene() override = default;
+
+	MicroBenchmarkScene(const MicroBenchmarkScene& other) = delete;
+	MicroBenchmarkScene(MicroBenchmarkScene&& other) noexcept = delete;
+	MicroBenchmarkScene& operator=(const MicroBenchmarkScene& other) = delete;
+	MicroBenchmarkScene& operator=(MicroBenchmarkScene&& other) noexcept = delete;
+
+	virtual void Initialize() override {}
+
+protected:
+	virtual void Update(float /*deltaTime*/) override {}
+};
+
+// Fixed seed, so every run measures the same inputs
+inline std::mt19937& GetBenchmarkRandom()
+{
+	static std::mt19937 random{ 1234 };
+	return random;
+}
+
+// Writes a flat grid of quadsPerSide^2 quads as an OBJ file into the temp directory, once per size.
+// Every inner vertex is shared by six triangles, the same ratio as a closed triangle mesh
+std::string GetGridObjFile(uint32_t quadsPerSide);
+
+// Restarts the JobSystem with threadCount threads including the calling one and with the default workers again when it goes out of scope.
+// Nothing starts the workers otherwise, the benchmarks run without an IliadGame
+class ScopedJobSystemThreads final
+{
+public:
+	explicit ScopedJobSystemThreads(uint32_t threadCount = ili::JobSystem::GetDefaultWorkerCount() + 1) { ili::JobSystem::GetInstance().Initialize(threadCount - 1); }
+	~ScopedJobSystemThreads() { ili::JobSystem::GetInstance().Initialize(); }
+
+	ScopedJobSystemThreads(const ScopedJobSystemThreads& other) = delete;
+	ScopedJobSystemThreads(ScopedJobSystemThreads&& other) noexcept = delete;
+	ScopedJobSystemThreads& operator=(const ScopedJobSystemThreads& other) = delete;
+	ScopedJobSystemThreads& operator=(ScopedJobSystemThreads&& other) noexcept = delete;
+};
+
+// One argument per thread count, from the calling thread alone up to one per core
+void ApplyThreadCountArguments(benchmark::internal::Benchmark* pBenchmark);
+
+// Headless device shared by the benchmarks that cannot avoid one, null when no Vulkan driver is installed
+ili::Device* GetBenchmarkDevice();
@@ -0,0 +1,231 @@
+﻿#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "SceneGraph/GameObject.h"
+#include "SceneGraph/ModelComponent.h"
+#include "SceneGraph/TransformComponent.h"
+#include "MicroBenchmarkFixtures.h"
+
+namespace
+{
+	std::vector<std::unique_ptr<ili::TransformComponent>> CreateTransforms(size_t count)
+	{
+		std::uniform_real_distribution<float> distribution{ -10.f, 10.f };
+		auto& random = GetBenchmarkRandom();
+
+		std::vector<std::unique_ptr<ili::TransformComponent>> transforms(count);
+		for (auto& pTransform : transforms)
+		{
+			pTransform = std::make_unique<ili::TransformComponent>();
+			pTransform->SetPosition({ distribution(random), distribution(random), distribution(random) });
+			pTransform->SetRotationDegrees({ distribution(random) * 18.f, distribution(random) * 18.f, distribution(random) * 18.f });
+			pTransform->SetScale(glm::vec3{ 1.f + distribution(random) * .05f });
+		}
+		return transforms;
+	}
+
+	// Distinct component types the lookup has to walk past
+	template <int Index>
+	class FillerComponent final : public ili::BaseComponent
+	{
+	protected:
+		virtual void Initialize() override {}
+	};
+
+	class TargetComponent final : public ili::BaseComponent
+	{
+	protected:
+		virtual void Initialize() override {}
+	};
+
+	constexpr int MAX_FILLER_COMPONENTS = 16;
+
+	template <int... Indices>
+	void AddFillerComponents(ili::GameObject& gameObject, int count, std::integer_sequence<int, Indices...>)
+	{
+		((Indices < count ? static_cast<void>(gameObject.AddComponent<FillerComponent<Indices>>()) : void()), ...);
+	}
+}
+
+// Argument is the transform count
+static void BM_TransformGetMatrix(benchmark::State& state)
+{
+	const auto transforms = CreateTransforms(static_cast<size_t>(state.range(0)));
+
+	for (auto _ : state)
+	{
+		for (const auto& pTransform : transforms)
+		{
+			glm::mat4 matrix = pTransform->GetMatrix();
+			benchmark::DoNotOptimize(matrix);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransformGetMatrix)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+// Argument is the transform count
+static void BM_TransformGetNormalMatrix(benchmark::State& state)
+{
+	const auto transforms = CreateTransforms(static_cast<size_t>(state.range(0)));
+
+	for (auto _ : state)
+	{
+		for (const auto& pTransform : transforms)
+		{
+			glm::mat3 matrix = pTransform->GetNormalMatrix();
+			benchmark::DoNotOptimize(matrix);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransformGetNormalMatrix)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+// Every transform moves before its matrices are read, so the cache never hits. Argument is the transform count
+static void BM_TransformRecompute(benchmark::State& state)
+{
+	const auto transforms = CreateTransforms(static_cast<size_t>(state.range(0)));
+
+	for (auto _ : state)
+	{
+		for (const auto& pTransform : transforms)
+		{
+			pTransform->Translate({ 0.f, 0.f, 0.f });
+			glm::mat4 matrix = pTransform->GetMatrix();
+			glm::mat3 normalMatrix = pTransform->GetNormalMatrix();
+			benchmark::DoNotOptimize(matrix);
+			benchmark::DoNotOptimize(normalMatrix);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransformRecompute)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+// Argument is the number of components added before the one that is looked up, after the transform
+static void BM_GameObjectGetComponent(benchmark::State& state)
+{
+	MicroBenchmarkScene scene{};
+	ili::GameObject* pGameObject = scene.CreateGameObject<ili::GameObject>();
+	AddFillerComponents(*pGameObject, static_cast<int>(state.range(0)), std::make_integer_sequence<int, MAX_FILLER_COMPONENTS>{});
+	pGameObject->AddComponent<TargetComponent>();
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(pGameObject->GetComponent<TargetComponent>());
+	}
+}
+BENCHMARK(BM_GameObjectGetComponent)->DenseRange(0, MAX_FILLER_COMPONENTS, 4);
+
+// Walks every object with a transform and a model the way the render systems do, every other object has one.
+// Argument is the object count
+static void BM_SceneViewModels(benchmark::State& state)
+{
+	const size_t objectCount = static_cast<size_t>(state.range(0));
+
+	MicroBenchmarkScene scene{};
+	for (size_t i{}; i < objectCount; ++i)
+	{
+		ili::GameObject* pGameObject = scene.CreateGameObject<ili::GameObject>();
+		if (i % 2 == 0) pGameObject->AddComponent<ili::ModelComponent>();
+	}
+
+	for (auto _ : state)
+	{
+		for (const auto [pTransform, pModelComponent] : scene.View<ili::TransformComponent, ili::ModelComponent>())
+		{
+			benchmark::DoNotOptimize(pTransform);
+			benchmark::DoNotOptimize(pModelComponent);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(objectCount));
+}
+BENCHMARK(BM_SceneViewModels)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+// Removes an object from the middle of the scene, argument is the object count
+static void BM_SceneRemoveGameObject(benchmark::State& state)
+{
+	const size_t objectCount = static_cast<size_t>(state.range(0));
+
+	MicroBenchmarkScene scene{};
+	for (size_t i{}; i < objectCount; ++i) scene.CreateGameObject<ili::GameObject>();
+
+	for (auto _ : state)
+	{
+		scene.RemoveGameObject(scene.GetGameObjects()[objectCount / 2]->GetHandle());
+		scene.DestroyRemovedGameObjects();
+
+		// Keeps the scene at the same size for the next iteration
+		state.PauseTiming();
+		scene.CreateGameObject<ili::GameObject>();
+		state.ResumeTiming();
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SceneRemoveGameObject)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+// A frame of projectiles, a thousand spawn and the thousand of the previous frame are destroyed.
+// The new projectiles are still listed as moved while the old ones are destroyed, the update then clears the list.
+// Argument is the number of other objects in the scene. None of them is recomputed or refitted, they are only
+// walked when the hierarchy closes the gaps the destroyed projectiles left, once every few frames
+static void BM_SceneSpawnDespawn(benchmark::State& state)
+{
+	constexpr size_t SPAWNS_PER_FRAME = 1'000;
+
+	MicroBenchmarkScene scene{};
+	for (int64_t i{}; i < state.range(0); ++i) scene.CreateGameObject<ili::GameObject>();
+
+	std::vector<ili::GameObjectHandle> projectiles{};
+	for (auto _ : state)
+	{
+		for (const ili::GameObjectHandle handle : projectiles) scene.RemoveGameObject(handle);
+		projectiles.clear();
+
+		for (size_t i{}; i < SPAWNS_PER_FRAME; ++i)
+		{
+			ili::GameObject* pProjectile = scene.CreateGameObject<ili::GameObject>();
+			pProjectile->AddComponent<ili::ModelComponent>();
+			projectiles.push_back(pProjectile->GetHandle());
+		}
+
+		scene.DestroyRemovedGameObjects();
+		scene.UpdateTransforms();
+	}
+
+	state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(SPAWNS_PER_FRAME));
+}
+BENCHMARK(BM_SceneSpawnDespawn)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+// Fills a scene with objects that each have a model and destroys it again, argument is the object count.
+// The counters are the pool statistics of the full scene
+static void BM_SceneLoadUnload(benchmark::State& state)
+{
+	const size_t objectCount = static_cast<size_t>(state.range(0));
+
+	ili::SceneAllocatorStats stats{};
+	for (auto _ : state)
+	{
+		auto pScene = std::make_unique<MicroBenchmarkScene>();
+		for (size_t i{}; i < objectCount; ++i)
+		{
+			pScene->CreateGameObject<ili::GameObject>()->AddComponent<ili::ModelComponent>();
+		}
+
+		state.PauseTiming();
+		stats = pScene->GetAllocatorStats();
+		state.ResumeTiming();
+	}
+
+	state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(objectCount));
+	state.counters["poolAllocations"] = static_cast<double>(stats.allocationCount);
+	state.counters["chunks"] = stats.chunkCount;
+	state.counters["fragmentation"] = stats.GetFragmentation();
+}
+BENCHMARK(BM_SceneLoadUnload)->RangeMultiplier(8)->Range(64, 1 << 15);
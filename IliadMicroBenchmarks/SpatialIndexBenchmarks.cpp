@@ -0,0 +1,158 @@
+﻿#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "SceneGraph/Bounds.h"
+#include "SceneGraph/SpatialIndex.h"
+#include "MicroBenchmarkFixtures.h"
+
+namespace
+{
+	constexpr float WORLD_HALF_EXTENT = 100.f;
+
+	// Unit sized boxes spread through the world
+	std::vector<ili::AABB> CreateBounds(size_t count)
+	{
+		std::uniform_real_distribution<float> distribution{ -WORLD_HALF_EXTENT, WORLD_HALF_EXTENT };
+		auto& random = GetBenchmarkRandom();
+
+		std::vector<ili::AABB> bounds(count);
+		for (ili::AABB& box : bounds)
+		{
+			const glm::vec3 center{ distribution(random), distribution(random), distribution(random) };
+			box = ili::AABB{ center - .5f, center + .5f };
+		}
+		return bounds;
+	}
+
+	// A camera in the middle of the world that sees a few percent of it
+	ili::Frustum CreateFrustum()
+	{
+		const glm::mat4 projection = glm::perspective(glm::radians(60.f), 16.f / 9.f, .1f, WORLD_HALF_EXTENT * .5f);
+		const glm::mat4 view = glm::lookAt(glm::vec3{ 0.f }, glm::vec3{ 1.f, 0.f, 0.f }, glm::vec3{ 0.f, 1.f, 0.f });
+		return ili::Frustum{ projection * view };
+	}
+}
+
+// Argument is the object count
+static void BM_SpatialIndexQueryFrustum(benchmark::State& state)
+{
+	const std::vector<ili::AABB> bounds = CreateBounds(static_cast<size_t>(state.range(0)));
+	const ili::Frustum frustum = CreateFrustum();
+
+	ili::SpatialIndex index{};
+	for (const ili::AABB& box : bounds) index.Insert(box, nullptr);
+
+	size_t visibleCount{};
+	for (auto _ : state)
+	{
+		visibleCount = 0;
+		index.QueryFrustum(frustum, [&visibleCount](ili::GameObject*) { ++visibleCount; });
+		benchmark::DoNotOptimize(visibleCount);
+	}
+
+	state.counters["visible"] = static_cast<double>(visibleCount);
+	state.counters["height"] = static_cast<double>(index.GetHeight());
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SpatialIndexQueryFrustum)->RangeMultiplier(8)->Range(64, 1 << 18);
+
+// What the render systems did before the index, every box against the frustum. Argument is the object count
+static void BM_LinearQueryFrustum(benchmark::State& state)
+{
+	const std::vector<ili::AABB> bounds = CreateBounds(static_cast<size_t>(state.range(0)));
+	const ili::Frustum frustum = CreateFrustum();
+
+	size_t visibleCount{};
+	for (auto _ : state)
+	{
+		visibleCount = 0;
+		for (const ili::AABB& box : bounds)
+		{
+			if (frustum.Intersects(box)) ++visibleCount;
+		}
+		benchmark::DoNotOptimize(visibleCount);
+	}
+
+	state.counters["visible"] = static_cast<double>(visibleCount);
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LinearQueryFrustum)->RangeMultiplier(8)->Range(64, 1 << 18);
+
+// Small spheres around random points, the kind of query gameplay code runs. Argument is the object count
+static void BM_SpatialIndexQuerySphere(benchmark::State& state)
+{
+	const std::vector<ili::AABB> bounds = CreateBounds(static_cast<size_t>(state.range(0)));
+	const std::vector<ili::AABB> queryPoints = CreateBounds(256);
+
+	ili::SpatialIndex index{};
+	for (const ili::AABB& box : bounds) index.Insert(box, nullptr);
+
+	size_t queryIndex{};
+	for (auto _ : state)
+	{
+		size_t hitCount{};
+		const ili::Sphere sphere{ queryPoints[queryIndex++ % queryPoints.size()].GetCenter(), 5.f };
+		index.QuerySphere(sphere, [&hitCount](ili::GameObject*) { ++hitCount; });
+		benchmark::DoNotOptimize(hitCount);
+	}
+}
+BENCHMARK(BM_SpatialIndexQuerySphere)->RangeMultiplier(8)->Range(64, 1 << 18);
+
+// Rays through the whole world that stop at the first box they hit. Argument is the object count
+static void BM_SpatialIndexQueryRay(benchmark::State& state)
+{
+	const std::vector<ili::AABB> bounds = CreateBounds(static_cast<size_t>(state.range(0)));
+	const std::vector<ili::AABB> targets = CreateBounds(256);
+
+	ili::SpatialIndex index{};
+	for (const ili::AABB& box : bounds) index.Insert(box, nullptr);
+
+	size_t rayIndex{};
+	for (auto _ : state)
+	{
+		const glm::vec3 target = targets[rayIndex++ % targets.size()].GetCenter();
+		const ili::Ray ray{ -target, glm::normalize(target) };
+
+		float closestDistance = 4.f * WORLD_HALF_EXTENT;
+		index.QueryRay(ray, closestDistance, [&closestDistance](ili::GameObject*, float distance)
+		{
+			closestDistance = std::min(closestDistance, distance);
+			return closestDistance;
+		});
+		benchmark::DoNotOptimize(closestDistance);
+	}
+}
+BENCHMARK(BM_SpatialIndexQueryRay)->RangeMultiplier(8)->Range(64, 1 << 18);
+
+// A tenth of the objects drift every frame, most of them stay inside their leaf box and only the rest is reinserted.
+// Argument is the object count
+static void BM_SpatialIndexMove(benchmark::State& state)
+{
+	std::vector<ili::AABB> bounds = CreateBounds(static_cast<size_t>(state.range(0)));
+	std::uniform_real_distribution<float> distribution{ -.1f, .1f };
+	auto& random = GetBenchmarkRandom();
+
+	ili::SpatialIndex index{};
+	std::vector<uint32_t> proxies{};
+	for (const ili::AABB& box : bounds) proxies.push_back(index.Insert(box, nullptr));
+
+	for (auto _ : state)
+	{
+		for (size_t i{}; i < bounds.size(); i += 10)
+		{
+			const glm::vec3 offset{ distribution(random), distribution(random), distribution(random) };
+			bounds[i].min += offset;
+			bounds[i].max += offset;
+			index.Move(proxies[i], bounds[i]);
+		}
+		index.RebuildIfDegraded();
+	}
+
+	state.counters["areaRatio"] = static_cast<double>(index.GetAreaRatio());
+	state.SetItemsProcessed(state.iterations() * (state.range(0) + 9) / 10);
+}
+BENCHMARK(BM_SpatialIndexMove)->RangeMultiplier(8)->Range(64, 1 << 18);
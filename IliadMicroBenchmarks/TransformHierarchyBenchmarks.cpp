@@ -0,0 +1,103 @@
+﻿#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "SceneGraph/TransformComponent.h"
+#include "SceneGraph/TransformHierarchy.h"
+#include "MicroBenchmarkFixtures.h"
+
+namespace
+{
+	constexpr uint32_t HIERARCHY_NODE_COUNT = 100'000;
+
+	// Breadth-first tree where every node gets fanout children, a fanout of one is a single chain
+	struct HierarchyFixture
+	{
+		// First, the hierarchy splits its work over the threads of the JobSystem when it rebuilds
+		ScopedJobSystemThreads threads;
+		std::vector<std::unique_ptr<ili::TransformComponent>> transforms{};
+		ili::TransformHierarchy hierarchy{};
+
+		HierarchyFixture(uint32_t rootCount, uint32_t fanout, uint32_t threadCount = ili::JobSystem::GetDefaultWorkerCount() + 1)
+			: threads(threadCount)
+		{
+			std::uniform_real_distribution<float> distribution{ -1.f, 1.f };
+			auto& random = GetBenchmarkRandom();
+
+			transforms.reserve(HIERARCHY_NODE_COUNT);
+			for (uint32_t i{}; i < HIERARCHY_NODE_COUNT; ++i)
+			{
+				auto& pTransform = transforms.emplace_back(std::make_unique<ili::TransformComponent>());
+				pTransform->SetPosition({ distribution(random), distribution(random), distribution(random) });
+				pTransform->SetRotationDegrees({ 0.f, distribution(random) * 180.f, 0.f });
+				hierarchy.Add(pTransform.get());
+
+				if (i >= rootCount) pTransform->SetParent(transforms[(i - rootCount) / fanout].get());
+			}
+			hierarchy.Update();
+		}
+	};
+}
+
+// Every root moves, so all 100k world matrices are propagated. Arguments are the root count and the fanout
+static void BM_HierarchyUpdateAll(benchmark::State& state)
+{
+	HierarchyFixture fixture{ static_cast<uint32_t>(state.range(0)), static_cast<uint32_t>(state.range(1)) };
+
+	for (auto _ : state)
+	{
+		for (int64_t i{}; i < state.range(0); ++i) fixture.transforms[i]->Translate({ 0.f, 0.f, 0.f });
+		fixture.hierarchy.Update();
+	}
+
+	state.SetItemsProcessed(state.iterations() * HIERARCHY_NODE_COUNT);
+}
+BENCHMARK(BM_HierarchyUpdateAll)->Args({ 1, 1 })->Args({ 1, 4 })->Args({ 1, 16 })->Args({ 1'000, 8 })->Unit(benchmark::kMicrosecond);
+
+// One node in a hundred moves, only their subtrees are updated. Arguments are the root count and the fanout
+static void BM_HierarchyUpdateDirtySubtrees(benchmark::State& state)
+{
+	HierarchyFixture fixture{ static_cast<uint32_t>(state.range(0)), static_cast<uint32_t>(state.range(1)) };
+
+	std::uniform_int_distribution<size_t> distribution{ 0, fixture.transforms.size() - 1 };
+	std::vector<ili::TransformComponent*> pMoving(HIERARCHY_NODE_COUNT / 100);
+	for (auto& pTransform : pMoving) pTransform = fixture.transforms[distribution(GetBenchmarkRandom())].get();
+
+	for (auto _ : state)
+	{
+		for (ili::TransformComponent* pTransform : pMoving) pTransform->Translate({ 0.f, 0.f, 0.f });
+		fixture.hierarchy.Update();
+	}
+
+	state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(pMoving.size()));
+}
+BENCHMARK(BM_HierarchyUpdateDirtySubtrees)->Args({ 1, 4 })->Args({ 1, 16 })->Args({ 1'000, 8 })->Unit(benchmark::kMicrosecond);
+
+// Nothing moved, the cost of a frame without changes
+static void BM_HierarchyUpdateClean(benchmark::State& state)
+{
+	HierarchyFixture fixture{ 1'000, 8 };
+
+	for (auto _ : state)
+	{
+		fixture.hierarchy.Update();
+	}
+}
+BENCHMARK(BM_HierarchyUpdateClean);
+
+// Every root of a wide forest moves, argument is the thread count of the JobSystem including the calling one
+static void BM_HierarchyUpdateScaling(benchmark::State& state)
+{
+	HierarchyFixture fixture{ 1'000, 8, static_cast<uint32_t>(state.range(0)) };
+
+	for (auto _ : state)
+	{
+		for (uint32_t i{}; i < 1'000; ++i) fixture.transforms[i]->Translate({ 0.f, 0.f, 0.f });
+		fixture.hierarchy.Update();
+	}
+
+	state.counters["threads"] = static_cast<double>(ili::JobSystem::GetInstance().GetThreadCount());
+	state.SetItemsProcessed(state.iterations() * HIERARCHY_NODE_COUNT);
+}
+BENCHMARK(BM_HierarchyUpdateScaling)->Apply(ApplyThreadCountArguments)->Unit(benchmark::kMicrosecond)->UseRealTime();
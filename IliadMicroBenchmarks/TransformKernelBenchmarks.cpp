@@ -0,0 +1,116 @@
+﻿#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "SceneGraph/TransformKernels.h"
+#include "MicroBenchmarkFixtures.h"
+
+namespace
+{
+	// Every third transform has a uniform scale, so both normal matrix paths are covered
+	ili::TransformBatch CreateBatch(size_t count)
+	{
+		std::uniform_real_distribution<float> distribution{ -1.f, 1.f };
+		auto& random = GetBenchmarkRandom();
+
+		ili::TransformBatch batch{};
+		for (size_t i{}; i < count; ++i)
+		{
+			const glm::vec3 position{ distribution(random) * 100.f, distribution(random) * 100.f, distribution(random) * 100.f };
+			const glm::vec3 rotation{ distribution(random) * 10.f, distribution(random) * 10.f, distribution(random) * 10.f };
+			const float scale = 1.5f + distribution(random);
+			batch.Add(position, rotation, i % 3 == 0 ? glm::vec3{ scale } : glm::vec3{ scale, 1.5f + distribution(random), 1.5f + distribution(random) });
+		}
+		return batch;
+	}
+
+	// Largest difference to the matrices glm builds, relative for elements above one
+	float GetMaxErrorToGlm(const ili::TransformBatch& batch)
+	{
+		float maxError{};
+		const auto compare = [&maxError](float expected, float actual)
+		{
+			maxError = std::max(maxError, std::abs(expected - actual) / std::max(std::abs(expected), 1.f));
+		};
+
+		for (size_t i{}; i < batch.GetSize(); ++i)
+		{
+			const glm::vec3 scale{ batch.scaleX[i], batch.scaleY[i], batch.scaleZ[i] };
+
+			glm::mat4 expected = glm::translate(glm::mat4{ 1.f }, { batch.positionX[i], batch.positionY[i], batch.positionZ[i] });
+			expected = glm::rotate(expected, batch.rotationY[i], { 0.f, 1.f, 0.f });
+			expected = glm::rotate(expected, batch.rotationX[i], { 1.f, 0.f, 0.f });
+			expected = glm::rotate(expected, batch.rotationZ[i], { 0.f, 0.f, 1.f });
+			expected = glm::scale(expected, scale);
+
+			// The kernels leave the magnitude of a uniform scale out of the normal matrix
+			glm::mat3 expectedNormal = glm::transpose(glm::inverse(glm::mat3{ expected }));
+			if (scale.x == scale.y && scale.y == scale.z) expectedNormal *= std::abs(scale.x);
+
+			for (int column{}; column < 4; ++column)
+			{
+				for (int row{}; row < 4; ++row) compare(expected[column][row], batch.matrices[i][column][row]);
+			}
+			for (int column{}; column < 3; ++column)
+			{
+				for (int row{}; row < 3; ++row) compare(expectedNormal[column][row], batch.normalMatrices[i][column][row]);
+			}
+		}
+		return maxError;
+	}
+}
+
+// Argument is the transform count, odd counts go through the padded last iteration
+static void BM_TransformKernels(benchmark::State& state)
+{
+	ili::TransformBatch batch = CreateBatch(static_cast<size_t>(state.range(0)));
+
+	ili::ComputeTransformMatrices(batch);
+	const float maxError = GetMaxErrorToGlm(batch);
+	if (maxError > 1e-5f)
+	{
+		state.SkipWithError("Kernel results differ from glm");
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		ili::ComputeTransformMatrices(batch);
+		benchmark::DoNotOptimize(batch.matrices.data());
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+	state.counters["lanes"] = static_cast<double>(ili::GetTransformKernelWidth());
+	state.counters["maxError"] = maxError;
+}
+BENCHMARK(BM_TransformKernels)->Arg(7)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+// The same work one transform at a time, what TransformComponent does for a single lazy read
+static void BM_TransformKernelsScalar(benchmark::State& state)
+{
+	ili::TransformBatch batch = CreateBatch(static_cast<size_t>(state.range(0)));
+	batch.matrices.resize(batch.GetSize());
+	batch.normalMatrices.resize(batch.GetSize());
+
+	for (auto _ : state)
+	{
+		for (size_t i{}; i < batch.GetSize(); ++i)
+		{
+			ili::ComputeTransformMatrix({ batch.positionX[i], batch.positionY[i], batch.positionZ[i] },
+				{ batch.rotationX[i], batch.rotationY[i], batch.rotationZ[i] },
+				{ batch.scaleX[i], batch.scaleY[i], batch.scaleZ[i] },
+				batch.matrices[i], batch.normalMatrices[i]);
+		}
+		benchmark::DoNotOptimize(batch.matrices.data());
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+	state.counters["maxError"] = GetMaxErrorToGlm(batch);
+}
+BENCHMARK(BM_TransformKernelsScalar)->Arg(7)->RangeMultiplier(8)->Range(64, 1 << 15);
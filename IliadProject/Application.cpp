@@ -1,5 +1,7 @@
 #include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <string_view>
 #include <vulkan/vulkan.h>
 #include <GLFW/glfw3.h>
 
@@ -15,9 +17,30 @@
 #include "Input/KeyboardInputMovement.h"
 #include "ProjectCore/IliadSampleProject.h"
 #include "SceneGraph/SceneManager.h"
-int main()
+// --headless [--frames N] [--width N] [--height N] [--capture DIRECTORY] [--capture-interval N]
+ili::HeadlessSettings ParseHeadlessSettings(int argc, char* argv[])
+{
+	ili::HeadlessSettings settings{};
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const std::string_view argument{ argv[i] };
+		const bool hasValue = i + 1 < argc;
+
+		if (argument == "--headless") settings.enabled = true;
+		else if (argument == "--frames" && hasValue) settings.frameCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if (argument == "--width" && hasValue) settings.width = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if (argument == "--height" && hasValue) settings.height = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if (argument == "--capture" && hasValue) settings.captureDirectory = argv[++i];
+		else if (argument == "--capture-interval" && hasValue) settings.captureInterval = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else std::cerr << "Ignoring unknown argument " << argument << std::endl;
+	}
+	return settings;
+}
+
+int main(int argc, char* argv[])
 {
 	const auto pGame = new IliadSampleProject();
+	pGame->SetHeadlessSettings(ParseHeadlessSettings(argc, argv));
 	pGame->Run();
 	delete pGame;
 	return 0;
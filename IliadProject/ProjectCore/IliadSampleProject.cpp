@@ -3,7 +3,11 @@
 
 void IliadSampleProject::OnGamePreparing()
 {
-
+	SetRenderPath(ili::RenderPath::Forward);
+	SetOcclusionCullingEnabled(true);
+	SetDynamicResolutionEnabled(true);
+	SetTargetFrameTime(1000.f / 60.f);
+	SetGpuProfilingEnabled(true);
 }
 
 void IliadSampleProject::InitializeGame()
@@ -0,0 +1,178 @@
+﻿#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Core/JobSystem.h"
+
+namespace
+{
+	// Starts the workers with the test thread as the main thread, every test leaves the job system shut down
+	class JobSystemTest : public testing::Test
+	{
+	protected:
+		static constexpr uint32_t WORKER_COUNT = 3;
+
+		virtual void SetUp() override { m_JobSystem.Initialize(WORKER_COUNT); }
+		virtual void TearDown() override { m_JobSystem.Shutdown(); }
+
+		ili::JobSystem& m_JobSystem{ ili::JobSystem::GetInstance() };
+	};
+
+	// Counts how often ParallelFor hands out each index
+	std::vector<uint32_t> GetVisitCounts(ili::JobSystem& jobSystem, uint32_t count, uint32_t grainSize)
+	{
+		std::vector<std::atomic<uint32_t>> visitCounts(count);
+		jobSystem.ParallelFor(count, grainSize, [&visitCounts, count](uint32_t begin, uint32_t end)
+		{
+			EXPECT_LT(begin, end);
+			EXPECT_LE(end, count);
+			for (uint32_t i = begin; i < end; ++i) ++visitCounts[i];
+		});
+
+		std::vector<uint32_t> counts{};
+		for (const std::atomic<uint32_t>& visitCount : visitCounts) counts.push_back(visitCount.load());
+		return counts;
+	}
+
+	// Starts depth levels of jobs that each start two jobs and wait for them
+	void RunNested(ili::JobSystem& jobSystem, uint32_t depth, std::atomic<uint32_t>& leafCount)
+	{
+		if (depth == 0)
+		{
+			++leafCount;
+			return;
+		}
+
+		ili::JobCounter counter{};
+		for (int i{}; i < 2; ++i) jobSystem.Run([&jobSystem, depth, &leafCount]() { RunNested(jobSystem, depth - 1, leafCount); }, &counter);
+		jobSystem.Wait(counter);
+	}
+}
+
+TEST_F(JobSystemTest, ParallelForVisitsEveryIndexOnce)
+{
+	EXPECT_EQ(m_JobSystem.GetThreadCount(), WORKER_COUNT + 1);
+
+	// Fewer chunks than threads, a single chunk, a last chunk that is not full and many small chunks
+	const std::pair<uint32_t, uint32_t> ranges[]{ { 0, 4 }, { 1, 1 }, { 3, 8 }, { 10, 3 }, { 1'000, 7 }, { 10'000, 64 }, { 4'096, 1 } };
+	for (const auto& [count, grainSize] : ranges)
+	{
+		EXPECT_EQ(GetVisitCounts(m_JobSystem, count, grainSize), std::vector<uint32_t>(count, 1u)) << count << " in chunks of " << grainSize;
+	}
+}
+
+TEST_F(JobSystemTest, ParallelForRethrowsAfterEveryChunkFinished)
+{
+	std::atomic<uint32_t> visitedCount{};
+	EXPECT_THROW(m_JobSystem.ParallelFor(1'000, 10, [&visitedCount](uint32_t begin, uint32_t end)
+	{
+		visitedCount += end - begin;
+		if (begin == 500) throw std::runtime_error("Chunk failed");
+	}), std::runtime_error);
+	EXPECT_EQ(visitedCount.load(), 1'000u);
+}
+
+TEST_F(JobSystemTest, WaitReturnsOnceTheCounterIsDone)
+{
+	ili::JobCounter counter{};
+	EXPECT_TRUE(counter.IsDone());
+
+	std::atomic<uint32_t> finishedCount{};
+	std::vector<uint32_t> results(200);
+	for (uint32_t i{}; i < results.size(); ++i)
+	{
+		m_JobSystem.Run([&finishedCount, &results, i]()
+		{
+			results[i] = i * i;
+			++finishedCount;
+		}, &counter);
+	}
+	m_JobSystem.Wait(counter);
+
+	EXPECT_TRUE(counter.IsDone());
+	EXPECT_EQ(finishedCount.load(), 200u);
+	// Wait also makes the results of the jobs visible
+	for (uint32_t i{}; i < results.size(); ++i) EXPECT_EQ(results[i], i * i);
+
+	// A done counter can be reused, and waiting on it again returns right away
+	m_JobSystem.Wait(counter);
+	m_JobSystem.Run([&finishedCount]() { ++finishedCount; }, &counter);
+	m_JobSystem.Wait(counter);
+	EXPECT_EQ(finishedCount.load(), 201u);
+}
+
+// Far more jobs wait for their children than there are threads, the waiting threads have to run the children themselves
+TEST_F(JobSystemTest, NestedWaitsDoNotDeadlock)
+{
+	std::atomic<uint32_t> leafCount{};
+	RunNested(m_JobSystem, 8, leafCount);
+	EXPECT_EQ(leafCount.load(), 256u);
+
+	// ParallelFor inside of ParallelFor waits the same way
+	std::atomic<uint32_t> visitedCount{};
+	m_JobSystem.ParallelFor(16, 1, [this, &visitedCount](uint32_t, uint32_t)
+	{
+		m_JobSystem.ParallelFor(64, 4, [&visitedCount](uint32_t begin, uint32_t end) { visitedCount += end - begin; });
+	});
+	EXPECT_EQ(visitedCount.load(), 16u * 64u);
+}
+
+TEST_F(JobSystemTest, MainThreadJobsRunOnTheMainThread)
+{
+	const std::thread::id mainThreadId = std::this_thread::get_id();
+	EXPECT_TRUE(m_JobSystem.IsMainThread());
+
+	// Right away on the main thread itself
+	bool hasRun{};
+	m_JobSystem.RunOnMainThread([&hasRun]() { hasRun = true; }, nullptr);
+	EXPECT_TRUE(hasRun);
+
+	// A job waits for main thread work, the main thread runs it while it waits for the job
+	std::thread::id runThreadId{};
+	ili::JobCounter counter{};
+	m_JobSystem.Run([this, &runThreadId]()
+	{
+		ili::JobCounter mainThreadCounter{};
+		m_JobSystem.RunOnMainThread([&runThreadId]() { runThreadId = std::this_thread::get_id(); }, &mainThreadCounter);
+		m_JobSystem.Wait(mainThreadCounter);
+	}, &counter);
+	m_JobSystem.Wait(counter);
+	EXPECT_EQ(runThreadId, mainThreadId);
+
+	// From a thread the job system does not know, queued until the game loop runs it
+	std::atomic<uint32_t> runCount{};
+	std::thread{ [this, &runCount]() { m_JobSystem.RunOnMainThread([&runCount]() { ++runCount; }, nullptr); } }.join();
+	EXPECT_EQ(runCount.load(), 0u);
+	m_JobSystem.ExecuteMainThreadJobs();
+	EXPECT_EQ(runCount.load(), 1u);
+}
+
+// Without workers every job runs on the thread that waits for it
+TEST_F(JobSystemTest, RunsEverythingOnTheWaitingThreadWithoutWorkers)
+{
+	m_JobSystem.Initialize(0);
+	EXPECT_EQ(m_JobSystem.GetThreadCount(), 1u);
+
+	const std::thread::id threadId = std::this_thread::get_id();
+	ili::JobCounter counter{};
+	uint32_t runCount{};
+	for (int i{}; i < 10; ++i)
+	{
+		m_JobSystem.Run([&runCount, threadId]()
+		{
+			EXPECT_EQ(std::this_thread::get_id(), threadId);
+			++runCount;
+		}, &counter);
+	}
+	EXPECT_FALSE(counter.IsDone());
+	m_JobSystem.Wait(counter);
+	EXPECT_EQ(runCount, 10u);
+
+	EXPECT_EQ(GetVisitCounts(m_JobSystem, 100, 7), std::vector<uint32_t>(100, 1u));
+}
@@ -0,0 +1,247 @@
+﻿#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/constants.hpp>
+
+#include "SceneGraph/Bounds.h"
+#include "SceneGraph/MeshBvh.h"
+
+namespace
+{
+	constexpr float MAX_DISTANCE_ERROR = 1e-4f;
+
+	struct Mesh
+	{
+		std::vector<glm::vec3> positions{};
+		std::vector<uint32_t> indices{};
+	};
+
+	struct BruteForceHit
+	{
+		float distance{};
+		uint32_t triangleIndex{};
+	};
+
+	// Unit sphere of rings * 2 * rings quads with smooth bumps, so the triangles are not all the same size and orientation
+	Mesh CreateSphereMesh(uint32_t rings)
+	{
+		const uint32_t sectors = 2 * rings;
+		Mesh mesh{};
+		for (uint32_t ring{}; ring <= rings; ++ring)
+		{
+			const float polar = glm::pi<float>() * static_cast<float>(ring) / static_cast<float>(rings);
+			for (uint32_t sector{}; sector <= sectors; ++sector)
+			{
+				const float azimuth = glm::two_pi<float>() * static_cast<float>(sector) / static_cast<float>(sectors);
+				const glm::vec3 direction{ std::sin(polar) * std::cos(azimuth), std::cos(polar), std::sin(polar) * std::sin(azimuth) };
+				mesh.positions.push_back(direction * (1.f + .1f * std::sin(6.f * polar) * std::sin(6.f * azimuth)));
+			}
+		}
+
+		for (uint32_t ring{}; ring < rings; ++ring)
+		{
+			for (uint32_t sector{}; sector < sectors; ++sector)
+			{
+				const uint32_t first = ring * (sectors + 1) + sector;
+				const uint32_t below = first + sectors + 1;
+				mesh.indices.insert(mesh.indices.end(), { first, below, first + 1, first + 1, below, below + 1 });
+			}
+		}
+		return mesh;
+	}
+
+	// Overlapping triangles of every size scattered through a box, without indices
+	Mesh CreateTriangleSoup(uint32_t triangleCount, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> position{ -4.f, 4.f };
+		std::uniform_real_distribution<float> size{ .05f, 2.f };
+
+		Mesh mesh{};
+		for (uint32_t i{}; i < triangleCount; ++i)
+		{
+			const glm::vec3 center{ position(random), position(random), position(random) };
+			const float triangleSize = size(random);
+			for (int vertex{}; vertex < 3; ++vertex)
+			{
+				mesh.positions.push_back(center + glm::vec3{ position(random), position(random), position(random) } * (triangleSize / 4.f));
+			}
+		}
+		return mesh;
+	}
+
+	// Möller-Trumbore over every triangle, hit from both sides like the MeshBvh
+	bool RaycastTriangles(const Mesh& mesh, const ili::Ray& ray, float maxDistance, BruteForceHit& hit)
+	{
+		const size_t vertexCount = mesh.indices.empty() ? mesh.positions.size() : mesh.indices.size();
+		const auto getPosition = [&mesh](size_t vertex) { return mesh.positions[mesh.indices.empty() ? vertex : mesh.indices[vertex]]; };
+
+		bool isHit{};
+		for (size_t i{}; i < vertexCount; i += 3)
+		{
+			const glm::vec3 vertex0 = getPosition(i);
+			const glm::vec3 edge1 = getPosition(i + 1) - vertex0;
+			const glm::vec3 edge2 = getPosition(i + 2) - vertex0;
+
+			const glm::vec3 p = glm::cross(ray.direction, edge2);
+			const float determinant = glm::dot(edge1, p);
+			if (determinant == 0.f) continue;
+
+			const float inverseDeterminant = 1.f / determinant;
+			const glm::vec3 s = ray.origin - vertex0;
+			const float u = glm::dot(s, p) * inverseDeterminant;
+			if (u < 0.f || u > 1.f) continue;
+
+			const glm::vec3 q = glm::cross(s, edge1);
+			const float v = glm::dot(ray.direction, q) * inverseDeterminant;
+			if (v < 0.f || u + v > 1.f) continue;
+
+			const float t = glm::dot(edge2, q) * inverseDeterminant;
+			if (t < 0.f || t >= maxDistance) continue;
+
+			maxDistance = t;
+			hit = { t, static_cast<uint32_t>(i / 3) };
+			isHit = true;
+		}
+		return isHit;
+	}
+
+	glm::vec3 GetRandomDirection(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> distribution{ -1.f, 1.f };
+		glm::vec3 direction{};
+		do
+		{
+			direction = { distribution(random), distribution(random), distribution(random) };
+		} while (glm::dot(direction, direction) < 1e-4f);
+		return glm::normalize(direction);
+	}
+
+	// Rays from outside aimed into the bounds or anywhere, rays starting inside the bounds and rays along the axes
+	std::vector<ili::Ray> CreateRays(const ili::AABB& bounds, size_t count, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> distribution{ 0.f, 1.f };
+		const auto getPointInBounds = [&]()
+		{
+			return bounds.min + (bounds.max - bounds.min) * glm::vec3{ distribution(random), distribution(random), distribution(random) };
+		};
+		const float outsideDistance = 2.f * glm::length(bounds.max - bounds.min);
+		const glm::vec3 center = (bounds.min + bounds.max) * .5f;
+
+		std::vector<ili::Ray> rays(count);
+		for (size_t i{}; i < count; ++i)
+		{
+			ili::Ray& ray = rays[i];
+			switch (i % 4)
+			{
+			case 0:
+				ray.origin = center + GetRandomDirection(random) * outsideDistance;
+				ray.direction = glm::normalize(getPointInBounds() - ray.origin);
+				break;
+			case 1:
+				// Most of these miss
+				ray.origin = center + GetRandomDirection(random) * outsideDistance;
+				ray.direction = GetRandomDirection(random);
+				break;
+			case 2:
+				ray.origin = getPointInBounds();
+				ray.direction = GetRandomDirection(random);
+				break;
+			default:
+			{
+				// Parallel to two slabs, the inverse direction holds infinities
+				ray.origin = getPointInBounds();
+				glm::vec3 direction{};
+				direction[static_cast<int>(i / 4 % 3)] = (i / 12) % 2 == 0 ? 1.f : -1.f;
+				ray.direction = direction;
+				break;
+			}
+			}
+		}
+		return rays;
+	}
+
+	void ExpectSameHitsAsBruteForce(const Mesh& mesh, const ili::MeshBvh& bvh, const std::vector<ili::Ray>& rays, float maxDistance)
+	{
+		uint32_t hitCount{};
+		uint32_t edgeHitCount{};
+		for (size_t i{}; i < rays.size(); ++i)
+		{
+			const ili::Ray& ray = rays[i];
+
+			BruteForceHit expected{};
+			const bool isExpectedHit = RaycastTriangles(mesh, ray, maxDistance, expected);
+
+			ili::MeshRayHit hit{};
+			const bool isHit = bvh.Raycast(ray, maxDistance, hit);
+			ASSERT_EQ(isHit, isExpectedHit) << "ray " << i;
+			if (!isHit) continue;
+
+			++hitCount;
+			EXPECT_NEAR(hit.distance, expected.distance, MAX_DISTANCE_ERROR) << "ray " << i;
+
+			// Two triangles can share the hit point on a common edge, then either one is the closest.
+			// The barycentrics below confirm that the point lies on the triangle that was reported
+			if (hit.triangleIndex != expected.triangleIndex) ++edgeHitCount;
+			EXPECT_GE(hit.barycentrics.x, -1e-4f) << "ray " << i;
+			EXPECT_GE(hit.barycentrics.y, -1e-4f) << "ray " << i;
+			EXPECT_LE(hit.barycentrics.x + hit.barycentrics.y, 1.f + 1e-4f) << "ray " << i;
+
+			const size_t firstVertex = static_cast<size_t>(hit.triangleIndex) * 3;
+			const auto getPosition = [&mesh](size_t vertex) { return mesh.positions[mesh.indices.empty() ? vertex : mesh.indices[vertex]]; };
+			const glm::vec3 vertex0 = getPosition(firstVertex);
+			const glm::vec3 point = vertex0 + (getPosition(firstVertex + 1) - vertex0) * hit.barycentrics.x + (getPosition(firstVertex + 2) - vertex0) * hit.barycentrics.y;
+			EXPECT_NEAR(glm::distance(point, ray.GetPoint(hit.distance)), 0.f, 1e-3f) << "ray " << i;
+		}
+
+		// Both hits and misses were compared, and nearly every hit is on the same triangle
+		EXPECT_GT(hitCount, 0u);
+		EXPECT_LT(hitCount, static_cast<uint32_t>(rays.size()));
+		EXPECT_LE(edgeHitCount, hitCount / 100);
+	}
+}
+
+TEST(MeshBvh, SphereRaycastMatchesBruteForce)
+{
+	std::mt19937 random{ 1234 };
+	const Mesh mesh = CreateSphereMesh(24);
+	const ili::MeshBvh bvh{ mesh.positions, mesh.indices };
+	ASSERT_EQ(bvh.GetTriangleCount(), mesh.indices.size() / 3);
+
+	const std::vector<ili::Ray> rays = CreateRays(bvh.GetBounds(), 2000, random);
+	ExpectSameHitsAsBruteForce(mesh, bvh, rays, std::numeric_limits<float>::max());
+}
+
+TEST(MeshBvh, TriangleSoupRaycastMatchesBruteForce)
+{
+	std::mt19937 random{ 5678 };
+	const Mesh mesh = CreateTriangleSoup(500, random);
+	const ili::MeshBvh bvh{ mesh.positions, mesh.indices };
+	ASSERT_EQ(bvh.GetTriangleCount(), 500u);
+
+	const std::vector<ili::Ray> rays = CreateRays(bvh.GetBounds(), 2000, random);
+	ExpectSameHitsAsBruteForce(mesh, bvh, rays, std::numeric_limits<float>::max());
+}
+
+// Hits beyond the maximum distance are misses, including those of rays starting inside the bounds
+TEST(MeshBvh, RaycastRespectsMaxDistance)
+{
+	std::mt19937 random{ 91011 };
+	const Mesh mesh = CreateTriangleSoup(300, random);
+	const ili::MeshBvh bvh{ mesh.positions, mesh.indices };
+
+	const std::vector<ili::Ray> rays = CreateRays(bvh.GetBounds(), 2000, random);
+	ExpectSameHitsAsBruteForce(mesh, bvh, rays, 1.5f);
+}
+
+TEST(MeshBvh, EmptyMeshIsNeverHit)
+{
+	const ili::MeshBvh bvh{ {}, {} };
+	EXPECT_EQ(bvh.GetTriangleCount(), 0u);
+
+	ili::MeshRayHit hit{};
+	EXPECT_FALSE(bvh.Raycast({ { 0.f, 0.f, -5.f }, { 0.f, 0.f, 1.f } }, std::numeric_limits<float>::max(), hit));
+}
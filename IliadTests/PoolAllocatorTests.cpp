@@ -0,0 +1,204 @@
+﻿#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "Core/PoolAllocator.h"
+#include "SceneGraph/SceneAllocator.h"
+
+namespace
+{
+	// Counts its destructor calls, so a test can tell the object was destroyed through the right type
+	struct Counted
+	{
+		explicit Counted(int* pDestroyedCount) : pDestroyedCount(pDestroyedCount) {}
+		virtual ~Counted() { ++*pDestroyedCount; }
+
+		int* pDestroyedCount;
+	};
+
+	struct OtherBase
+	{
+		virtual ~OtherBase() = default;
+
+		double value{ 1.0 };
+	};
+
+	// The Counted base is not at the start of the object
+	struct MultipleBases final : OtherBase, Counted
+	{
+		explicit MultipleBases(int* pDestroyedCount) : Counted(pDestroyedCount) {}
+	};
+
+	struct VirtualBase
+	{
+		virtual ~VirtualBase() = default;
+
+		int value{};
+	};
+
+	struct VirtualLeft : virtual VirtualBase {};
+	struct VirtualRight : virtual VirtualBase {};
+
+	// The shared VirtualBase sits at the end of the object
+	struct Diamond final : VirtualLeft, VirtualRight
+	{
+		explicit Diamond(int* pDestroyedCount) : pDestroyedCount(pDestroyedCount) {}
+		~Diamond() override { ++*pDestroyedCount; }
+
+		int* pDestroyedCount;
+	};
+
+	struct Throwing
+	{
+		Throwing() { throw std::runtime_error("Construction failed"); }
+	};
+}
+
+TEST(PoolAllocator, ChunksGrowUntilTheMaximum)
+{
+	ili::PoolAllocator pool{ 24, 8 };
+	std::vector<void*> pBlocks{};
+
+	// 16 blocks, then as many again as the pool has, which doubles the capacity
+	const uint32_t expectedCapacities[]{ 16, 32, 64, 128, 256, 512, 1'024, 2'048, 3'072, 4'096 };
+	for (uint32_t chunk{}; chunk < std::size(expectedCapacities); ++chunk)
+	{
+		while (pBlocks.size() < expectedCapacities[chunk]) pBlocks.push_back(pool.Allocate());
+
+		EXPECT_EQ(pool.GetStats().chunkCount, chunk + 1);
+		EXPECT_EQ(pool.GetStats().capacityBlockCount, expectedCapacities[chunk]);
+	}
+
+	for (void* pBlock : pBlocks)
+	{
+		EXPECT_EQ(reinterpret_cast<uintptr_t>(pBlock) % 8, 0u);
+		pool.Deallocate(pBlock);
+	}
+}
+
+TEST(PoolAllocator, FreedBlocksAreReusedFirst)
+{
+	ili::PoolAllocator pool{ 32, 16 };
+	std::vector<void*> pBlocks{};
+	for (int i{}; i < 10; ++i) pBlocks.push_back(pool.Allocate());
+
+	// Last freed, first reused
+	pool.Deallocate(pBlocks[3]);
+	pool.Deallocate(pBlocks[7]);
+	EXPECT_EQ(pool.Allocate(), pBlocks[7]);
+	EXPECT_EQ(pool.Allocate(), pBlocks[3]);
+
+	// The holes were filled, nothing new was reserved
+	EXPECT_EQ(pool.GetStats().chunkCount, 1u);
+	EXPECT_EQ(pool.GetStats().allocationCount, 12u);
+	EXPECT_EQ(pool.GetStats().liveBlockCount, 10u);
+
+	for (void* pBlock : pBlocks) pool.Deallocate(pBlock);
+}
+
+TEST(PoolAllocator, StatsReportUsageAndFragmentation)
+{
+	// Rounded up to the alignment
+	ili::PoolAllocator pool{ 20, 16 };
+	EXPECT_EQ(pool.GetStats().blockSize, 32u);
+	EXPECT_EQ(pool.GetStats().GetFragmentation(), 0.f);
+
+	std::vector<void*> pBlocks{};
+	for (int i{}; i < 12; ++i) pBlocks.push_back(pool.Allocate());
+	for (int i{}; i < 4; ++i) pool.Deallocate(pBlocks[i]);
+
+	const ili::PoolStats& stats = pool.GetStats();
+	EXPECT_EQ(stats.liveBlockCount, 8u);
+	EXPECT_EQ(stats.capacityBlockCount, 16u);
+	EXPECT_EQ(stats.GetUsedBytes(), 8u * 32u);
+	EXPECT_EQ(stats.GetReservedBytes(), 16u * 32u);
+	EXPECT_FLOAT_EQ(stats.GetFragmentation(), .5f);
+
+	for (int i = 4; i < 12; ++i) pool.Deallocate(pBlocks[i]);
+	EXPECT_FLOAT_EQ(pool.GetStats().GetFragmentation(), 1.f);
+}
+
+// The deleter gets a pointer to a base that does not start the block, it has to free the block of the whole object
+TEST(PoolDeleter, FreesTheBlockOfAMultipleInheritanceObject)
+{
+	ili::PoolAllocator pool{ sizeof(MultipleBases), alignof(MultipleBases) };
+	int destroyedCount{};
+
+	void* pBlock = pool.Allocate();
+	MultipleBases* pObject = new (pBlock) MultipleBases(&destroyedCount);
+	Counted* pBase = pObject;
+	ASSERT_NE(static_cast<void*>(pBase), pBlock);
+
+	ili::PoolPtr<Counted>{ pBase, ili::PoolDeleter{ &pool } }.reset();
+	EXPECT_EQ(destroyedCount, 1);
+	EXPECT_EQ(pool.GetStats().liveBlockCount, 0u);
+	EXPECT_EQ(pool.Allocate(), pBlock);
+	pool.Deallocate(pBlock);
+}
+
+TEST(PoolDeleter, FreesTheBlockOfAVirtualInheritanceObject)
+{
+	ili::PoolAllocator pool{ sizeof(Diamond), alignof(Diamond) };
+	int destroyedCount{};
+
+	void* pBlock = pool.Allocate();
+	VirtualBase* pBase = new (pBlock) Diamond(&destroyedCount);
+	ASSERT_NE(static_cast<void*>(pBase), pBlock);
+
+	ili::PoolPtr<VirtualBase>{ pBase, ili::PoolDeleter{ &pool } }.reset();
+	EXPECT_EQ(destroyedCount, 1);
+	EXPECT_EQ(pool.GetStats().liveBlockCount, 0u);
+	EXPECT_EQ(pool.Allocate(), pBlock);
+	pool.Deallocate(pBlock);
+}
+
+TEST(PoolDeleter, DeletesObjectsWithoutAPool)
+{
+	int destroyedCount{};
+	ili::PoolPtr<Counted>{ new MultipleBases(&destroyedCount) }.reset();
+	EXPECT_EQ(destroyedCount, 1);
+}
+
+TEST(SceneAllocator, StatsAddUpOverEveryPool)
+{
+	ili::SceneAllocator allocator{};
+	EXPECT_EQ(allocator.GetStats().poolCount, 0u);
+
+	int destroyedCount{};
+	std::vector<ili::PoolPtr<Counted>> pObjects{};
+	for (int i{}; i < 3; ++i) pObjects.push_back(allocator.New<MultipleBases>(&destroyedCount));
+	ili::PoolPtr<Diamond> pDiamond = allocator.New<Diamond>(&destroyedCount);
+
+	ili::SceneAllocatorStats stats = allocator.GetStats();
+	EXPECT_EQ(stats.poolCount, 2u);
+	EXPECT_EQ(stats.chunkCount, 2u);
+	EXPECT_EQ(stats.allocationCount, 4u);
+	EXPECT_EQ(stats.liveObjectCount, 4u);
+
+	ili::PoolAllocator multipleBasesPool{ sizeof(MultipleBases), alignof(MultipleBases) };
+	ili::PoolAllocator diamondPool{ sizeof(Diamond), alignof(Diamond) };
+	const size_t multipleBasesBlock = multipleBasesPool.GetStats().blockSize;
+	const size_t diamondBlock = diamondPool.GetStats().blockSize;
+	EXPECT_EQ(stats.usedBytes, 3 * multipleBasesBlock + diamondBlock);
+	EXPECT_EQ(stats.reservedBytes, 16 * multipleBasesBlock + 16 * diamondBlock);
+
+	pObjects.clear();
+	pDiamond.reset();
+	EXPECT_EQ(destroyedCount, 4);
+	stats = allocator.GetStats();
+	EXPECT_EQ(stats.liveObjectCount, 0u);
+	EXPECT_EQ(stats.usedBytes, 0u);
+	EXPECT_FLOAT_EQ(stats.GetFragmentation(), 1.f);
+}
+
+TEST(SceneAllocator, FailedConstructionReturnsTheBlock)
+{
+	ili::SceneAllocator allocator{};
+	EXPECT_THROW(allocator.New<Throwing>(), std::runtime_error);
+
+	const ili::SceneAllocatorStats stats = allocator.GetStats();
+	EXPECT_EQ(stats.allocationCount, 1u);
+	EXPECT_EQ(stats.liveObjectCount, 0u);
+}
@@ -0,0 +1,140 @@
+﻿#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Core/PointLight.h"
+#include "SceneGraph/Scene.h"
+
+namespace
+{
+	// Scene that can be created without a SceneManager, filled by the tests themselves
+	class TestScene final : public ili::Scene
+	{
+	public:
+		TestScene() = default;
+		virtual ~TestScene() override = default;
+
+		TestScene(const TestScene& other) = delete;
+		TestScene(TestScene&& other) noexcept = delete;
+		TestScene& operator=(const TestScene& other) = delete;
+		TestScene& operator=(TestScene&& other) noexcept = delete;
+
+		virtual void Initialize() override {}
+
+	protected:
+		virtual void Update(float /*deltaTime*/) override {}
+	};
+}
+
+TEST(Scene, RemovedObjectStaysUntilDestroyed)
+{
+	TestScene scene{};
+	ili::GameObject* pGameObject = scene.CreateGameObject<ili::GameObject>();
+	const ili::GameObjectHandle handle = pGameObject->GetHandle();
+
+	scene.RemoveGameObject(handle);
+	EXPECT_TRUE(scene.IsValid(handle));
+	EXPECT_EQ(scene.GetGameObject(handle), pGameObject);
+	EXPECT_TRUE(pGameObject->IsPendingRemoval());
+	EXPECT_EQ(scene.GetGameObjects().size(), 1u);
+
+	scene.DestroyRemovedGameObjects();
+	EXPECT_FALSE(scene.IsValid(handle));
+	EXPECT_EQ(scene.GetGameObject(handle), nullptr);
+	EXPECT_TRUE(scene.GetGameObjects().empty());
+	EXPECT_EQ(scene.GetTransformHierarchy().GetNodeCount(), 0u);
+}
+
+TEST(Scene, RepeatedAndStaleRemovalsAreIgnored)
+{
+	TestScene scene{};
+	const ili::GameObjectHandle handle = scene.CreateGameObject<ili::GameObject>()->GetHandle();
+	const ili::GameObjectHandle otherHandle = scene.CreateGameObject<ili::GameObject>()->GetHandle();
+
+	scene.RemoveGameObject(handle);
+	scene.RemoveGameObject(handle);
+	scene.DestroyRemovedGameObjects();
+
+	// The slot of the destroyed object is reused, its handle must not remove the new object
+	ili::GameObject* pNewGameObject = scene.CreateGameObject<ili::GameObject>();
+	EXPECT_EQ(pNewGameObject->GetHandle().index, handle.index);
+	scene.RemoveGameObject(handle);
+	scene.RemoveGameObject(ili::GameObjectHandle{});
+	scene.DestroyRemovedGameObjects();
+
+	EXPECT_EQ(scene.GetGameObject(pNewGameObject->GetHandle()), pNewGameObject);
+	EXPECT_FALSE(pNewGameObject->IsPendingRemoval());
+	EXPECT_TRUE(scene.IsValid(otherHandle));
+	EXPECT_EQ(scene.GetGameObjects().size(), 2u);
+}
+
+// Removing while iterating over the scene's objects is safe, nothing is destroyed before DestroyRemovedGameObjects
+TEST(Scene, RemovingWhileIteratingDestroysAfterwards)
+{
+	TestScene scene{};
+	for (int i{}; i < 10; ++i) scene.CreateGameObject<ili::GameObject>();
+
+	for (const ili::PoolPtr<ili::GameObject>& pGameObject : scene.GetGameObjects())
+	{
+		if (pGameObject->GetId() % 2 == 0) scene.RemoveGameObject(pGameObject->GetHandle());
+	}
+	EXPECT_EQ(scene.GetGameObjects().size(), 10u);
+
+	scene.DestroyRemovedGameObjects();
+	EXPECT_EQ(scene.GetGameObjects().size(), 5u);
+	for (const ili::PoolPtr<ili::GameObject>& pGameObject : scene.GetGameObjects()) EXPECT_EQ(pGameObject->GetId() % 2, 1u);
+}
+
+TEST(Scene, ChildrenOfDestroyedObjectBecomeRoots)
+{
+	TestScene scene{};
+	ili::GameObject* pParent = scene.CreateGameObject<ili::GameObject>();
+	ili::GameObject* pChild = scene.CreateGameObject<ili::GameObject>();
+	pParent->GetTransform()->SetPosition({ 5.f, 0.f, 0.f });
+	pChild->GetTransform()->SetPosition({ 0.f, 1.f, 0.f });
+	pChild->GetTransform()->SetParent(pParent->GetTransform());
+	scene.UpdateTransforms();
+	EXPECT_EQ(pChild->GetTransform()->GetWorldPosition(), glm::vec3(5.f, 1.f, 0.f));
+
+	scene.RemoveGameObject(pParent->GetHandle());
+	// Still attached until the parent is destroyed
+	EXPECT_EQ(pChild->GetTransform()->GetParent(), pParent->GetTransform());
+
+	scene.DestroyRemovedGameObjects();
+	scene.UpdateTransforms();
+	EXPECT_EQ(pChild->GetTransform()->GetParent(), nullptr);
+	EXPECT_EQ(pChild->GetTransform()->GetWorldPosition(), glm::vec3(0.f, 1.f, 0.f));
+}
+
+TEST(Scene, DestroyedPointLightLeavesTheLightList)
+{
+	TestScene scene{};
+	std::vector<ili::PointLightGameObject*> pLights{};
+	for (int i{}; i < 4; ++i)
+	{
+		pLights.push_back(scene.CreatePointLight());
+		scene.CreateGameObject<ili::GameObject>();
+	}
+
+	// Objects that are not lights leave the list alone
+	scene.RemoveGameObject(scene.GetGameObjects().back()->GetHandle());
+	scene.DestroyRemovedGameObjects();
+	EXPECT_EQ(scene.GetPointLights().size(), 4u);
+
+	scene.RemoveGameObject(pLights[1]->GetHandle());
+	scene.RemoveGameObject(pLights[3]->GetHandle());
+	scene.DestroyRemovedGameObjects();
+
+	std::vector<ili::PointLightGameObject*> remainingLights = scene.GetPointLights();
+	std::ranges::sort(remainingLights);
+	std::vector<ili::PointLightGameObject*> expectedLights{ pLights[0], pLights[2] };
+	std::ranges::sort(expectedLights);
+	EXPECT_EQ(remainingLights, expectedLights);
+
+	// The lights that were moved in the list can still be destroyed
+	scene.RemoveGameObject(pLights[2]->GetHandle());
+	scene.RemoveGameObject(pLights[0]->GetHandle());
+	scene.DestroyRemovedGameObjects();
+	EXPECT_TRUE(scene.GetPointLights().empty());
+}
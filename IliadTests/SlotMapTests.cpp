@@ -0,0 +1,107 @@
+﻿#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Core/SlotMap.h"
+
+TEST(SlotMap, InsertedValuesAreFoundByHandle)
+{
+	ili::SlotMap<int> slotMap{};
+	const ili::SlotHandle first = slotMap.Insert(10);
+	const ili::SlotHandle second = slotMap.Insert(20);
+
+	EXPECT_NE(first, second);
+	ASSERT_NE(slotMap.Get(first), nullptr);
+	ASSERT_NE(slotMap.Get(second), nullptr);
+	EXPECT_EQ(*slotMap.Get(first), 10);
+	EXPECT_EQ(*slotMap.Get(second), 20);
+	EXPECT_EQ(slotMap.GetSize(), 2u);
+	EXPECT_FALSE(slotMap.Contains(ili::SlotHandle{}));
+}
+
+TEST(SlotMap, RemovedHandleIsStale)
+{
+	ili::SlotMap<int> slotMap{};
+	const ili::SlotHandle handle = slotMap.Insert(10);
+
+	EXPECT_TRUE(slotMap.Remove(handle));
+	EXPECT_FALSE(slotMap.Contains(handle));
+	EXPECT_EQ(slotMap.Get(handle), nullptr);
+	EXPECT_EQ(slotMap.GetSize(), 0u);
+	// Removing twice is ignored
+	EXPECT_FALSE(slotMap.Remove(handle));
+}
+
+// The freed slot is reused with a new generation, the old handle must not reach the new value
+TEST(SlotMap, ReusedSlotRejectsOldHandle)
+{
+	ili::SlotMap<int> slotMap{};
+	const ili::SlotHandle oldHandle = slotMap.Insert(10);
+	slotMap.Insert(20);
+	slotMap.Remove(oldHandle);
+
+	EXPECT_EQ(slotMap.GetNextIndex(), oldHandle.index);
+	const ili::SlotHandle newHandle = slotMap.Insert(30);
+	EXPECT_EQ(newHandle.index, oldHandle.index);
+	EXPECT_NE(newHandle.generation, oldHandle.generation);
+
+	EXPECT_FALSE(slotMap.Contains(oldHandle));
+	EXPECT_EQ(slotMap.Get(oldHandle), nullptr);
+	EXPECT_FALSE(slotMap.Remove(oldHandle));
+	ASSERT_NE(slotMap.Get(newHandle), nullptr);
+	EXPECT_EQ(*slotMap.Get(newHandle), 30);
+}
+
+// Removals fill the gap with the last value, the handles of the values that moved stay valid
+TEST(SlotMap, RemovalKeepsOtherHandlesAndPacksValues)
+{
+	ili::SlotMap<int> slotMap{};
+	std::vector<ili::SlotHandle> handles{};
+	for (int value{}; value < 100; ++value) handles.push_back(slotMap.Insert(value));
+
+	for (int value{}; value < 100; value += 3) EXPECT_TRUE(slotMap.Remove(handles[value]));
+	for (int value{}; value < 100; ++value)
+	{
+		const int* pValue = slotMap.Get(handles[value]);
+		if (value % 3 == 0)
+		{
+			EXPECT_EQ(pValue, nullptr) << "value " << value;
+		}
+		else
+		{
+			ASSERT_NE(pValue, nullptr) << "value " << value;
+			EXPECT_EQ(*pValue, value);
+		}
+	}
+
+	std::vector<int> values = slotMap.GetValues();
+	std::ranges::sort(values);
+	EXPECT_EQ(values.size(), 66u);
+	EXPECT_EQ(slotMap.GetSize(), 66u);
+	EXPECT_TRUE(std::ranges::none_of(values, [](int value) { return value % 3 == 0; }));
+	EXPECT_EQ(std::ranges::adjacent_find(values), values.end());
+}
+
+// Every slot is reused many times, no old handle of any generation is accepted
+TEST(SlotMap, GenerationsOfReusedSlotsStayStale)
+{
+	ili::SlotMap<int> slotMap{};
+	std::vector<ili::SlotHandle> staleHandles{};
+	for (int round{}; round < 10; ++round)
+	{
+		std::vector<ili::SlotHandle> handles{};
+		for (int value{}; value < 8; ++value) handles.push_back(slotMap.Insert(round * 8 + value));
+		for (const ili::SlotHandle handle : handles)
+		{
+			EXPECT_LT(handle.index, 8u);
+			slotMap.Remove(handle);
+			staleHandles.push_back(handle);
+		}
+	}
+
+	const ili::SlotHandle handle = slotMap.Insert(-1);
+	for (const ili::SlotHandle staleHandle : staleHandles) EXPECT_EQ(slotMap.Get(staleHandle), nullptr);
+	ASSERT_NE(slotMap.Get(handle), nullptr);
+	EXPECT_EQ(*slotMap.Get(handle), -1);
+}
@@ -0,0 +1,102 @@
+﻿#include <gtest/gtest.h>
+
+#include "Core/SoftwareOcclusionCuller.h"
+#include "SceneGraph/Camera.h"
+
+namespace
+{
+	// Camera at the origin looking down +z, the wall of the occluder tests faces it at z = 4.5
+	glm::mat4 GetViewProjection()
+	{
+		ili::Camera camera{};
+		camera.SetPerspectiveProjection(glm::radians(60.f), 16.f / 9.f, 0.1f, 100.f);
+		camera.SetViewDirection({ 0.f, 0.f, 0.f }, { 0.f, 0.f, 1.f });
+		return camera.GetProjection() * camera.GetView();
+	}
+
+	// 6 x 6 box, 1 deep, centered 5 in front of the camera. It covers the middle of the screen but not its edges
+	void RasterizeWall(ili::SoftwareOcclusionCuller& culler)
+	{
+		glm::mat4 modelMatrix{ 1.f };
+		modelMatrix[3] = glm::vec4{ 0.f, 0.f, 5.f, 1.f };
+		culler.RasterizeOccluder(ili::OccluderMesh::CreateBox({ 3.f, 3.f, .5f }), modelMatrix);
+	}
+}
+
+TEST(SoftwareOcclusionCuller, EmptyDepthBufferHidesNothingOnScreen)
+{
+	ili::SoftwareOcclusionCuller culler{};
+	culler.BeginFrame(GetViewProjection());
+
+	for (uint32_t y{}; y < culler.GetHeight(); ++y)
+	{
+		for (uint32_t x{}; x < culler.GetWidth(); ++x) ASSERT_EQ(culler.GetDepth(x, y), 1.f);
+	}
+
+	EXPECT_TRUE(culler.IsVisible({ { 0.f, 0.f, 10.f }, .5f }));
+	EXPECT_TRUE(culler.IsVisible({ { 0.f, 0.f, 90.f }, .1f }));
+	// Off screen objects are culled without any occluder
+	EXPECT_FALSE(culler.IsVisible({ { 100.f, 0.f, 10.f }, 1.f }));
+	EXPECT_EQ(culler.GetStats().occluderTriangleCount, 0u);
+}
+
+TEST(SoftwareOcclusionCuller, OccluderHidesSphereBehindIt)
+{
+	ili::SoftwareOcclusionCuller culler{};
+	culler.BeginFrame(GetViewProjection());
+	RasterizeWall(culler);
+
+	EXPECT_EQ(culler.GetStats().occluderTriangleCount, 12u);
+	EXPECT_LT(culler.GetDepth(culler.GetWidth() / 2, culler.GetHeight() / 2), 1.f);
+
+	EXPECT_FALSE(culler.IsVisible({ { 0.f, 0.f, 10.f }, .5f }));
+	EXPECT_FALSE(culler.IsVisible({ { 1.f, -1.f, 20.f }, 2.f }));
+	// The same sphere in front of the wall
+	EXPECT_TRUE(culler.IsVisible({ { 0.f, 0.f, 2.f }, .5f }));
+}
+
+TEST(SoftwareOcclusionCuller, PartiallyVisibleSphereIsVisible)
+{
+	ili::SoftwareOcclusionCuller culler{};
+	culler.BeginFrame(GetViewProjection());
+	RasterizeWall(culler);
+
+	// The wall's silhouette ends at x = 6.67 at this distance, the sphere reaches past it
+	EXPECT_TRUE(culler.IsVisible({ { 6.5f, 0.f, 10.f }, 1.f }));
+	// Intersects the wall, its front half is nearer than the wall
+	EXPECT_TRUE(culler.IsVisible({ { 0.f, 0.f, 5.f }, 1.f }));
+}
+
+TEST(SoftwareOcclusionCuller, SphereCrossingNearPlaneIsVisible)
+{
+	ili::SoftwareOcclusionCuller culler{};
+	culler.BeginFrame(GetViewProjection());
+	RasterizeWall(culler);
+
+	EXPECT_TRUE(culler.IsVisible({ { 0.f, 0.f, .1f }, .5f }));
+	// Mostly behind the camera
+	EXPECT_TRUE(culler.IsVisible({ { 0.f, 0.f, -1.f }, 1.5f }));
+}
+
+TEST(SoftwareOcclusionCuller, TestsAreCountedIntoCallerStats)
+{
+	ili::SoftwareOcclusionCuller culler{};
+	culler.BeginFrame(GetViewProjection());
+	RasterizeWall(culler);
+
+	ili::RenderStats stats{};
+	EXPECT_FALSE(culler.IsVisible({ { 0.f, 0.f, 10.f }, .5f }, stats));
+	EXPECT_TRUE(culler.IsVisible({ { 0.f, 0.f, 2.f }, .5f }, stats));
+	EXPECT_TRUE(culler.IsVisible({ { 6.5f, 0.f, 10.f }, 1.f }, stats));
+
+	EXPECT_EQ(stats.occlusionTestCount, 3u);
+	EXPECT_EQ(stats.occlusionCullCount, 1u);
+	// The culler counts the same tests
+	EXPECT_EQ(culler.GetStats().testedCount, 3u);
+	EXPECT_EQ(culler.GetStats().culledCount, 1u);
+
+	// And starts over with the next frame
+	culler.BeginFrame(GetViewProjection());
+	EXPECT_EQ(culler.GetStats().testedCount, 0u);
+	EXPECT_EQ(culler.GetStats().culledCount, 0u);
+}
@@ -0,0 +1,260 @@
+﻿#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "SceneGraph/Bounds.h"
+#include "SceneGraph/SpatialIndex.h"
+
+namespace
+{
+	// The index never dereferences its objects, ids stand in for them
+	ili::GameObject* ToGameObject(uint32_t id)
+	{
+		return reinterpret_cast<ili::GameObject*>(static_cast<uintptr_t>(id + 1) * alignof(std::max_align_t));
+	}
+
+	uint32_t ToId(ili::GameObject* pGameObject)
+	{
+		return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(pGameObject) / alignof(std::max_align_t) - 1);
+	}
+
+	// Boxes of every size scattered through a large cube
+	std::vector<ili::AABB> CreateBoxes(uint32_t boxCount, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> position{ -50.f, 50.f };
+		std::uniform_real_distribution<float> size{ .1f, 3.f };
+
+		std::vector<ili::AABB> boxes{};
+		for (uint32_t i{}; i < boxCount; ++i)
+		{
+			const glm::vec3 min{ position(random), position(random), position(random) };
+			boxes.push_back({ min, min + glm::vec3{ size(random), size(random), size(random) } });
+		}
+		return boxes;
+	}
+
+	// Indexed by id, a removed object has no proxy
+	struct Objects
+	{
+		std::vector<ili::AABB> boxes{};
+		std::vector<uint32_t> proxies{};
+
+		template <typename Test>
+		std::vector<uint32_t> GetExpectedIds(const Test& test) const
+		{
+			std::vector<uint32_t> ids{};
+			for (uint32_t id{}; id < boxes.size(); ++id)
+			{
+				if (proxies[id] != ili::SpatialIndex::NULL_PROXY && test(boxes[id])) ids.push_back(id);
+			}
+			return ids;
+		}
+	};
+
+	Objects InsertBoxes(ili::SpatialIndex& index, std::vector<ili::AABB> boxes)
+	{
+		Objects objects{ std::move(boxes) };
+		for (uint32_t id{}; id < objects.boxes.size(); ++id) objects.proxies.push_back(index.Insert(objects.boxes[id], ToGameObject(id)));
+		return objects;
+	}
+
+	std::vector<uint32_t> QueryAABB(const ili::SpatialIndex& index, const ili::AABB& box)
+	{
+		std::vector<uint32_t> ids{};
+		index.QueryAABB(box, [&ids](ili::GameObject* pGameObject) { ids.push_back(ToId(pGameObject)); });
+		std::ranges::sort(ids);
+		return ids;
+	}
+
+	std::vector<uint32_t> QueryFrustum(const ili::SpatialIndex& index, const ili::Frustum& frustum)
+	{
+		std::vector<uint32_t> ids{};
+		index.QueryFrustum(frustum, [&ids](ili::GameObject* pGameObject) { ids.push_back(ToId(pGameObject)); });
+		std::ranges::sort(ids);
+		return ids;
+	}
+
+	// Every query box and the frustum agree with testing each object on its own
+	void ExpectQueriesMatchBruteForce(const ili::SpatialIndex& index, const Objects& objects, std::mt19937& random)
+	{
+		for (const ili::AABB& box : CreateBoxes(20, random))
+		{
+			const ili::AABB queryBox{ box.min, box.max + 10.f };
+			EXPECT_EQ(QueryAABB(index, queryBox), objects.GetExpectedIds([&queryBox](const ili::AABB& bounds) { return bounds.Intersects(queryBox); }));
+		}
+
+		const glm::mat4 view = glm::lookAt(glm::vec3{ 0.f, 0.f, 80.f }, glm::vec3{ 10.f, 5.f, 0.f }, glm::vec3{ 0.f, 1.f, 0.f });
+		const ili::Frustum frustum{ glm::perspective(glm::radians(40.f), 1.5f, .1f, 120.f) * view };
+		EXPECT_EQ(QueryFrustum(index, frustum), objects.GetExpectedIds([&frustum](const ili::AABB& bounds) { return frustum.Intersects(bounds); }));
+	}
+}
+
+TEST(SpatialIndex, InsertedObjectsAreFound)
+{
+	std::mt19937 random{ 3 };
+	ili::SpatialIndex index{};
+	const Objects objects = InsertBoxes(index, CreateBoxes(500, random));
+
+	EXPECT_EQ(index.GetProxyCount(), 500u);
+	for (uint32_t id{}; id < objects.boxes.size(); ++id)
+	{
+		EXPECT_EQ(index.GetGameObject(objects.proxies[id]), ToGameObject(id));
+		EXPECT_EQ(index.GetBounds(objects.proxies[id]).min, objects.boxes[id].min);
+	}
+	// The inserts keep the tree balanced, far from one level per object
+	EXPECT_LE(index.GetHeight(), 20u);
+	ExpectQueriesMatchBruteForce(index, objects, random);
+}
+
+TEST(SpatialIndex, RemovedObjectsAreNotFound)
+{
+	std::mt19937 random{ 5 };
+	ili::SpatialIndex index{};
+	Objects objects = InsertBoxes(index, CreateBoxes(300, random));
+
+	for (uint32_t id{}; id < objects.boxes.size(); id += 3)
+	{
+		index.Remove(objects.proxies[id]);
+		objects.proxies[id] = ili::SpatialIndex::NULL_PROXY;
+	}
+	EXPECT_EQ(index.GetProxyCount(), 200u);
+	ExpectQueriesMatchBruteForce(index, objects, random);
+
+	// The freed nodes are reused and the proxies that stayed are still valid
+	const uint32_t newProxy = index.Insert(objects.boxes[0], ToGameObject(0));
+	objects.proxies[0] = newProxy;
+	EXPECT_EQ(index.GetGameObject(objects.proxies[1]), ToGameObject(1));
+	ExpectQueriesMatchBruteForce(index, objects, random);
+
+	for (uint32_t& proxy : objects.proxies)
+	{
+		if (proxy != ili::SpatialIndex::NULL_PROXY) index.Remove(proxy);
+		proxy = ili::SpatialIndex::NULL_PROXY;
+	}
+	EXPECT_EQ(index.GetProxyCount(), 0u);
+	EXPECT_TRUE(QueryAABB(index, { glm::vec3{ -100.f }, glm::vec3{ 100.f } }).empty());
+}
+
+// Small moves stay in the leaf box and large ones reinsert, either way the queries see the new bounds
+TEST(SpatialIndex, MovedObjectsAreFoundAtTheirNewBounds)
+{
+	std::mt19937 random{ 7 };
+	ili::SpatialIndex index{};
+	Objects objects = InsertBoxes(index, CreateBoxes(300, random));
+	std::uniform_real_distribution<float> offset{ -.1f, .1f };
+
+	for (uint32_t id{}; id < objects.boxes.size(); ++id)
+	{
+		const glm::vec3 move = id % 2 == 0 ? glm::vec3{ offset(random), offset(random), offset(random) } : glm::vec3{ 30.f * offset(random), 0.f, 20.f };
+		objects.boxes[id].min += move;
+		objects.boxes[id].max += move;
+		index.Move(objects.proxies[id], objects.boxes[id]);
+	}
+	ExpectQueriesMatchBruteForce(index, objects, random);
+
+	index.RebuildIfDegraded();
+	ExpectQueriesMatchBruteForce(index, objects, random);
+}
+
+TEST(SpatialIndex, RayVisitsTheHitObjects)
+{
+	std::mt19937 random{ 11 };
+	ili::SpatialIndex index{};
+	const Objects objects = InsertBoxes(index, CreateBoxes(500, random));
+	index.Rebuild();
+
+	std::uniform_real_distribution<float> direction{ -1.f, 1.f };
+	for (int rayIndex{}; rayIndex < 50; ++rayIndex)
+	{
+		const ili::Ray ray{ glm::vec3{ 0.f }, glm::vec3{ direction(random), direction(random), direction(random) } };
+		const glm::vec3 inverseDirection = ray.GetInverseDirection();
+
+		// Returning the max distance again visits every object the ray hits
+		std::vector<uint32_t> ids{};
+		index.QueryRay(ray, 100.f, [&ids](ili::GameObject* pGameObject, float /*distance*/)
+		{
+			ids.push_back(ToId(pGameObject));
+			return 100.f;
+		});
+		std::ranges::sort(ids);
+
+		float closestDistance = std::numeric_limits<float>::max();
+		const std::vector<uint32_t> expectedIds = objects.GetExpectedIds([&](const ili::AABB& bounds)
+		{
+			float distance{};
+			if (!ili::Ray::IntersectsBox(ray.origin, inverseDirection, bounds, 100.f, distance)) return false;
+			closestDistance = std::min(closestDistance, distance);
+			return true;
+		});
+		EXPECT_EQ(ids, expectedIds) << "ray " << rayIndex;
+
+		// Returning the hit distance narrows the search down to the closest hit
+		float nearestDistance = std::numeric_limits<float>::max();
+		index.QueryRay(ray, 100.f, [&nearestDistance](ili::GameObject* /*pGameObject*/, float distance)
+		{
+			nearestDistance = std::min(nearestDistance, distance);
+			return distance;
+		});
+		if (!expectedIds.empty()) EXPECT_FLOAT_EQ(nearestDistance, closestDistance) << "ray " << rayIndex;
+	}
+}
+
+// A freshly filled tree is rebuilt on its first update, after that only a tree that got worse is
+TEST(SpatialIndex, RebuildsOnlyWhenTheTreeDegraded)
+{
+	std::mt19937 random{ 13 };
+	ili::SpatialIndex index{};
+	Objects objects = InsertBoxes(index, CreateBoxes(500, random));
+	const float insertedRatio = index.GetAreaRatio();
+
+	index.RebuildIfDegraded();
+	const float rebuiltRatio = index.GetAreaRatio();
+	EXPECT_LT(rebuiltRatio, insertedRatio);
+
+	// Every object moving together reinserts them all but keeps the tree about as good
+	int rebuildCount{};
+	for (int frame{}; frame < 10; ++frame)
+	{
+		for (uint32_t id{}; id < objects.boxes.size(); ++id)
+		{
+			objects.boxes[id].min.x += 1.f;
+			objects.boxes[id].max.x += 1.f;
+			index.Move(objects.proxies[id], objects.boxes[id]);
+		}
+
+		const float movedRatio = index.GetAreaRatio();
+		index.RebuildIfDegraded();
+		if (index.GetAreaRatio() != movedRatio) ++rebuildCount;
+	}
+	EXPECT_LT(rebuildCount, 10);
+	ExpectQueriesMatchBruteForce(index, objects, random);
+
+	// Objects that crowd together make the inner nodes overlap more and more until the tree is rebuilt
+	rebuildCount = 0;
+	for (int frame{}; frame < 10; ++frame)
+	{
+		for (uint32_t id{}; id < objects.boxes.size(); ++id)
+		{
+			const glm::vec3 center = objects.boxes[id].GetCenter() * .7f;
+			objects.boxes[id] = { center - .5f, center + .5f };
+			index.Move(objects.proxies[id], objects.boxes[id]);
+		}
+
+		const float movedRatio = index.GetAreaRatio();
+		index.RebuildIfDegraded();
+		if (index.GetAreaRatio() != movedRatio) ++rebuildCount;
+	}
+	EXPECT_GT(rebuildCount, 0);
+	ExpectQueriesMatchBruteForce(index, objects, random);
+
+	// Nothing changed, nothing to measure or rebuild
+	const float ratio = index.GetAreaRatio();
+	index.RebuildIfDegraded();
+	EXPECT_EQ(index.GetAreaRatio(), ratio);
+}
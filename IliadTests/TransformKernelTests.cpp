@@ -0,0 +1,146 @@
+﻿#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "SceneGraph/TransformKernels.h"
+
+namespace
+{
+	// Same tolerance as the kernel benchmarks, relative for elements above one
+	constexpr float MAX_ERROR = 1e-5f;
+
+	// Every third transform has a uniform scale, so both normal matrix paths are covered.
+	// Mirrored batches negate the uniform scales and one or all axes of the others
+	ili::TransformBatch CreateBatch(size_t count, bool isMirrored = false)
+	{
+		std::mt19937 random{ 1234 };
+		std::uniform_real_distribution<float> distribution{ -1.f, 1.f };
+
+		ili::TransformBatch batch{};
+		for (size_t i{}; i < count; ++i)
+		{
+			const glm::vec3 position{ distribution(random) * 100.f, distribution(random) * 100.f, distribution(random) * 100.f };
+			const glm::vec3 rotation{ distribution(random) * 10.f, distribution(random) * 10.f, distribution(random) * 10.f };
+			const float scale = 1.5f + distribution(random);
+			glm::vec3 scales = i % 3 == 0 ? glm::vec3{ scale } : glm::vec3{ scale, 1.5f + distribution(random), 1.5f + distribution(random) };
+			if (isMirrored)
+			{
+				if (i % 3 == 1) scales.y = -scales.y;
+				else scales = -scales;
+			}
+			batch.Add(position, rotation, scales);
+		}
+		return batch;
+	}
+
+	// The chain of glm calls TransformComponent used before the kernels existed
+	void ComputeGlmMatrices(const ili::TransformBatch& batch, size_t index, glm::mat4& matrix, glm::mat3& normalMatrix)
+	{
+		const glm::vec3 scale{ batch.scaleX[index], batch.scaleY[index], batch.scaleZ[index] };
+
+		matrix = glm::translate(glm::mat4{ 1.f }, { batch.positionX[index], batch.positionY[index], batch.positionZ[index] });
+		matrix = glm::rotate(matrix, batch.rotationY[index], { 0.f, 1.f, 0.f });
+		matrix = glm::rotate(matrix, batch.rotationX[index], { 1.f, 0.f, 0.f });
+		matrix = glm::rotate(matrix, batch.rotationZ[index], { 0.f, 0.f, 1.f });
+		matrix = glm::scale(matrix, scale);
+
+		// The kernels leave the magnitude of a uniform scale out of the normal matrix
+		normalMatrix = glm::transpose(glm::inverse(glm::mat3{ matrix }));
+		if (scale.x == scale.y && scale.y == scale.z) normalMatrix *= std::abs(scale.x);
+	}
+
+	float GetError(float expected, float actual)
+	{
+		return std::abs(expected - actual) / std::max(std::abs(expected), 1.f);
+	}
+
+	void ExpectMatricesMatchGlm(const ili::TransformBatch& batch)
+	{
+		ASSERT_EQ(batch.matrices.size(), batch.GetSize());
+		ASSERT_EQ(batch.normalMatrices.size(), batch.GetSize());
+
+		for (size_t i{}; i < batch.GetSize(); ++i)
+		{
+			glm::mat4 expected{};
+			glm::mat3 expectedNormal{};
+			ComputeGlmMatrices(batch, i, expected, expectedNormal);
+
+			for (int column{}; column < 4; ++column)
+			{
+				for (int row{}; row < 4; ++row)
+				{
+					EXPECT_LE(GetError(expected[column][row], batch.matrices[i][column][row]), MAX_ERROR)
+						<< "matrix " << i << " of " << batch.GetSize() << ", column " << column << ", row " << row;
+				}
+			}
+			for (int column{}; column < 3; ++column)
+			{
+				for (int row{}; row < 3; ++row)
+				{
+					EXPECT_LE(GetError(expectedNormal[column][row], batch.normalMatrices[i][column][row]), MAX_ERROR)
+						<< "normal matrix " << i << " of " << batch.GetSize() << ", column " << column << ", row " << row;
+				}
+			}
+		}
+	}
+}
+
+// Counts below, at and above the kernel widths (1, 4 and 8), most of them leave a partial last iteration
+TEST(TransformKernels, BatchMatchesGlm)
+{
+	for (const size_t count : { 1u, 2u, 3u, 4u, 5u, 7u, 8u, 9u, 13u, 16u, 31u, 67u, 1001u })
+	{
+		ili::TransformBatch batch = CreateBatch(count);
+		ili::ComputeTransformMatrices(batch);
+		ExpectMatricesMatchGlm(batch);
+	}
+}
+
+TEST(TransformKernels, MirroredBatchMatchesGlm)
+{
+	for (const size_t count : { 1u, 3u, 4u, 7u, 8u, 9u, 67u })
+	{
+		ili::TransformBatch batch = CreateBatch(count, true);
+		ili::ComputeTransformMatrices(batch);
+		ExpectMatricesMatchGlm(batch);
+	}
+}
+
+// Recomputing a batch that shrank must not leave matrices of the removed transforms behind
+TEST(TransformKernels, ShrunkBatchMatchesGlm)
+{
+	ili::TransformBatch batch = CreateBatch(21);
+	ili::ComputeTransformMatrices(batch);
+
+	const ili::TransformBatch smallerBatch = CreateBatch(6);
+	batch.Clear();
+	for (size_t i{}; i < smallerBatch.GetSize(); ++i)
+	{
+		batch.Add({ smallerBatch.positionX[i], smallerBatch.positionY[i], smallerBatch.positionZ[i] },
+			{ smallerBatch.rotationX[i], smallerBatch.rotationY[i], smallerBatch.rotationZ[i] },
+			{ smallerBatch.scaleX[i], smallerBatch.scaleY[i], smallerBatch.scaleZ[i] });
+	}
+	ili::ComputeTransformMatrices(batch);
+	ExpectMatricesMatchGlm(batch);
+}
+
+TEST(TransformKernels, SingleTransformMatchesGlm)
+{
+	ili::TransformBatch batch = CreateBatch(9);
+	batch.matrices.resize(batch.GetSize());
+	batch.normalMatrices.resize(batch.GetSize());
+
+	for (size_t i{}; i < batch.GetSize(); ++i)
+	{
+		ili::ComputeTransformMatrix({ batch.positionX[i], batch.positionY[i], batch.positionZ[i] },
+			{ batch.rotationX[i], batch.rotationY[i], batch.rotationZ[i] },
+			{ batch.scaleX[i], batch.scaleY[i], batch.scaleZ[i] },
+			batch.matrices[i], batch.normalMatrices[i]);
+	}
+	ExpectMatricesMatchGlm(batch);
+}